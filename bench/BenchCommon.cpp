@@ -0,0 +1,101 @@
+#include "BenchCommon.h"
+#include <QFile>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+
+namespace bench
+{
+
+qint64 residentBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return static_cast<qint64>(counters.WorkingSetSize);
+    return -1;
+#elif defined(Q_OS_LINUX)
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2)
+        return -1;
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+TrackEntry makeTrack(int index)
+{
+    const int album = index / 10;
+    const int artist = album / 8;
+    TrackEntry entry;
+    entry.id = QStringLiteral("tr-%1").arg(index);
+    entry.title = QStringLiteral("Track title number %1").arg(index);
+    entry.artist = QStringLiteral("Artist name %1").arg(artist);
+    entry.artistId = QStringLiteral("ar-%1").arg(artist);
+    entry.album = QStringLiteral("Album title %1").arg(album);
+    entry.albumId = QStringLiteral("al-%1").arg(album);
+    entry.coverArt = QStringLiteral("al-%1").arg(album);
+    entry.duration = 180 + index % 240;
+    entry.track = static_cast<qint16>(index % 10 + 1);
+    entry.year = static_cast<qint16>(1960 + album % 60);
+    entry.replayGainTrackGain = -7.5f;
+    entry.replayGainAlbumGain = -8.0f;
+    return entry;
+}
+
+AlbumEntry makeAlbum(int index)
+{
+    const int artist = index / 8;
+    AlbumEntry entry;
+    entry.id = QStringLiteral("al-%1").arg(index);
+    entry.name = QStringLiteral("Album title %1").arg(index);
+    entry.artist = QStringLiteral("Artist name %1").arg(artist);
+    entry.artistId = QStringLiteral("ar-%1").arg(artist);
+    entry.coverArt = QStringLiteral("al-%1").arg(index);
+    entry.created = QStringLiteral("2020-01-01T00:00:00.000Z");
+    entry.songCount = 10;
+    entry.duration = 2400;
+    entry.year = static_cast<qint16>(1960 + index % 60);
+    return entry;
+}
+
+ArtistEntry makeArtist(int index)
+{
+    ArtistEntry entry;
+    entry.id = QStringLiteral("ar-%1").arg(index);
+    entry.name = QStringLiteral("Artist name %1").arg(index);
+    entry.coverArt = QStringLiteral("ar-%1").arg(index);
+    entry.albumCount = 8;
+    return entry;
+}
+
+int intOption(const QStringList &args, const QString &name, int fallback)
+{
+    const int at = args.indexOf(name);
+    if (at < 0 || at + 1 >= args.size())
+        return fallback;
+    bool ok = false;
+    const int value = args.at(at + 1).toInt(&ok);
+    return ok ? value : fallback;
+}
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include "../src/core/LibraryTypes.h"
+
+// Helpers shared by the benchmark commands. Generated data is shaped like
+// a real library (ten tracks per album, eight albums per artist) and every
+// record gets fresh strings, as if it had just been parsed from a reply.
+namespace bench
+{
+// Resident set size of this process, or -1 where it cannot be read.
+qint64 residentBytes();
+double elapsedMs(const QElapsedTimer &timer);
+QTextStream &out();
+
+TrackEntry makeTrack(int index);
+AlbumEntry makeAlbum(int index);
+ArtistEntry makeArtist(int index);
+
+// Integer option "--name value", or fallback.
+int intOption(const QStringList &args, const QString &name, int fallback);
+}
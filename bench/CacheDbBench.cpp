@@ -0,0 +1,127 @@
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QVariantMap>
+#include "BenchCommon.h"
+#include "../src/core/CacheDatabase.h"
+
+// Writes N metadata rows (10k by default) the way saveMetadata() used to,
+// with SQLite's default journal, a statement prepared per write and one
+// implicit transaction each, and the way it does now, through
+// CacheDatabase's WAL connection, cached statements and write-behind
+// batches. Timed until the last row is committed.
+
+namespace
+{
+
+const char *CREATE_TABLE = R"(
+    CREATE TABLE IF NOT EXISTS metadata_cache (
+        type TEXT NOT NULL,
+        id TEXT NOT NULL,
+        data TEXT NOT NULL,
+        cached_at INTEGER NOT NULL,
+        last_access INTEGER NOT NULL DEFAULT 0,
+        PRIMARY KEY (type, id)
+    )
+)";
+
+const char *INSERT_ROW = R"(
+    INSERT OR REPLACE INTO metadata_cache (type, id, data, cached_at, last_access)
+    VALUES (?, ?, ?, ?, ?)
+)";
+
+QString rowJson(int index)
+{
+    const AlbumEntry album = bench::makeAlbum(index);
+    QVariantMap map;
+    map.insert(QStringLiteral("id"), album.id);
+    map.insert(QStringLiteral("name"), album.name);
+    map.insert(QStringLiteral("artist"), album.artist);
+    map.insert(QStringLiteral("artistId"), album.artistId);
+    map.insert(QStringLiteral("coverArt"), album.coverArt);
+    map.insert(QStringLiteral("songCount"), album.songCount);
+    map.insert(QStringLiteral("year"), album.year);
+    return QString::fromUtf8(QJsonDocument::fromVariant(map).toJson(QJsonDocument::Compact));
+}
+
+void bindRow(QSqlQuery &query, int index, const QString &json)
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    query.addBindValue(QStringLiteral("album"));
+    query.addBindValue(QStringLiteral("al-%1").arg(index));
+    query.addBindValue(json);
+    query.addBindValue(now);
+    query.addBindValue(now);
+}
+
+double writeUntuned(const QString &path, const QStringList &rows)
+{
+    double ms = 0;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("untuned"));
+        db.setDatabaseName(path);
+        if (!db.open())
+            return -1;
+        QSqlQuery(db).exec(QString::fromLatin1(CREATE_TABLE));
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < rows.size(); ++i) {
+            QSqlQuery query(db);
+            query.prepare(QString::fromLatin1(INSERT_ROW));
+            bindRow(query, i, rows.at(i));
+            query.exec();
+        }
+        ms = bench::elapsedMs(timer);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(QStringLiteral("untuned"));
+    return ms;
+}
+
+double writeTuned(const QString &path, const QStringList &rows)
+{
+    CacheDatabase database(path);
+    database.write([](QSqlDatabase &db) { QSqlQuery(db).exec(QString::fromLatin1(CREATE_TABLE)); }).waitForFinished();
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < rows.size(); ++i) {
+        const QString json = rows.at(i);
+        database.enqueue([i, json](QSqlDatabase &db) {
+            QSqlQuery &query = CacheDatabase::statement(db, INSERT_ROW);
+            bindRow(query, i, json);
+            query.exec();
+        });
+    }
+    // Ordered after every enqueued write.
+    database.write([](QSqlDatabase &) {}).waitForFinished();
+    return bench::elapsedMs(timer);
+}
+
+}
+
+int runCacheDbBench(const QStringList &args)
+{
+    const int count = bench::intOption(args, QStringLiteral("--rows"), 10000);
+    QTemporaryDir dir;
+    if (!dir.isValid())
+        return 1;
+
+    QStringList rows;
+    rows.reserve(count);
+    for (int i = 0; i < count; ++i)
+        rows.append(rowJson(i));
+
+    const double before = writeUntuned(dir.filePath(QStringLiteral("untuned.db")), rows);
+    const double after = writeTuned(dir.filePath(QStringLiteral("tuned.db")), rows);
+    bench::out() << "rows\tmode\tms\trows/s\n";
+    bench::out() << count << "\tper-write transaction\t" << QString::number(before, 'f', 1) << '\t'
+                 << qRound64(count / (before / 1000.0)) << '\n';
+    bench::out() << count << "\tWAL + write-behind\t" << QString::number(after, 'f', 1) << '\t'
+                 << qRound64(count / (after / 1000.0)) << '\n';
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <QCoreApplication>
+#include <QHash>
+#include <QProcess>
+#include <QVariantMap>
+#include "BenchCommon.h"
+#include "../src/core/LibraryCatalog.h"
+
+// Memory of a loaded library in three shapes:
+//   variant  - one QVariantMap per track, as QML and the queue used to hold them
+//   entries  - TrackEntry records with strings shared through a pool, the
+//              store before LibraryCatalog
+//   catalog  - LibraryCatalog
+// Each shape is built in a child process so allocator reuse does not skew
+// the resident-size deltas.
+
+namespace
+{
+
+QVariantMap toVariantMap(const TrackEntry &entry)
+{
+    QVariantMap map;
+    map.insert(QStringLiteral("id"), entry.id);
+    map.insert(QStringLiteral("title"), entry.title);
+    map.insert(QStringLiteral("artist"), entry.artist);
+    map.insert(QStringLiteral("artistId"), entry.artistId);
+    map.insert(QStringLiteral("album"), entry.album);
+    map.insert(QStringLiteral("albumId"), entry.albumId);
+    map.insert(QStringLiteral("coverArt"), entry.coverArt);
+    map.insert(QStringLiteral("duration"), entry.duration);
+    map.insert(QStringLiteral("track"), entry.track);
+    map.insert(QStringLiteral("year"), entry.year);
+    map.insert(QStringLiteral("replayGainTrackGain"), entry.replayGainTrackGain);
+    map.insert(QStringLiteral("replayGainAlbumGain"), entry.replayGainAlbumGain);
+    return map;
+}
+
+QString pooled(QHash<QString, QString> &pool, const QString &value)
+{
+    auto it = pool.constFind(value);
+    if (it == pool.constEnd())
+        it = pool.insert(value, value);
+    return it.value();
+}
+
+// Prints "<rss delta> <self-reported bytes or -1>".
+int runChild(const QString &shape, int count)
+{
+    const qint64 before = bench::residentBytes();
+    qint64 reported = -1;
+
+    QVariantList variants;
+    QHash<QString, QString> pool;
+    TrackList entries;
+    LibraryCatalog catalog;
+
+    if (shape == QLatin1String("variant")) {
+        variants.reserve(count);
+        for (int i = 0; i < count; ++i)
+            variants.append(toVariantMap(bench::makeTrack(i)));
+    } else if (shape == QLatin1String("entries")) {
+        entries.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            TrackEntry entry = bench::makeTrack(i);
+            entry.artist = pooled(pool, entry.artist);
+            entry.artistId = pooled(pool, entry.artistId);
+            entry.album = pooled(pool, entry.album);
+            entry.albumId = pooled(pool, entry.albumId);
+            entry.coverArt = pooled(pool, entry.coverArt);
+            entries.append(entry);
+        }
+    } else if (shape == QLatin1String("catalog")) {
+        for (int i = 0; i < count; ++i)
+            catalog.addTrack(bench::makeTrack(i));
+        reported = catalog.memoryUsage();
+    } else {
+        return 1;
+    }
+
+    const qint64 after = bench::residentBytes();
+    bench::out() << (before >= 0 && after >= 0 ? after - before : -1) << ' ' << reported << '\n';
+    return 0;
+}
+
+}
+
+int runCatalogBench(const QStringList &args)
+{
+    if (args.value(0) == QLatin1String("--child"))
+        return runChild(args.value(1), args.value(2).toInt());
+
+    const QList<int> counts = {10000, 100000, 500000};
+    const QStringList shapes = {QStringLiteral("variant"), QStringLiteral("entries"), QStringLiteral("catalog")};
+    bench::out() << "tracks\tshape\tRSS MiB\tbytes/track\treported MiB\n";
+    for (const int count : counts) {
+        for (const QString &shape : shapes) {
+            QProcess child;
+            child.start(QCoreApplication::applicationFilePath(),
+                        {QStringLiteral("catalog"), QStringLiteral("--child"), shape, QString::number(count)});
+            if (!child.waitForFinished(-1) || child.exitCode() != 0) {
+                bench::out() << count << '\t' << shape << "\tfailed\n";
+                continue;
+            }
+            const QList<QByteArray> fields = child.readAllStandardOutput().trimmed().split(' ');
+            const qint64 rss = fields.value(0).toLongLong();
+            const qint64 reported = fields.value(1).toLongLong();
+            bench::out() << count << '\t' << shape << '\t'
+                         << QString::number(rss / 1048576.0, 'f', 1) << '\t'
+                         << (rss >= 0 ? rss / count : -1) << '\t'
+                         << (reported >= 0 ? QString::number(reported / 1048576.0, 'f', 1) : QStringLiteral("-"))
+                         << '\n';
+            bench::out().flush();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <QRandomGenerator>
+#include <QVariantList>
+#include <QVariantMap>
+#include <algorithm>
+#include <random>
+#include "BenchCommon.h"
+#include "../src/playback/PlaybackQueue.h"
+
+// Shuffle, remove and insert on a queue of N tracks (10k by default), as
+// PlayerController used to do them on QVariantLists, finding tracks by
+// comparing ids entry by entry and reordering mpv one misplaced track at a
+// time, and as it does now on a PlaybackQueue with minimal move lists.
+// Each row is the average over the given number of operations.
+
+namespace
+{
+
+QVariantMap trackMap(int index)
+{
+    const TrackEntry track = bench::makeTrack(index);
+    QVariantMap map;
+    map.insert(QStringLiteral("id"), track.id);
+    map.insert(QStringLiteral("title"), track.title);
+    map.insert(QStringLiteral("artist"), track.artist);
+    map.insert(QStringLiteral("album"), track.album);
+    map.insert(QStringLiteral("albumId"), track.albumId);
+    map.insert(QStringLiteral("coverArt"), track.coverArt);
+    map.insert(QStringLiteral("duration"), track.duration);
+    return map;
+}
+
+QString idOf(const QVariant &track)
+{
+    return track.toMap().value(QStringLiteral("id")).toString();
+}
+
+int findById(const QVariantList &list, const QString &id)
+{
+    for (int i = 0; i < list.size(); ++i) {
+        if (idOf(list.at(i)) == id)
+            return i;
+    }
+    return -1;
+}
+
+// The old queue: the play order and, while shuffled, the queued order.
+struct ListQueue
+{
+    QVariantList queue;
+    QVariantList original;
+    int index = 0;
+
+    // Shuffles, keeps the current track first and counts the playlist-moves
+    // the old order sync issued to bring mpv in line.
+    int shuffle()
+    {
+        const QString currentId = idOf(queue.at(index));
+        QVariantList target = original;
+        std::shuffle(target.begin(), target.end(), std::mt19937(QRandomGenerator::global()->generate()));
+        target.move(findById(target, currentId), 0);
+        int moves = 0;
+        QVariantList mpv = queue;
+        for (int i = 0; i < target.size(); ++i) {
+            const int at = findById(mpv, idOf(target.at(i)));
+            if (at != i) {
+                mpv.insert(i, mpv.takeAt(at));
+                ++moves;
+            }
+        }
+        queue = target;
+        index = 0;
+        return moves;
+    }
+
+    void removeAt(int position)
+    {
+        const QString id = idOf(queue.at(position));
+        queue.removeAt(position);
+        const int at = findById(original, id);
+        if (at >= 0)
+            original.removeAt(at);
+        if (position < index)
+            --index;
+    }
+
+    void append(const QVariantMap &track)
+    {
+        const QString currentId = idOf(queue.at(index));
+        queue.append(track);
+        original.append(track);
+        index = findById(queue, currentId);
+    }
+};
+
+void row(const char *operation, const char *mode, int count, double ms, int extra = -1)
+{
+    bench::out() << operation << '\t' << mode << '\t' << QString::number(ms / count, 'f', 3);
+    if (extra >= 0)
+        bench::out() << '\t' << extra;
+    bench::out() << '\n';
+}
+
+}
+
+int runQueueBench(const QStringList &args)
+{
+    const int size = bench::intOption(args, QStringLiteral("--tracks"), 10000);
+    const int shuffles = bench::intOption(args, QStringLiteral("--shuffles"), 3);
+    const int edits = bench::intOption(args, QStringLiteral("--edits"), 1000);
+
+    QVariantList tracks;
+    tracks.reserve(size);
+    for (int i = 0; i < size; ++i)
+        tracks.append(trackMap(i));
+    QRandomGenerator random(42);
+
+    ListQueue list{tracks, tracks, size / 2};
+    TrackList entries;
+    entries.reserve(size);
+    for (int i = 0; i < size; ++i)
+        entries.append(bench::makeTrack(i));
+    PlaybackQueue queue;
+    queue.append(entries);
+    const PlaybackQueue::Handle current = queue.handleAt(size / 2);
+
+    bench::out() << size << " tracks\n";
+    bench::out() << "operation\tqueue\tms per op\tmpv moves\n";
+
+    QElapsedTimer timer;
+    timer.start();
+    int moves = 0;
+    for (int i = 0; i < shuffles; ++i)
+        moves += list.shuffle();
+    row("shuffle", "QVariantList", shuffles, bench::elapsedMs(timer), moves / shuffles);
+
+    timer.restart();
+    moves = 0;
+    for (int i = 0; i < shuffles; ++i) {
+        const QList<PlaybackQueue::Handle> before = queue.order();
+        queue.setShuffled(true, current);
+        moves += static_cast<int>(PlaybackQueue::minimalMoves(before, queue.order()).size());
+        queue.setShuffled(false);
+    }
+    row("shuffle", "PlaybackQueue", shuffles, bench::elapsedMs(timer), moves / shuffles);
+    queue.setShuffled(true, current);
+
+    timer.restart();
+    for (int i = 0; i < edits; ++i)
+        list.append(trackMap(size + i));
+    row("insert", "QVariantList", edits, bench::elapsedMs(timer));
+
+    timer.restart();
+    for (int i = 0; i < edits; ++i)
+        queue.append(TrackList{bench::makeTrack(size + i)}, queue.positionOf(current) + 1);
+    row("insert", "PlaybackQueue", edits, bench::elapsedMs(timer));
+
+    // Neither queue holds the current track among the removed ones.
+    timer.restart();
+    for (int i = 0; i < edits; ++i)
+        list.removeAt(list.index + 1 + random.bounded(list.queue.size() - list.index - 1));
+    row("remove", "QVariantList", edits, bench::elapsedMs(timer));
+
+    timer.restart();
+    for (int i = 0; i < edits; ++i) {
+        const int from = queue.positionOf(current) + 1;
+        queue.removeAt(from + random.bounded(queue.size() - from));
+    }
+    row("remove", "PlaybackQueue", edits, bench::elapsedMs(timer));
+    return 0;
+}
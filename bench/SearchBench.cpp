@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <vector>
+#include "BenchCommon.h"
+#include "../src/core/SearchIndex.h"
+
+// Search as you type over a mirrored library of N tracks (200k by
+// default): every query below is typed one character at a time and each
+// prefix is searched with the limits SubsonicClient uses. A keystroke is
+// within budget when its search takes under 5 ms.
+
+namespace
+{
+
+const double BUDGET_MS = 5.0;
+
+// Short prefixes match most of the library, which is the slow case.
+const char *QUERIES[] = {
+    "track title number 123",
+    "artist name 42",
+    "album title 1999 artist",
+    "umber 77",
+    "itle 5",
+    "no such thing",
+};
+
+SearchIndex buildIndex(int trackCount)
+{
+    SearchIndex::Builder builder;
+    const int albumCount = (trackCount + 9) / 10;
+    const int artistCount = (albumCount + 7) / 8;
+    for (int i = 0; i < artistCount; ++i) {
+        const ArtistEntry artist = bench::makeArtist(i);
+        builder.add(SearchIndex::Kind::Artist, artist.id, artist.name);
+    }
+    for (int i = 0; i < albumCount; ++i) {
+        const AlbumEntry album = bench::makeAlbum(i);
+        builder.add(SearchIndex::Kind::Album, album.id, album.name, album.artist);
+    }
+    for (int i = 0; i < trackCount; ++i) {
+        const TrackEntry track = bench::makeTrack(i);
+        builder.add(SearchIndex::Kind::Track, track.id, track.title, track.artist + QLatin1Char(' ') + track.album);
+    }
+    return builder.build();
+}
+
+}
+
+int runSearchBench(const QStringList &args)
+{
+    const int count = bench::intOption(args, QStringLiteral("--tracks"), 200000);
+
+    QElapsedTimer timer;
+    timer.start();
+    const SearchIndex index = buildIndex(count);
+    bench::out() << count << " tracks, " << index.size() << " documents indexed in "
+                 << QString::number(bench::elapsedMs(timer), 'f', 0) << " ms\n";
+    bench::out() << "query\tkeystrokes\tmedian ms\tmax ms\tover " << BUDGET_MS << " ms\n";
+
+    int over = 0;
+    for (const char *query : QUERIES) {
+        const QString text = QString::fromLatin1(query);
+        std::vector<double> times;
+        for (qsizetype length = 1; length <= text.size(); ++length) {
+            timer.restart();
+            index.search(text.left(length), 20, 40, 100);
+            times.push_back(bench::elapsedMs(timer));
+        }
+        std::vector<double> sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+        const auto slow = std::count_if(times.begin(), times.end(), [](double ms) { return ms >= BUDGET_MS; });
+        over += static_cast<int>(slow);
+        bench::out() << '"' << text << "\"\t" << times.size() << '\t'
+                     << QString::number(sorted[sorted.size() / 2], 'f', 2) << '\t'
+                     << QString::number(sorted.back(), 'f', 2) << '\t' << slow << '\n';
+    }
+    bench::out() << (over == 0 ? "every keystroke within budget\n" : "some keystrokes over budget\n");
+    return over == 0 ? 0 : 2;
+}
@@ -0,0 +1,112 @@
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include "BenchCommon.h"
+#include "../src/core/ListSnapshot.h"
+
+// Loads a cached album list (50k albums by default) the way it used to be
+// stored, as one JSON document parsed and converted in full, and as a
+// ListSnapshot, which is mapped and decoded a page at a time. Reports the
+// time until the first page could be shown and until every album is
+// decoded.
+
+namespace
+{
+
+const int FIRST_PAGE = 50;
+
+QByteArray encodeJson(const AlbumList &albums)
+{
+    QJsonArray array;
+    for (const AlbumEntry &album : albums) {
+        QJsonObject object;
+        object.insert(QStringLiteral("id"), album.id);
+        object.insert(QStringLiteral("name"), album.name);
+        object.insert(QStringLiteral("artist"), album.artist);
+        object.insert(QStringLiteral("artistId"), album.artistId);
+        object.insert(QStringLiteral("coverArt"), album.coverArt);
+        object.insert(QStringLiteral("songCount"), album.songCount);
+        object.insert(QStringLiteral("year"), album.year);
+        array.append(object);
+    }
+    return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
+
+AlbumList decodeJson(const QByteArray &json)
+{
+    const QVariantList list = QJsonDocument::fromJson(json).toVariant().toList();
+    AlbumList albums;
+    albums.reserve(list.size());
+    for (const QVariant &value : list) {
+        const QVariantMap map = value.toMap();
+        AlbumEntry album;
+        album.id = map.value(QStringLiteral("id")).toString();
+        album.name = map.value(QStringLiteral("name")).toString();
+        album.artist = map.value(QStringLiteral("artist")).toString();
+        album.artistId = map.value(QStringLiteral("artistId")).toString();
+        album.coverArt = map.value(QStringLiteral("coverArt")).toString();
+        album.songCount = map.value(QStringLiteral("songCount")).toInt();
+        album.year = static_cast<qint16>(map.value(QStringLiteral("year")).toInt());
+        albums.append(album);
+    }
+    return albums;
+}
+
+QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+void report(const char *format, qint64 bytes, double firstPage, double all, qsizetype decoded)
+{
+    bench::out() << format << '\t' << bytes / 1024 << '\t' << QString::number(firstPage, 'f', 2) << '\t'
+                 << QString::number(all, 'f', 2) << '\t' << decoded << '\n';
+}
+
+}
+
+int runSnapshotBench(const QStringList &args)
+{
+    const int count = bench::intOption(args, QStringLiteral("--albums"), 50000);
+    QTemporaryDir dir;
+    if (!dir.isValid())
+        return 1;
+
+    AlbumList albums;
+    albums.reserve(count);
+    for (int i = 0; i < count; ++i)
+        albums.append(bench::makeAlbum(i));
+    const QString jsonPath = dir.filePath(QStringLiteral("albums.json"));
+    const QString snapshotPath = dir.filePath(QStringLiteral("albums.snapshot"));
+    if (!writeFile(jsonPath, encodeJson(albums)) || !writeFile(snapshotPath, ListSnapshot::encode(albums)))
+        return 1;
+    albums = {};
+
+    bench::out() << count << " albums\n";
+    bench::out() << "format\tKiB\tfirst page ms\tall ms\tdecoded\n";
+
+    // JSON cannot show anything before the whole document is converted.
+    QElapsedTimer timer;
+    timer.start();
+    const AlbumList fromJson = decodeJson(readFile(jsonPath));
+    const double json = bench::elapsedMs(timer);
+    report("json", QFile(jsonPath).size(), json, json, fromJson.size());
+
+    timer.restart();
+    const ListSnapshot snapshot = ListSnapshot::open(snapshotPath);
+    const AlbumList page = snapshot.albums(0, FIRST_PAGE);
+    const double firstPage = bench::elapsedMs(timer);
+    const AlbumList rest = snapshot.albums(page.size());
+    const double all = bench::elapsedMs(timer);
+    report("snapshot", snapshot.byteSize(), firstPage, all, page.size() + rest.size());
+    return 0;
+}
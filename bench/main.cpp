@@ -0,0 +1,56 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include "BenchCommon.h"
+
+int runCatalogBench(const QStringList &args);
+int runCacheDbBench(const QStringList &args);
+int runSnapshotBench(const QStringList &args);
+int runSearchBench(const QStringList &args);
+int runQueueBench(const QStringList &args);
+
+namespace
+{
+
+struct Command
+{
+    const char *name;
+    const char *summary;
+    int (*run)(const QStringList &args);
+};
+
+const Command COMMANDS[] = {
+    {"catalog", "memory of the track store at 10k/100k/500k tracks", runCatalogBench},
+    {"cachedb", "writing 10k metadata rows, per-write transactions vs write-behind", runCacheDbBench},
+    {"snapshot", "loading a cached 50k-album list, JSON vs snapshot", runSnapshotBench},
+    {"search", "search as you type over 200k tracks, 5 ms per keystroke", runSearchBench},
+    {"queue", "shuffle, remove and insert on a 10k-track queue", runQueueBench},
+};
+
+int usage()
+{
+    bench::out() << "usage: shibamusic-bench <command> [options]\n";
+    for (const Command &command : COMMANDS)
+        bench::out() << "  " << command.name << "\t" << command.summary << "\n";
+    bench::out().flush();
+    return 1;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeFirst();
+    if (args.isEmpty())
+        return usage();
+    const QString name = args.takeFirst();
+    for (const Command &command : COMMANDS) {
+        if (name == QLatin1String(command.name)) {
+            const int result = command.run(args);
+            bench::out().flush();
+            return result;
+        }
+    }
+    return usage();
+}
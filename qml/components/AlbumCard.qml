@@ -145,13 +145,13 @@ Item {
             Connections {
                 target: api
                 function onTracksChanged() {
-                    if (hoverArea.pendingPlayAlbumId.length > 0 && api.tracks.length > 0) {
+                    if (hoverArea.pendingPlayAlbumId.length > 0 && api.tracksModel.count > 0) {
                         player.playCurrentTracks(0)
                         hoverArea.pendingPlayAlbumId = ""
                     }
-                    if (hoverArea.pendingQueueAlbumId.length > 0 && api.tracks.length > 0) {
-                        for (var i = 0; i < api.tracks.length; i++) {
-                            player.addToQueue(api.tracks[i])
+                    if (hoverArea.pendingQueueAlbumId.length > 0 && api.tracksModel.count > 0) {
+                        for (var i = 0; i < api.tracksModel.count; i++) {
+                            player.addToQueue(api.tracksModel.get(i))
                         }
                         hoverArea.pendingQueueAlbumId = ""
                     }
@@ -232,7 +232,7 @@ Item {
                 Connections {
                     target: api
                     function onTracksChanged() {
-                        if (playBtn.pendingAlbumId.length > 0 && api.tracks.length > 0) {
+                        if (playBtn.pendingAlbumId.length > 0 && api.tracksModel.count > 0) {
                             player.playCurrentTracks()
                             playBtn.pendingAlbumId = ""
                         }
@@ -17,7 +17,7 @@ Rectangle {
         GradientStop { position: 1.0; color: theme.surface }
     }
     signal queueRequested()
-    readonly property bool hasQueue: (player && player.queue) ? (player.queue.length > 0) : false
+    readonly property bool hasQueue: (player && player.queueModel) ? (player.queueModel.count > 0) : false
     readonly property bool hasTrack: (player && player.currentTrack) ? (!!player.currentTrack.id) : false
 
     RowLayout {
@@ -46,7 +46,7 @@ Rectangle {
                     id: coverImage
                     anchors.fill: parent
                     anchors.margins: 2
-                    source: bar.hasTrack ? api.coverArtUrl(player.currentTrack.coverArt, 256) : ""
+                    source: bar.hasTrack ? api.coverImageUrl(player.currentTrack.coverArt, 256) : ""
                     fillMode: Image.PreserveAspectCrop
                     asynchronous: true
                     smooth: true
@@ -15,8 +15,8 @@ Rectangle {
 
     readonly property var currentTrack: player && player.currentTrack ? player.currentTrack : null
     readonly property bool hasTrack: Boolean(currentTrack && currentTrack.id)
-    readonly property var queueData: player && player.queue ? player.queue : []
-    readonly property bool hasQueue: queueData && queueData.length > 0
+    readonly property var queueModel: player ? player.queueModel : null
+    readonly property bool hasQueue: queueModel !== null && queueModel.count > 0
 
     ColumnLayout {
         anchors.fill: parent
@@ -84,7 +84,7 @@ Rectangle {
                     Image {
                         id: coverImageNowPlaying
                         anchors.fill: parent
-                        source: panel.hasTrack ? api.coverArtUrl(panel.currentTrack.coverArt, 256) : ""
+                        source: panel.hasTrack ? api.coverImageUrl(panel.currentTrack.coverArt, 256) : ""
                         fillMode: Image.PreserveAspectCrop
                         asynchronous: true
                         cache: true
@@ -158,12 +158,12 @@ Rectangle {
                 id: queueList
                 spacing: theme.spacingMd
                 clip: true
-                model: panel.queueData
+                model: panel.queueModel
                 delegate: Rectangle {
                     width: queueList.width
                     height: 60
                     radius: theme.radiusButton
-                    property bool active: panel.hasTrack && modelData.id === panel.currentTrack.id
+                    property bool active: panel.hasTrack && model.id === panel.currentTrack.id
                     color: active ? (theme.isMica ? Qt.tint(theme.listItemActive, Qt.rgba(theme.accent.r, theme.accent.g, theme.accent.b, 0.18)) : theme.listItemActive)
                           : (theme.isMica ? Qt.rgba(theme.cardBackground.r, theme.cardBackground.g, theme.cardBackground.b, 0.9) : theme.cardBackground)
                     border.color: active ? theme.accent : theme.cardBorder
@@ -182,7 +182,7 @@ Rectangle {
                             Image {
                                 id: coverImageQueue
                                 anchors.fill: parent
-                                source: api.coverArtUrl(modelData.coverArt, 128)
+                                source: api.coverImageUrl(model.coverArt, 128)
                                 fillMode: Image.PreserveAspectCrop
                                 asynchronous: true
                                 cache: true
@@ -203,14 +203,14 @@ Rectangle {
                             spacing: theme.spacingXs / 2
                             Label {
                                 Layout.fillWidth: true
-                                text: modelData.title
+                                text: model.title
                                 font.pixelSize: theme.fontSizeSmall
                                 elide: Label.ElideRight
                                 color: theme.textPrimary
                             }
                             Label {
                                 Layout.fillWidth: true
-                                text: modelData.artist
+                                text: model.artist
                                 color: theme.textSecondary
                                 font.pixelSize: theme.fontSizeExtraSmall
                                 elide: Label.ElideRight
@@ -84,7 +84,7 @@ Drawer {
                             
                             Image {
                                 anchors.fill: parent
-                                source: api.coverArtUrl(modelData.coverArt, 128)
+                                source: api.coverImageUrl(modelData.coverArt, 128)
                                 fillMode: Image.PreserveAspectCrop
                                 asynchronous: true
                             }
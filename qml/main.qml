@@ -819,7 +819,7 @@ ApplicationWindow {
                     Layout.leftMargin: theme.paddingPage
                 }
                 Label {
-                    visible: !player.queue || player.queue.length === 0
+                    visible: !player.queueModel || player.queueModel.count === 0
                     text: qsTr("No tracks in queue. Add songs using the + button.")
                     color: theme.textSecondary
                     font.pixelSize: theme.fontSizeBody
@@ -829,7 +829,7 @@ ApplicationWindow {
                     Layout.fillHeight: true
                     clip: true
                     spacing: theme.spacingMd + theme.spacingXs / 2
-                    model: player && player.queue ? player.queue : []
+                    model: player ? player.queueModel : null
                     delegate: Rectangle {
                         width: parent.width
                         height: theme.queueItemHeight
@@ -857,15 +857,15 @@ ApplicationWindow {
                                 
                                 Image {
                                     anchors.fill: parent
-                                    source: modelData.coverArt ? api.coverArtUrl(modelData.coverArt, 128) : ""
+                                    source: model.coverArt ? api.coverImageUrl(model.coverArt, 128) : ""
                                     fillMode: Image.PreserveAspectCrop
                                     asynchronous: true
-                                    visible: modelData.coverArt && status !== Image.Error
+                                    visible: model.coverArt && status !== Image.Error
                                 }
                                 
                                 Image {
                                     anchors.centerIn: parent
-                                    visible: !modelData.coverArt
+                                    visible: !model.coverArt
                                     source: "qrc:/qml/icons/music_note.svg"
                                     sourceSize.width: theme.iconSizeMedium
                                     sourceSize.height: theme.iconSizeMedium
@@ -879,7 +879,7 @@ ApplicationWindow {
                                 
                                 Label {
                                     Layout.fillWidth: true
-                                    text: modelData.title || qsTr("Faixa desconhecida")
+                                    text: model.title || qsTr("Faixa desconhecida")
                                     font.pixelSize: theme.fontSizeBody
                                     font.weight: Font.Medium
                                     color: theme.textPrimary
@@ -888,7 +888,7 @@ ApplicationWindow {
                                 
                                 Label {
                                     Layout.fillWidth: true
-                                    text: modelData.artist || "-"
+                                    text: model.artist || "-"
                                     color: theme.textSecondary
                                     font.pixelSize: theme.fontSizeCaption
                                     elide: Label.ElideRight
@@ -946,8 +946,8 @@ ApplicationWindow {
             }
         }
         function onArtistsChanged() {
-            if (!win.initialLibraryLoaded && api.artists.length > 0) {
-                api.fetchArtist(api.artists[0].id)
+            if (!win.initialLibraryLoaded && api.artistsModel.count > 0) {
+                api.fetchArtist(api.artistsModel.get(0).id)
             }
         }
         function onAlbumsChanged() {
@@ -1235,17 +1235,17 @@ ApplicationWindow {
     // Media control shortcuts
     Shortcut {
         sequence: "Space"
-        onActivated: if (player && player.queue.length > 0) player.toggle()
+        onActivated: if (player && player.queueModel.count > 0) player.toggle()
     }
     
     Shortcut {
         sequence: "Shift+N"
-        onActivated: if (player && player.queue.length > 0) player.next()
+        onActivated: if (player && player.queueModel.count > 0) player.next()
     }
     
     Shortcut {
         sequence: "Shift+P"
-        onActivated: if (player && player.queue.length > 0) player.previous()
+        onActivated: if (player && player.queueModel.count > 0) player.previous()
     }
     
     Shortcut {
@@ -1389,6 +1389,12 @@ ApplicationWindow {
             windowStateSaveTimer.restart()
     }
 
+    Binding {
+        target: player
+        property: "windowVisible"
+        value: win.visible && win.visibility !== Window.Minimized && win.visibility !== Window.Hidden
+    }
+
     onVisibilityChanged: function(newVisibility) {
         captureWindowedGeometry()
         if (!windowStateRestored)
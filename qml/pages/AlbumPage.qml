@@ -16,8 +16,8 @@ Page {
     function requestArtistPage() {
         var id = artistId
         var name = artistName
-        if (api && api.tracks && (!id || id.length === 0) && api.tracks.length > 0) {
-            var first = api.tracks[0]
+        if (api && (!id || id.length === 0) && api.tracksModel.count > 0) {
+            var first = api.tracksModel.get(0)
             if (first && first.albumId === albumId) {
                 id = first.artistId || id
                 if (!name || name.length === 0)
@@ -33,9 +33,9 @@ Page {
     }
 
     function refreshArtistMetadata() {
-        if (!api || !api.tracks || api.tracks.length === 0)
+        if (!api || api.tracksModel.count === 0)
             return
-        var firstTrack = api.tracks[0]
+        var firstTrack = api.tracksModel.get(0)
         if (!firstTrack || firstTrack.albumId !== albumId)
             return
         if (!artistId || artistId.length === 0)
@@ -109,7 +109,7 @@ Page {
                 Image {
                     id: bgImage
                     anchors.fill: parent
-                    source: (api && coverArtId) ? api.coverArtUrl(coverArtId, 600) : ""
+                    source: (api && coverArtId) ? api.coverImageUrl(coverArtId, 600) : ""
                     fillMode: Image.PreserveAspectCrop
                     asynchronous: true
                     visible: false
@@ -148,7 +148,7 @@ Page {
                         clip: true
                         Image {
                             anchors.fill: parent
-                            source: api.coverArtUrl(coverArtId, 512)
+                            source: api.coverImageUrl(coverArtId, 512)
                             fillMode: Image.PreserveAspectCrop
                             asynchronous: true
                             visible: !!coverArtId && status !== Image.Error
@@ -175,7 +175,7 @@ Page {
                         Item {
                             id: artistLink
                             property bool hovered: false
-                            property bool enabled: (!!artistId && artistId.length > 0) || (api.tracks.length > 0 && api.tracks[0].albumId === albumId)
+                            property bool enabled: (!!artistId && artistId.length > 0) || (api.tracksModel.count > 0 && api.tracksModel.get(0).albumId === albumId)
                             Layout.alignment: Qt.AlignLeft
                             Layout.preferredWidth: artistText.implicitWidth
                             Layout.preferredHeight: artistText.implicitHeight
@@ -202,19 +202,19 @@ Page {
                             ToolButton {
                                 text: qsTr("Play")
                                 icon.source: "qrc:/qml/icons/play_arrow.svg"
-                                enabled: api.tracks.length > 0
+                                enabled: api.tracksModel.count > 0
                                 onClicked: {
-                                    if (api.tracks.length > 0)
+                                    if (api.tracksModel.count > 0)
                                         player.playCurrentTracks();
                                 }
                             }
                             ToolButton {
                                 text: qsTr("Queue")
                                 icon.source: "qrc:/qml/icons/add.svg"
-                                enabled: api.tracks.length > 0
+                                enabled: api.tracksModel.count > 0
                                 onClicked: {
-                                    for (var i = 0; i < api.tracks.length; ++i)
-                                        player.addToQueue(api.tracks[i])
+                                    for (var i = 0; i < api.tracksModel.count; ++i)
+                                        player.addToQueue(api.tracksModel.get(i))
                                 }
                             }
                             ToolButton {
@@ -229,7 +229,7 @@ Page {
                                     MenuItem {
                                         text: qsTr("Shuffle Play")
                                         icon.source: "qrc:/qml/icons/shuffle.svg"
-                                        enabled: api.tracks.length > 0
+                                        enabled: api.tracksModel.count > 0
                                         onTriggered: {
                                             var shuffled = api.tracks.slice()
                                             for (var i = shuffled.length - 1; i > 0; i--) {
@@ -247,16 +247,16 @@ Page {
                                     MenuItem {
                                         text: qsTr("Add to Playlist")
                                         icon.source: "qrc:/qml/icons/add.svg"
-                                        enabled: api.tracks.length > 0
+                                        enabled: api.tracksModel.count > 0
                                         onTriggered: { /* TODO: Implement add to playlist */ }
                                     }
                                     MenuItem {
                                         text: qsTr("Add to Favorites")
                                         icon.source: "qrc:/qml/icons/favorite_border.svg"
-                                        enabled: api.tracks.length > 0
+                                        enabled: api.tracksModel.count > 0
                                         onTriggered: {
-                                            for (var i = 0; i < api.tracks.length; i++) {
-                                                api.star(api.tracks[i].id, "song")
+                                            for (var i = 0; i < api.tracksModel.count; i++) {
+                                                api.star(api.tracksModel.get(i).id, "song")
                                             }
                                         }
                                     }
@@ -264,7 +264,7 @@ Page {
                                     MenuItem {
                                         text: qsTr("Go to Artist")
                                         icon.source: "qrc:/qml/icons/mic.svg"
-                                        enabled: artistName.length > 0 && api.tracks.length > 0
+                                        enabled: artistName.length > 0 && api.tracksModel.count > 0
                                         onTriggered: requestArtistPage()
                                     }
                                     MenuItem {
@@ -282,14 +282,14 @@ Page {
                         Components.SectionHeader {
                 width: contentCol.width - contentCol.padding * 2
                 title: qsTr("Tracks")
-                subtitle: (api && api.tracks && api.tracks.length > 0)
-                          ? qsTr("%1 músicas").arg(api.tracks.length)
+                subtitle: (api && api.tracksModel.count > 0)
+                          ? qsTr("%1 músicas").arg(api.tracksModel.count)
                           : qsTr("Álbum vazio")
             }
 
                         Loader {
                 width: contentCol.width - contentCol.padding * 2
-                sourceComponent: (api && api.tracks && api.tracks.length > 0) ? trackList : emptyTracks
+                sourceComponent: (api && api.tracksModel.count > 0) ? trackList : emptyTracks
             }
         }
     }
@@ -300,16 +300,16 @@ Page {
             width: parent.width
             spacing: theme.spacingLg
             Repeater {
-                model: (api && api.tracks) ? api.tracks : []
+                model: api ? api.tracksModel : null
                 delegate: Components.TrackRow {
                     index: index
                     width: parent.width
-                    title: (modelData.track > 0 ? modelData.track + ". " : "") + modelData.title
-                    subtitle: modelData.artist
-                    duration: modelData.duration
-                    cover: (api && modelData.coverArt) ? api.coverArtUrl(modelData.coverArt, 128) : ""
-                    onPlayClicked: { if (player) player.playTrack(modelData, index) }
-                    onQueueClicked: { if (player) player.addToQueue(modelData) }
+                    title: (model.track > 0 ? model.track + ". " : "") + model.title
+                    subtitle: model.artist
+                    duration: model.duration
+                    cover: (api && model.coverArt) ? api.coverImageUrl(model.coverArt, 128) : ""
+                    onPlayClicked: { if (player) player.playTrack(api.tracksModel.get(index), index) }
+                    onQueueClicked: { if (player) player.addToQueue(api.tracksModel.get(index)) }
                 }
             }
         }
@@ -368,7 +368,7 @@ Page {
                 font.family: theme.fontFamily
             }
             Label {
-                text: qsTr("<b>Faixas:</b> %1").arg(api && api.tracks ? api.tracks.length : 0)
+                text: qsTr("<b>Faixas:</b> %1").arg(api ? api.tracksModel.count : 0)
                 Layout.fillWidth: true
                 font.family: theme.fontFamily
             }
@@ -10,26 +10,56 @@ Page {
 
     background: Rectangle { color: "transparent" }
 
+    // Server order (by name) is shown windowed: only pages near the
+    // viewport are loaded. Other orders sort a fully loaded list locally.
+    readonly property bool windowed: sortCombo.currentIndex === 0
+
+    function loadAlbums() {
+        if (!api)
+            return
+        if (windowed) {
+            if (api.pagedAlbumModel && api.pagedAlbumModel.count === 0)
+                api.openPagedAlbumList("alphabeticalByName")
+        } else if (api.albumListModel && api.albumListModel.count === 0) {
+            api.fetchAlbumList("alphabeticalByName")
+        }
+    }
+
     Component.onCompleted: {
         try {
-            if (api && api.fetchAlbumList)
-                api.fetchAlbumList("alphabeticalByName");
+            loadAlbums()
         } catch (e) {
             console.error("AlbumsPage initialization error:", e)
         }
     }
 
+    onWindowedChanged: loadAlbums()
+
     ColumnLayout {
         anchors.fill: parent
         anchors.margins: theme.paddingPage
         spacing: theme.spacing2xl
 
-        Label {
-            text: qsTr("Albums")
-            font.pixelSize: theme.fontSizeDisplay
-            font.weight: Font.DemiBold
-            color: theme.textPrimary
-            Layout.leftMargin: 0
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: theme.spacingXl
+
+            Label {
+                text: qsTr("Albums")
+                font.pixelSize: theme.fontSizeDisplay
+                font.weight: Font.DemiBold
+                color: theme.textPrimary
+                Layout.leftMargin: 0
+                Layout.fillWidth: true
+            }
+
+            ComboBox {
+                id: sortCombo
+                // Indexes follow AlbumListModel::SortOrder
+                model: [qsTr("Name"), qsTr("Artist"), qsTr("Year"), qsTr("Recently Added")]
+                currentIndex: api && api.albumListModel ? api.albumListModel.sortOrder : 0
+                onActivated: if (api && api.albumListModel) api.albumListModel.sortOrder = currentIndex
+            }
         }
 
         GridView {
@@ -46,7 +76,7 @@ Page {
             displayMarginBeginning: 1000
             displayMarginEnd: 1000
             reuseItems: false
-            model: (api && api.albumList) ? api.albumList : []
+            model: api ? (albumsPage.windowed ? api.pagedAlbumModel : api.albumListModel) : null
             
             ScrollBar.vertical: Components.ScrollBar {
                 theme.manager: themeManager
@@ -61,19 +91,20 @@ Page {
                     anchors.fill: parent
                     anchors.margins: theme.spacingLg
                     visible: true
-                    title: (modelData && modelData.name) ? modelData.name : qsTr("Álbum Desconhecido")
-                    subtitle: (modelData && modelData.artist) ? modelData.artist : "Artista desconhecido"
-                    cover: (modelData && modelData.coverArt && api) ? api.coverArtUrl(modelData.coverArt, 256) : ""
-                    albumId: (modelData && modelData.id) ? modelData.id : ""
-                    artistId: (modelData && modelData.artistId) ? modelData.artistId : ""
+                    // Rows of a page that is still loading have no id yet.
+                    title: (model && model.name) ? model.name : ((model && model.id) ? qsTr("Álbum Desconhecido") : "")
+                    subtitle: (model && model.artist) ? model.artist : ((model && model.id) ? "Artista desconhecido" : "")
+                    cover: (model && model.coverArt && api) ? api.coverImageUrl(model.coverArt, 256) : ""
+                    albumId: (model && model.id) ? model.id : ""
+                    artistId: (model && model.artistId) ? model.artistId : ""
                     onClicked: {
-                        if (albumsPage && modelData && modelData.id)
+                        if (albumsPage && model && model.id)
                             albumsPage.albumClicked(
-                                modelData.id, 
-                                modelData.name || "", 
-                                modelData.artist || "", 
-                                modelData.coverArt || "", 
-                                modelData.artistId || ""
+                                model.id, 
+                                model.name || "", 
+                                model.artist || "", 
+                                model.coverArt || "", 
+                                model.artistId || ""
                             )
                     }
                 }
@@ -82,8 +113,23 @@ Page {
             property bool initialLoadComplete: false
             property real savedContentY: 0
             
+            function reportViewport() {
+                if (!api || !api.pagedAlbumModel || count === 0 || !width || !height)
+                    return
+                var columns = Math.max(1, Math.floor(width / cellWidth))
+                var first = indexAt(cellWidth / 2, contentY + 1)
+                var last = indexAt(columns * cellWidth - cellWidth / 2, contentY + height - 1)
+                if (first < 0)
+                    first = 0
+                if (last < 0)
+                    last = count - 1
+                api.pagedAlbumModel.setViewport(first, last)
+            }
+
             function maybeFetchMore() {
                 try {
+                    if (albumsPage.windowed)
+                        return;
                     if (!api || !api.albumListHasMore || api.albumListLoading)
                         return;
                     if (!contentHeight || !height) return;
@@ -98,10 +144,19 @@ Page {
                 }
             }
 
-            onContentYChanged: { if (gridView) maybeFetchMore() }
+            onContentYChanged: {
+                if (!gridView)
+                    return
+                if (albumsPage.windowed)
+                    reportViewport()
+                else
+                    maybeFetchMore()
+            }
+            onHeightChanged: if (albumsPage.windowed) reportViewport()
+            onWidthChanged: if (albumsPage.windowed) reportViewport()
             
             onContentHeightChanged: {
-                if (gridView && initialLoadComplete && savedContentY > 0) {
+                if (gridView && !albumsPage.windowed && initialLoadComplete && savedContentY > 0) {
                     contentY = savedContentY
                 }
             }
@@ -109,7 +164,9 @@ Page {
             onCountChanged: {
                 if (gridView && count > 0) {
                     initialLoadComplete = true
-                    if (savedContentY > 0) {
+                    if (albumsPage.windowed)
+                        reportViewport()
+                    else if (savedContentY > 0) {
                         contentY = savedContentY
                     }
                 }
@@ -117,7 +174,7 @@ Page {
 
             footer: Item {
                 width: gridView.width
-                height: (api && api.albumListLoading) ? 56 : 0
+                height: (!albumsPage.windowed && api && api.albumListLoading) ? 56 : 0
                 BusyIndicator {
                     anchors.centerIn: parent
                     running: api && api.albumListLoading
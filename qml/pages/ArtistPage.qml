@@ -13,6 +13,7 @@ Page {
     property string artistName: ""
     property string coverArtId: ""
     property string pendingRandomAlbumId: ""
+    property bool playAllPending: false
 
     background: Rectangle { color: "transparent" }
 
@@ -24,6 +25,7 @@ Page {
     StackView.onStatusChanged: {
         if (StackView.status === StackView.Deactivating) {
             pendingRandomAlbumId = ""
+            playAllPending = false
         }
     }
 
@@ -48,20 +50,35 @@ Page {
                 return
             if (!artistPage.pendingRandomAlbumId.length)
                 return
-            if (!api.tracks || api.tracks.length === 0)
+            if (api.tracksModel.count === 0)
                 return
-            var first = api.tracks[0]
+            var first = api.tracksModel.get(0)
             if (!first || !first.albumId)
                 return
             var fetchedAlbumId = String(first.albumId)
             if (fetchedAlbumId !== artistPage.pendingRandomAlbumId)
                 return
-            var index = Math.floor(Math.random() * api.tracks.length)
-            var track = api.tracks[index]
+            var index = Math.floor(Math.random() * api.tracksModel.count)
+            var track = api.tracksModel.get(index)
             artistPage.pendingRandomAlbumId = ""
             if (track)
                 player.playTrack(track)
         }
+        // Play All: start with the first album, queue the rest in order.
+        function onAlbumTracksAppended(firstRow, count) {
+            if (!artistPage.playAllPending)
+                return
+            var tracks = []
+            for (var i = firstRow; i < firstRow + count; ++i)
+                tracks.push(api.tracksModel.get(i))
+            if (firstRow === 0)
+                player.playAlbum(tracks, 0)
+            else
+                player.appendToQueue(tracks)
+        }
+        function onAlbumBatchFinished() {
+            artistPage.playAllPending = false
+        }
     }
 
     Flickable {
@@ -104,7 +121,7 @@ Page {
                 Image {
                     id: bgImage
                     anchors.fill: parent
-                    source: (api && coverArtId) ? api.coverArtUrl(coverArtId, 600) : ""
+                    source: (api && coverArtId) ? api.coverImageUrl(coverArtId, 600) : ""
                     fillMode: Image.PreserveAspectCrop
                     asynchronous: true
                     visible: false
@@ -143,7 +160,7 @@ Page {
                         clip: true
                         Image {
                             anchors.fill: parent
-                            source: (api && coverArtId) ? api.coverArtUrl(coverArtId, 512) : ""
+                            source: (api && coverArtId) ? api.coverImageUrl(coverArtId, 512) : ""
                             fillMode: Image.PreserveAspectCrop
                             asynchronous: true
                             visible: !!coverArtId && status !== Image.Error
@@ -176,6 +193,23 @@ Page {
                         }
                           Row {
                             spacing: theme.spacingLg
+                            ToolButton {
+                                text: qsTr("Play All")
+                                icon.source: "qrc:/qml/icons/play_arrow.svg"
+                                enabled: api && api.albums && api.albums.length > 0
+                                onClicked: {
+                                    if (!api || !api.albums || api.albums.length === 0)
+                                        return
+                                    var ids = []
+                                    for (var i = 0; i < api.albums.length; ++i) {
+                                        if (api.albums[i] && api.albums[i].id)
+                                            ids.push(String(api.albums[i].id))
+                                    }
+                                    artistPage.pendingRandomAlbumId = ""
+                                    artistPage.playAllPending = true
+                                    api.fetchAlbumsTracks(ids)
+                                }
+                            }
                             ToolButton {
                                 text: qsTr("Shuffle")
                                 icon.source: "qrc:/qml/icons/shuffle.svg"
@@ -187,6 +221,7 @@ Page {
                                     var album = api.albums[idx]
                                     if (!album || !album.id)
                                         return
+                                    artistPage.playAllPending = false
                                     artistPage.pendingRandomAlbumId = String(album.id)
                                     api.clearTracks()
                                     api.fetchAlbum(album.id)
@@ -228,7 +263,7 @@ Page {
                     height: 250
                     title: modelData.name
                     subtitle: modelData.year > 0 ? modelData.year : ""
-                    cover: (api && modelData.coverArt) ? api.coverArtUrl(modelData.coverArt, 300) : ""
+                    cover: (api && modelData.coverArt) ? api.coverImageUrl(modelData.coverArt, 300) : ""
                     albumId: modelData.id
                     artistId: modelData.artistId || artistPage.artistId
                     onClicked: artistPage.albumClicked(modelData.id, modelData.name, modelData.artist || artistPage.artistName, modelData.coverArt, modelData.artistId || artistPage.artistId)
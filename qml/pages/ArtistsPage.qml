@@ -33,11 +33,11 @@ Page {
             cellHeight: 244
             flickDeceleration: 1200
             maximumFlickVelocity: 2500
-            model: (api && api.artists) ? api.artists : []
+            model: api ? api.artistsModel : null
             delegate: Components.ArtistCard {
-                name: modelData.name || qsTr("Artista desconhecido")
-                cover: (modelData.coverArt && api) ? api.coverArtUrl(modelData.coverArt, 256) : ""
-                onClicked: artistsPage.artistClicked(modelData.id, modelData.name, modelData.coverArt)
+                name: model.name || qsTr("Artista desconhecido")
+                cover: (model.coverArt && api) ? api.coverImageUrl(model.coverArt, 256) : ""
+                onClicked: artistsPage.artistClicked(model.id, model.name, model.coverArt)
             }
             
             ScrollBar.vertical: Components.ScrollBar {
@@ -7,6 +7,8 @@ Page {
     Components.ThemePalette { id: theme }
     id: cacheSettingsPage
     
+    Component.onCompleted: if (cacheManager) cacheManager.refreshStats()
+    
     background: Rectangle {
         color: "transparent"
     }
@@ -61,7 +63,7 @@ Page {
                         }
                         Label {
                             id: cacheSizeLabel
-                            text: formatBytes(cacheManager ? cacheManager.getCacheSize() : 0)
+                            text: formatBytes(cacheManager ? cacheManager.cacheSize : 0)
                             color: theme.textPrimary
                             font.weight: Font.Medium
                         }
@@ -72,23 +74,94 @@ Page {
                         }
                         Label {
                             id: imageCountLabel
-                            text: cacheManager ? cacheManager.getImageCount() : "0"
+                            text: cacheManager ? cacheManager.imageCount : "0"
                             color: theme.textPrimary
                             font.weight: Font.Medium
                         }
+
+                        Label {
+                            text: qsTr("Size Limit:")
+                            color: theme.textSecondary
+                        }
+                        ComboBox {
+                            id: cacheLimitCombo
+                            readonly property var limits: [256, 512, 1024, 2048, 5120].map(mb => mb * 1024 * 1024)
+                            model: limits.map(bytes => formatBytes(bytes))
+                            currentIndex: {
+                                if (!cacheManager)
+                                    return -1
+                                // Closest preset to the stored value
+                                var best = 0
+                                for (var i = 1; i < limits.length; ++i) {
+                                    if (Math.abs(limits[i] - cacheManager.cacheLimit) < Math.abs(limits[best] - cacheManager.cacheLimit))
+                                        best = i
+                                }
+                                return best
+                            }
+                            onActivated: if (cacheManager) cacheManager.cacheLimit = limits[currentIndex]
+                        }
                     }
                     
                     Button {
                         text: qsTr("Refresh Stats")
                         Layout.preferredWidth: 150
-                        onClicked: {
-                            cacheSizeLabel.text = formatBytes(cacheManager.getCacheSize())
-                            imageCountLabel.text = cacheManager.getImageCount()
-                        }
+                        onClicked: cacheManager.refreshStats()
                     }
                 }
             }
             
+            // Offline Library
+            Rectangle {
+                Layout.fillWidth: true
+                Layout.preferredHeight: libraryColumn.implicitHeight + theme.spacing4xl
+                radius: theme.radiusCard
+                color: theme.cardBackground
+                border.color: theme.cardBorder
+                border.width: 1
+
+                ColumnLayout {
+                    id: libraryColumn
+                    anchors.fill: parent
+                    anchors.margins: theme.paddingCard
+                    spacing: theme.spacingLg
+
+                    Label {
+                        text: qsTr("Offline Library")
+                        font.pixelSize: theme.fontSizeSection
+                        font.weight: Font.DemiBold
+                        color: theme.textPrimary
+                    }
+
+                    Switch {
+                        text: qsTr("Keep a local copy of the library")
+                        checked: librarySync ? librarySync.enabled : false
+                        onToggled: if (librarySync) librarySync.enabled = checked
+                    }
+
+                    Label {
+                        Layout.fillWidth: true
+                        wrapMode: Text.WordWrap
+                        color: theme.textSecondary
+                        text: {
+                            if (!librarySync || !librarySync.enabled)
+                                return qsTr("Artists, albums and playlists are loaded from the server.")
+                            if (librarySync.running)
+                                return librarySync.pendingAlbums > 0
+                                        ? qsTr("Syncing: %1 albums updated, %2 remaining").arg(librarySync.syncedAlbums).arg(librarySync.pendingAlbums)
+                                        : qsTr("Checking for changes...")
+                            return librarySync.ready ? qsTr("Up to date") : qsTr("Not synced yet")
+                        }
+                    }
+
+                    Button {
+                        text: qsTr("Sync Now")
+                        Layout.preferredWidth: 150
+                        enabled: librarySync && librarySync.enabled && !librarySync.running
+                        onClicked: librarySync.syncNow()
+                    }
+                }
+            }
+
             // Cache Management Actions
             Rectangle {
                 Layout.fillWidth: true
@@ -116,8 +189,6 @@ Page {
                         Layout.fillWidth: true
                         onClicked: {
                             cacheManager.clearImageCache(30)
-                            cacheSizeLabel.text = formatBytes(cacheManager.getCacheSize())
-                            imageCountLabel.text = cacheManager.getImageCount()
                         }
                     }
                     
@@ -173,8 +244,6 @@ Page {
         
         onAccepted: {
             cacheManager.clearAllCache()
-            cacheSizeLabel.text = formatBytes(0)
-            imageCountLabel.text = "0"
         }
     }
     
@@ -32,15 +32,15 @@ Page {
             spacing: theme.spacingLg
             flickDeceleration: 1200
             maximumFlickVelocity: 2500
-            model: api.favorites
+            model: api.favoritesModel
             delegate: Components.TrackRow {
                 width: listView.width
-                title: modelData.title
-                subtitle: modelData.artist
-                duration: modelData.duration
-                cover: api.coverArtUrl(modelData.coverArt, 128)
-                onPlayClicked: player.playTrack(modelData)
-                onQueueClicked: player.addToQueue(modelData)
+                title: model.title
+                subtitle: model.artist
+                duration: model.duration
+                cover: api.coverImageUrl(model.coverArt, 128)
+                onPlayClicked: player.playTrack(api.favoritesModel.get(index))
+                onQueueClicked: player.addToQueue(api.favoritesModel.get(index))
             }
             
             MouseArea {
@@ -169,7 +169,7 @@ Page {
                                         delegate: Components.ArtistCard {
                                             name: modelData.name || qsTr("Artista Desconhecido")
                                             albumCount: modelData.albumCount || 0
-                                            cover: modelData.coverArt ? api.coverArtUrl(modelData.coverArt, 256) : ""
+                                            cover: modelData.coverArt ? api.coverImageUrl(modelData.coverArt, 256) : ""
                                             artistId: modelData.id
                                             onClicked: homePage.artistClicked(modelData.id, modelData.name, modelData.coverArt)
                                         }
@@ -229,7 +229,7 @@ Page {
                                         delegate: Components.AlbumCard {
                                             title: modelData.name || qsTr("Álbum Desconhecido")
                                             subtitle: modelData.artist || "Artista desconhecido"
-                                            cover: modelData.coverArt ? api.coverArtUrl(modelData.coverArt, 256) : ""
+                                            cover: modelData.coverArt ? api.coverImageUrl(modelData.coverArt, 256) : ""
                                             albumId: modelData.id
                                             artistId: modelData.artistId || ""
                                             onClicked: homePage.albumClicked(modelData.id, modelData.name, modelData.artist, modelData.coverArt, modelData.artistId || "")
@@ -320,7 +320,7 @@ Page {
             Loader {
                 visible: !searchActive
                 width: column.width - column.padding * 2
-                sourceComponent: (api && api.randomSongs && api.randomSongs.length > 0) ? madeForYou : emptyState
+                sourceComponent: (api && api.randomSongsModel.count > 0) ? madeForYou : emptyState
             }
 
             Label {
@@ -370,7 +370,7 @@ Page {
                             delegate: Components.AlbumCard {
                                 title: modelData.name || qsTr("Álbum Desconhecido")
                                 subtitle: modelData.artist || "Artista desconhecido"
-                                cover: (modelData.coverArt && api) ? api.coverArtUrl(modelData.coverArt, 256) : ""
+                                cover: (modelData.coverArt && api) ? api.coverImageUrl(modelData.coverArt, 256) : ""
                                 albumId: modelData.id
                                 artistId: modelData.artistId || ""
                                 onClicked: homePage.albumClicked(modelData.id, modelData.name, modelData.artist, modelData.coverArt, modelData.artistId || "")
@@ -426,7 +426,7 @@ Page {
                             delegate: Components.AlbumCard {
                                 title: modelData.name || qsTr("Álbum Desconhecido")
                                 subtitle: modelData.artist || qsTr("Artista desconhecido")
-                                cover: (modelData.coverArt && api) ? api.coverArtUrl(modelData.coverArt, 256) : ""
+                                cover: (modelData.coverArt && api) ? api.coverImageUrl(modelData.coverArt, 256) : ""
                                 albumId: modelData.id
                                 artistId: modelData.artistId || ""
                                 onClicked: homePage.albumClicked(modelData.id, modelData.name, modelData.artist, modelData.coverArt, modelData.artistId || "")
@@ -508,7 +508,7 @@ Page {
                                 
                                 Image {
                                     anchors.fill: parent
-                                    source: track.coverArt ? api.coverArtUrl(track.coverArt, 128) : ""
+                                    source: track.coverArt ? api.coverImageUrl(track.coverArt, 128) : ""
                                     fillMode: Image.PreserveAspectCrop
                                     asynchronous: true
                                     visible: track.coverArt && status !== Image.Error
@@ -608,9 +608,9 @@ Page {
                 clip: true
                 spacing: theme.spacingMd
                 interactive: false
-                model: (api && api.randomSongs) ? api.randomSongs : []
+                model: api ? api.randomSongsModel : null
                 delegate: Rectangle {
-                    property var track: modelData
+                    property var track: model
                     width: madeList.width
                     height: 60
                     radius: theme.radiusCard
@@ -648,7 +648,7 @@ Page {
                             clip: true
                             Image {
                                 anchors.fill: parent
-                                source: (track.coverArt && api) ? api.coverArtUrl(track.coverArt, 128) : ""
+                                source: (track.coverArt && api) ? api.coverImageUrl(track.coverArt, 128) : ""
                                 fillMode: Image.PreserveAspectCrop
                                 asynchronous: true
                                 visible: track.coverArt && status !== Image.Error
@@ -771,11 +771,11 @@ Page {
                                     
                                     MenuItem {
                                         text: qsTr("Play now")
-                                        onTriggered: player.playAlbum([track], 0)
+                                        onTriggered: player.playAlbum([api.randomSongsModel.get(index)], 0)
                                     }
                                     MenuItem {
                                         text: qsTr("Add to queue")
-                                        onTriggered: player.addToQueue(track)
+                                        onTriggered: player.addToQueue(api.randomSongsModel.get(index))
                                     }
                                     MenuItem {
                                         text: qsTr("Go to album")
@@ -788,7 +788,7 @@ Page {
 
                     TapHandler {
                         acceptedButtons: Qt.LeftButton
-                        onTapped: player.playAlbum([track], 0)
+                        onTapped: player.playAlbum([api.randomSongsModel.get(index)], 0)
                     }
                 }
             }
@@ -75,7 +75,7 @@ Page {
                         clip: true
                         Image {
                             anchors.fill: parent
-                            source: coverArtId ? api.coverArtUrl(coverArtId, 256) : ""
+                            source: coverArtId ? api.coverImageUrl(coverArtId, 256) : ""
                             fillMode: Image.PreserveAspectCrop
                             asynchronous: true
                             visible: !!coverArtId && status !== Image.Error
@@ -108,19 +108,19 @@ Page {
                             ToolButton {
                                 text: qsTr("Play")
                                 icon.source: "qrc:/qml/icons/play_arrow.svg"
-                                enabled: api.tracks.length > 0
+                                enabled: api.tracksModel.count > 0
                                 onClicked: {
-                                    if (api.tracks.length > 0)
+                                    if (api.tracksModel.count > 0)
                                         player.playCurrentTracks();
                                 }
                             }
                             ToolButton {
                                 text: qsTr("Queue")
                                 icon.source: "qrc:/qml/icons/add.svg"
-                                enabled: api.tracks.length > 0
+                                enabled: api.tracksModel.count > 0
                                 onClicked: {
-                                    for (var i = 0; i < api.tracks.length; ++i)
-                                        player.addToQueue(api.tracks[i])
+                                    for (var i = 0; i < api.tracksModel.count; ++i)
+                                        player.addToQueue(api.tracksModel.get(i))
                                 }
                             }
                         }
@@ -131,12 +131,12 @@ Page {
             Components.SectionHeader {
                 width: contentCol.width - contentCol.padding * 2
                 title: qsTr("Tracks")
-                subtitle: api.tracks.length > 0 ? qsTr("%1 músicas").arg(api.tracks.length) : qsTr("Playlist vazia")
+                subtitle: api.tracksModel.count > 0 ? qsTr("%1 músicas").arg(api.tracksModel.count) : qsTr("Playlist vazia")
             }
 
             Loader {
                 width: contentCol.width - contentCol.padding * 2
-                sourceComponent: api.tracks.length === 0 ? emptyTracks : trackList
+                sourceComponent: api.tracksModel.count === 0 ? emptyTracks : trackList
             }
         }
     }
@@ -147,16 +147,16 @@ Page {
             width: parent.width
             spacing: theme.spacingLg
             Repeater {
-                model: api.tracks
+                model: api.tracksModel
                 delegate: Components.TrackRow {
                     index: index
                     width: parent.width
-                    title: modelData.title
-                    subtitle: modelData.artist
-                    duration: modelData.duration
-                    cover: api.coverArtUrl(modelData.coverArt, 128)
-                    onPlayClicked: player.playTrack(modelData, index)
-                    onQueueClicked: player.addToQueue(modelData)
+                    title: model.title
+                    subtitle: model.artist
+                    duration: model.duration
+                    cover: api.coverImageUrl(model.coverArt, 128)
+                    onPlayClicked: player.playTrack(api.tracksModel.get(index), index)
+                    onQueueClicked: player.addToQueue(api.tracksModel.get(index))
                 }
             }
         }
@@ -68,7 +68,7 @@ Page {
 
                             Image {
                                 anchors.fill: parent
-                                source: modelData.coverArt ? api.coverArtUrl(modelData.coverArt, 256) : ""
+                                source: modelData.coverArt ? api.coverImageUrl(modelData.coverArt, 256) : ""
                                 fillMode: Image.PreserveAspectCrop
                                 asynchronous: true
                             }
@@ -118,7 +118,7 @@ Page {
                             Connections {
                                 target: api
                                 function onTracksChanged() {
-                                    if (playBtn.pendingPlaylistId.length > 0 && api.tracks.length > 0) {
+                                    if (playBtn.pendingPlaylistId.length > 0 && api.tracksModel.count > 0) {
                                         player.playCurrentTracks()
                                         playBtn.pendingPlaylistId = ""
                                     }
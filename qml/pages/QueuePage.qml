@@ -47,7 +47,7 @@ Item {
         Image {
             id: bgImage
             anchors.fill: parent
-            source: player.currentTrack && player.currentTrack.coverArt ? api.coverArtUrl(player.currentTrack.coverArt, 1024) : ""
+            source: player.currentTrack && player.currentTrack.coverArt ? api.coverImageUrl(player.currentTrack.coverArt, 1024) : ""
             fillMode: Image.PreserveAspectCrop
             asynchronous: true
         }
@@ -88,7 +88,7 @@ Item {
 
                     Image {
                         anchors.fill: parent
-                        source: player.currentTrack && player.currentTrack.coverArt ? api.coverArtUrl(player.currentTrack.coverArt, 512) : ""
+                        source: player.currentTrack && player.currentTrack.coverArt ? api.coverImageUrl(player.currentTrack.coverArt, 512) : ""
                         fillMode: Image.PreserveAspectCrop
                         asynchronous: true
                     }
@@ -113,7 +113,7 @@ Item {
                     clip: true
 
                     ListView {
-                        model: player.queue
+                        model: player.queueModel
                         spacing: theme.spacingMd
                         delegate: Rectangle {
                             width: ListView.view.width
@@ -139,7 +139,7 @@ Item {
 
                                     Image {
                                         anchors.fill: parent
-                                        source: modelData.coverArt ? api.coverArtUrl(modelData.coverArt, 128) : ""
+                                        source: model.coverArt ? api.coverImageUrl(model.coverArt, 128) : ""
                                         fillMode: Image.PreserveAspectCrop
                                         asynchronous: true
                                     }
@@ -151,7 +151,7 @@ Item {
 
                                     Label {
                                         Layout.fillWidth: true
-                                        text: modelData.title || qsTr("Faixa desconhecida")
+                                        text: model.title || qsTr("Faixa desconhecida")
                                         font.pixelSize: theme.fontSizeBody
                                         font.weight: Font.Medium
                                         color: theme.textPrimary
@@ -160,7 +160,7 @@ Item {
 
                                     Label {
                                         Layout.fillWidth: true
-                                        text: modelData.artist || "-"
+                                        text: model.artist || "-"
                                         color: theme.textMuted
                                         font.pixelSize: theme.fontSizeCaption
                                         elide: Text.ElideRight
@@ -0,0 +1,181 @@
+#include "AlbumSortIndex.h"
+#include <algorithm>
+
+AlbumSortIndex::AlbumSortIndex(const LibraryCatalog *catalog)
+    : m_catalog(catalog)
+{
+    m_collator.setNumericMode(true);
+    m_rows[index(m_order)].emplace();
+}
+
+QList<AlbumSortIndex::Run> AlbumSortIndex::insert(const QList<Handle> &handles)
+{
+    QList<Handle> incoming;
+    incoming.reserve(handles.size());
+    for (const Handle handle : handles)
+    {
+        if (m_members.contains(handle))
+            continue;
+        m_members.insert(handle);
+        updateKeys(handle);
+        incoming.append(handle);
+    }
+
+    QList<Run> current;
+    if (incoming.isEmpty())
+        return current;
+    for (int i = 0; i < static_cast<int>(m_rows.size()); ++i)
+    {
+        if (!m_rows[i])
+            continue;
+        QList<Run> runs = merge(static_cast<Order>(i), *m_rows[i], incoming);
+        if (i == index(m_order))
+            current = std::move(runs);
+    }
+    return current;
+}
+
+void AlbumSortIndex::setOrder(Order order)
+{
+    if (order == m_order)
+        return;
+    std::optional<QList<Handle>> &rows = m_rows[index(order)];
+    if (!rows)
+    {
+        QList<Handle> sorted = this->rows();
+        std::stable_sort(sorted.begin(), sorted.end(), [this, order](Handle a, Handle b)
+                         { return less(order, a, b); });
+        rows = std::move(sorted);
+    }
+    m_order = order;
+}
+
+void AlbumSortIndex::clear()
+{
+    for (auto &rows : m_rows)
+        rows.reset();
+    m_rows[index(m_order)].emplace();
+    m_members.clear();
+}
+
+void AlbumSortIndex::clearKeys()
+{
+    clear();
+    m_keys.clear();
+    m_keys.shrink_to_fit();
+}
+
+void AlbumSortIndex::remap(const QList<Handle> &remap)
+{
+    // Collation keys stay valid: the text is the same, only its string ids
+    // moved with the arena.
+    const auto &albums = m_catalog->albums();
+    std::vector<std::optional<Keys>> keys(albums.id.size());
+    for (size_t old = 0; old < m_keys.size(); ++old)
+    {
+        const Handle handle = old < static_cast<size_t>(remap.size()) ? remap.at(old) : LibraryCatalog::InvalidHandle;
+        if (!m_keys[old] || handle == LibraryCatalog::InvalidHandle)
+            continue;
+        Keys &moved = keys[handle].emplace(std::move(*m_keys[old]));
+        moved.nameId = albums.name.at(handle);
+        moved.artistId = albums.artist.at(handle);
+    }
+    m_keys = std::move(keys);
+
+    QSet<Handle> members;
+    members.reserve(m_members.size());
+    for (const Handle handle : std::as_const(m_members))
+        members.insert(remap.at(handle));
+    m_members = std::move(members);
+    for (auto &rows : m_rows)
+    {
+        if (!rows)
+            continue;
+        for (Handle &handle : *rows)
+            handle = remap.at(handle);
+    }
+}
+
+void AlbumSortIndex::updateKeys(Handle handle)
+{
+    const auto &albums = m_catalog->albums();
+    if (handle >= m_keys.size())
+        m_keys.resize(albums.id.size());
+
+    // Recomputed only when the catalog row now holds different text.
+    const LibraryCatalog::StringId nameId = albums.name.at(handle);
+    const LibraryCatalog::StringId artistId = albums.artist.at(handle);
+    std::optional<Keys> &keys = m_keys[handle];
+    if (keys && keys->nameId == nameId && keys->artistId == artistId)
+        return;
+    keys.emplace(Keys{nameId, artistId, m_collator.sortKey(m_catalog->string(nameId)),
+                      m_collator.sortKey(m_catalog->string(artistId))});
+}
+
+bool AlbumSortIndex::less(Order order, Handle a, Handle b) const
+{
+    const Keys &left = keys(a);
+    const Keys &right = keys(b);
+    const auto &albums = m_catalog->albums();
+
+    switch (order)
+    {
+    case Order::Name:
+        break;
+    case Order::Artist:
+        if (const int byArtist = left.artist.compare(right.artist))
+            return byArtist < 0;
+        if (albums.year.at(a) != albums.year.at(b))
+            return albums.year.at(a) < albums.year.at(b);
+        break;
+    case Order::Year:
+        if (albums.year.at(a) != albums.year.at(b))
+            return albums.year.at(a) > albums.year.at(b);
+        break;
+    case Order::RecentlyAdded:
+        // ISO 8601 timestamps order as plain strings.
+        if (const int byDate = m_catalog->view(albums.created.at(b)).compare(m_catalog->view(albums.created.at(a))))
+            return byDate < 0;
+        break;
+    }
+    return left.name.compare(right.name) < 0;
+}
+
+QList<AlbumSortIndex::Run> AlbumSortIndex::merge(Order order, QList<Handle> &rows, QList<Handle> incoming) const
+{
+    const auto lessThan = [this, order](Handle a, Handle b)
+    { return less(order, a, b); };
+    std::stable_sort(incoming.begin(), incoming.end(), lessThan);
+
+    // Both sides are sorted, so each incoming run lands in a single gap and
+    // the search for the next gap starts where the previous one ended.
+    QList<Run> runs;
+    qsizetype from = 0;
+    qsizetype original = 0; // position in rows before this merge
+    while (from < incoming.size())
+    {
+        const qsizetype pos = std::upper_bound(rows.cbegin() + original, rows.cend(), incoming.at(from), lessThan) - rows.cbegin();
+        qsizetype to = from + 1;
+        while (to < incoming.size() && (pos == rows.size() || lessThan(incoming.at(to), rows.at(pos))))
+            ++to;
+        runs.append({static_cast<int>(pos + from), incoming.mid(from, to - from)});
+        original = pos;
+        from = to;
+    }
+
+    QList<Handle> merged;
+    merged.reserve(rows.size() + incoming.size());
+    qsizetype taken = 0;
+    qsizetype inserted = 0;
+    for (const Run &run : runs)
+    {
+        const qsizetype at = run.row - inserted;
+        merged.append(rows.mid(taken, at - taken));
+        merged.append(run.handles);
+        taken = at;
+        inserted += run.handles.size();
+    }
+    merged.append(rows.mid(taken));
+    rows = std::move(merged);
+    return runs;
+}
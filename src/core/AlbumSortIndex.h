@@ -0,0 +1,72 @@
+#pragma once
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QList>
+#include <QSet>
+#include <array>
+#include <optional>
+#include <vector>
+#include "LibraryCatalog.h"
+
+// Keeps the album list sorted as pages arrive. Collation keys for name and
+// artist are computed once per album, so a comparison compares two
+// prepared keys instead of running localeAwareCompare. Every order that
+// has been shown is kept sorted alongside the current one, so switching
+// back to it needs no sort at all.
+class AlbumSortIndex
+{
+public:
+    using Handle = LibraryCatalog::Handle;
+
+    enum class Order
+    {
+        Name,
+        Artist,        // then year, then name
+        Year,          // newest first, then name
+        RecentlyAdded  // by creation date, newest first
+    };
+
+    // Albums that land next to each other in the current order; row is
+    // the position after every earlier run has been inserted.
+    struct Run
+    {
+        int row;
+        QList<Handle> handles;
+    };
+
+    explicit AlbumSortIndex(const LibraryCatalog *catalog);
+
+    Order order() const { return m_order; }
+    const QList<Handle> &rows() const { return *m_rows[index(m_order)]; }
+
+    // Merges albums into every kept order and returns where they went in
+    // the current one. Albums already present are skipped.
+    QList<Run> insert(const QList<Handle> &handles);
+    // Sorts once by precomputed keys when the order has not been kept yet.
+    void setOrder(Order order);
+    void clear();
+    // Needed after the catalog itself was cleared and handles reused.
+    void clearKeys();
+    // After LibraryCatalog::compact(); every member must have been kept.
+    void remap(const QList<Handle> &remap);
+
+private:
+    struct Keys
+    {
+        LibraryCatalog::StringId nameId, artistId;
+        QCollatorSortKey name, artist;
+    };
+
+    static int index(Order order) { return static_cast<int>(order); }
+    const Keys &keys(Handle handle) const { return *m_keys[handle]; }
+    void updateKeys(Handle handle);
+    bool less(Order order, Handle a, Handle b) const;
+    QList<Run> merge(Order order, QList<Handle> &rows, QList<Handle> incoming) const;
+
+    const LibraryCatalog *m_catalog;
+    QCollator m_collator;
+    std::vector<std::optional<Keys>> m_keys;  // by catalog handle
+    QSet<Handle> m_members;
+    Order m_order = Order::Name;
+    std::array<std::optional<QList<Handle>>, 4> m_rows;
+};
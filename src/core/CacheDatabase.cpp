@@ -0,0 +1,134 @@
+#include "CacheDatabase.h"
+#include <QSqlError>
+#include <QThread>
+#include <QHash>
+#include <QDebug>
+
+// How long small writes are held back to share a transaction, and how
+// many are collected at most before committing early.
+static constexpr int WRITE_BEHIND_DELAY_MS = 30;
+static constexpr qsizetype WRITE_BEHIND_MAX_BATCH = 512;
+static constexpr qint64 MMAP_SIZE = 256ll * 1024 * 1024;
+
+CacheDatabase::CacheDatabase(const QString &path, int readerCount, QObject *parent)
+    : QObject(parent),
+      m_path(path),
+      m_writer(std::make_unique<QThreadPool>()),
+      m_readers(std::make_unique<QThreadPool>()) {
+    // Connections belong to the thread that opened them, so pool threads
+    // must live as long as the pool does.
+    m_writer->setMaxThreadCount(1);
+    m_writer->setExpiryTimeout(-1);
+    m_readers->setMaxThreadCount(qMax(1, readerCount));
+    m_readers->setExpiryTimeout(-1);
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(WRITE_BEHIND_DELAY_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, &CacheDatabase::flush);
+}
+
+CacheDatabase::~CacheDatabase() {
+    m_flushTimer.stop();
+    flush();
+
+    // Finish queued work (pending writes included) and join the threads
+    // before dropping their connections.
+    m_readers.reset();
+    m_writer.reset();
+
+    QMutexLocker locker(&m_connectionsMutex);
+    for (const QString &name : std::as_const(m_connections))
+        QSqlDatabase::removeDatabase(name);
+}
+
+QSqlDatabase CacheDatabase::connection(bool writer) {
+    const QString name = QStringLiteral("cache_%1_%2")
+                             .arg(reinterpret_cast<quintptr>(this), 0, 16)
+                             .arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+    if (QSqlDatabase::contains(name))
+        return QSqlDatabase::database(name);
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+    db.setDatabaseName(m_path);
+    // Wait out the writer's locks instead of failing lookups with SQLITE_BUSY.
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if (!db.open()) {
+        qWarning() << "Failed to open cache database connection:" << db.lastError().text();
+    } else {
+        QSqlQuery pragma(db);
+        // journal_mode is stored in the file; setting it once from the
+        // writer is enough and keeps readers from taking a write lock.
+        if (writer)
+            pragma.exec("PRAGMA journal_mode=WAL");
+        pragma.exec("PRAGMA synchronous=NORMAL");
+        pragma.exec(QStringLiteral("PRAGMA mmap_size=%1").arg(MMAP_SIZE));
+        pragma.exec("PRAGMA temp_store=MEMORY");
+    }
+
+    QMutexLocker locker(&m_connectionsMutex);
+    m_connections.append(name);
+    return db;
+}
+
+QSqlQuery &CacheDatabase::statement(QSqlDatabase &db, const char *sql) {
+    // Each pool thread owns exactly one connection per database, so the
+    // cache is per thread; it is destroyed when the pool joins its threads.
+    // Queries live on the heap: a rehash must not move a statement a
+    // caller still holds.
+    thread_local QHash<QString, std::shared_ptr<QSqlQuery>> statements;
+    const QString key = db.connectionName() + QLatin1Char('\n') + QLatin1String(sql);
+    std::shared_ptr<QSqlQuery> &query = statements[key];
+    if (!query) {
+        query = std::make_shared<QSqlQuery>(db);
+        if (!query->prepare(QString::fromLatin1(sql)))
+            qWarning() << "Failed to prepare cache statement:" << query->lastError().text();
+    }
+    return *query;
+}
+
+void CacheDatabase::enqueue(WriteOp op) {
+    bool full = false;
+    bool schedule = false;
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        m_pending.append(std::move(op));
+        full = m_pending.size() >= WRITE_BEHIND_MAX_BATCH;
+        schedule = !m_flushScheduled;
+        m_flushScheduled = true;
+    }
+
+    if (full)
+        flush();
+    else if (schedule)
+        scheduleFlush();
+}
+
+void CacheDatabase::scheduleFlush() {
+    if (QThread::currentThread() == thread()) {
+        m_flushTimer.start();
+        return;
+    }
+    QMetaObject::invokeMethod(this, [this]() { m_flushTimer.start(); }, Qt::QueuedConnection);
+}
+
+void CacheDatabase::flush() {
+    QList<WriteOp> batch;
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        batch.swap(m_pending);
+        m_flushScheduled = false;
+    }
+    if (batch.isEmpty() || !m_writer)
+        return;
+
+    m_writer->start([this, batch = std::move(batch)]() {
+        QSqlDatabase db = connection(true);
+        const bool inTransaction = db.transaction();
+        for (const WriteOp &op : batch)
+            op(db);
+        if (inTransaction && !db.commit()) {
+            qWarning() << "Failed to commit cache writes:" << db.lastError().text();
+            db.rollback();
+        }
+    });
+}
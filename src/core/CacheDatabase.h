@@ -0,0 +1,89 @@
+#pragma once
+#include <QObject>
+#include <QFuture>
+#include <QPromise>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+#include <QThreadPool>
+#include <QTimer>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+// SQLite access for CacheManager kept off the GUI thread. Writes run in
+// order on a single writer thread with its own connection; reads run on a
+// small pool of reader threads, each with a private connection, so
+// lookups proceed concurrently with each other and with writes.
+// Reads are not ordered against queued writes; schedule a read with
+// write() when it has to observe them.
+//
+// Connections use WAL journaling with synchronous=NORMAL and memory-mapped
+// I/O, so readers never block on the writer and a commit costs one WAL
+// append instead of two fsyncs.
+class CacheDatabase : public QObject {
+    Q_OBJECT
+public:
+    using WriteOp = std::function<void(QSqlDatabase &)>;
+
+    explicit CacheDatabase(const QString &path, int readerCount = 2, QObject *parent = nullptr);
+    ~CacheDatabase() override;
+
+    // fn is called as fn(QSqlDatabase &) on a database thread.
+    template <typename Fn>
+    auto read(Fn fn) { return run(m_readers.get(), false, std::move(fn)); }
+    // Runs after everything enqueued before it.
+    template <typename Fn>
+    auto write(Fn fn) {
+        flush();
+        return run(m_writer.get(), true, std::move(fn));
+    }
+
+    // Write-behind: small writes are collected for a few milliseconds and
+    // committed together in one transaction. Thread safe.
+    void enqueue(WriteOp op);
+    void flush();
+
+    // Statement prepared once per connection and reused; call finish() on
+    // it once the results are read so it does not hold a read snapshot.
+    // The reference stays valid for the life of the thread, so several
+    // statements can be held at once.
+    static QSqlQuery &statement(QSqlDatabase &db, const char *sql);
+
+    QString path() const { return m_path; }
+
+private:
+    template <typename Fn>
+    auto run(QThreadPool *pool, bool writer, Fn fn) {
+        using Result = std::invoke_result_t<Fn, QSqlDatabase &>;
+        auto promise = std::make_shared<QPromise<Result>>();
+        QFuture<Result> future = promise->future();
+        promise->start();
+        pool->start([this, writer, promise, fn = std::move(fn)]() mutable {
+            QSqlDatabase db = connection(writer);
+            if constexpr (std::is_void_v<Result>) {
+                fn(db);
+            } else {
+                promise->addResult(fn(db));
+            }
+            promise->finish();
+        });
+        return future;
+    }
+
+    QSqlDatabase connection(bool writer);
+    void scheduleFlush();
+
+    QString m_path;
+    std::unique_ptr<QThreadPool> m_writer;
+    std::unique_ptr<QThreadPool> m_readers;
+    QMutex m_connectionsMutex;
+    QStringList m_connections;
+
+    QMutex m_pendingMutex;
+    QList<WriteOp> m_pending;
+    bool m_flushScheduled = false;
+    QTimer m_flushTimer;
+};
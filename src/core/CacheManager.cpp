@@ -1,51 +1,439 @@
 #include "CacheManager.h"
+#include "CacheDatabase.h"
+#include "ImageStore.h"
+#include "ListSnapshot.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QStandardPaths>
 #include <QDir>
 #include <QBuffer>
+#include <QImage>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSettings>
 #include <QDebug>
+#include <QLoggingCategory>
+#include <algorithm>
+
+// Byte-budget collection steps; enable with
+// QT_LOGGING_RULES="shibamusic.cache.debug=true".
+Q_LOGGING_CATEGORY(lcCache, "shibamusic.cache", QtInfoMsg)
+
+namespace {
+
+constexpr qint64 DEFAULT_CACHE_LIMIT = 1024ll * 1024 * 1024;
+constexpr qint64 MIN_CACHE_LIMIT = 64ll * 1024 * 1024;
+constexpr int GC_IDLE_DELAY_MS = 5000;          // after a write
+constexpr int GC_CONTINUE_DELAY_MS = 1000;      // between chunks while over budget
+constexpr int GC_PERIOD_MS = 10 * 60 * 1000;
+constexpr int GC_CHUNK = 128;                   // oldest entries considered per kind and step
+constexpr qint64 VACUUM_THRESHOLD = 8ll * 1024 * 1024;
+
+struct CacheStats {
+    qint64 size = 0;
+    int imageCount = 0;
+    bool more = false; // collection stopped early and is still over budget
+};
+
+struct CachePaths {
+    QString database;
+    QString network;
+    QString audio;
+    QString snapshots;
+};
+
+struct CacheFile {
+    QString path;
+    qint64 size;
+    qint64 lastAccess;
+};
+
+qint64 databaseFileBytes(const QString &path) {
+    return QFileInfo(path).size() + QFileInfo(path + "-wal").size() + QFileInfo(path + "-shm").size();
+}
+
+// A download StreamProxy is still writing; it only becomes an audio cache
+// entry once complete, so it is counted but never deleted from here.
+bool isPartialDownload(const QString &path) {
+    return path.endsWith(QLatin1String(".part"));
+}
+
+// Total size of a file cache directory (the network or the audio cache);
+// optionally adds the files that may be evicted to files. Entries have no
+// access time, so modification time stands in.
+qint64 scanCacheDirectory(const QString &dir, QList<CacheFile> *files = nullptr) {
+    qint64 total = 0;
+    QDirIterator it(dir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QFileInfo info = it.nextFileInfo();
+        total += info.size();
+        if (files && !isPartialDownload(info.filePath())) {
+            files->append({info.filePath(), info.size(), info.lastModified().toSecsSinceEpoch()});
+        }
+    }
+    return total;
+}
+
+// Deletes every file under dir but keeps the directories, which
+// QNetworkDiskCache expects to find; a missing entry is just a miss.
+void removeCachedFiles(const QString &dir) {
+    QDirIterator it(dir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        if (!isPartialDownload(path)) {
+            QFile::remove(path);
+        }
+    }
+}
+
+qint64 imageBytes(QSqlDatabase &db, int *count = nullptr) {
+    QSqlQuery query(db);
+    if (!query.exec("SELECT COALESCE(SUM(size), 0), COUNT(*) FROM image_blobs") || !query.next()) {
+        return 0;
+    }
+    if (count) {
+        *count = query.value(1).toInt();
+    }
+    return query.value(0).toLongLong();
+}
+
+qint64 snapshotBytes(QSqlDatabase &db) {
+    QSqlQuery query(db);
+    if (!query.exec("SELECT COALESCE(SUM(snapshot_size), 0) FROM list_cache") || !query.next()) {
+        return 0;
+    }
+    return query.value(0).toLongLong();
+}
+
+QString snapshotPath(const QString &dir, const QString &type) {
+    return dir + QLatin1Char('/') + ImageStore::hashOf(type.toUtf8()) + QStringLiteral(".snap");
+}
+
+CacheStats readStats(QSqlDatabase &db, const CachePaths &paths) {
+    CacheStats stats;
+    stats.size = imageBytes(db, &stats.imageCount) + snapshotBytes(db) + databaseFileBytes(paths.database)
+               + scanCacheDirectory(paths.network) + scanCacheDirectory(paths.audio);
+    return stats;
+}
+
+}
+
+// The network and audio cache directories as of the start of a collection
+// run. Later steps of the run keep the total up to date with their own
+// deletions instead of walking both trees again; the next run rescans,
+// since downloads land there without telling us.
+struct CacheFileIndex {
+    bool scanned = false;
+    qint64 bytes = 0;
+    QList<CacheFile> files; // oldest first
+    qsizetype next = 0;     // first file not evicted yet
+};
+
+namespace {
+
+// One step of the byte-budget policy: while the total is over the limit,
+// evict the least recently used entries, whatever cache they belong to,
+// until it is 10% under. Only GC_CHUNK entries per kind are considered so
+// a step stays short; the caller runs another one if more is set.
+CacheStats collect(QSqlDatabase &db, const ImageStore &store, const CachePaths &paths, qint64 limit,
+                   CacheFileIndex &files) {
+    if (!files.scanned) {
+        files.bytes = scanCacheDirectory(paths.network, &files.files) + scanCacheDirectory(paths.audio, &files.files);
+        std::sort(files.files.begin(), files.files.end(), [](const CacheFile &a, const CacheFile &b) {
+            return a.lastAccess < b.lastAccess;
+        });
+        files.scanned = true;
+    }
+    CacheStats stats;
+    stats.size = imageBytes(db, &stats.imageCount) + snapshotBytes(db) + databaseFileBytes(paths.database) + files.bytes;
+    if (stats.size <= limit) {
+        return stats;
+    }
+    
+    enum class Kind { Image, Metadata, List, File };
+    struct Candidate {
+        Kind kind;
+        QString key;
+        QString subKey;
+        qint64 size;
+        qint64 lastAccess;
+    };
+    QList<Candidate> candidates;
+    
+    QSqlQuery query(db);
+    query.prepare("SELECT hash, size, last_access FROM image_blobs ORDER BY last_access LIMIT ?");
+    query.addBindValue(GC_CHUNK);
+    if (query.exec()) {
+        while (query.next()) {
+            candidates.append({Kind::Image, query.value(0).toString(), {}, query.value(1).toLongLong(), query.value(2).toLongLong()});
+        }
+    }
+    query.prepare("SELECT type, id, LENGTH(CAST(data AS BLOB)), last_access FROM metadata_cache ORDER BY last_access LIMIT ?");
+    query.addBindValue(GC_CHUNK);
+    if (query.exec()) {
+        while (query.next()) {
+            candidates.append({Kind::Metadata, query.value(0).toString(), query.value(1).toString(), query.value(2).toLongLong(), query.value(3).toLongLong()});
+        }
+    }
+    query.prepare("SELECT type, LENGTH(CAST(data AS BLOB)) + snapshot_size, last_access FROM list_cache ORDER BY last_access LIMIT ?");
+    query.addBindValue(GC_CHUNK);
+    if (query.exec()) {
+        while (query.next()) {
+            candidates.append({Kind::List, query.value(0).toString(), {}, query.value(1).toLongLong(), query.value(2).toLongLong()});
+        }
+    }
+    query.finish();
+    const qsizetype filesEnd = std::min(files.files.size(), files.next + GC_CHUNK);
+    for (qsizetype i = files.next; i < filesEnd; ++i) {
+        const CacheFile &file = files.files.at(i);
+        candidates.append({Kind::File, file.path, {}, file.size, file.lastAccess});
+    }
+    // Stable, so files still leave in index order and next stays valid.
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.lastAccess < b.lastAccess;
+    });
+    
+    const qint64 target = limit - limit / 10;
+    QStringList removedImages;
+    qsizetype evicted = 0;
+    db.transaction();
+    for (const Candidate &candidate : std::as_const(candidates)) {
+        if (stats.size <= target) {
+            break;
+        }
+        switch (candidate.kind) {
+        case Kind::Image:
+            query.prepare("DELETE FROM image_keys WHERE hash = ?");
+            query.addBindValue(candidate.key);
+            query.exec();
+            query.prepare("DELETE FROM image_blobs WHERE hash = ?");
+            query.addBindValue(candidate.key);
+            query.exec();
+            removedImages.append(candidate.key);
+            --stats.imageCount;
+            break;
+        case Kind::Metadata:
+            query.prepare("DELETE FROM metadata_cache WHERE type = ? AND id = ?");
+            query.addBindValue(candidate.key);
+            query.addBindValue(candidate.subKey);
+            query.exec();
+            break;
+        case Kind::List:
+            query.prepare("DELETE FROM list_cache WHERE type = ?");
+            query.addBindValue(candidate.key);
+            query.exec();
+            QFile::remove(snapshotPath(paths.snapshots, candidate.key));
+            break;
+        case Kind::File:
+            // QNetworkDiskCache and AudioCache treat a missing file as a miss.
+            QFile::remove(candidate.key);
+            files.bytes -= candidate.size;
+            ++files.next;
+            break;
+        }
+        stats.size -= candidate.size;
+        ++evicted;
+    }
+    db.commit();
+    
+    // Only delete files once the index no longer points at them.
+    for (const QString &hash : std::as_const(removedImages)) {
+        store.remove(hash);
+    }
+    
+    // Rows removed from the database leave free pages behind; give them
+    // back once they add up. Cheap now that images live outside the file.
+    if (query.exec("SELECT freelist_count * page_size FROM pragma_freelist_count, pragma_page_size")
+        && query.next() && query.value(0).toLongLong() > VACUUM_THRESHOLD) {
+        query.finish();
+        query.exec("VACUUM");
+    }
+    
+    stats.more = evicted > 0 && stats.size > target;
+    qCDebug(lcCache) << "Cache collection evicted" << evicted << "entries; now" << stats.size << "of" << limit << "bytes";
+    return stats;
+}
+
+void addColumnIfMissing(QSqlDatabase &db, const QString &table, const QString &column, const QString &definition) {
+    QSqlQuery query(db);
+    if (query.exec(QStringLiteral("PRAGMA table_info(%1)").arg(table))) {
+        while (query.next()) {
+            if (query.value(1).toString() == column) {
+                return;
+            }
+        }
+    }
+    query.exec(QStringLiteral("ALTER TABLE %1 ADD COLUMN %2 %3").arg(table, column, definition));
+}
+
+void touch(CacheDatabase *database, const char *sql, const QVariantList &key) {
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    database->enqueue([sql, key, now](QSqlDatabase &db) {
+        QSqlQuery &query = CacheDatabase::statement(db, sql);
+        query.addBindValue(now);
+        for (const QVariant &value : key) {
+            query.addBindValue(value);
+        }
+        query.exec();
+    });
+}
+
+// Writes the bytes to the store (once per distinct image) and points key
+// at them.
+bool insertImage(QSqlDatabase &db, const ImageStore &store, const QString &key, const QByteArray &data) {
+    const QString hash = ImageStore::hashOf(data);
+    if (!store.write(hash, data)) {
+        return false;
+    }
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    
+    // One statement at a time: the blob row is written before the key
+    // that refers to it.
+    QSqlQuery &blob = CacheDatabase::statement(db, R"(
+        INSERT INTO image_blobs (hash, size, last_access) VALUES (?, ?, ?)
+        ON CONFLICT(hash) DO UPDATE SET last_access = excluded.last_access
+    )");
+    blob.addBindValue(hash);
+    blob.addBindValue(data.size());
+    blob.addBindValue(now);
+    if (!blob.exec()) {
+        qWarning() << "Failed to save image to cache:" << blob.lastError().text();
+        return false;
+    }
+    
+    QSqlQuery &index = CacheDatabase::statement(db, R"(
+        INSERT OR REPLACE INTO image_keys (url, hash, cached_at)
+        VALUES (?, ?, ?)
+    )");
+    index.addBindValue(key);
+    index.addBindValue(hash);
+    index.addBindValue(now);
+    if (!index.exec()) {
+        qWarning() << "Failed to save image to cache:" << index.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+ImageBytes selectImage(QSqlDatabase &db, const ImageStore &store, const QString &key, QString *hash) {
+    QSqlQuery &query = CacheDatabase::statement(db, "SELECT hash FROM image_keys WHERE url = ?");
+    query.addBindValue(key);
+    if (query.exec() && query.next()) {
+        *hash = query.value(0).toString();
+    }
+    query.finish();
+    if (hash->isEmpty()) {
+        return ImageBytes();
+    }
+    return store.map(*hash);
+}
+
+// Deletes index rows and files of images no key refers to any more.
+void removeUnreferencedImages(QSqlDatabase &db, const ImageStore &store) {
+    QSqlQuery query(db);
+    QStringList hashes;
+    if (query.exec("SELECT hash FROM image_blobs WHERE hash NOT IN (SELECT hash FROM image_keys)")) {
+        while (query.next()) {
+            hashes.append(query.value(0).toString());
+        }
+    }
+    query.finish();
+    if (hashes.isEmpty()) {
+        return;
+    }
+    
+    query.exec("DELETE FROM image_blobs WHERE hash NOT IN (SELECT hash FROM image_keys)");
+    for (const QString &hash : std::as_const(hashes)) {
+        store.remove(hash);
+    }
+}
+
+bool exists(QSqlDatabase &db, const char *sql, const QVariantList &values) {
+    QSqlQuery &query = CacheDatabase::statement(db, sql);
+    for (const QVariant &value : values) {
+        query.addBindValue(value);
+    }
+    const bool found = query.exec() && query.next();
+    query.finish();
+    return found;
+}
+
+}
 
 CacheManager::CacheManager(QObject *parent) : QObject(parent) {
     m_cachePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
     QDir().mkpath(m_cachePath);
     m_imageMemoryCache.setMaxCost(50 * 1024 * 1024); // 50MB limit
+    
+    QSettings settings;
+    m_cacheLimit = qMax(settings.value("cache/limitBytes", DEFAULT_CACHE_LIMIT).toLongLong(), MIN_CACHE_LIMIT);
+    m_gcTimer.setSingleShot(true);
+    connect(&m_gcTimer, &QTimer::timeout, this, &CacheManager::collectGarbage);
 }
 
 CacheManager::~CacheManager() {
-    if (m_db.isOpen()) {
-        m_db.close();
-    }
+    // Flushes queued writes before the connections close.
+    m_db.reset();
 }
 
 bool CacheManager::initialize() {
-    m_db = QSqlDatabase::addDatabase("QSQLITE", "cache_connection");
-    m_db.setDatabaseName(m_cachePath + "/shibamusic_cache.db");
-    
-    if (!m_db.open()) {
-        qWarning() << "Failed to open cache database:" << m_db.lastError().text();
+    m_images = std::make_unique<ImageStore>(m_cachePath + "/images");
+    m_snapshotDir = m_cachePath + "/lists";
+    QDir().mkpath(m_snapshotDir);
+    m_db = std::make_unique<CacheDatabase>(m_cachePath + "/shibamusic_cache.db");
+
+    // The only blocking call: the schema has to exist before the first read.
+    const bool ok = m_db->write([](QSqlDatabase &db) {
+        if (!db.isOpen()) {
+            return false;
+        }
+        return createTables(db);
+    }).result();
+
+    if (!ok) {
+        qWarning() << "Failed to open cache database:" << m_db->path();
         return false;
     }
+    qDebug() << "Cache database initialized at:" << m_db->path();
     
-    createTables();
-    qDebug() << "Cache database initialized at:" << m_db.databaseName();
+    // Older versions kept image blobs inside the database. Drop them and
+    // give the space back; it only happens once, off the GUI thread.
+    m_db->write([](QSqlDatabase &db) {
+        QSqlQuery query(db);
+        if (query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'image_cache'") && query.next()) {
+            query.finish();
+            query.exec("DROP TABLE image_cache");
+            query.exec("VACUUM");
+        }
+    });
+    refreshStats();
+    scheduleCollection(GC_IDLE_DELAY_MS);
     return true;
 }
 
-void CacheManager::createTables() {
-    QSqlQuery query(m_db);
+bool CacheManager::createTables(QSqlDatabase &db) {
+    QSqlQuery query(db);
     
-    // Image cache table
+    // Image index: the bytes live in the ImageStore, one file per distinct
+    // image; keys (URLs, cover ids) map onto those files.
     query.exec(R"(
-        CREATE TABLE IF NOT EXISTS image_cache (
+        CREATE TABLE IF NOT EXISTS image_blobs (
+            hash TEXT PRIMARY KEY,
+            size INTEGER NOT NULL,
+            last_access INTEGER NOT NULL
+        )
+    )");
+    query.exec(R"(
+        CREATE TABLE IF NOT EXISTS image_keys (
             url TEXT PRIMARY KEY,
-            data BLOB NOT NULL,
-            cached_at INTEGER NOT NULL,
-            size INTEGER NOT NULL
+            hash TEXT NOT NULL,
+            cached_at INTEGER NOT NULL
         )
     )");
     
@@ -56,6 +444,7 @@ void CacheManager::createTables() {
             id TEXT NOT NULL,
             data TEXT NOT NULL,
             cached_at INTEGER NOT NULL,
+            last_access INTEGER NOT NULL DEFAULT 0,
             PRIMARY KEY (type, id)
         )
     )");
@@ -65,14 +454,34 @@ void CacheManager::createTables() {
         CREATE TABLE IF NOT EXISTS list_cache (
             type TEXT PRIMARY KEY,
             data TEXT NOT NULL,
-            cached_at INTEGER NOT NULL
+            cached_at INTEGER NOT NULL,
+            last_access INTEGER NOT NULL DEFAULT 0
         )
     )");
+    const bool ok = !query.lastError().isValid();
+    
+    // Databases from before the byte budget lack the access columns.
+    addColumnIfMissing(db, "metadata_cache", "last_access", "INTEGER NOT NULL DEFAULT 0");
+    addColumnIfMissing(db, "list_cache", "last_access", "INTEGER NOT NULL DEFAULT 0");
+    // Bytes of the list's snapshot file, if it is stored as one.
+    addColumnIfMissing(db, "list_cache", "snapshot_size", "INTEGER NOT NULL DEFAULT 0");
     
     // Create indices for faster queries
-    query.exec("CREATE INDEX IF NOT EXISTS idx_image_cached_at ON image_cache(cached_at)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_image_blobs_last_access ON image_blobs(last_access)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_image_keys_hash ON image_keys(hash)");
     query.exec("CREATE INDEX IF NOT EXISTS idx_metadata_cached_at ON metadata_cache(cached_at)");
     query.exec("CREATE INDEX IF NOT EXISTS idx_list_cached_at ON list_cache(cached_at)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_metadata_last_access ON metadata_cache(last_access)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_list_last_access ON list_cache(last_access)");
+    return ok;
+}
+
+QString CacheManager::networkCacheDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/network";
+}
+
+QString CacheManager::audioCacheDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/audio";
 }
 
 QString CacheManager::getCachePath() {
@@ -81,14 +490,12 @@ QString CacheManager::getCachePath() {
 
 // Image cache methods
 bool CacheManager::hasImage(const QString& url) {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT 1 FROM image_cache WHERE url = ?");
-    query.addBindValue(url);
-    
-    if (query.exec() && query.next()) {
-        return true;
+    if (!m_db) {
+        return false;
     }
-    return false;
+    return m_db->read([url](QSqlDatabase &db) {
+        return exists(db, "SELECT 1 FROM image_keys WHERE url = ?", {url});
+    }).result();
 }
 
 QPixmap CacheManager::getImage(const QString& url) {
@@ -96,204 +503,457 @@ QPixmap CacheManager::getImage(const QString& url) {
         return *cached;
     }
     
-    QSqlQuery query(m_db);
-    query.prepare("SELECT data FROM image_cache WHERE url = ?");
-    query.addBindValue(url);
-    
-    if (query.exec() && query.next()) {
-        QByteArray data = query.value(0).toByteArray();
-        QPixmap pixmap;
-        if (pixmap.loadFromData(data)) {
-            int cost = pixmap.width() * pixmap.height() * pixmap.depth() / 8;
-            m_imageMemoryCache.insert(url, new QPixmap(pixmap), cost);
-            return pixmap;
-        }
+    QPixmap pixmap;
+    if (pixmap.loadFromData(imageData(url))) {
+        int cost = pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+        m_imageMemoryCache.insert(url, new QPixmap(pixmap), cost);
     }
-    
-    return QPixmap();
+    return pixmap;
 }
 
 void CacheManager::saveImage(const QString& url, const QPixmap& pixmap) {
     int cost = pixmap.width() * pixmap.height() * pixmap.depth() / 8;
     m_imageMemoryCache.insert(url, new QPixmap(pixmap), cost);
-    
-    QByteArray data;
-    QBuffer buffer(&data);
-    buffer.open(QIODevice::WriteOnly);
-    
-    if (!pixmap.save(&buffer, "JPEG", 90)) {
-        qWarning() << "Failed to convert pixmap to JPEG for caching";
+    if (!m_db) {
         return;
     }
     
-    QSqlQuery query(m_db);
-    query.prepare(R"(
-        INSERT OR REPLACE INTO image_cache (url, data, cached_at, size)
-        VALUES (?, ?, ?, ?)
-    )");
-    query.addBindValue(url);
-    query.addBindValue(data);
-    query.addBindValue(QDateTime::currentSecsSinceEpoch());
-    query.addBindValue(data.size());
-    
-    if (query.exec()) {
-        emit imageCached(url);
-    } else {
-        qWarning() << "Failed to save image to cache:" << query.lastError().text();
+    // A pixmap has lost its original encoding, so this has to re-encode;
+    // callers holding the server's bytes should use saveImageData().
+    // QPixmap is GUI-thread only; encode from a QImage on the writer.
+    const QImage image = pixmap.toImage();
+    const ImageStore *store = m_images.get();
+    m_db->enqueue([this, store, url, image](QSqlDatabase &db) {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        if (!image.save(&buffer, "JPEG", 90)) {
+            qWarning() << "Failed to convert pixmap to JPEG for caching";
+            return;
+        }
+        if (insertImage(db, *store, url, data)) {
+            QMetaObject::invokeMethod(this, [this, url]() {
+                emit imageCached(url);
+            }, Qt::QueuedConnection);
+        }
+    });
+    scheduleCollection(GC_IDLE_DELAY_MS);
+}
+
+QByteArray CacheManager::imageData(const QString& key) {
+    return imageDataAsync(key).result().toByteArray();
+}
+
+QFuture<ImageBytes> CacheManager::imageDataAsync(const QString& key) {
+    return imageDataAsync(QStringList{key}).then([](const QList<ImageBytes> &found) {
+        return found.value(0);
+    });
+}
+
+QFuture<QList<ImageBytes>> CacheManager::imageDataAsync(const QStringList& keys) {
+    if (!m_db) {
+        return QtFuture::makeReadyValueFuture(QList<ImageBytes>(keys.size()));
     }
+    const ImageStore *store = m_images.get();
+    CacheDatabase *database = m_db.get();
+    return m_db->read([store, database, keys](QSqlDatabase &db) {
+        QList<ImageBytes> result(keys.size());
+        QStringList hits;
+        for (qsizetype i = 0; i < keys.size(); ++i) {
+            QString hash;
+            result[i] = selectImage(db, *store, keys.at(i), &hash);
+            if (!result.at(i).isEmpty()) {
+                hits.append(hash);
+            }
+        }
+        
+        // Access times feed eviction; batch them with the other writes
+        // rather than writing from a reader.
+        if (!hits.isEmpty()) {
+            const qint64 now = QDateTime::currentSecsSinceEpoch();
+            database->enqueue([hits, now](QSqlDatabase &db) {
+                QSqlQuery &query = CacheDatabase::statement(db, "UPDATE image_blobs SET last_access = ? WHERE hash = ?");
+                for (const QString &hash : hits) {
+                    query.addBindValue(now);
+                    query.addBindValue(hash);
+                    query.exec();
+                }
+            });
+        }
+        return result;
+    });
+}
+
+void CacheManager::saveImageData(const QString& key, const QByteArray& data) {
+    if (!m_db || data.isEmpty()) {
+        return;
+    }
+    const ImageStore *store = m_images.get();
+    m_db->enqueue([this, store, key, data](QSqlDatabase &db) {
+        if (insertImage(db, *store, key, data)) {
+            QMetaObject::invokeMethod(this, [this, key]() {
+                emit imageCached(key);
+            }, Qt::QueuedConnection);
+        }
+    });
+    scheduleCollection(GC_IDLE_DELAY_MS);
 }
 
 void CacheManager::clearImageCache(int olderThanDays) {
-    QSqlQuery query(m_db);
-    qint64 threshold = QDateTime::currentSecsSinceEpoch() - (olderThanDays * 86400);
-    
-    query.prepare("DELETE FROM image_cache WHERE cached_at < ?");
-    query.addBindValue(threshold);
-    
-    if (query.exec()) {
-        qDebug() << "Cleared" << query.numRowsAffected() << "old images from cache";
+    m_imageMemoryCache.clear();
+    if (!m_db) {
+        return;
     }
+    qint64 threshold = QDateTime::currentSecsSinceEpoch() - (olderThanDays * 86400);
+    const ImageStore *store = m_images.get();
+    m_db->write([store, threshold](QSqlDatabase &db) {
+        // Images nobody has looked at since the threshold go, with every
+        // key that points at them.
+        QSqlQuery query(db);
+        query.prepare("DELETE FROM image_keys WHERE hash IN (SELECT hash FROM image_blobs WHERE last_access < ?)");
+        query.addBindValue(threshold);
+        
+        if (query.exec()) {
+            qDebug() << "Cleared" << query.numRowsAffected() << "old images from cache";
+        }
+        removeUnreferencedImages(db, *store);
+    });
+    refreshStats();
 }
 
 // Metadata cache methods
 bool CacheManager::hasMetadata(const QString& type, const QString& id) {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT 1 FROM metadata_cache WHERE type = ? AND id = ?");
-    query.addBindValue(type);
-    query.addBindValue(id);
-    
-    if (query.exec() && query.next()) {
-        return true;
+    if (!m_db) {
+        return false;
     }
-    return false;
+    return m_db->read([type, id](QSqlDatabase &db) {
+        return exists(db, "SELECT 1 FROM metadata_cache WHERE type = ? AND id = ?", {type, id});
+    }).result();
 }
 
 QVariantMap CacheManager::getMetadata(const QString& type, const QString& id) {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT data FROM metadata_cache WHERE type = ? AND id = ?");
-    query.addBindValue(type);
-    query.addBindValue(id);
-    
-    if (query.exec() && query.next()) {
-        QString jsonStr = query.value(0).toString();
-        QJsonDocument doc = QJsonDocument::fromJson(jsonStr.toUtf8());
-        return doc.object().toVariantMap();
+    return getMetadataAsync(type, id).result();
+}
+
+QFuture<QVariantMap> CacheManager::getMetadataAsync(const QString& type, const QString& id) {
+    if (!m_db) {
+        return QtFuture::makeReadyValueFuture(QVariantMap());
     }
-    
-    return QVariantMap();
+    CacheDatabase *database = m_db.get();
+    return m_db->read([database, type, id](QSqlDatabase &db) {
+        QSqlQuery &query = CacheDatabase::statement(db, "SELECT data FROM metadata_cache WHERE type = ? AND id = ?");
+        query.addBindValue(type);
+        query.addBindValue(id);
+        
+        QByteArray json;
+        if (query.exec() && query.next()) {
+            json = query.value(0).toString().toUtf8();
+        }
+        query.finish();
+        if (!json.isEmpty()) {
+            touch(database, "UPDATE metadata_cache SET last_access = ? WHERE type = ? AND id = ?", {type, id});
+        }
+        return QJsonDocument::fromJson(json).object().toVariantMap();
+    });
 }
 
 void CacheManager::saveMetadata(const QString& type, const QString& id, const QVariantMap& data) {
-    QJsonDocument doc = QJsonDocument::fromVariant(data);
-    QString jsonStr = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-    
-    QSqlQuery query(m_db);
-    query.prepare(R"(
-        INSERT OR REPLACE INTO metadata_cache (type, id, data, cached_at)
-        VALUES (?, ?, ?, ?)
-    )");
-    query.addBindValue(type);
-    query.addBindValue(id);
-    query.addBindValue(jsonStr);
-    query.addBindValue(QDateTime::currentSecsSinceEpoch());
-    
-    if (!query.exec()) {
-        qWarning() << "Failed to save metadata to cache:" << query.lastError().text();
+    saveMetadata(type, id, [data]() { return data; });
+}
+
+void CacheManager::saveMetadata(const QString& type, const QString& id, std::function<QVariantMap()> build) {
+    if (!m_db) {
+        return;
     }
+    // Serialization happens on the writer thread too.
+    m_db->enqueue([type, id, build = std::move(build)](QSqlDatabase &db) {
+        QJsonDocument doc = QJsonDocument::fromVariant(build());
+        QString jsonStr = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
+        
+        QSqlQuery &query = CacheDatabase::statement(db, R"(
+            INSERT OR REPLACE INTO metadata_cache (type, id, data, cached_at, last_access)
+            VALUES (?, ?, ?, ?, ?)
+        )");
+        const qint64 now = QDateTime::currentSecsSinceEpoch();
+        query.addBindValue(type);
+        query.addBindValue(id);
+        query.addBindValue(jsonStr);
+        query.addBindValue(now);
+        query.addBindValue(now);
+        
+        if (!query.exec()) {
+            qWarning() << "Failed to save metadata to cache:" << query.lastError().text();
+        }
+    });
+    scheduleCollection(GC_IDLE_DELAY_MS);
 }
 
 void CacheManager::clearMetadataCache(int olderThanDays) {
-    QSqlQuery query(m_db);
-    qint64 threshold = QDateTime::currentSecsSinceEpoch() - (olderThanDays * 86400);
-    
-    query.prepare("DELETE FROM metadata_cache WHERE cached_at < ?");
-    query.addBindValue(threshold);
-    
-    if (query.exec()) {
-        qDebug() << "Cleared" << query.numRowsAffected() << "old metadata entries from cache";
+    if (!m_db) {
+        return;
     }
+    qint64 threshold = QDateTime::currentSecsSinceEpoch() - (olderThanDays * 86400);
+    m_db->write([threshold](QSqlDatabase &db) {
+        QSqlQuery query(db);
+        query.prepare("DELETE FROM metadata_cache WHERE cached_at < ?");
+        query.addBindValue(threshold);
+        
+        if (query.exec()) {
+            qDebug() << "Cleared" << query.numRowsAffected() << "old metadata entries from cache";
+        }
+    });
 }
 
 // List cache methods
 bool CacheManager::hasList(const QString& type) {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT 1 FROM list_cache WHERE type = ?");
-    query.addBindValue(type);
-    
-    if (query.exec() && query.next()) {
-        return true;
+    if (!m_db) {
+        return false;
     }
-    return false;
+    return m_db->read([type](QSqlDatabase &db) {
+        return exists(db, "SELECT 1 FROM list_cache WHERE type = ?", {type});
+    }).result();
 }
 
 QVariantList CacheManager::getList(const QString& type) {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT data FROM list_cache WHERE type = ?");
-    query.addBindValue(type);
-    
-    if (query.exec() && query.next()) {
-        QString jsonStr = query.value(0).toString();
-        QJsonDocument doc = QJsonDocument::fromJson(jsonStr.toUtf8());
-        return doc.array().toVariantList();
+    return getListAsync(type).result();
+}
+
+QFuture<QVariantList> CacheManager::getListAsync(const QString& type) {
+    if (!m_db) {
+        return QtFuture::makeReadyValueFuture(QVariantList());
     }
-    
-    return QVariantList();
+    CacheDatabase *database = m_db.get();
+    return m_db->read([database, type](QSqlDatabase &db) {
+        QSqlQuery &query = CacheDatabase::statement(db, "SELECT data FROM list_cache WHERE type = ?");
+        query.addBindValue(type);
+        
+        QByteArray json;
+        if (query.exec() && query.next()) {
+            json = query.value(0).toString().toUtf8();
+        }
+        query.finish();
+        if (!json.isEmpty()) {
+            touch(database, "UPDATE list_cache SET last_access = ? WHERE type = ?", {type});
+        }
+        return QJsonDocument::fromJson(json).array().toVariantList();
+    });
 }
 
 void CacheManager::saveList(const QString& type, const QVariantList& data) {
-    QJsonDocument doc = QJsonDocument::fromVariant(data);
-    QString jsonStr = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-    
-    QSqlQuery query(m_db);
-    query.prepare(R"(
-        INSERT OR REPLACE INTO list_cache (type, data, cached_at)
-        VALUES (?, ?, ?)
-    )");
-    query.addBindValue(type);
-    query.addBindValue(jsonStr);
-    query.addBindValue(QDateTime::currentSecsSinceEpoch());
-    
-    if (!query.exec()) {
-        qWarning() << "Failed to save list to cache:" << query.lastError().text();
+    if (!m_db) {
+        return;
+    }
+    // Large lists (every artist) take a while to serialize; do it on the
+    // writer rather than in the caller's reply handler.
+    m_db->enqueue([type, data, dir = m_snapshotDir](QSqlDatabase &db) {
+        QJsonDocument doc = QJsonDocument::fromVariant(data);
+        QString jsonStr = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
+        // Replaces a snapshot stored under the same type, if any.
+        QFile::remove(snapshotPath(dir, type));
+        
+        QSqlQuery &query = CacheDatabase::statement(db, R"(
+            INSERT OR REPLACE INTO list_cache (type, data, cached_at, last_access)
+            VALUES (?, ?, ?, ?)
+        )");
+        const qint64 now = QDateTime::currentSecsSinceEpoch();
+        query.addBindValue(type);
+        query.addBindValue(jsonStr);
+        query.addBindValue(now);
+        query.addBindValue(now);
+        
+        if (!query.exec()) {
+            qWarning() << "Failed to save list to cache:" << query.lastError().text();
+        }
+    });
+    scheduleCollection(GC_IDLE_DELAY_MS);
+}
+
+QFuture<ListSnapshot> CacheManager::getListSnapshotAsync(const QString& type) {
+    if (!m_db) {
+        return QtFuture::makeReadyValueFuture(ListSnapshot());
     }
+    CacheDatabase *database = m_db.get();
+    return m_db->read([database, type, dir = m_snapshotDir](QSqlDatabase &db) {
+        if (!exists(db, "SELECT 1 FROM list_cache WHERE type = ? AND snapshot_size > 0", {type})) {
+            return ListSnapshot();
+        }
+        ListSnapshot snapshot = ListSnapshot::open(snapshotPath(dir, type));
+        if (snapshot.isValid()) {
+            touch(database, "UPDATE list_cache SET last_access = ? WHERE type = ?", {type});
+        }
+        return snapshot;
+    });
+}
+
+void CacheManager::saveListSnapshot(const QString& type, const TrackList& items) {
+    saveSnapshot(type, [items]() { return ListSnapshot::encode(items); });
+}
+
+void CacheManager::saveListSnapshot(const QString& type, const AlbumList& items) {
+    saveSnapshot(type, [items]() { return ListSnapshot::encode(items); });
+}
+
+void CacheManager::saveListSnapshot(const QString& type, const ArtistList& items) {
+    saveSnapshot(type, [items]() { return ListSnapshot::encode(items); });
+}
+
+void CacheManager::saveListSnapshot(const QString& type, const PlaylistList& items) {
+    saveSnapshot(type, [items]() { return ListSnapshot::encode(items); });
+}
+
+void CacheManager::saveSnapshot(const QString& type, std::function<QByteArray()> encode) {
+    if (!m_db) {
+        return;
+    }
+    m_db->enqueue([type, encode = std::move(encode), dir = m_snapshotDir](QSqlDatabase &db) {
+        const QByteArray data = encode();
+        // Renamed into place: a reader still mapping the old file keeps it.
+        QSaveFile file(snapshotPath(dir, type));
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            qWarning() << "Failed to write list snapshot" << file.fileName() << file.errorString();
+            return;
+        }
+        
+        QSqlQuery &query = CacheDatabase::statement(db, R"(
+            INSERT OR REPLACE INTO list_cache (type, data, cached_at, last_access, snapshot_size)
+            VALUES (?, '', ?, ?, ?)
+        )");
+        const qint64 now = QDateTime::currentSecsSinceEpoch();
+        query.addBindValue(type);
+        query.addBindValue(now);
+        query.addBindValue(now);
+        query.addBindValue(data.size());
+        
+        if (!query.exec()) {
+            qWarning() << "Failed to save list snapshot to cache:" << query.lastError().text();
+        }
+    });
+    scheduleCollection(GC_IDLE_DELAY_MS);
 }
 
 void CacheManager::clearListCache() {
-    QSqlQuery query(m_db);
-    if (query.exec("DELETE FROM list_cache")) {
-        qDebug() << "Cleared all list cache";
+    if (!m_db) {
+        return;
+    }
+    m_db->write([dir = m_snapshotDir](QSqlDatabase &db) {
+        QSqlQuery query(db);
+        if (query.exec("DELETE FROM list_cache")) {
+            qDebug() << "Cleared all list cache";
+        }
+        QDir(dir).removeRecursively();
+        QDir().mkpath(dir);
+    });
+}
+
+// Size limit and collection
+void CacheManager::setCacheLimit(qint64 bytes) {
+    bytes = qMax(bytes, MIN_CACHE_LIMIT);
+    if (bytes == m_cacheLimit) {
+        return;
     }
+    m_cacheLimit = bytes;
+    QSettings settings;
+    settings.setValue("cache/limitBytes", bytes);
+    emit cacheLimitChanged();
+    scheduleCollection(0);
+}
+
+void CacheManager::scheduleCollection(int delayMs) {
+    // Never postpones a run that is already due sooner, so a steady stream
+    // of writes cannot keep collection from happening.
+    if (!m_db || (m_gcTimer.isActive() && m_gcTimer.remainingTime() <= delayMs)) {
+        return;
+    }
+    m_gcTimer.start(delayMs);
+}
+
+void CacheManager::collectGarbage() {
+    if (!m_db) {
+        return;
+    }
+    const ImageStore *store = m_images.get();
+    const CachePaths paths{m_db->path(), networkCacheDirectory(), audioCacheDirectory(), m_snapshotDir};
+    const qint64 limit = m_cacheLimit;
+    if (!m_gcFiles) {
+        m_gcFiles = std::make_shared<CacheFileIndex>();
+    }
+    m_db->write([store, paths, limit, files = m_gcFiles](QSqlDatabase &db) {
+        return collect(db, *store, paths, limit, *files);
+    }).then(this, [this](CacheStats stats) {
+        if (!stats.more) {
+            m_gcFiles.reset();
+        }
+        applyStats(stats.size, stats.imageCount);
+        scheduleCollection(stats.more ? GC_CONTINUE_DELAY_MS : GC_PERIOD_MS);
+    });
+}
+
+void CacheManager::applyStats(qint64 size, int imageCount) {
+    if (size == m_cacheSize && imageCount == m_imageCount) {
+        return;
+    }
+    m_cacheSize = size;
+    m_imageCount = imageCount;
+    emit statsChanged();
 }
 
 // Statistics methods
+void CacheManager::refreshStats() {
+    if (!m_db) {
+        return;
+    }
+    // Queued behind pending writes so the numbers reflect them.
+    const CachePaths paths{m_db->path(), networkCacheDirectory(), audioCacheDirectory(), m_snapshotDir};
+    m_db->write([paths](QSqlDatabase &db) {
+        return readStats(db, paths);
+    }).then(this, [this](CacheStats stats) {
+        applyStats(stats.size, stats.imageCount);
+    });
+}
+
 qint64 CacheManager::getCacheSize() {
-    QSqlQuery query(m_db);
-    query.exec("SELECT SUM(size) FROM image_cache");
-    
-    if (query.next()) {
-        return query.value(0).toLongLong();
+    if (!m_db) {
+        return 0;
     }
-    return 0;
+    const CachePaths paths{m_db->path(), networkCacheDirectory(), audioCacheDirectory(), m_snapshotDir};
+    return m_db->write([paths](QSqlDatabase &db) {
+        return readStats(db, paths).size;
+    }).result();
 }
 
 int CacheManager::getImageCount() {
-    QSqlQuery query(m_db);
-    query.exec("SELECT COUNT(*) FROM image_cache");
-    
-    if (query.next()) {
-        return query.value(0).toInt();
+    if (!m_db) {
+        return 0;
     }
-    return 0;
+    return m_db->write([](QSqlDatabase &db) {
+        int count = 0;
+        imageBytes(db, &count);
+        return count;
+    }).result();
 }
 
 void CacheManager::clearAllCache() {
     m_imageMemoryCache.clear();
-    QSqlQuery query(m_db);
-    query.exec("DELETE FROM image_cache");
-    query.exec("DELETE FROM metadata_cache");
-    query.exec("DELETE FROM list_cache");
-    query.exec("VACUUM");
+    m_gcFiles.reset();
+    if (m_db) {
+        const ImageStore *store = m_images.get();
+        m_db->write([store, dir = m_snapshotDir, network = networkCacheDirectory(),
+                     audio = audioCacheDirectory()](QSqlDatabase &db) {
+            QSqlQuery query(db);
+            query.exec("DELETE FROM image_keys");
+            query.exec("DELETE FROM image_blobs");
+            store->clear();
+            query.exec("DELETE FROM metadata_cache");
+            query.exec("DELETE FROM list_cache");
+            QDir(dir).removeRecursively();
+            QDir().mkpath(dir);
+            removeCachedFiles(network);
+            removeCachedFiles(audio);
+            query.exec("VACUUM");
+            qDebug() << "Cleared all cache data";
+        });
+        refreshStats();
+    }
     
-    qDebug() << "Cleared all cache data";
     emit cacheCleared();
 }
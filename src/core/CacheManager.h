@@ -1,39 +1,93 @@
 #pragma once
 #include <QObject>
-#include <QSqlDatabase>
 #include <QPixmap>
 #include <QVariantMap>
 #include <QVariantList>
 #include <QCache>
+#include <QFuture>
+#include <QTimer>
+#include <functional>
+#include <memory>
+
+#include "ImageStore.h"
+#include "ListSnapshot.h"
+
+class CacheDatabase;
+class QSqlDatabase;
+struct CacheFileIndex;
 
 class CacheManager : public QObject {
     Q_OBJECT
+    Q_PROPERTY(qint64 cacheSize READ cacheSize NOTIFY statsChanged)
+    Q_PROPERTY(int imageCount READ imageCount NOTIFY statsChanged)
+    Q_PROPERTY(qint64 cacheLimit READ cacheLimit WRITE setCacheLimit NOTIFY cacheLimitChanged)
 
 public:
     explicit CacheManager(QObject *parent = nullptr);
     ~CacheManager();
 
     bool initialize();
-    
+
+    // All database work runs on CacheDatabase threads. The *Async variants
+    // return futures; continue on the GUI thread with .then(this, ...).
+    // Writes are queued and return immediately. The blocking wrappers
+    // wait for the result and are kept for callers that need it at once.
+
     // Image cache
     Q_INVOKABLE bool hasImage(const QString& url);
     Q_INVOKABLE QPixmap getImage(const QString& url);
     Q_INVOKABLE void saveImage(const QString& url, const QPixmap& pixmap);
     Q_INVOKABLE void clearImageCache(int olderThanDays = 30);
-    
+    // Original encoded bytes, kept in a content-addressed ImageStore and
+    // memory-mapped on read; keys with identical images share one file.
+    QByteArray imageData(const QString& key);
+    QFuture<ImageBytes> imageDataAsync(const QString& key);
+    // One lookup for several keys; results in key order, empty when missing.
+    QFuture<QList<ImageBytes>> imageDataAsync(const QStringList& keys);
+    void saveImageData(const QString& key, const QByteArray& data);
+
     // Metadata cache
     Q_INVOKABLE bool hasMetadata(const QString& type, const QString& id);
     Q_INVOKABLE QVariantMap getMetadata(const QString& type, const QString& id);
+    QFuture<QVariantMap> getMetadataAsync(const QString& type, const QString& id);
     Q_INVOKABLE void saveMetadata(const QString& type, const QString& id, const QVariantMap& data);
+    // Builds the entry on the writer thread.
+    void saveMetadata(const QString& type, const QString& id, std::function<QVariantMap()> build);
     Q_INVOKABLE void clearMetadataCache(int olderThanDays = 7);
-    
+
     // List cache (artists, albums, playlists)
     Q_INVOKABLE bool hasList(const QString& type);
     Q_INVOKABLE QVariantList getList(const QString& type);
+    QFuture<QVariantList> getListAsync(const QString& type);
     Q_INVOKABLE void saveList(const QString& type, const QVariantList& data);
     Q_INVOKABLE void clearListCache();
-    
-    // Cache statistics
+    // Typed lists are stored as ListSnapshot files and mapped on read, so a
+    // cached list is on screen without JSON parsing or QVariant boxing.
+    // Encoding runs on the writer thread.
+    QFuture<ListSnapshot> getListSnapshotAsync(const QString& type);
+    void saveListSnapshot(const QString& type, const TrackList& items);
+    void saveListSnapshot(const QString& type, const AlbumList& items);
+    void saveListSnapshot(const QString& type, const ArtistList& items);
+    void saveListSnapshot(const QString& type, const PlaylistList& items);
+
+    // Byte budget shared by everything on disk: this database, the image
+    // store, the QNetworkDiskCache directory and StreamProxy's audio cache.
+    // Least recently used entries of any kind are evicted in the
+    // background, a chunk at a time, whenever the total goes over the limit.
+    qint64 cacheLimit() const { return m_cacheLimit; }
+    void setCacheLimit(qint64 bytes);
+    static QString networkCacheDirectory();
+    static QString audioCacheDirectory();
+
+    // For stores that keep their own tables in the cache database.
+    CacheDatabase *database() const { return m_db.get(); }
+
+    // Cache statistics. cacheSize is the real on-disk total across all of
+    // the above. The properties hold the last values read and are
+    // refreshed in the background; get* block for a fresh count.
+    qint64 cacheSize() const { return m_cacheSize; }
+    int imageCount() const { return m_imageCount; }
+    Q_INVOKABLE void refreshStats();
     Q_INVOKABLE qint64 getCacheSize();
     Q_INVOKABLE int getImageCount();
     Q_INVOKABLE void clearAllCache();
@@ -41,12 +95,27 @@ public:
 signals:
     void cacheCleared();
     void imageCached(const QString& url);
+    void statsChanged();
+    void cacheLimitChanged();
 
 private:
-    void createTables();
+    static bool createTables(QSqlDatabase &db);
     QString getCachePath();
-    
-    QSqlDatabase m_db;
+    void scheduleCollection(int delayMs);
+    void collectGarbage();
+    void applyStats(qint64 size, int imageCount);
+    void saveSnapshot(const QString& type, std::function<QByteArray()> encode);
+
+    // Declared first so it outlives the database and its queued writes.
+    std::unique_ptr<ImageStore> m_images;
+    std::unique_ptr<CacheDatabase> m_db;
     QString m_cachePath;
+    QString m_snapshotDir;
     QCache<QString, QPixmap> m_imageMemoryCache;
+    qint64 m_cacheSize = 0;
+    int m_imageCount = 0;
+    qint64 m_cacheLimit = 0;
+    QTimer m_gcTimer;
+    // Carried between the steps of one collection run.
+    std::shared_ptr<CacheFileIndex> m_gcFiles;
 };
@@ -0,0 +1,345 @@
+#include "CoverImageProvider.h"
+#include "SubsonicClient.h"
+#include "CacheManager.h"
+#include "RequestScheduler.h"
+
+#include <QBuffer>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QNetworkReply>
+#include <QThreadPool>
+#include <QFuture>
+#include <QUrl>
+#include <utility>
+
+namespace {
+
+constexpr int MASTER_SIZES[] = {512, 1024};
+constexpr int DEFAULT_COVER_SIZE = 300;
+
+// Halves both dimensions with a 2x2 box filter. Pixels are 32-bit
+// ARGB/RGB; masking with 0x00ff00ff lets one integer add sum two channels
+// at once with room for four samples, so a pixel costs a dozen integer ops
+// and the loop body auto-vectorizes.
+QImage halve(const QImage &src) {
+    const int width = src.width() / 2;
+    const int height = src.height() / 2;
+    QImage dst(width, height, src.format());
+    constexpr quint32 mask = 0x00ff00ffu;
+    constexpr quint32 round = 0x00020002u;
+
+    for (int y = 0; y < height; ++y) {
+        const auto *row0 = reinterpret_cast<const quint32 *>(src.constScanLine(2 * y));
+        const auto *row1 = reinterpret_cast<const quint32 *>(src.constScanLine(2 * y + 1));
+        auto *out = reinterpret_cast<quint32 *>(dst.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            const quint32 a = row0[2 * x], b = row0[2 * x + 1];
+            const quint32 c = row1[2 * x], d = row1[2 * x + 1];
+            const quint32 rb = (a & mask) + (b & mask) + (c & mask) + (d & mask);
+            const quint32 ag = ((a >> 8) & mask) + ((b >> 8) & mask) + ((c >> 8) & mask) + ((d >> 8) & mask);
+            out[x] = (((rb + round) >> 2) & mask) | ((((ag + round) >> 2) & mask) << 8);
+        }
+    }
+    return dst;
+}
+
+// Fits image into a size x size box. Halving does the bulk of the work
+// cheaply; the last, non power-of-two step uses Qt's smooth scaler on an
+// image that is already less than twice the target.
+QImage scaleTo(QImage image, int size) {
+    while (qMax(image.width(), image.height()) / 2 >= size && image.width() >= 2 && image.height() >= 2)
+        image = halve(image);
+    if (qMax(image.width(), image.height()) > size)
+        image = image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    return image;
+}
+
+QByteArray encode(const QImage &image) {
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, image.hasAlphaChannel() ? "PNG" : "JPEG", 90))
+        return {};
+    return data;
+}
+
+}
+
+// CoverRequestState / CoverImageResponse
+
+void CoverRequestState::finish(const QImage &image, const QString &error) {
+    QMutexLocker locker(&mutex);
+    CoverImageResponse *target = std::exchange(response, nullptr);
+    if (!target)
+        return;
+    target->m_image = image;
+    target->m_error = error;
+    // Still under the lock, so the response cannot be destroyed meanwhile.
+    emit target->finished();
+}
+
+void CoverRequestState::finishCancelled() {
+    finish({}, QStringLiteral("Cancelled"));
+}
+
+void CoverRequestState::cancel() {
+    std::function<void()> handler;
+    {
+        QMutexLocker locker(&mutex);
+        cancelled = true;
+        handler = std::exchange(cancelHandler, nullptr);
+    }
+    if (handler)
+        handler();
+}
+
+void CoverRequestState::setCancelHandler(std::function<void()> handler) {
+    {
+        QMutexLocker locker(&mutex);
+        if (!cancelled) {
+            cancelHandler = std::move(handler);
+            return;
+        }
+    }
+    handler();
+}
+
+CoverImageResponse::CoverImageResponse(std::shared_ptr<CoverRequestState> state)
+    : m_state(std::move(state)) {
+    m_state->response = this;
+}
+
+CoverImageResponse::~CoverImageResponse() {
+    QMutexLocker locker(&m_state->mutex);
+    m_state->response = nullptr;
+}
+
+QQuickTextureFactory *CoverImageResponse::textureFactory() const {
+    return QQuickTextureFactory::textureFactoryForImage(m_image);
+}
+
+QString CoverImageResponse::errorString() const {
+    return m_error;
+}
+
+void CoverImageResponse::cancel() {
+    m_state->cancel();
+}
+
+// CoverArtLoader
+
+CoverArtLoader::CoverArtLoader(SubsonicClient *api, CacheManager *cache, QObject *parent)
+    : QObject(parent), m_api(api), m_cache(cache), m_scheduler(new RequestScheduler(&m_nam, this)) {
+    m_nam.setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+}
+
+int CoverArtLoader::masterSizeFor(int size) {
+    for (const int master : MASTER_SIZES) {
+        if (size <= master)
+            return master;
+    }
+    return size;
+}
+
+QString CoverArtLoader::cacheKey(const QString &coverId, int size) const {
+    return QStringLiteral("cover:%1|%2|%3").arg(m_api ? m_api->serverUrl() : QString(), coverId).arg(size);
+}
+
+void CoverArtLoader::load(const QString &coverId, int size, const std::shared_ptr<CoverRequestState> &state) {
+    if (state->cancelled) {
+        state->finishCancelled();
+        return;
+    }
+    if (coverId.isEmpty() || !m_api || !m_cache) {
+        state->finish({}, tr("No cover art"));
+        return;
+    }
+
+    // The exact size, then any stored master that can be scaled down, all
+    // in one lookup on the cache's reader threads.
+    QList<int> sizes{size};
+    for (const int master : MASTER_SIZES) {
+        if (master > size)
+            sizes.append(master);
+    }
+    QStringList keys;
+    for (const int candidate : std::as_const(sizes))
+        keys.append(cacheKey(coverId, candidate));
+
+    m_cache->imageDataAsync(keys).then(this, [this, coverId, size, sizes, state](const QList<ImageBytes> &found) {
+        if (state->cancelled) {
+            state->finishCancelled();
+            return;
+        }
+        for (qsizetype i = 0; i < found.size(); ++i) {
+            if (!found.at(i).isEmpty()) {
+                deriveAsync(coverId, found.at(i), sizes.at(i), {{size, state}}, false);
+                return;
+            }
+        }
+        if (!m_api) {
+            state->finish({}, tr("No cover art"));
+            return;
+        }
+        fetchMaster(coverId, masterSizeFor(size), {size, state});
+    });
+}
+
+void CoverArtLoader::fetchMaster(const QString &coverId, int masterSize, Waiter waiter) {
+    const QString key = cacheKey(coverId, masterSize);
+    auto pending = m_pendingFetches.find(key);
+    if (pending != m_pendingFetches.end()) {
+        pending->waiters.append(waiter);
+        watchCancel(key, waiter);
+        return;
+    }
+
+    QNetworkRequest request(m_api->coverArtUrl(coverId, masterSize));
+    request.setRawHeader("Accept", "image/jpeg,image/png;q=0.9,*/*;q=0.8");
+    QNetworkReply *reply = m_scheduler->get(request, RequestPriority::Visible);
+    m_pendingFetches.insert(key, {{waiter}, reply});
+    watchCancel(key, waiter);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, key, coverId, masterSize]() {
+        reply->deleteLater();
+        const QList<Waiter> waiters = m_pendingFetches.take(key).waiters;
+        if (reply->error() != QNetworkReply::NoError) {
+            const QString message = reply->errorString();
+            for (const auto &waiter : waiters)
+                waiter.state->finish({}, message);
+            return;
+        }
+        deriveAsync(coverId, ImageBytes(reply->readAll()), masterSize, waiters, true);
+    });
+}
+
+// A cover scrolled out of view cancels its response; once nobody waits
+// for a master any more, its download is dropped.
+void CoverArtLoader::watchCancel(const QString &key, const Waiter &waiter) {
+    QPointer<CoverArtLoader> guard(this);
+    waiter.state->setCancelHandler([guard, key]() {
+        QMetaObject::invokeMethod(guard.data(), [guard, key]() {
+            if (guard)
+                guard->dropIfAbandoned(key);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void CoverArtLoader::dropIfAbandoned(const QString &key) {
+    const auto pending = m_pendingFetches.constFind(key);
+    if (pending == m_pendingFetches.constEnd())
+        return;
+    for (const auto &waiter : pending->waiters) {
+        if (!waiter.state->cancelled)
+            return;
+    }
+    const PendingFetch fetch = m_pendingFetches.take(key);
+    if (QNetworkReply *reply = fetch.reply) {
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+    for (const auto &waiter : fetch.waiters)
+        waiter.state->finishCancelled();
+}
+
+void CoverArtLoader::deriveAsync(const QString &coverId, ImageBytes master, int masterSize,
+                                 QList<Waiter> waiters, bool storeMaster) {
+    // Keys are built here: the server URL must be read on this thread.
+    const QString masterKey = cacheKey(coverId, masterSize);
+    QList<QString> variantKeys;
+    variantKeys.reserve(waiters.size());
+    for (const auto &waiter : std::as_const(waiters))
+        variantKeys.append(cacheKey(coverId, waiter.size));
+
+    QPointer<CoverArtLoader> guard(this);
+    QThreadPool::globalInstance()->start([guard, master = std::move(master), masterSize, masterKey,
+                                          waiters = std::move(waiters), variantKeys, storeMaster]() {
+        bool anyWaiting = false;
+        for (const auto &waiter : waiters) {
+            if (waiter.state->cancelled)
+                waiter.state->finishCancelled();
+            else
+                anyWaiting = true;
+        }
+        // A downloaded master is still worth keeping for the next request.
+        if (!anyWaiting && !storeMaster)
+            return;
+
+        QImage image;
+        if (!image.loadFromData(master.view())) {
+            // Typically an error document instead of an image; don't store it.
+            for (const auto &waiter : waiters)
+                waiter.state->finish({}, QStringLiteral("Invalid cover art data"));
+            return;
+        }
+        image.convertTo(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+
+        QList<std::pair<QString, QByteArray>> toStore;
+        if (storeMaster)
+            toStore.append({masterKey, master.toByteArray()});
+
+        QHash<int, QImage> scaled;
+        for (qsizetype i = 0; i < waiters.size(); ++i) {
+            const Waiter &waiter = waiters.at(i);
+            if (waiter.state->cancelled) {
+                waiter.state->finishCancelled();
+                continue;
+            }
+            auto it = scaled.find(waiter.size);
+            if (it == scaled.end()) {
+                it = scaled.insert(waiter.size, scaleTo(image, waiter.size));
+                if (waiter.size != masterSize) {
+                    QByteArray encoded = encode(*it);
+                    if (!encoded.isEmpty())
+                        toStore.append({variantKeys.at(i), std::move(encoded)});
+                }
+            }
+            waiter.state->finish(*it);
+        }
+
+        if (!guard || toStore.isEmpty())
+            return;
+        QMetaObject::invokeMethod(guard.data(), [guard, toStore]() {
+            if (!guard)
+                return;
+            for (const auto &entry : toStore)
+                guard->store(entry.first, entry.second);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void CoverArtLoader::store(const QString &key, const QByteArray &data) {
+    if (m_cache)
+        m_cache->saveImageData(key, data);
+}
+
+// CoverImageProvider
+
+CoverImageProvider::CoverImageProvider(SubsonicClient *api, CacheManager *cache)
+    : m_loader(new CoverArtLoader(api, cache)) {
+}
+
+CoverImageProvider::~CoverImageProvider() {
+    m_loader->deleteLater();
+}
+
+QQuickImageResponse *CoverImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize) {
+    // id is "<percent-encoded cover id>/<size>"; a smaller sourceSize wins.
+    const qsizetype slash = id.lastIndexOf(QLatin1Char('/'));
+    const QString coverId = QUrl::fromPercentEncoding(id.left(qMax<qsizetype>(slash, 0)).toUtf8());
+    int size = slash >= 0 ? id.mid(slash + 1).toInt() : 0;
+    const int requested = qMax(requestedSize.width(), requestedSize.height());
+    if (requested > 0 && (size <= 0 || requested < size))
+        size = requested;
+    if (size <= 0)
+        size = DEFAULT_COVER_SIZE;
+
+    auto state = std::make_shared<CoverRequestState>();
+    auto *response = new CoverImageResponse(state);
+    // Always answer asynchronously: QtQuick connects to finished() only
+    // after this returns.
+    QMetaObject::invokeMethod(m_loader, [loader = m_loader, coverId, size, state]() {
+        loader->load(coverId, size, state);
+    }, Qt::QueuedConnection);
+    return response;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <QQuickAsyncImageProvider>
+#include <QQuickImageResponse>
+#include <QNetworkAccessManager>
+#include <QImage>
+#include <QMutex>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "ImageStore.h"
+
+class SubsonicClient;
+class CacheManager;
+class RequestScheduler;
+class CoverImageResponse;
+class QNetworkReply;
+
+// Shared between a response (owned by QtQuick on the pixmap reader thread)
+// and the loader working on it, which may outlive the response.
+struct CoverRequestState {
+    QMutex mutex;
+    CoverImageResponse *response = nullptr;
+    std::atomic<bool> cancelled{false};
+    std::function<void()> cancelHandler;  // under mutex; run once on cancel()
+
+    void finish(const QImage &image, const QString &error = {});
+    // QtQuick still expects finished() after cancelling; every cancelled
+    // path ends in finishCancelled().
+    void finishCancelled();
+    void cancel();
+    // Runs handler at once if the request is already cancelled.
+    void setCancelHandler(std::function<void()> handler);
+};
+
+class CoverImageResponse : public QQuickImageResponse {
+public:
+    explicit CoverImageResponse(std::shared_ptr<CoverRequestState> state);
+    ~CoverImageResponse() override;
+
+    QQuickTextureFactory *textureFactory() const override;
+    QString errorString() const override;
+    void cancel() override;
+
+private:
+    friend struct CoverRequestState;
+
+    std::shared_ptr<CoverRequestState> m_state;
+    QImage m_image;
+    QString m_error;
+};
+
+// Fetches, derives and stores cover art on the GUI thread, where the
+// client and the cache database live. Decoding and scaling run on the
+// thread pool.
+class CoverArtLoader : public QObject {
+    Q_OBJECT
+public:
+    CoverArtLoader(SubsonicClient *api, CacheManager *cache, QObject *parent = nullptr);
+
+    void load(const QString &coverId, int size, const std::shared_ptr<CoverRequestState> &state);
+
+    // Sizes fetched from the server; every other size is derived from the
+    // smallest master at least as large.
+    static int masterSizeFor(int size);
+
+private:
+    struct Waiter {
+        int size;
+        std::shared_ptr<CoverRequestState> state;
+    };
+
+    struct PendingFetch {
+        QList<Waiter> waiters;
+        QPointer<QNetworkReply> reply;
+    };
+
+    QString cacheKey(const QString &coverId, int size) const;
+    void fetchMaster(const QString &coverId, int masterSize, Waiter waiter);
+    void watchCancel(const QString &key, const Waiter &waiter);
+    void dropIfAbandoned(const QString &key);
+    void deriveAsync(const QString &coverId, ImageBytes master, int masterSize,
+                     QList<Waiter> waiters, bool storeMaster);
+    void store(const QString &key, const QByteArray &data);
+
+    QPointer<SubsonicClient> m_api;
+    QPointer<CacheManager> m_cache;
+    QNetworkAccessManager m_nam;
+    RequestScheduler *m_scheduler;
+    QHash<QString, PendingFetch> m_pendingFetches; // by master cache key
+};
+
+// Serves image://cover/<id>/<size>. Each cover is downloaded once at a
+// master size and the smaller sizes QML asks for are scaled locally and
+// kept in the CacheManager image table, so a grid showing the same album
+// at 128 and 256 px costs one round trip instead of two.
+class CoverImageProvider : public QQuickAsyncImageProvider {
+public:
+    CoverImageProvider(SubsonicClient *api, CacheManager *cache);
+    ~CoverImageProvider() override;
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+private:
+    CoverArtLoader *m_loader;
+};
@@ -0,0 +1,79 @@
+#include "ImageStore.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDebug>
+
+QByteArrayView ImageBytes::view() const {
+    if (m_mapped) {
+        return QByteArrayView(m_mapped, m_mappedSize);
+    }
+    return QByteArrayView(m_bytes);
+}
+
+QByteArray ImageBytes::toByteArray() const {
+    if (m_mapped) {
+        return view().toByteArray();
+    }
+    return m_bytes;
+}
+
+ImageStore::ImageStore(const QString &root) : m_root(root) {
+    QDir().mkpath(m_root);
+}
+
+QString ImageStore::hashOf(QByteArrayView data) {
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+}
+
+QString ImageStore::pathFor(const QString &hash) const {
+    return m_root + QLatin1Char('/') + hash.left(2) + QLatin1Char('/') + hash;
+}
+
+bool ImageStore::write(const QString &hash, QByteArrayView data) const {
+    const QString path = pathFor(hash);
+    // Same hash, same bytes: nothing to do.
+    if (QFileInfo::exists(path)) {
+        return true;
+    }
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // QSaveFile renames into place, so readers never map a partial file.
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(data.data(), data.size()) != data.size()
+        || !file.commit()) {
+        qWarning() << "Failed to write cached image" << path << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+ImageBytes ImageStore::map(const QString &hash) const {
+    ImageBytes bytes;
+    auto file = std::make_shared<QFile>(pathFor(hash));
+    if (!file->open(QIODevice::ReadOnly) || file->size() == 0) {
+        return bytes;
+    }
+    uchar *mapped = file->map(0, file->size());
+    if (!mapped) {
+        // Some filesystems refuse mappings; fall back to a plain read.
+        bytes.m_bytes = file->readAll();
+        return bytes;
+    }
+    bytes.m_mappedSize = file->size();
+    bytes.m_mapped = mapped;
+    bytes.m_file = std::move(file);
+    return bytes;
+}
+
+bool ImageStore::remove(const QString &hash) const {
+    return QFile::remove(pathFor(hash));
+}
+
+void ImageStore::clear() const {
+    QDir(m_root).removeRecursively();
+    QDir().mkpath(m_root);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <memory>
+
+class QFile;
+
+// Encoded image bytes, either memory-mapped from the ImageStore or held in
+// memory (fresh from the network). Cheap to copy; a mapping stays valid
+// for as long as any copy is alive.
+class ImageBytes {
+public:
+    ImageBytes() = default;
+    explicit ImageBytes(QByteArray bytes) : m_bytes(std::move(bytes)) {}
+
+    QByteArrayView view() const;
+    bool isEmpty() const { return view().isEmpty(); }
+    qsizetype size() const { return view().size(); }
+    // Copies mapped data; free for in-memory bytes.
+    QByteArray toByteArray() const;
+
+private:
+    friend class ImageStore;
+
+    std::shared_ptr<QFile> m_file;
+    const uchar *m_mapped = nullptr;
+    qint64 m_mappedSize = 0;
+    QByteArray m_bytes;
+};
+
+// Content-addressed directory of original image files, sharded by the
+// first two hex digits of their SHA-256 (images/ab/abcdef...). Identical
+// images share one file whatever key they were stored under; CacheManager
+// keeps the key -> hash index and access times in SQLite. Thread safe.
+class ImageStore {
+public:
+    explicit ImageStore(const QString &root);
+
+    static QString hashOf(QByteArrayView data);
+
+    // Writes data under hash unless a file is already there.
+    bool write(const QString &hash, QByteArrayView data) const;
+    ImageBytes map(const QString &hash) const;
+    bool remove(const QString &hash) const;
+    void clear() const;
+
+    QString root() const { return m_root; }
+
+private:
+    QString pathFor(const QString &hash) const;
+
+    QString m_root;
+};
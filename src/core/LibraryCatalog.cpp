@@ -0,0 +1,295 @@
+#include "LibraryCatalog.h"
+#include <QHashFunctions>
+
+static constexpr qsizetype INITIAL_STRING_SLOTS = 1024;
+
+template <typename T>
+static void storeColumn(QList<T> &column, LibraryCatalog::Handle handle, T value)
+{
+    if (handle == static_cast<LibraryCatalog::Handle>(column.size()))
+        column.append(value);
+    else
+        column[handle] = value;
+}
+
+template <typename T>
+static qsizetype columnBytes(const QList<T> &column)
+{
+    return column.capacity() * static_cast<qsizetype>(sizeof(T));
+}
+
+template <typename K, typename V>
+static qsizetype hashBytes(const QHash<K, V> &hash)
+{
+    // Key, value and per-entry span overhead; close enough for reporting.
+    return hash.capacity() * static_cast<qsizetype>(sizeof(K) + sizeof(V) + 1);
+}
+
+LibraryCatalog::LibraryCatalog()
+{
+    clear();
+}
+
+QStringView LibraryCatalog::view(StringId id) const
+{
+    if (id == 0 || id >= static_cast<StringId>(m_spans.size()))
+        return {};
+    const Span &span = m_spans.at(id);
+    return QStringView(m_arena).mid(span.offset, span.length);
+}
+
+LibraryCatalog::StringId LibraryCatalog::findString(QStringView str) const
+{
+    if (str.isEmpty() || m_slots.isEmpty())
+        return 0;
+    const size_t mask = static_cast<size_t>(m_slots.size()) - 1;
+    for (size_t i = qHash(str) & mask;; i = (i + 1) & mask)
+    {
+        const StringId id = m_slots.at(i);
+        if (id == 0)
+            return 0;
+        if (view(id) == str)
+            return id;
+    }
+}
+
+LibraryCatalog::StringId LibraryCatalog::intern(QStringView str)
+{
+    if (str.isEmpty())
+        return 0;
+
+    // Keep the table at most half full so probe runs stay short.
+    if (m_spans.size() * 2 >= m_slots.size())
+        growStringTable();
+
+    const size_t mask = static_cast<size_t>(m_slots.size()) - 1;
+    size_t i = qHash(str) & mask;
+    for (;; i = (i + 1) & mask)
+    {
+        const StringId id = m_slots.at(i);
+        if (id == 0)
+            break;
+        if (view(id) == str)
+            return id;
+    }
+
+    const StringId id = static_cast<StringId>(m_spans.size());
+    m_spans.append({static_cast<quint32>(m_arena.size()), static_cast<quint32>(str.size())});
+    m_arena.append(str);
+    m_slots[i] = id;
+    return id;
+}
+
+void LibraryCatalog::growStringTable()
+{
+    const qsizetype slotCount = m_slots.isEmpty() ? INITIAL_STRING_SLOTS : m_slots.size() * 2;
+    m_slots.fill(0, slotCount);
+
+    const size_t mask = static_cast<size_t>(slotCount) - 1;
+    for (StringId id = 1; id < static_cast<StringId>(m_spans.size()); ++id)
+    {
+        size_t i = qHash(view(id)) & mask;
+        while (m_slots.at(i) != 0)
+            i = (i + 1) & mask;
+        m_slots[i] = id;
+    }
+}
+
+LibraryCatalog::Handle LibraryCatalog::addTrack(const TrackEntry &entry)
+{
+    const StringId id = intern(entry.id);
+    Handle handle = id ? m_trackById.value(id, InvalidHandle) : InvalidHandle;
+    if (handle == InvalidHandle)
+    {
+        handle = static_cast<Handle>(m_tracks.id.size());
+        m_tracks.id.append(id);
+        if (id)
+            m_trackById.insert(id, handle);
+    }
+
+    storeColumn(m_tracks.title, handle, intern(entry.title));
+    storeColumn(m_tracks.artist, handle, intern(entry.artist));
+    storeColumn(m_tracks.artistId, handle, intern(entry.artistId));
+    storeColumn(m_tracks.album, handle, intern(entry.album));
+    storeColumn(m_tracks.albumId, handle, intern(entry.albumId));
+    storeColumn(m_tracks.coverArt, handle, intern(entry.coverArt));
+    storeColumn(m_tracks.duration, handle, entry.duration);
+    storeColumn(m_tracks.track, handle, entry.track);
+    storeColumn(m_tracks.year, handle, entry.year);
+    storeColumn(m_tracks.trackGain, handle, entry.replayGainTrackGain);
+    storeColumn(m_tracks.albumGain, handle, entry.replayGainAlbumGain);
+    return handle;
+}
+
+LibraryCatalog::Handle LibraryCatalog::addAlbum(const AlbumEntry &entry)
+{
+    const StringId id = intern(entry.id);
+    Handle handle = id ? m_albumById.value(id, InvalidHandle) : InvalidHandle;
+    if (handle == InvalidHandle)
+    {
+        handle = static_cast<Handle>(m_albums.id.size());
+        m_albums.id.append(id);
+        if (id)
+            m_albumById.insert(id, handle);
+    }
+
+    storeColumn(m_albums.name, handle, intern(entry.name));
+    storeColumn(m_albums.artist, handle, intern(entry.artist));
+    storeColumn(m_albums.artistId, handle, intern(entry.artistId));
+    storeColumn(m_albums.coverArt, handle, intern(entry.coverArt));
+    // Snapshots do not carry the creation date; keep the one already known.
+    if (!entry.created.isEmpty() || handle == static_cast<Handle>(m_albums.created.size()))
+        storeColumn(m_albums.created, handle, intern(entry.created));
+    storeColumn(m_albums.songCount, handle, entry.songCount);
+    storeColumn(m_albums.duration, handle, entry.duration);
+    storeColumn(m_albums.playCount, handle, entry.playCount);
+    storeColumn(m_albums.year, handle, entry.year);
+    return handle;
+}
+
+LibraryCatalog::Handle LibraryCatalog::addArtist(const ArtistEntry &entry)
+{
+    const StringId id = intern(entry.id);
+    Handle handle = id ? m_artistById.value(id, InvalidHandle) : InvalidHandle;
+    if (handle == InvalidHandle)
+    {
+        handle = static_cast<Handle>(m_artists.id.size());
+        m_artists.id.append(id);
+        if (id)
+            m_artistById.insert(id, handle);
+    }
+
+    storeColumn(m_artists.name, handle, intern(entry.name));
+    storeColumn(m_artists.coverArt, handle, intern(entry.coverArt));
+    storeColumn(m_artists.albumCount, handle, entry.albumCount);
+    return handle;
+}
+
+LibraryCatalog::Handle LibraryCatalog::findTrack(QStringView id) const
+{
+    const StringId sid = findString(id);
+    return sid ? m_trackById.value(sid, InvalidHandle) : InvalidHandle;
+}
+
+LibraryCatalog::Handle LibraryCatalog::findAlbum(QStringView id) const
+{
+    const StringId sid = findString(id);
+    return sid ? m_albumById.value(sid, InvalidHandle) : InvalidHandle;
+}
+
+LibraryCatalog::Handle LibraryCatalog::findArtist(QStringView id) const
+{
+    const StringId sid = findString(id);
+    return sid ? m_artistById.value(sid, InvalidHandle) : InvalidHandle;
+}
+
+TrackEntry LibraryCatalog::track(Handle handle) const
+{
+    TrackEntry entry;
+    if (handle >= static_cast<Handle>(m_tracks.id.size()))
+        return entry;
+    entry.id = string(m_tracks.id.at(handle));
+    entry.title = string(m_tracks.title.at(handle));
+    entry.artist = string(m_tracks.artist.at(handle));
+    entry.artistId = string(m_tracks.artistId.at(handle));
+    entry.album = string(m_tracks.album.at(handle));
+    entry.albumId = string(m_tracks.albumId.at(handle));
+    entry.coverArt = string(m_tracks.coverArt.at(handle));
+    entry.duration = m_tracks.duration.at(handle);
+    entry.track = m_tracks.track.at(handle);
+    entry.year = m_tracks.year.at(handle);
+    entry.replayGainTrackGain = m_tracks.trackGain.at(handle);
+    entry.replayGainAlbumGain = m_tracks.albumGain.at(handle);
+    return entry;
+}
+
+AlbumEntry LibraryCatalog::album(Handle handle) const
+{
+    AlbumEntry entry;
+    if (handle >= static_cast<Handle>(m_albums.id.size()))
+        return entry;
+    entry.id = string(m_albums.id.at(handle));
+    entry.name = string(m_albums.name.at(handle));
+    entry.artist = string(m_albums.artist.at(handle));
+    entry.artistId = string(m_albums.artistId.at(handle));
+    entry.coverArt = string(m_albums.coverArt.at(handle));
+    entry.created = string(m_albums.created.at(handle));
+    entry.songCount = m_albums.songCount.at(handle);
+    entry.duration = m_albums.duration.at(handle);
+    entry.playCount = m_albums.playCount.at(handle);
+    entry.year = m_albums.year.at(handle);
+    return entry;
+}
+
+ArtistEntry LibraryCatalog::artist(Handle handle) const
+{
+    ArtistEntry entry;
+    if (handle >= static_cast<Handle>(m_artists.id.size()))
+        return entry;
+    entry.id = string(m_artists.id.at(handle));
+    entry.name = string(m_artists.name.at(handle));
+    entry.coverArt = string(m_artists.coverArt.at(handle));
+    entry.albumCount = m_artists.albumCount.at(handle);
+    return entry;
+}
+
+qsizetype LibraryCatalog::memoryUsage() const
+{
+    qsizetype bytes = m_arena.capacity() * static_cast<qsizetype>(sizeof(QChar));
+    bytes += columnBytes(m_spans) + columnBytes(m_slots);
+
+    bytes += columnBytes(m_tracks.id) + columnBytes(m_tracks.title) + columnBytes(m_tracks.artist)
+             + columnBytes(m_tracks.artistId) + columnBytes(m_tracks.album) + columnBytes(m_tracks.albumId)
+             + columnBytes(m_tracks.coverArt) + columnBytes(m_tracks.duration) + columnBytes(m_tracks.track)
+             + columnBytes(m_tracks.year) + columnBytes(m_tracks.trackGain) + columnBytes(m_tracks.albumGain);
+    bytes += columnBytes(m_albums.id) + columnBytes(m_albums.name) + columnBytes(m_albums.artist)
+             + columnBytes(m_albums.artistId) + columnBytes(m_albums.coverArt) + columnBytes(m_albums.created)
+             + columnBytes(m_albums.songCount) + columnBytes(m_albums.duration) + columnBytes(m_albums.playCount) + columnBytes(m_albums.year);
+    bytes += columnBytes(m_artists.id) + columnBytes(m_artists.name) + columnBytes(m_artists.coverArt)
+             + columnBytes(m_artists.albumCount);
+
+    bytes += hashBytes(m_trackById) + hashBytes(m_albumById) + hashBytes(m_artistById);
+    return bytes;
+}
+
+template <typename Add>
+static QList<LibraryCatalog::Handle> keepLive(const QList<bool> &live, qsizetype count, Add add)
+{
+    QList<LibraryCatalog::Handle> remap(count, LibraryCatalog::InvalidHandle);
+    for (qsizetype handle = 0; handle < count && handle < live.size(); ++handle)
+    {
+        if (live.at(handle))
+            remap[handle] = add(static_cast<LibraryCatalog::Handle>(handle));
+    }
+    return remap;
+}
+
+LibraryCatalog::Remap LibraryCatalog::compact(const QList<bool> &liveTracks, const QList<bool> &liveAlbums,
+                                              const QList<bool> &liveArtists)
+{
+    // Re-adding the live records to an empty catalog interns only the
+    // strings they use, in the order they are first needed.
+    LibraryCatalog next;
+    Remap remap;
+    remap.tracks = keepLive(liveTracks, trackCount(), [&](Handle handle)
+                            { return next.addTrack(track(handle)); });
+    remap.albums = keepLive(liveAlbums, albumCount(), [&](Handle handle)
+                            { return next.addAlbum(album(handle)); });
+    remap.artists = keepLive(liveArtists, artistCount(), [&](Handle handle)
+                             { return next.addArtist(artist(handle)); });
+    *this = std::move(next);
+    return remap;
+}
+
+void LibraryCatalog::clear()
+{
+    m_arena = QString();
+    m_spans = {{0, 0}}; // string id 0 is the empty string
+    m_slots = {};
+    m_tracks = {};
+    m_albums = {};
+    m_artists = {};
+    m_trackById = {};
+    m_albumById = {};
+    m_artistById = {};
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringView>
+#include "LibraryTypes.h"
+
+// Column store for every track, album and artist the client has loaded.
+// Records are addressed by dense 32-bit handles and keyed by their server
+// id, so loading the same album twice updates one row. All text lives once
+// in a shared UTF-16 arena; columns only hold 32-bit string ids into it.
+// Records are only added; compact() drops the ones no model refers to any
+// more. Not thread safe: owned and used by the GUI thread.
+class LibraryCatalog
+{
+public:
+    using Handle = quint32;
+    using StringId = quint32;
+    static constexpr Handle InvalidHandle = 0xffffffffu;
+
+    struct TrackColumns
+    {
+        QList<StringId> id, title, artist, artistId, album, albumId, coverArt;
+        QList<qint32> duration;
+        QList<qint16> track, year;
+        QList<float> trackGain, albumGain;
+    };
+
+    struct AlbumColumns
+    {
+        QList<StringId> id, name, artist, artistId, coverArt, created;
+        QList<qint32> songCount, duration, playCount;
+        QList<qint16> year;
+    };
+
+    struct ArtistColumns
+    {
+        QList<StringId> id, name, coverArt;
+        QList<qint32> albumCount;
+    };
+
+    // Old handle -> new handle per kind, InvalidHandle for dropped records.
+    struct Remap
+    {
+        QList<Handle> tracks, albums, artists;
+    };
+
+    LibraryCatalog();
+
+    Handle addTrack(const TrackEntry &entry);
+    Handle addAlbum(const AlbumEntry &entry);
+    Handle addArtist(const ArtistEntry &entry);
+
+    Handle findTrack(QStringView id) const;
+    Handle findAlbum(QStringView id) const;
+    Handle findArtist(QStringView id) const;
+
+    TrackEntry track(Handle handle) const;
+    AlbumEntry album(Handle handle) const;
+    ArtistEntry artist(Handle handle) const;
+
+    const TrackColumns &tracks() const { return m_tracks; }
+    const AlbumColumns &albums() const { return m_albums; }
+    const ArtistColumns &artists() const { return m_artists; }
+
+    // Views are invalidated by the next insertion; copy with string().
+    QStringView view(StringId id) const;
+    QString string(StringId id) const { return view(id).toString(); }
+
+    qsizetype trackCount() const { return m_tracks.id.size(); }
+    qsizetype albumCount() const { return m_albums.id.size(); }
+    qsizetype artistCount() const { return m_artists.id.size(); }
+
+    // Approximate heap footprint of the columns, arena and lookup tables.
+    qsizetype memoryUsage() const;
+
+    // Rebuilds the catalog with only the records marked live (by handle)
+    // and the strings they use. Every holder of handles or string ids must
+    // apply the returned remap before using them again.
+    Remap compact(const QList<bool> &liveTracks, const QList<bool> &liveAlbums, const QList<bool> &liveArtists);
+
+    void clear();
+
+private:
+    struct Span
+    {
+        quint32 offset;
+        quint32 length;
+    };
+
+    StringId intern(QStringView str);
+    StringId findString(QStringView str) const;
+    void growStringTable();
+
+    QString m_arena;
+    QList<Span> m_spans;
+    QList<StringId> m_slots; // open-addressed string dedup table, 0 = empty
+
+    TrackColumns m_tracks;
+    AlbumColumns m_albums;
+    ArtistColumns m_artists;
+    QHash<StringId, Handle> m_trackById;
+    QHash<StringId, Handle> m_albumById;
+    QHash<StringId, Handle> m_artistById;
+};
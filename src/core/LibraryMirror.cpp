@@ -0,0 +1,558 @@
+#include "LibraryMirror.h"
+#include "CacheDatabase.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+namespace {
+
+// Track lists are stored once per owner: "album:<id>" or
+// "playlist:<id>", in server order.
+constexpr const char *TRACK_COLUMNS =
+    "id, title, artist, artist_id, album, album_id, cover_art, duration, track, year, track_gain, album_gain";
+
+QString albumOwner(const QString &albumId) {
+    return QStringLiteral("album:") + albumId;
+}
+
+QString playlistOwner(const QString &playlistId) {
+    return QStringLiteral("playlist:") + playlistId;
+}
+
+void storeTracks(QSqlDatabase &db, const QString &owner, const TrackList &tracks) {
+    QSqlQuery &remove = CacheDatabase::statement(db, "DELETE FROM mirror_track_lists WHERE owner = ?");
+    remove.addBindValue(owner);
+    remove.exec();
+
+    QSqlQuery &insert = CacheDatabase::statement(db, R"(
+        INSERT INTO mirror_track_lists (owner, position, id, title, artist, artist_id, album, album_id,
+                                        cover_art, duration, track, year, track_gain, album_gain)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+    )");
+    for (qsizetype i = 0; i < tracks.size(); ++i) {
+        const TrackEntry &track = tracks.at(i);
+        insert.addBindValue(owner);
+        insert.addBindValue(i);
+        insert.addBindValue(track.id);
+        insert.addBindValue(track.title);
+        insert.addBindValue(track.artist);
+        insert.addBindValue(track.artistId);
+        insert.addBindValue(track.album);
+        insert.addBindValue(track.albumId);
+        insert.addBindValue(track.coverArt);
+        insert.addBindValue(track.duration);
+        insert.addBindValue(track.track);
+        insert.addBindValue(track.year);
+        insert.addBindValue(track.replayGainTrackGain);
+        insert.addBindValue(track.replayGainAlbumGain);
+        if (!insert.exec()) {
+            qWarning() << "Failed to mirror track" << track.id << insert.lastError().text();
+        }
+    }
+}
+
+TrackEntry readTrack(const QSqlQuery &query) {
+    TrackEntry track;
+    track.id = query.value(0).toString();
+    track.title = query.value(1).toString();
+    track.artist = query.value(2).toString();
+    track.artistId = query.value(3).toString();
+    track.album = query.value(4).toString();
+    track.albumId = query.value(5).toString();
+    track.coverArt = query.value(6).toString();
+    track.duration = query.value(7).toInt();
+    track.track = static_cast<qint16>(query.value(8).toInt());
+    track.year = static_cast<qint16>(query.value(9).toInt());
+    track.replayGainTrackGain = query.value(10).toFloat();
+    track.replayGainAlbumGain = query.value(11).toFloat();
+    return track;
+}
+
+TrackList readTracks(QSqlDatabase &db, const QString &owner) {
+    TrackList tracks;
+    QSqlQuery query(db);
+    query.prepare(QStringLiteral("SELECT %1 FROM mirror_track_lists WHERE owner = ? ORDER BY position")
+                      .arg(QLatin1String(TRACK_COLUMNS)));
+    query.addBindValue(owner);
+    if (!query.exec()) {
+        return tracks;
+    }
+    while (query.next()) {
+        tracks.append(readTrack(query));
+    }
+    return tracks;
+}
+
+AlbumEntry readAlbum(const QSqlQuery &query) {
+    AlbumEntry album;
+    album.id = query.value(0).toString();
+    album.name = query.value(1).toString();
+    album.artist = query.value(2).toString();
+    album.artistId = query.value(3).toString();
+    album.coverArt = query.value(4).toString();
+    album.songCount = query.value(5).toInt();
+    album.duration = query.value(6).toInt();
+    album.playCount = query.value(7).toInt();
+    album.year = static_cast<qint16>(query.value(8).toInt());
+    return album;
+}
+
+bool exists(QSqlDatabase &db, const char *sql, const QString &value) {
+    QSqlQuery &query = CacheDatabase::statement(db, sql);
+    query.addBindValue(value);
+    const bool found = query.exec() && query.next();
+    query.finish();
+    return found;
+}
+
+}
+
+LibraryMirror::LibraryMirror(CacheDatabase *db) : m_db(db) {
+    m_db->write([](QSqlDatabase &db) {
+        if (!createTables(db)) {
+            qWarning() << "Failed to create library mirror tables:" << db.lastError().text();
+        }
+    });
+}
+
+bool LibraryMirror::createTables(QSqlDatabase &db) {
+    QSqlQuery query(db);
+    query.exec(R"(
+        CREATE TABLE IF NOT EXISTS mirror_artists (
+            id TEXT PRIMARY KEY,
+            name TEXT NOT NULL,
+            cover_art TEXT,
+            album_count INTEGER NOT NULL,
+            position INTEGER NOT NULL
+        )
+    )");
+    query.exec(R"(
+        CREATE TABLE IF NOT EXISTS mirror_albums (
+            id TEXT PRIMARY KEY,
+            name TEXT NOT NULL,
+            artist TEXT,
+            artist_id TEXT,
+            cover_art TEXT,
+            song_count INTEGER NOT NULL,
+            duration INTEGER NOT NULL,
+            play_count INTEGER NOT NULL,
+            year INTEGER NOT NULL,
+            created TEXT,
+            changed TEXT
+        )
+    )");
+    // Albums whose tracks still have to be fetched; survives restarts so
+    // an interrupted sync picks up where it stopped.
+    query.exec(R"(
+        CREATE TABLE IF NOT EXISTS mirror_pending (
+            album_id TEXT PRIMARY KEY
+        )
+    )");
+    query.exec(R"(
+        CREATE TABLE IF NOT EXISTS mirror_playlists (
+            id TEXT PRIMARY KEY,
+            name TEXT NOT NULL,
+            cover_art TEXT,
+            song_count INTEGER NOT NULL,
+            duration INTEGER NOT NULL,
+            changed TEXT,
+            position INTEGER NOT NULL,
+            synced INTEGER NOT NULL DEFAULT 0
+        )
+    )");
+    query.exec(R"(
+        CREATE TABLE IF NOT EXISTS mirror_track_lists (
+            owner TEXT NOT NULL,
+            position INTEGER NOT NULL,
+            id TEXT NOT NULL,
+            title TEXT,
+            artist TEXT,
+            artist_id TEXT,
+            album TEXT,
+            album_id TEXT,
+            cover_art TEXT,
+            duration INTEGER,
+            track INTEGER,
+            year INTEGER,
+            track_gain REAL,
+            album_gain REAL,
+            PRIMARY KEY (owner, position)
+        )
+    )");
+    // Starred items used to be mirrored but were never read back.
+    query.exec("DROP TABLE IF EXISTS mirror_starred");
+    query.exec("DELETE FROM mirror_track_lists WHERE owner = 'starred'");
+    query.exec(R"(
+        CREATE TABLE IF NOT EXISTS mirror_state (
+            key TEXT PRIMARY KEY,
+            value TEXT
+        )
+    )");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_mirror_albums_artist ON mirror_albums(artist_id)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_mirror_track_lists_id ON mirror_track_lists(id)");
+    return !query.lastError().isValid();
+}
+
+// Reads
+
+QFuture<std::optional<ArtistList>> LibraryMirror::artists() const {
+    return m_db->read([](QSqlDatabase &db) -> std::optional<ArtistList> {
+        ArtistList artists;
+        QSqlQuery query(db);
+        if (!query.exec("SELECT id, name, cover_art, album_count FROM mirror_artists ORDER BY position")) {
+            return std::nullopt;
+        }
+        while (query.next()) {
+            ArtistEntry artist;
+            artist.id = query.value(0).toString();
+            artist.name = query.value(1).toString();
+            artist.coverArt = query.value(2).toString();
+            artist.albumCount = query.value(3).toInt();
+            artists.append(artist);
+        }
+        if (artists.isEmpty()) {
+            return std::nullopt;
+        }
+        return artists;
+    });
+}
+
+QFuture<std::optional<ArtistDetail>> LibraryMirror::artist(const QString &artistId) const {
+    return m_db->read([artistId](QSqlDatabase &db) -> std::optional<ArtistDetail> {
+        QSqlQuery query(db);
+        query.prepare("SELECT cover_art FROM mirror_artists WHERE id = ?");
+        query.addBindValue(artistId);
+        if (!query.exec() || !query.next()) {
+            return std::nullopt;
+        }
+        ArtistDetail detail;
+        detail.coverArt = query.value(0).toString();
+
+        query.prepare(R"(
+            SELECT id, name, artist, artist_id, cover_art, song_count, duration, play_count, year
+            FROM mirror_albums WHERE artist_id = ? ORDER BY year, name
+        )");
+        query.addBindValue(artistId);
+        if (query.exec()) {
+            while (query.next()) {
+                detail.albums.append(readAlbum(query));
+            }
+        }
+        return detail;
+    });
+}
+
+QFuture<std::optional<TrackList>> LibraryMirror::albumTracks(const QString &albumId) const {
+    return m_db->read([albumId](QSqlDatabase &db) -> std::optional<TrackList> {
+        if (!exists(db, "SELECT 1 FROM mirror_albums WHERE id = ?", albumId)
+            || exists(db, "SELECT 1 FROM mirror_pending WHERE album_id = ?", albumId)) {
+            return std::nullopt;
+        }
+        return readTracks(db, albumOwner(albumId));
+    });
+}
+
+QFuture<std::optional<TrackList>> LibraryMirror::playlistTracks(const QString &playlistId) const {
+    return m_db->read([playlistId](QSqlDatabase &db) -> std::optional<TrackList> {
+        if (!exists(db, "SELECT 1 FROM mirror_playlists WHERE id = ? AND synced = 1", playlistId)) {
+            return std::nullopt;
+        }
+        return readTracks(db, playlistOwner(playlistId));
+    });
+}
+
+QFuture<int> LibraryMirror::albumCount() const {
+    return m_db->read([](QSqlDatabase &db) {
+        QSqlQuery query(db);
+        return query.exec("SELECT COUNT(*) FROM mirror_albums") && query.next() ? query.value(0).toInt() : 0;
+    });
+}
+
+// Search
+
+QFuture<std::shared_ptr<const SearchIndex>> LibraryMirror::searchIndex() const {
+    return m_db->read([](QSqlDatabase &db) {
+        SearchIndex::Builder builder;
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        if (query.exec("SELECT id, name FROM mirror_artists")) {
+            while (query.next()) {
+                builder.add(SearchIndex::Kind::Artist, query.value(0).toString(), query.value(1).toString());
+            }
+        }
+        if (query.exec("SELECT id, name, artist FROM mirror_albums")) {
+            while (query.next()) {
+                builder.add(SearchIndex::Kind::Album, query.value(0).toString(), query.value(1).toString(),
+                            query.value(2).toString());
+            }
+        }
+        // Album track lists hold every track once; playlists repeat them.
+        if (query.exec("SELECT id, title, artist, album FROM mirror_track_lists WHERE owner LIKE 'album:%'")) {
+            while (query.next()) {
+                builder.add(SearchIndex::Kind::Track, query.value(0).toString(), query.value(1).toString(),
+                            query.value(2).toString() + QLatin1Char(' ') + query.value(3).toString());
+            }
+        }
+        return std::make_shared<const SearchIndex>(builder.build());
+    });
+}
+
+QFuture<SearchResults> LibraryMirror::resolve(const SearchIndex::Hits &hits) const {
+    return m_db->read([hits](QSqlDatabase &db) {
+        SearchResults results;
+        QSqlQuery &artist = CacheDatabase::statement(db, "SELECT id, name, cover_art, album_count FROM mirror_artists WHERE id = ?");
+        for (const QString &id : hits.artistIds) {
+            artist.addBindValue(id);
+            if (artist.exec() && artist.next()) {
+                ArtistEntry entry;
+                entry.id = artist.value(0).toString();
+                entry.name = artist.value(1).toString();
+                entry.coverArt = artist.value(2).toString();
+                entry.albumCount = artist.value(3).toInt();
+                results.artists.append(entry);
+            }
+            artist.finish();
+        }
+
+        QSqlQuery &album = CacheDatabase::statement(db, R"(
+            SELECT id, name, artist, artist_id, cover_art, song_count, duration, play_count, year
+            FROM mirror_albums WHERE id = ?
+        )");
+        for (const QString &id : hits.albumIds) {
+            album.addBindValue(id);
+            if (album.exec() && album.next()) {
+                results.albums.append(readAlbum(album));
+            }
+            album.finish();
+        }
+
+        QSqlQuery &track = CacheDatabase::statement(db, R"(
+            SELECT id, title, artist, artist_id, album, album_id, cover_art, duration, track, year, track_gain, album_gain
+            FROM mirror_track_lists WHERE id = ? AND owner LIKE 'album:%' LIMIT 1
+        )");
+        for (const QString &id : hits.trackIds) {
+            track.addBindValue(id);
+            if (track.exec() && track.next()) {
+                results.tracks.append(readTrack(track));
+            }
+            track.finish();
+        }
+        return results;
+    });
+}
+
+// State
+
+QFuture<QString> LibraryMirror::state(const QString &key) const {
+    // Through the writer so it sees every queued setState().
+    return m_db->write([key](QSqlDatabase &db) {
+        QSqlQuery query(db);
+        query.prepare("SELECT value FROM mirror_state WHERE key = ?");
+        query.addBindValue(key);
+        return query.exec() && query.next() ? query.value(0).toString() : QString();
+    });
+}
+
+void LibraryMirror::setState(const QString &key, const QString &value) {
+    m_db->enqueue([key, value](QSqlDatabase &db) {
+        QSqlQuery &query = CacheDatabase::statement(db, "INSERT OR REPLACE INTO mirror_state (key, value) VALUES (?, ?)");
+        query.addBindValue(key);
+        query.addBindValue(value);
+        query.exec();
+    });
+}
+
+QFuture<void> LibraryMirror::clear() {
+    return m_db->write([](QSqlDatabase &db) {
+        QSqlQuery query(db);
+        for (const char *table : {"mirror_artists", "mirror_albums", "mirror_pending", "mirror_playlists",
+                                  "mirror_track_lists", "mirror_state"}) {
+            query.exec(QStringLiteral("DELETE FROM %1").arg(QLatin1String(table)));
+        }
+    });
+}
+
+// Sync writes
+
+void LibraryMirror::replaceArtists(const ArtistList &artists) {
+    m_db->enqueue([artists](QSqlDatabase &db) {
+        QSqlQuery query(db);
+        query.exec("DELETE FROM mirror_artists");
+        query.prepare("INSERT OR REPLACE INTO mirror_artists (id, name, cover_art, album_count, position) VALUES (?, ?, ?, ?, ?)");
+        for (qsizetype i = 0; i < artists.size(); ++i) {
+            const ArtistEntry &artist = artists.at(i);
+            query.addBindValue(artist.id);
+            query.addBindValue(artist.name);
+            query.addBindValue(artist.coverArt);
+            query.addBindValue(artist.albumCount);
+            query.addBindValue(i);
+            query.exec();
+        }
+    });
+}
+
+QFuture<int> LibraryMirror::mergeAlbums(const AlbumList &albums) {
+    return m_db->write([albums](QSqlDatabase &db) {
+        db.transaction();
+        QSqlQuery query(db);
+        query.exec("CREATE TEMP TABLE IF NOT EXISTS listed_albums (id TEXT PRIMARY KEY)");
+        query.exec("DELETE FROM listed_albums");
+
+        QSqlQuery listed(db), previous(db), upsert(db), queue(db);
+        listed.prepare("INSERT OR IGNORE INTO listed_albums (id) VALUES (?)");
+        previous.prepare("SELECT created, changed, song_count, duration FROM mirror_albums WHERE id = ?");
+        upsert.prepare(R"(
+            INSERT OR REPLACE INTO mirror_albums (id, name, artist, artist_id, cover_art, song_count,
+                                                  duration, play_count, year, created, changed)
+            VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        )");
+        queue.prepare("INSERT OR IGNORE INTO mirror_pending (album_id) VALUES (?)");
+
+        for (const AlbumEntry &album : albums) {
+            listed.addBindValue(album.id);
+            listed.exec();
+
+            // created/changed catch edits; the counts catch servers that
+            // report neither.
+            previous.addBindValue(album.id);
+            const bool known = previous.exec() && previous.next();
+            const bool changed = !known
+                || previous.value(0).toString() != album.created
+                || previous.value(1).toString() != album.changed
+                || previous.value(2).toInt() != album.songCount
+                || previous.value(3).toInt() != album.duration;
+            previous.finish();
+
+            upsert.addBindValue(album.id);
+            upsert.addBindValue(album.name);
+            upsert.addBindValue(album.artist);
+            upsert.addBindValue(album.artistId);
+            upsert.addBindValue(album.coverArt);
+            upsert.addBindValue(album.songCount);
+            upsert.addBindValue(album.duration);
+            upsert.addBindValue(album.playCount);
+            upsert.addBindValue(album.year);
+            upsert.addBindValue(album.created);
+            upsert.addBindValue(album.changed);
+            upsert.exec();
+
+            if (changed) {
+                queue.addBindValue(album.id);
+                queue.exec();
+            }
+        }
+
+        query.exec(R"(
+            DELETE FROM mirror_track_lists WHERE owner IN (
+                SELECT 'album:' || id FROM mirror_albums WHERE id NOT IN (SELECT id FROM listed_albums))
+        )");
+        query.exec("DELETE FROM mirror_pending WHERE album_id NOT IN (SELECT id FROM listed_albums)");
+        query.exec("DELETE FROM mirror_albums WHERE id NOT IN (SELECT id FROM listed_albums)");
+        query.exec("DELETE FROM listed_albums");
+        db.commit();
+
+        return query.exec("SELECT COUNT(*) FROM mirror_pending") && query.next() ? query.value(0).toInt() : 0;
+    });
+}
+
+QFuture<QStringList> LibraryMirror::pendingAlbums(int limit) const {
+    // On the writer, behind the queued storeAlbumTracks() calls.
+    return m_db->write([limit](QSqlDatabase &db) {
+        QStringList ids;
+        QSqlQuery query(db);
+        query.prepare("SELECT album_id FROM mirror_pending ORDER BY rowid LIMIT ?");
+        query.addBindValue(limit);
+        if (query.exec()) {
+            while (query.next()) {
+                ids.append(query.value(0).toString());
+            }
+        }
+        return ids;
+    });
+}
+
+void LibraryMirror::storeAlbumTracks(const QString &albumId, const TrackList &tracks) {
+    m_db->enqueue([albumId, tracks](QSqlDatabase &db) {
+        storeTracks(db, albumOwner(albumId), tracks);
+        QSqlQuery &done = CacheDatabase::statement(db, "DELETE FROM mirror_pending WHERE album_id = ?");
+        done.addBindValue(albumId);
+        done.exec();
+    });
+}
+
+void LibraryMirror::removeAlbum(const QString &albumId) {
+    m_db->enqueue([albumId](QSqlDatabase &db) {
+        storeTracks(db, albumOwner(albumId), {});
+        QSqlQuery query(db);
+        for (const char *sql : {"DELETE FROM mirror_pending WHERE album_id = ?", "DELETE FROM mirror_albums WHERE id = ?"}) {
+            query.prepare(sql);
+            query.addBindValue(albumId);
+            query.exec();
+        }
+    });
+}
+
+QFuture<QStringList> LibraryMirror::mergePlaylists(const PlaylistList &playlists) {
+    return m_db->write([playlists](QSqlDatabase &db) {
+        QStringList stale;
+        QStringList ids;
+        db.transaction();
+        QSqlQuery previous(db), upsert(db), query(db);
+        previous.prepare("SELECT song_count, duration, changed, synced FROM mirror_playlists WHERE id = ?");
+        upsert.prepare(R"(
+            INSERT OR REPLACE INTO mirror_playlists (id, name, cover_art, song_count, duration, changed, position, synced)
+            VALUES (?, ?, ?, ?, ?, ?, ?, ?)
+        )");
+        for (qsizetype i = 0; i < playlists.size(); ++i) {
+            const PlaylistEntry &playlist = playlists.at(i);
+            ids.append(playlist.id);
+            previous.addBindValue(playlist.id);
+            const bool current = previous.exec() && previous.next()
+                && previous.value(0).toInt() == playlist.songCount
+                && previous.value(1).toInt() == playlist.duration
+                && previous.value(2).toString() == playlist.changed
+                && previous.value(3).toBool();
+            previous.finish();
+            if (!current) {
+                stale.append(playlist.id);
+            }
+
+            upsert.addBindValue(playlist.id);
+            upsert.addBindValue(playlist.name);
+            upsert.addBindValue(playlist.coverArt);
+            upsert.addBindValue(playlist.songCount);
+            upsert.addBindValue(playlist.duration);
+            upsert.addBindValue(playlist.changed);
+            upsert.addBindValue(i);
+            upsert.addBindValue(current);
+            upsert.exec();
+        }
+
+        // Playlists deleted on the server.
+        QStringList removed;
+        if (query.exec("SELECT id FROM mirror_playlists")) {
+            while (query.next()) {
+                if (!ids.contains(query.value(0).toString())) {
+                    removed.append(query.value(0).toString());
+                }
+            }
+        }
+        for (const QString &id : std::as_const(removed)) {
+            storeTracks(db, playlistOwner(id), {});
+            query.prepare("DELETE FROM mirror_playlists WHERE id = ?");
+            query.addBindValue(id);
+            query.exec();
+        }
+        db.commit();
+        return stale;
+    });
+}
+
+void LibraryMirror::storePlaylistTracks(const QString &playlistId, const TrackList &tracks) {
+    m_db->enqueue([playlistId, tracks](QSqlDatabase &db) {
+        storeTracks(db, playlistOwner(playlistId), tracks);
+        QSqlQuery &done = CacheDatabase::statement(db, "UPDATE mirror_playlists SET synced = 1 WHERE id = ?");
+        done.addBindValue(playlistId);
+        done.exec();
+    });
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <QFuture>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <optional>
+#include "LibraryTypes.h"
+#include "SearchIndex.h"
+
+class CacheDatabase;
+class QSqlDatabase;
+
+struct ArtistDetail {
+    QString coverArt;
+    AlbumList albums;
+};
+
+struct SearchResults {
+    ArtistList artists;
+    AlbumList albums;
+    TrackList tracks;
+};
+
+// Local copy of the server's catalog in the cache database, kept up to
+// date by LibrarySync. Reads run on the reader threads; a lookup returns
+// nullopt when the mirror cannot answer it (never synced, or the album is
+// still waiting for its tracks), so callers fall back to the server.
+class LibraryMirror {
+public:
+    explicit LibraryMirror(CacheDatabase *db);
+
+    QFuture<std::optional<ArtistList>> artists() const;
+    QFuture<std::optional<ArtistDetail>> artist(const QString &artistId) const;
+    QFuture<std::optional<TrackList>> albumTracks(const QString &albumId) const;
+    QFuture<std::optional<TrackList>> playlistTracks(const QString &playlistId) const;
+    QFuture<int> albumCount() const;
+
+    // Index over every mirrored artist, album and track, built on a reader
+    // thread. Does not see queued writes; order it behind them with state().
+    QFuture<std::shared_ptr<const SearchIndex>> searchIndex() const;
+    // Entries for index hits, in hit order.
+    QFuture<SearchResults> resolve(const SearchIndex::Hits &hits) const;
+
+    // Sync bookkeeping; "scope" names the server and user mirrored.
+    QFuture<QString> state(const QString &key) const;
+    void setState(const QString &key, const QString &value);
+    // Drops everything, e.g. when the server or user changes.
+    QFuture<void> clear();
+
+    // Sync writes. All are queued on the writer in call order.
+    void replaceArtists(const ArtistList &artists);
+    // Stores the album listing and queues every new or changed album, and
+    // drops albums the server no longer has. Resolves to the queue length.
+    QFuture<int> mergeAlbums(const AlbumList &albums);
+    // Next albums waiting for their tracks, oldest first.
+    QFuture<QStringList> pendingAlbums(int limit) const;
+    void storeAlbumTracks(const QString &albumId, const TrackList &tracks);
+    void removeAlbum(const QString &albumId);
+    // Resolves to the ids of playlists that are new or changed.
+    QFuture<QStringList> mergePlaylists(const PlaylistList &playlists);
+    void storePlaylistTracks(const QString &playlistId, const TrackList &tracks);
+
+private:
+    static bool createTables(QSqlDatabase &db);
+
+    CacheDatabase *m_db;
+};
@@ -0,0 +1,332 @@
+#include "LibraryModels.h"
+
+LibraryListModel::LibraryListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+    connect(this, &QAbstractItemModel::rowsInserted, this, &LibraryListModel::countChanged);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, &LibraryListModel::countChanged);
+    connect(this, &QAbstractItemModel::modelReset, this, &LibraryListModel::countChanged);
+}
+
+QVariantList LibraryListModel::toVariantList() const
+{
+    QVariantList result;
+    const int rows = rowCount();
+    result.reserve(rows);
+    for (int row = 0; row < rows; ++row)
+        result.append(get(row));
+    return result;
+}
+
+// TrackListModel
+
+TrackListModel::TrackListModel(LibraryCatalog *catalog, QObject *parent)
+    : EntryListModel<TrackEntry>(catalog, parent)
+{
+}
+
+QVariant TrackListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size())
+        return {};
+
+    const Handle h = m_rows.at(index.row());
+    const auto &columns = m_catalog->tracks();
+    switch (role)
+    {
+    case IdRole:
+        return string(columns.id.at(h));
+    case TitleRole:
+    case Qt::DisplayRole:
+        return string(columns.title.at(h));
+    case ArtistRole:
+        return string(columns.artist.at(h));
+    case ArtistIdRole:
+        return string(columns.artistId.at(h));
+    case AlbumRole:
+        return string(columns.album.at(h));
+    case AlbumIdRole:
+        return string(columns.albumId.at(h));
+    case CoverArtRole:
+        return string(columns.coverArt.at(h));
+    case DurationRole:
+        return columns.duration.at(h);
+    case TrackRole:
+        return columns.track.at(h);
+    case YearRole:
+        return columns.year.at(h);
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> TrackListModel::roleNames() const
+{
+    return {
+        {IdRole, "id"},
+        {TitleRole, "title"},
+        {ArtistRole, "artist"},
+        {ArtistIdRole, "artistId"},
+        {AlbumRole, "album"},
+        {AlbumIdRole, "albumId"},
+        {CoverArtRole, "coverArt"},
+        {DurationRole, "duration"},
+        {TrackRole, "track"},
+        {YearRole, "year"},
+    };
+}
+
+QVariantMap TrackListModel::toVariant(const TrackEntry &entry)
+{
+    QVariantMap map;
+    map.insert(QStringLiteral("id"), entry.id);
+    map.insert(QStringLiteral("title"), entry.title);
+    map.insert(QStringLiteral("artist"), entry.artist);
+    map.insert(QStringLiteral("artistId"), entry.artistId);
+    map.insert(QStringLiteral("album"), entry.album);
+    map.insert(QStringLiteral("albumId"), entry.albumId);
+    map.insert(QStringLiteral("duration"), entry.duration);
+    if (entry.track > 0)
+        map.insert(QStringLiteral("track"), entry.track);
+    if (entry.year > 0)
+        map.insert(QStringLiteral("year"), entry.year);
+    if (!entry.coverArt.isEmpty())
+        map.insert(QStringLiteral("coverArt"), entry.coverArt);
+    map.insert(QStringLiteral("replayGainTrackGain"), entry.replayGainTrackGain);
+    map.insert(QStringLiteral("replayGainAlbumGain"), entry.replayGainAlbumGain);
+    return map;
+}
+
+TrackEntry TrackListModel::fromVariant(const QVariantMap &map)
+{
+    TrackEntry entry;
+    entry.id = map.value(QStringLiteral("id")).toString();
+    entry.title = map.value(QStringLiteral("title")).toString();
+    entry.artist = map.value(QStringLiteral("artist")).toString();
+    entry.artistId = map.value(QStringLiteral("artistId")).toString();
+    entry.album = map.value(QStringLiteral("album")).toString();
+    entry.albumId = map.value(QStringLiteral("albumId")).toString();
+    entry.coverArt = map.value(QStringLiteral("coverArt")).toString();
+    entry.duration = map.value(QStringLiteral("duration")).toInt();
+    entry.track = static_cast<qint16>(map.value(QStringLiteral("track")).toInt());
+    entry.year = static_cast<qint16>(map.value(QStringLiteral("year")).toInt());
+    entry.replayGainTrackGain = static_cast<float>(map.value(QStringLiteral("replayGainTrackGain")).toDouble());
+    entry.replayGainAlbumGain = static_cast<float>(map.value(QStringLiteral("replayGainAlbumGain")).toDouble());
+    return entry;
+}
+
+TrackList TrackListModel::fromVariantList(const QVariantList &list)
+{
+    TrackList result;
+    result.reserve(list.size());
+    for (const QVariant &value : list)
+        result.append(fromVariant(value.toMap()));
+    return result;
+}
+
+// AlbumListModel
+
+AlbumListModel::AlbumListModel(LibraryCatalog *catalog, QObject *parent)
+    : EntryListModel<AlbumEntry>(catalog, parent), m_sortIndex(catalog)
+{
+}
+
+QVariant AlbumListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size())
+        return {};
+
+    const Handle h = m_rows.at(index.row());
+    const auto &columns = m_catalog->albums();
+    switch (role)
+    {
+    case IdRole:
+        return string(columns.id.at(h));
+    case NameRole:
+    case Qt::DisplayRole:
+        return string(columns.name.at(h));
+    case ArtistRole:
+        return string(columns.artist.at(h));
+    case ArtistIdRole:
+        return string(columns.artistId.at(h));
+    case CoverArtRole:
+        return string(columns.coverArt.at(h));
+    case YearRole:
+        return columns.year.at(h);
+    case SongCountRole:
+        return columns.songCount.at(h);
+    case DurationRole:
+        return columns.duration.at(h);
+    case PlayCountRole:
+        return columns.playCount.at(h);
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> AlbumListModel::roleNames() const
+{
+    return roles();
+}
+
+QHash<int, QByteArray> AlbumListModel::roles()
+{
+    return {
+        {IdRole, "id"},
+        {NameRole, "name"},
+        {ArtistRole, "artist"},
+        {ArtistIdRole, "artistId"},
+        {CoverArtRole, "coverArt"},
+        {YearRole, "year"},
+        {SongCountRole, "songCount"},
+        {DurationRole, "duration"},
+        {PlayCountRole, "playCount"},
+    };
+}
+
+void AlbumListModel::merge(const AlbumList &albums)
+{
+    if (albums.isEmpty())
+        return;
+    for (const AlbumSortIndex::Run &run : m_sortIndex.insert(addToCatalog(albums)))
+        insertHandles(run.row, run.handles);
+}
+
+void AlbumListModel::setItems(const AlbumList &albums)
+{
+    clear();
+    merge(albums);
+}
+
+void AlbumListModel::clear()
+{
+    m_sortIndex.clear();
+    EntryListModel<AlbumEntry>::clear();
+}
+
+void AlbumListModel::remapHandles(const QList<Handle> &remap)
+{
+    EntryListModel<AlbumEntry>::remapHandles(remap);
+    m_sortIndex.remap(remap);
+}
+
+void AlbumListModel::setSortOrder(SortOrder order)
+{
+    if (order == sortOrder())
+        return;
+    m_sortIndex.setOrder(static_cast<AlbumSortIndex::Order>(order));
+    setHandles(m_sortIndex.rows());
+    emit sortOrderChanged();
+}
+
+QVariantMap AlbumListModel::toVariant(const AlbumEntry &entry)
+{
+    QVariantMap map;
+    map.insert(QStringLiteral("id"), entry.id);
+    map.insert(QStringLiteral("name"), entry.name);
+    map.insert(QStringLiteral("artist"), entry.artist);
+    map.insert(QStringLiteral("artistId"), entry.artistId);
+    map.insert(QStringLiteral("coverArt"), entry.coverArt);
+    map.insert(QStringLiteral("year"), entry.year);
+    if (entry.songCount > 0)
+        map.insert(QStringLiteral("songCount"), entry.songCount);
+    if (entry.duration > 0)
+        map.insert(QStringLiteral("duration"), entry.duration);
+    if (entry.playCount > 0)
+        map.insert(QStringLiteral("playCount"), entry.playCount);
+    return map;
+}
+
+AlbumEntry AlbumListModel::fromVariant(const QVariantMap &map)
+{
+    AlbumEntry entry;
+    entry.id = map.value(QStringLiteral("id")).toString();
+    entry.name = map.value(QStringLiteral("name")).toString();
+    entry.artist = map.value(QStringLiteral("artist")).toString();
+    entry.artistId = map.value(QStringLiteral("artistId")).toString();
+    entry.coverArt = map.value(QStringLiteral("coverArt")).toString();
+    entry.year = static_cast<qint16>(map.value(QStringLiteral("year")).toInt());
+    entry.songCount = map.value(QStringLiteral("songCount")).toInt();
+    entry.duration = map.value(QStringLiteral("duration")).toInt();
+    entry.playCount = map.value(QStringLiteral("playCount")).toInt();
+    return entry;
+}
+
+AlbumList AlbumListModel::fromVariantList(const QVariantList &list)
+{
+    AlbumList result;
+    result.reserve(list.size());
+    for (const QVariant &value : list)
+        result.append(fromVariant(value.toMap()));
+    return result;
+}
+
+// ArtistListModel
+
+ArtistListModel::ArtistListModel(LibraryCatalog *catalog, QObject *parent)
+    : EntryListModel<ArtistEntry>(catalog, parent)
+{
+}
+
+QVariant ArtistListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size())
+        return {};
+
+    const Handle h = m_rows.at(index.row());
+    const auto &columns = m_catalog->artists();
+    switch (role)
+    {
+    case IdRole:
+        return string(columns.id.at(h));
+    case NameRole:
+    case Qt::DisplayRole:
+        return string(columns.name.at(h));
+    case CoverArtRole:
+        return string(columns.coverArt.at(h));
+    case AlbumCountRole:
+        return columns.albumCount.at(h);
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> ArtistListModel::roleNames() const
+{
+    return {
+        {IdRole, "id"},
+        {NameRole, "name"},
+        {CoverArtRole, "coverArt"},
+        {AlbumCountRole, "albumCount"},
+    };
+}
+
+QVariantMap ArtistListModel::toVariant(const ArtistEntry &entry)
+{
+    QVariantMap map;
+    map.insert(QStringLiteral("id"), entry.id);
+    map.insert(QStringLiteral("name"), entry.name);
+    map.insert(QStringLiteral("coverArt"), entry.coverArt);
+    if (entry.albumCount > 0)
+        map.insert(QStringLiteral("albumCount"), entry.albumCount);
+    return map;
+}
+
+ArtistEntry ArtistListModel::fromVariant(const QVariantMap &map)
+{
+    ArtistEntry entry;
+    entry.id = map.value(QStringLiteral("id")).toString();
+    entry.name = map.value(QStringLiteral("name")).toString();
+    entry.coverArt = map.value(QStringLiteral("coverArt")).toString();
+    entry.albumCount = map.value(QStringLiteral("albumCount")).toInt();
+    return entry;
+}
+
+ArtistList ArtistListModel::fromVariantList(const QVariantList &list)
+{
+    ArtistList result;
+    result.reserve(list.size());
+    for (const QVariant &value : list)
+        result.append(fromVariant(value.toMap()));
+    return result;
+}
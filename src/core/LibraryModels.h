@@ -0,0 +1,268 @@
+#pragma once
+#include <QAbstractListModel>
+#include <QVariantMap>
+#include <QVariantList>
+#include "LibraryTypes.h"
+#include "LibraryCatalog.h"
+#include "AlbumSortIndex.h"
+
+// Shared QML surface of the library list models: a bindable row count and
+// row access for imperative JS code (play all, add to queue, ...).
+class LibraryListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+public:
+    explicit LibraryListModel(QObject *parent = nullptr);
+
+    int count() const { return rowCount(); }
+    Q_INVOKABLE virtual QVariantMap get(int row) const = 0;
+    Q_INVOKABLE QVariantList toVariantList() const;
+
+signals:
+    void countChanged();
+};
+
+// Rows are handles into the shared LibraryCatalog, so a model costs four
+// bytes per row and the same track shown in several views is stored once.
+// Appends and inserts emit rowsInserted, same-sized replacements emit
+// dataChanged, and only a change of size falls back to a model reset.
+template <typename Entry>
+class EntryListModel : public LibraryListModel
+{
+public:
+    using Handle = LibraryCatalog::Handle;
+    using List = QList<Entry>;
+
+    explicit EntryListModel(LibraryCatalog *catalog, QObject *parent = nullptr)
+        : LibraryListModel(parent), m_catalog(catalog)
+    {
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : static_cast<int>(m_rows.size());
+    }
+
+    const QList<Handle> &handles() const { return m_rows; }
+    Handle handleAt(int row) const { return m_rows.at(row); }
+    bool isEmpty() const { return m_rows.isEmpty(); }
+
+    void setItems(const List &items) { setHandles(addToCatalog(items)); }
+    void append(const List &items) { insertHandles(static_cast<int>(m_rows.size()), addToCatalog(items)); }
+    void insert(int row, const List &items) { insertHandles(row, addToCatalog(items)); }
+
+    void setHandles(QList<Handle> handles)
+    {
+        if (handles.isEmpty() && m_rows.isEmpty())
+            return;
+        if (!m_rows.isEmpty() && handles.size() == m_rows.size())
+        {
+            m_rows = std::move(handles);
+            emit dataChanged(index(0), index(static_cast<int>(m_rows.size()) - 1));
+            return;
+        }
+        beginResetModel();
+        m_rows = std::move(handles);
+        endResetModel();
+    }
+
+    void insertHandles(int row, const QList<Handle> &handles)
+    {
+        if (handles.isEmpty())
+            return;
+        beginInsertRows(QModelIndex(), row, row + static_cast<int>(handles.size()) - 1);
+        if (row == m_rows.size())
+        {
+            m_rows.append(handles);
+        }
+        else
+        {
+            QList<Handle> merged;
+            merged.reserve(m_rows.size() + handles.size());
+            merged.append(m_rows.mid(0, row));
+            merged.append(handles);
+            merged.append(m_rows.mid(row));
+            m_rows = std::move(merged);
+        }
+        endInsertRows();
+    }
+
+    // After LibraryCatalog::compact(). Rows still show the same records, so
+    // nothing is signalled.
+    void remapHandles(const QList<Handle> &remap)
+    {
+        for (Handle &handle : m_rows)
+            handle = remap.at(handle);
+    }
+
+    void clear()
+    {
+        if (!m_rows.isEmpty())
+        {
+            beginResetModel();
+            m_rows.clear();
+            endResetModel();
+        }
+        m_rows.squeeze();
+    }
+
+    QVariantMap get(int row) const override
+    {
+        if (row < 0 || row >= m_rows.size())
+            return {};
+        return variantAt(m_rows.at(row));
+    }
+
+    // Rows as plain records, e.g. for writing a ListSnapshot.
+    List entries() const
+    {
+        List result;
+        result.reserve(m_rows.size());
+        for (const Handle handle : m_rows)
+            result.append(entryAt(handle));
+        return result;
+    }
+
+protected:
+    virtual Handle addEntry(const Entry &entry) = 0;
+    virtual Entry entryAt(Handle handle) const = 0;
+    virtual QVariantMap variantAt(Handle handle) const = 0;
+
+    QList<Handle> addToCatalog(const List &items)
+    {
+        QList<Handle> handles;
+        handles.reserve(items.size());
+        for (const Entry &entry : items)
+            handles.append(addEntry(entry));
+        return handles;
+    }
+
+    QString string(LibraryCatalog::StringId id) const { return m_catalog->string(id); }
+
+    LibraryCatalog *m_catalog;
+    QList<Handle> m_rows;
+};
+
+class TrackListModel : public EntryListModel<TrackEntry>
+{
+    Q_OBJECT
+public:
+    enum Role
+    {
+        IdRole = Qt::UserRole + 1,
+        TitleRole,
+        ArtistRole,
+        ArtistIdRole,
+        AlbumRole,
+        AlbumIdRole,
+        CoverArtRole,
+        DurationRole,
+        TrackRole,
+        YearRole
+    };
+
+    explicit TrackListModel(LibraryCatalog *catalog, QObject *parent = nullptr);
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    static QVariantMap toVariant(const TrackEntry &entry);
+    static TrackEntry fromVariant(const QVariantMap &map);
+    static TrackList fromVariantList(const QVariantList &list);
+
+protected:
+    Handle addEntry(const TrackEntry &entry) override { return m_catalog->addTrack(entry); }
+    TrackEntry entryAt(Handle handle) const override { return m_catalog->track(handle); }
+    QVariantMap variantAt(Handle handle) const override { return toVariant(m_catalog->track(handle)); }
+};
+
+class AlbumListModel : public EntryListModel<AlbumEntry>
+{
+    Q_OBJECT
+    Q_PROPERTY(SortOrder sortOrder READ sortOrder WRITE setSortOrder NOTIFY sortOrderChanged)
+public:
+    enum SortOrder
+    {
+        SortByName = static_cast<int>(AlbumSortIndex::Order::Name),
+        SortByArtist = static_cast<int>(AlbumSortIndex::Order::Artist),
+        SortByYear = static_cast<int>(AlbumSortIndex::Order::Year),
+        SortByRecentlyAdded = static_cast<int>(AlbumSortIndex::Order::RecentlyAdded)
+    };
+    Q_ENUM(SortOrder)
+
+    enum Role
+    {
+        IdRole = Qt::UserRole + 1,
+        NameRole,
+        ArtistRole,
+        ArtistIdRole,
+        CoverArtRole,
+        YearRole,
+        SongCountRole,
+        DurationRole,
+        PlayCountRole
+    };
+
+    explicit AlbumListModel(LibraryCatalog *catalog, QObject *parent = nullptr);
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    // Shared with PagedAlbumModel, so album delegates work with either.
+    static QHash<int, QByteArray> roles();
+
+    // Rows are always kept in sortOrder. Albums are merged in with one
+    // rowsInserted per contiguous run instead of a re-sort and reset, and
+    // a change of order moves rows without a reset.
+    SortOrder sortOrder() const { return static_cast<SortOrder>(m_sortIndex.order()); }
+    void setSortOrder(SortOrder order);
+    void merge(const AlbumList &albums);
+    void setItems(const AlbumList &albums);
+    void clear();
+    // After the catalog was cleared.
+    void clearSortKeys() { m_sortIndex.clearKeys(); }
+    void remapHandles(const QList<Handle> &remap);
+
+    static QVariantMap toVariant(const AlbumEntry &entry);
+    static AlbumEntry fromVariant(const QVariantMap &map);
+    static AlbumList fromVariantList(const QVariantList &list);
+
+protected:
+    Handle addEntry(const AlbumEntry &entry) override { return m_catalog->addAlbum(entry); }
+    AlbumEntry entryAt(Handle handle) const override { return m_catalog->album(handle); }
+    QVariantMap variantAt(Handle handle) const override { return toVariant(m_catalog->album(handle)); }
+
+signals:
+    void sortOrderChanged();
+
+private:
+    AlbumSortIndex m_sortIndex;
+};
+
+class ArtistListModel : public EntryListModel<ArtistEntry>
+{
+    Q_OBJECT
+public:
+    enum Role
+    {
+        IdRole = Qt::UserRole + 1,
+        NameRole,
+        CoverArtRole,
+        AlbumCountRole
+    };
+
+    explicit ArtistListModel(LibraryCatalog *catalog, QObject *parent = nullptr);
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    static QVariantMap toVariant(const ArtistEntry &entry);
+    static ArtistEntry fromVariant(const QVariantMap &map);
+    static ArtistList fromVariantList(const QVariantList &list);
+
+protected:
+    Handle addEntry(const ArtistEntry &entry) override { return m_catalog->addArtist(entry); }
+    ArtistEntry entryAt(Handle handle) const override { return m_catalog->artist(handle); }
+    QVariantMap variantAt(Handle handle) const override { return toVariant(m_catalog->artist(handle)); }
+};
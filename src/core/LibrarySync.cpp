@@ -0,0 +1,371 @@
+#include "LibrarySync.h"
+#include "SubsonicClient.h"
+#include "CacheManager.h"
+#include <QNetworkReply>
+#include <QSettings>
+#include <QDebug>
+#include <utility>
+
+static constexpr int MAX_PARALLEL_REQUESTS = 4;
+static constexpr int ALBUM_PAGE_SIZE = 500;
+static constexpr int ALBUM_BATCH_SIZE = 200;   // pending albums loaded per round
+static constexpr int SUBSONIC_NOT_FOUND = 70;
+static constexpr int SYNC_INTERVAL_MS = 60 * 60 * 1000;
+static const QString PHASE_ALBUMS = QStringLiteral("albums:");
+
+LibrarySync::LibrarySync(SubsonicClient *api, CacheManager *cache, QObject *parent)
+    : QObject(parent), m_api(api), m_scheduler(&m_nam)
+{
+    m_nam.setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+    if (cache && cache->database())
+        m_mirror = std::make_unique<LibraryMirror>(cache->database());
+
+    QSettings settings;
+    m_enabled = settings.value(QStringLiteral("librarySync/enabled"), false).toBool();
+
+    m_periodic.setInterval(SYNC_INTERVAL_MS);
+    connect(&m_periodic, &QTimer::timeout, this, &LibrarySync::syncNow);
+    if (m_enabled)
+        m_periodic.start();
+
+    if (api)
+        connect(api, &SubsonicClient::authenticatedChanged, this, &LibrarySync::onAuthenticationChanged);
+}
+
+LibrarySync::~LibrarySync()
+{
+    cancel();
+}
+
+void LibrarySync::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled)
+        return;
+    m_enabled = enabled;
+    QSettings settings;
+    settings.setValue(QStringLiteral("librarySync/enabled"), enabled);
+    emit enabledChanged();
+
+    if (enabled)
+    {
+        m_periodic.start();
+        syncNow();
+        return;
+    }
+
+    // Opting out gives the space back.
+    m_periodic.stop();
+    cancel();
+    setReady(false);
+    if (m_mirror)
+        m_mirror->clear();
+}
+
+void LibrarySync::onAuthenticationChanged()
+{
+    cancel();
+    setReady(false);
+    if (!m_api || !m_api->isAuthenticated() || !m_mirror || !m_enabled)
+        return;
+
+    // A complete mirror of this server and user answers right away, while
+    // the catch-up sync runs.
+    const QString scope = m_api->serverUrl() + QLatin1Char('|') + m_api->username();
+    m_mirror->state(QStringLiteral("scope")).then(this, [this, scope](const QString &stored)
+                                                  {
+        if (stored != scope || !m_enabled)
+            return;
+        m_mirror->state(QStringLiteral("complete")).then(this, [this, scope](const QString &complete) {
+            if (complete == QLatin1String("1") && m_api && m_api->isAuthenticated()
+                && scope == m_api->serverUrl() + QLatin1Char('|') + m_api->username()) {
+                setReady(true);
+                rebuildSearchIndex();
+            }
+        }); });
+    syncNow();
+}
+
+void LibrarySync::syncNow()
+{
+    if (!m_enabled || m_running || !m_mirror || !m_api || !m_api->isAuthenticated())
+        return;
+    begin(m_api->serverUrl() + QLatin1Char('|') + m_api->username());
+}
+
+void LibrarySync::cancel()
+{
+    ++m_generation;
+    m_jobs.clear();
+    m_onDrained = {};
+    m_inFlight = 0;
+    const auto replies = std::exchange(m_replies, {});
+    for (QNetworkReply *reply : replies)
+    {
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+    setRunning(false);
+}
+
+void LibrarySync::begin(const QString &scope)
+{
+    ++m_generation;
+    const quint64 generation = m_generation;
+    m_scope = scope;
+    setRunning(true);
+    setProgress(0, 0);
+
+    m_mirror->state(QStringLiteral("scope")).then(this, [this, generation, scope](const QString &stored)
+                                                  {
+        if (!isCurrent(generation))
+            return;
+        if (stored != scope) {
+            // Another server or user: start over.
+            setReady(false);
+            m_mirror->clear();
+            m_mirror->setState(QStringLiteral("scope"), scope);
+        }
+        m_mirror->state(QStringLiteral("phase")).then(this, [this, generation](const QString &phase) {
+            if (!isCurrent(generation))
+                return;
+            if (phase.startsWith(PHASE_ALBUMS)) {
+                // Interrupted while fetching albums: the queue is still there.
+                m_lastModified = phase.mid(PHASE_ALBUMS.size()).toLongLong();
+                fetchPendingAlbums();
+            } else {
+                checkIndexes();
+            }
+        }); });
+}
+
+void LibrarySync::checkIndexes()
+{
+    const quint64 generation = m_generation;
+    m_mirror->state(QStringLiteral("lastModified")).then(this, [this, generation](const QString &stored)
+                                                         {
+        if (!isCurrent(generation))
+            return;
+        QUrlQuery params;
+        if (!stored.isEmpty())
+            params.addQueryItem(QStringLiteral("ifModifiedSince"), stored);
+        request(QStringLiteral("getIndexes"), params, [this, stored](const SubsonicResponse &response) {
+            const qint64 lastModified = response.lastModified;
+            if (lastModified != 0 && QString::number(lastModified) == stored) {
+                syncPlaylists();
+                return;
+            }
+            fetchArtists(lastModified);
+        }); });
+}
+
+void LibrarySync::fetchArtists(qint64 lastModified)
+{
+    request(QStringLiteral("getArtists"), {}, [this, lastModified](const SubsonicResponse &response)
+            {
+        m_mirror->replaceArtists(response.artists);
+        fetchAlbumPage(0, std::make_shared<AlbumList>(), lastModified); });
+}
+
+void LibrarySync::fetchAlbumPage(int offset, std::shared_ptr<AlbumList> albums, qint64 lastModified)
+{
+    QUrlQuery params;
+    params.addQueryItem(QStringLiteral("type"), QStringLiteral("alphabeticalByName"));
+    params.addQueryItem(QStringLiteral("size"), QString::number(ALBUM_PAGE_SIZE));
+    params.addQueryItem(QStringLiteral("offset"), QString::number(offset));
+
+    request(QStringLiteral("getAlbumList2"), params, [this, offset, albums, lastModified](const SubsonicResponse &response)
+            {
+        albums->append(response.albums);
+        if (response.albums.size() == ALBUM_PAGE_SIZE) {
+            fetchAlbumPage(offset + ALBUM_PAGE_SIZE, albums, lastModified);
+            return;
+        }
+
+        const quint64 generation = m_generation;
+        m_mirror->mergeAlbums(*albums).then(this, [this, generation, lastModified](int pending) {
+            if (!isCurrent(generation))
+                return;
+            m_lastModified = lastModified;
+            m_mirror->setState(QStringLiteral("phase"), PHASE_ALBUMS + QString::number(lastModified));
+            setProgress(pending, 0);
+            fetchPendingAlbums();
+        }); });
+}
+
+void LibrarySync::fetchPendingAlbums()
+{
+    const quint64 generation = m_generation;
+    m_mirror->pendingAlbums(ALBUM_BATCH_SIZE).then(this, [this, generation](const QStringList &ids)
+                                                   {
+        if (!isCurrent(generation))
+            return;
+        if (ids.isEmpty()) {
+            // Only now is the library up to date with lastModified.
+            if (m_lastModified != 0)
+                m_mirror->setState(QStringLiteral("lastModified"), QString::number(m_lastModified));
+            m_mirror->setState(QStringLiteral("phase"), QString());
+            syncPlaylists();
+            return;
+        }
+
+        if (m_pendingAlbums < ids.size())
+            setProgress(static_cast<int>(ids.size()), m_syncedAlbums);
+        for (const QString &albumId : ids) {
+            QUrlQuery params;
+            params.addQueryItem(QStringLiteral("id"), albumId);
+            request(
+                QStringLiteral("getAlbum"), params,
+                [this, albumId](const SubsonicResponse &response) {
+                    m_mirror->storeAlbumTracks(albumId, response.tracks);
+                    setProgress(qMax(0, m_pendingAlbums - 1), m_syncedAlbums + 1);
+                },
+                [this, albumId](const SubsonicResponse &response) {
+                    if (response.errorCode != SUBSONIC_NOT_FOUND) {
+                        fail(response.errorMessage);
+                        return;
+                    }
+                    // Deleted since it was listed.
+                    m_mirror->removeAlbum(albumId);
+                    setProgress(qMax(0, m_pendingAlbums - 1), m_syncedAlbums);
+                });
+        }
+        m_onDrained = [this] { fetchPendingAlbums(); }; });
+}
+
+void LibrarySync::syncPlaylists()
+{
+    request(QStringLiteral("getPlaylists"), {}, [this](const SubsonicResponse &response)
+            {
+        const quint64 generation = m_generation;
+        m_mirror->mergePlaylists(response.playlists).then(this, [this, generation](const QStringList &stale) {
+            if (!isCurrent(generation))
+                return;
+            if (stale.isEmpty()) {
+                finish();
+                return;
+            }
+            for (const QString &playlistId : stale) {
+                QUrlQuery params;
+                params.addQueryItem(QStringLiteral("id"), playlistId);
+                request(
+                    QStringLiteral("getPlaylist"), params,
+                    [this, playlistId](const SubsonicResponse &playlist) {
+                        m_mirror->storePlaylistTracks(playlistId, playlist.tracks);
+                    },
+                    [](const SubsonicResponse &) {});
+            }
+            m_onDrained = [this] { finish(); };
+        }); });
+}
+
+void LibrarySync::finish()
+{
+    m_mirror->setState(QStringLiteral("complete"), QStringLiteral("1"));
+    setRunning(false);
+    setReady(true);
+    rebuildSearchIndex();
+    setProgress(0, m_syncedAlbums);
+    qDebug() << "Library sync finished;" << m_syncedAlbums << "albums updated";
+    emit synced();
+}
+
+void LibrarySync::fail(const QString &message)
+{
+    // Whatever was stored stays; the next sync resumes from it.
+    qWarning() << "Library sync stopped:" << message;
+    cancel();
+    emit errorOccurred(message);
+}
+
+void LibrarySync::rebuildSearchIndex()
+{
+    // state() runs behind the queued sync writes, so the index sees them.
+    m_mirror->state(QStringLiteral("complete")).then(this, [this](const QString &)
+                                                     {
+        if (!m_ready)
+            return;
+        m_mirror->searchIndex().then(this, [this](std::shared_ptr<const SearchIndex> index) {
+            if (m_ready)
+                m_searchIndex = std::move(index);
+        }); });
+}
+
+void LibrarySync::request(const QString &method, const QUrlQuery &params, Handler onSuccess, Handler onApiError)
+{
+    m_jobs.push_back({method, params, std::move(onSuccess), std::move(onApiError)});
+    pump();
+}
+
+void LibrarySync::pump()
+{
+    while (m_inFlight < MAX_PARALLEL_REQUESTS && !m_jobs.empty() && m_api)
+    {
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        ++m_inFlight;
+
+        QNetworkReply *reply = m_scheduler.get(QNetworkRequest(m_api->apiUrl(job.method, job.params)),
+                                                RequestPriority::Background);
+        m_replies.insert(reply);
+        const quint64 generation = m_generation;
+        connect(reply, &QNetworkReply::finished, this, [this, reply, generation, job = std::move(job)]()
+                {
+            reply->deleteLater();
+            m_replies.remove(reply);
+            if (!isCurrent(generation))
+                return;
+            if (reply->error() != QNetworkReply::NoError) {
+                fail(reply->errorString());
+                return;
+            }
+
+            // The job counts as in flight until its handler has run, so
+            // m_onDrained never fires while a result is still being parsed.
+            SubsonicParser::parseAsync(reply->readAll(), this, [this, generation, job](SubsonicResponse response) {
+                if (!isCurrent(generation))
+                    return;
+                --m_inFlight;
+                if (!response.ok) {
+                    if (job.onApiError)
+                        job.onApiError(response);
+                    else
+                        fail(response.errorMessage);
+                } else {
+                    job.onSuccess(response);
+                }
+                if (!isCurrent(generation))
+                    return;
+                pump();
+                if (m_jobs.empty() && m_inFlight == 0 && m_onDrained)
+                    std::exchange(m_onDrained, {})();
+            }); });
+    }
+}
+
+void LibrarySync::setRunning(bool running)
+{
+    if (m_running == running)
+        return;
+    m_running = running;
+    emit runningChanged();
+}
+
+void LibrarySync::setReady(bool ready)
+{
+    if (m_ready == ready)
+        return;
+    m_ready = ready;
+    if (!ready)
+        m_searchIndex.reset();
+    emit readyChanged();
+}
+
+void LibrarySync::setProgress(int pending, int synced)
+{
+    if (m_pendingAlbums == pending && m_syncedAlbums == synced)
+        return;
+    m_pendingAlbums = pending;
+    m_syncedAlbums = synced;
+    emit progressChanged();
+}
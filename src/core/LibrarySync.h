@@ -0,0 +1,116 @@
+#pragma once
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QUrlQuery>
+#include <deque>
+#include <functional>
+#include <memory>
+#include "LibraryMirror.h"
+#include "RequestScheduler.h"
+#include "SubsonicParser.h"
+
+class SubsonicClient;
+class CacheManager;
+class QNetworkReply;
+
+// Opt-in mirror of the whole catalog into the cache database.
+//
+// A sync runs in phases:
+//   1. getIndexes?ifModifiedSince: when lastModified has not moved since
+//      the last complete sync, the library itself is unchanged and steps
+//      2-4 are skipped.
+//   2. getArtists replaces the artist list.
+//   3. getAlbumList2 is paged through; albums that are new, or whose
+//      created/changed/songCount/duration differ, are queued.
+//   4. Queued albums are fetched with getAlbum, a few at a time.
+//   5. Playlists, refetched when changed.
+// The album queue lives in the database, so an interrupted sync resumes at
+// step 4. All requests go out at Background priority and yield to the UI.
+class LibrarySync : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+    Q_PROPERTY(bool ready READ ready NOTIFY readyChanged)
+    Q_PROPERTY(int pendingAlbums READ pendingAlbums NOTIFY progressChanged)
+    Q_PROPERTY(int syncedAlbums READ syncedAlbums NOTIFY progressChanged)
+public:
+    LibrarySync(SubsonicClient *api, CacheManager *cache, QObject *parent = nullptr);
+    ~LibrarySync() override;
+
+    bool enabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+    bool running() const { return m_running; }
+    // A complete mirror of the current server and user exists.
+    bool ready() const { return m_ready; }
+    int pendingAlbums() const { return m_pendingAlbums; }
+    int syncedAlbums() const { return m_syncedAlbums; }
+
+    LibraryMirror *mirror() { return m_mirror.get(); }
+    // Local search over the mirror; null until ready and built.
+    std::shared_ptr<const SearchIndex> searchIndex() const { return m_searchIndex; }
+
+    Q_INVOKABLE void syncNow();
+    Q_INVOKABLE void cancel();
+
+signals:
+    void enabledChanged();
+    void runningChanged();
+    void readyChanged();
+    void progressChanged();
+    // A sync completed; the mirror may hold new data.
+    void synced();
+    void errorOccurred(const QString &message);
+
+private:
+    using Handler = std::function<void(const SubsonicResponse &)>;
+    struct Job
+    {
+        QString method;
+        QUrlQuery params;
+        Handler onSuccess;
+        Handler onApiError;  // default: the sync fails
+    };
+
+    void onAuthenticationChanged();
+    void begin(const QString &scope);
+    void checkIndexes();
+    void fetchArtists(qint64 lastModified);
+    void fetchAlbumPage(int offset, std::shared_ptr<AlbumList> albums, qint64 lastModified);
+    void fetchPendingAlbums();
+    void syncPlaylists();
+    void finish();
+    void fail(const QString &message);
+    void rebuildSearchIndex();
+
+    void request(const QString &method, const QUrlQuery &params, Handler onSuccess, Handler onApiError = {});
+    void pump();
+    bool isCurrent(quint64 generation) const { return m_running && generation == m_generation; }
+    void setRunning(bool running);
+    void setReady(bool ready);
+    void setProgress(int pending, int synced);
+
+    QPointer<SubsonicClient> m_api;
+    std::unique_ptr<LibraryMirror> m_mirror;
+    std::shared_ptr<const SearchIndex> m_searchIndex;
+    QNetworkAccessManager m_nam;
+    RequestScheduler m_scheduler;
+    QTimer m_periodic;
+
+    bool m_enabled = false;
+    bool m_running = false;
+    bool m_ready = false;
+    quint64 m_generation = 0;
+    QString m_scope;
+    qint64 m_lastModified = 0;  // of the sync in progress
+    int m_pendingAlbums = 0;
+    int m_syncedAlbums = 0;
+
+    std::deque<Job> m_jobs;
+    QSet<QNetworkReply *> m_replies;
+    int m_inFlight = 0;
+    std::function<void()> m_onDrained;
+};
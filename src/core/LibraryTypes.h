@@ -0,0 +1,61 @@
+#pragma once
+#include <QString>
+#include <QList>
+
+// Plain records produced by SubsonicParser and stored by SubsonicClient.
+// Kept free of QVariant so they can be built on worker threads and moved
+// to the GUI thread without any per-field boxing.
+
+struct TrackEntry
+{
+    QString id;
+    QString title;
+    QString artist;
+    QString artistId;
+    QString album;
+    QString albumId;
+    QString coverArt;
+    qint32 duration = 0;
+    qint16 track = 0;
+    qint16 year = 0;
+    float replayGainTrackGain = 0.0f;
+    float replayGainAlbumGain = 0.0f;
+};
+
+struct AlbumEntry
+{
+    QString id;
+    QString name;
+    QString artist;
+    QString artistId;
+    QString coverArt;
+    QString created;  // ISO 8601; only used for sync change detection
+    QString changed;  // OpenSubsonic, may be empty
+    qint32 songCount = 0;
+    qint32 duration = 0;
+    qint32 playCount = 0;
+    qint16 year = 0;
+};
+
+struct ArtistEntry
+{
+    QString id;
+    QString name;
+    QString coverArt;
+    qint32 albumCount = 0;
+};
+
+struct PlaylistEntry
+{
+    QString id;
+    QString name;
+    QString coverArt;
+    QString changed;
+    qint32 songCount = 0;
+    qint32 duration = 0;
+};
+
+using TrackList = QList<TrackEntry>;
+using AlbumList = QList<AlbumEntry>;
+using ArtistList = QList<ArtistEntry>;
+using PlaylistList = QList<PlaylistEntry>;
@@ -0,0 +1,426 @@
+#include "ListSnapshot.h"
+#include <QFile>
+#include <QHash>
+#include <cstring>
+#include <type_traits>
+
+namespace
+{
+
+constexpr quint32 MAGIC = 0x534c5353; // "SSLS"
+
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    quint16 kind;
+    quint16 reserved;
+    quint32 count;
+    quint32 recordSize;
+    quint32 stringCount;
+    quint32 recordsOffset;
+    quint32 offsetsOffset;
+    quint32 heapOffset;
+    quint32 heapLength; // UTF-16 code units
+};
+
+struct TrackRecord
+{
+    quint32 id, title, artist, artistId, album, albumId, coverArt;
+    qint32 duration;
+    qint16 track, year;
+    float trackGain, albumGain;
+};
+
+struct AlbumRecord
+{
+    quint32 id, name, artist, artistId, coverArt;
+    qint32 songCount, duration, playCount;
+    qint16 year;
+    qint16 reserved;
+};
+
+struct ArtistRecord
+{
+    quint32 id, name, coverArt;
+    qint32 albumCount;
+};
+
+struct PlaylistRecord
+{
+    quint32 id, name, coverArt;
+    qint32 songCount, duration;
+};
+
+// The layout is the file format; a padding change must bump Version.
+static_assert(sizeof(Header) == 40);
+static_assert(sizeof(TrackRecord) == 44);
+static_assert(sizeof(AlbumRecord) == 36);
+static_assert(sizeof(ArtistRecord) == 16);
+static_assert(sizeof(PlaylistRecord) == 20);
+static_assert(std::is_trivially_copyable_v<TrackRecord> && std::is_trivially_copyable_v<AlbumRecord>);
+
+template <typename Record>
+constexpr ListSnapshot::Kind kindOf()
+{
+    if constexpr (std::is_same_v<Record, TrackRecord>)
+        return ListSnapshot::Kind::Tracks;
+    else if constexpr (std::is_same_v<Record, AlbumRecord>)
+        return ListSnapshot::Kind::Albums;
+    else if constexpr (std::is_same_v<Record, ArtistRecord>)
+        return ListSnapshot::Kind::Artists;
+    else
+        return ListSnapshot::Kind::Playlists;
+}
+
+quint32 recordSizeOf(ListSnapshot::Kind kind)
+{
+    switch (kind)
+    {
+    case ListSnapshot::Kind::Tracks:
+        return sizeof(TrackRecord);
+    case ListSnapshot::Kind::Albums:
+        return sizeof(AlbumRecord);
+    case ListSnapshot::Kind::Artists:
+        return sizeof(ArtistRecord);
+    case ListSnapshot::Kind::Playlists:
+        return sizeof(PlaylistRecord);
+    case ListSnapshot::Kind::Invalid:
+        break;
+    }
+    return 0;
+}
+
+constexpr quint32 align4(quint32 value)
+{
+    return (value + 3u) & ~3u;
+}
+
+// Collects records and deduplicated strings, then lays them out.
+template <typename Record>
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(qsizetype count)
+    {
+        m_records.reserve(count);
+        m_offsets.append(0); // string id 0 is the empty string
+        m_offsets.append(0);
+    }
+
+    quint32 intern(const QString &str)
+    {
+        if (str.isEmpty())
+            return 0;
+        auto it = m_ids.constFind(str);
+        if (it != m_ids.cend())
+            return it.value();
+        const quint32 id = static_cast<quint32>(m_offsets.size() - 1);
+        m_heap.append(str);
+        m_offsets.append(static_cast<quint32>(m_heap.size()));
+        m_ids.insert(str, id);
+        return id;
+    }
+
+    void add(const Record &record) { m_records.append(record); }
+
+    QByteArray finish() const
+    {
+        Header header{};
+        header.magic = MAGIC;
+        header.version = ListSnapshot::Version;
+        header.kind = static_cast<quint16>(kindOf<Record>());
+        header.count = static_cast<quint32>(m_records.size());
+        header.recordSize = sizeof(Record);
+        header.stringCount = static_cast<quint32>(m_offsets.size() - 1);
+        header.recordsOffset = align4(sizeof(Header));
+        header.offsetsOffset = align4(header.recordsOffset + header.count * header.recordSize);
+        header.heapOffset = align4(header.offsetsOffset + static_cast<quint32>(m_offsets.size() * sizeof(quint32)));
+        header.heapLength = static_cast<quint32>(m_heap.size());
+
+        QByteArray data(header.heapOffset + header.heapLength * sizeof(char16_t), Qt::Uninitialized);
+        char *out = data.data();
+        std::memset(out, 0, header.heapOffset);
+        std::memcpy(out, &header, sizeof(header));
+        if (!m_records.isEmpty())
+            std::memcpy(out + header.recordsOffset, m_records.constData(), m_records.size() * sizeof(Record));
+        std::memcpy(out + header.offsetsOffset, m_offsets.constData(), m_offsets.size() * sizeof(quint32));
+        if (!m_heap.isEmpty())
+            std::memcpy(out + header.heapOffset, m_heap.utf16(), m_heap.size() * sizeof(char16_t));
+        return data;
+    }
+
+private:
+    QList<Record> m_records;
+    QList<quint32> m_offsets;
+    QString m_heap;
+    QHash<QString, quint32> m_ids;
+};
+
+}
+
+QByteArray ListSnapshot::encode(const TrackList &tracks)
+{
+    SnapshotWriter<TrackRecord> writer(tracks.size());
+    for (const TrackEntry &entry : tracks)
+    {
+        TrackRecord record{};
+        record.id = writer.intern(entry.id);
+        record.title = writer.intern(entry.title);
+        record.artist = writer.intern(entry.artist);
+        record.artistId = writer.intern(entry.artistId);
+        record.album = writer.intern(entry.album);
+        record.albumId = writer.intern(entry.albumId);
+        record.coverArt = writer.intern(entry.coverArt);
+        record.duration = entry.duration;
+        record.track = entry.track;
+        record.year = entry.year;
+        record.trackGain = entry.replayGainTrackGain;
+        record.albumGain = entry.replayGainAlbumGain;
+        writer.add(record);
+    }
+    return writer.finish();
+}
+
+QByteArray ListSnapshot::encode(const AlbumList &albums)
+{
+    SnapshotWriter<AlbumRecord> writer(albums.size());
+    for (const AlbumEntry &entry : albums)
+    {
+        AlbumRecord record{};
+        record.id = writer.intern(entry.id);
+        record.name = writer.intern(entry.name);
+        record.artist = writer.intern(entry.artist);
+        record.artistId = writer.intern(entry.artistId);
+        record.coverArt = writer.intern(entry.coverArt);
+        record.songCount = entry.songCount;
+        record.duration = entry.duration;
+        record.playCount = entry.playCount;
+        record.year = entry.year;
+        writer.add(record);
+    }
+    return writer.finish();
+}
+
+QByteArray ListSnapshot::encode(const ArtistList &artists)
+{
+    SnapshotWriter<ArtistRecord> writer(artists.size());
+    for (const ArtistEntry &entry : artists)
+    {
+        ArtistRecord record{};
+        record.id = writer.intern(entry.id);
+        record.name = writer.intern(entry.name);
+        record.coverArt = writer.intern(entry.coverArt);
+        record.albumCount = entry.albumCount;
+        writer.add(record);
+    }
+    return writer.finish();
+}
+
+QByteArray ListSnapshot::encode(const PlaylistList &playlists)
+{
+    SnapshotWriter<PlaylistRecord> writer(playlists.size());
+    for (const PlaylistEntry &entry : playlists)
+    {
+        PlaylistRecord record{};
+        record.id = writer.intern(entry.id);
+        record.name = writer.intern(entry.name);
+        record.coverArt = writer.intern(entry.coverArt);
+        record.songCount = entry.songCount;
+        record.duration = entry.duration;
+        writer.add(record);
+    }
+    return writer.finish();
+}
+
+ListSnapshot ListSnapshot::open(const QString &path)
+{
+    ListSnapshot snapshot;
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly) || file->size() < static_cast<qint64>(sizeof(Header)))
+        return snapshot;
+
+    const qint64 size = file->size();
+    if (const uchar *mapped = file->map(0, size))
+    {
+        if (snapshot.attach(QByteArrayView(mapped, size)))
+            snapshot.m_file = std::move(file);
+        return snapshot;
+    }
+    return fromData(file->readAll());
+}
+
+ListSnapshot ListSnapshot::fromData(QByteArray data)
+{
+    ListSnapshot snapshot;
+    snapshot.m_bytes = std::move(data);
+    if (!snapshot.attach(QByteArrayView(snapshot.m_bytes)))
+        snapshot.m_bytes.clear();
+    return snapshot;
+}
+
+bool ListSnapshot::attach(QByteArrayView data)
+{
+    if (data.size() < static_cast<qsizetype>(sizeof(Header)))
+        return false;
+    Header header;
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    const auto kind = static_cast<Kind>(header.kind);
+    if (header.magic != MAGIC || header.version != Version || header.recordSize != recordSizeOf(kind)
+        || header.recordSize == 0)
+    {
+        return false;
+    }
+
+    // Every section has to lie inside the data, in order, and aligned.
+    const quint64 size = static_cast<quint64>(data.size());
+    const quint64 recordsEnd = header.recordsOffset + quint64(header.count) * header.recordSize;
+    const quint64 offsetsEnd = header.offsetsOffset + (quint64(header.stringCount) + 1) * sizeof(quint32);
+    const quint64 heapEnd = header.heapOffset + quint64(header.heapLength) * sizeof(char16_t);
+    if (header.recordsOffset < sizeof(Header) || recordsEnd > header.offsetsOffset
+        || offsetsEnd > header.heapOffset || heapEnd > size
+        || (header.offsetsOffset | header.heapOffset) % 4 != 0)
+    {
+        return false;
+    }
+
+    m_data = data;
+    m_kind = kind;
+    m_count = header.count;
+    m_recordSize = header.recordSize;
+    m_recordsOffset = header.recordsOffset;
+    m_stringCount = header.stringCount;
+    m_offsets = reinterpret_cast<const quint32 *>(data.data() + header.offsetsOffset);
+    m_heap = reinterpret_cast<const char16_t *>(data.data() + header.heapOffset);
+    m_heapLength = header.heapLength;
+    return true;
+}
+
+QStringView ListSnapshot::string(quint32 id) const
+{
+    if (id == 0 || id >= m_stringCount)
+        return {};
+    const quint32 begin = m_offsets[id];
+    const quint32 end = m_offsets[id + 1];
+    // Offsets are not validated up front; a corrupt entry reads as empty.
+    if (begin > end || end > m_heapLength)
+        return {};
+    return QStringView(m_heap + begin, end - begin);
+}
+
+const char *ListSnapshot::record(qsizetype index) const
+{
+    if (index < 0 || index >= m_count)
+        return nullptr;
+    return m_data.data() + m_recordsOffset + index * m_recordSize;
+}
+
+TrackEntry ListSnapshot::track(qsizetype index) const
+{
+    TrackEntry entry;
+    const char *data = m_kind == Kind::Tracks ? record(index) : nullptr;
+    if (!data)
+        return entry;
+    TrackRecord record;
+    std::memcpy(&record, data, sizeof(record));
+    entry.id = string(record.id).toString();
+    entry.title = string(record.title).toString();
+    entry.artist = string(record.artist).toString();
+    entry.artistId = string(record.artistId).toString();
+    entry.album = string(record.album).toString();
+    entry.albumId = string(record.albumId).toString();
+    entry.coverArt = string(record.coverArt).toString();
+    entry.duration = record.duration;
+    entry.track = record.track;
+    entry.year = record.year;
+    entry.replayGainTrackGain = record.trackGain;
+    entry.replayGainAlbumGain = record.albumGain;
+    return entry;
+}
+
+AlbumEntry ListSnapshot::album(qsizetype index) const
+{
+    AlbumEntry entry;
+    const char *data = m_kind == Kind::Albums ? record(index) : nullptr;
+    if (!data)
+        return entry;
+    AlbumRecord record;
+    std::memcpy(&record, data, sizeof(record));
+    entry.id = string(record.id).toString();
+    entry.name = string(record.name).toString();
+    entry.artist = string(record.artist).toString();
+    entry.artistId = string(record.artistId).toString();
+    entry.coverArt = string(record.coverArt).toString();
+    entry.songCount = record.songCount;
+    entry.duration = record.duration;
+    entry.playCount = record.playCount;
+    entry.year = record.year;
+    return entry;
+}
+
+ArtistEntry ListSnapshot::artist(qsizetype index) const
+{
+    ArtistEntry entry;
+    const char *data = m_kind == Kind::Artists ? record(index) : nullptr;
+    if (!data)
+        return entry;
+    ArtistRecord record;
+    std::memcpy(&record, data, sizeof(record));
+    entry.id = string(record.id).toString();
+    entry.name = string(record.name).toString();
+    entry.coverArt = string(record.coverArt).toString();
+    entry.albumCount = record.albumCount;
+    return entry;
+}
+
+PlaylistEntry ListSnapshot::playlist(qsizetype index) const
+{
+    PlaylistEntry entry;
+    const char *data = m_kind == Kind::Playlists ? record(index) : nullptr;
+    if (!data)
+        return entry;
+    PlaylistRecord record;
+    std::memcpy(&record, data, sizeof(record));
+    entry.id = string(record.id).toString();
+    entry.name = string(record.name).toString();
+    entry.coverArt = string(record.coverArt).toString();
+    entry.songCount = record.songCount;
+    entry.duration = record.duration;
+    return entry;
+}
+
+template <typename Entry, typename Decode>
+QList<Entry> ListSnapshot::decodeRange(qsizetype index, qsizetype count, Decode decode) const
+{
+    QList<Entry> result;
+    index = qBound<qsizetype>(0, index, m_count);
+    const qsizetype end = count < 0 ? m_count : qMin(m_count, index + count);
+    if (end <= index)
+        return result;
+    result.reserve(end - index);
+    for (qsizetype i = index; i < end; ++i)
+        result.append((this->*decode)(i));
+    return result;
+}
+
+TrackList ListSnapshot::tracks(qsizetype index, qsizetype count) const
+{
+    return m_kind == Kind::Tracks ? decodeRange<TrackEntry>(index, count, &ListSnapshot::track) : TrackList();
+}
+
+AlbumList ListSnapshot::albums(qsizetype index, qsizetype count) const
+{
+    return m_kind == Kind::Albums ? decodeRange<AlbumEntry>(index, count, &ListSnapshot::album) : AlbumList();
+}
+
+ArtistList ListSnapshot::artists(qsizetype index, qsizetype count) const
+{
+    return m_kind == Kind::Artists ? decodeRange<ArtistEntry>(index, count, &ListSnapshot::artist) : ArtistList();
+}
+
+PlaylistList ListSnapshot::playlists(qsizetype index, qsizetype count) const
+{
+    return m_kind == Kind::Playlists ? decodeRange<PlaylistEntry>(index, count, &ListSnapshot::playlist)
+                                     : PlaylistList();
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QStringView>
+#include <memory>
+#include "LibraryTypes.h"
+
+class QFile;
+
+// Versioned binary form of a cached library list. Layout, all integers in
+// host byte order and every section 4-byte aligned:
+//
+//   Header      magic, version, kind, record count/size, section offsets
+//   Records     count fixed-width records; text fields are string ids
+//   Offsets     stringCount + 1 quint32 offsets into the heap; string i
+//               spans [offset[i], offset[i + 1])
+//   Heap        UTF-16 text, each distinct string stored once
+//
+// A snapshot is read in place, usually from a memory-mapped file: opening
+// one only checks the header, and records are decoded when asked for, so
+// showing the first page of a 50k-album list touches the first page only.
+class ListSnapshot
+{
+public:
+    enum class Kind : quint16
+    {
+        Invalid = 0,
+        Tracks = 1,
+        Albums = 2,
+        Artists = 3,
+        Playlists = 4
+    };
+
+    static constexpr quint32 Version = 1;
+
+    ListSnapshot() = default;
+
+    static QByteArray encode(const TrackList &tracks);
+    static QByteArray encode(const AlbumList &albums);
+    static QByteArray encode(const ArtistList &artists);
+    static QByteArray encode(const PlaylistList &playlists);
+
+    // Maps path read-only; falls back to reading it when mapping fails.
+    static ListSnapshot open(const QString &path);
+    static ListSnapshot fromData(QByteArray data);
+
+    bool isValid() const { return m_kind != Kind::Invalid; }
+    Kind kind() const { return m_kind; }
+    qsizetype size() const { return m_count; }
+    qsizetype byteSize() const { return m_data.size(); }
+
+    // Points into the snapshot; valid while any copy of it is alive.
+    QStringView string(quint32 id) const;
+
+    TrackEntry track(qsizetype index) const;
+    AlbumEntry album(qsizetype index) const;
+    ArtistEntry artist(qsizetype index) const;
+    PlaylistEntry playlist(qsizetype index) const;
+
+    // Decodes count records from index on; count < 0 means to the end.
+    TrackList tracks(qsizetype index = 0, qsizetype count = -1) const;
+    AlbumList albums(qsizetype index = 0, qsizetype count = -1) const;
+    ArtistList artists(qsizetype index = 0, qsizetype count = -1) const;
+    PlaylistList playlists(qsizetype index = 0, qsizetype count = -1) const;
+
+private:
+    bool attach(QByteArrayView data);
+    const char *record(qsizetype index) const;
+    template <typename Entry, typename Decode>
+    QList<Entry> decodeRange(qsizetype index, qsizetype count, Decode decode) const;
+
+    std::shared_ptr<QFile> m_file;
+    QByteArray m_bytes;
+    QByteArrayView m_data;
+    Kind m_kind = Kind::Invalid;
+    qsizetype m_count = 0;
+    quint32 m_recordSize = 0;
+    quint32 m_recordsOffset = 0;
+    quint32 m_stringCount = 0;
+    const quint32 *m_offsets = nullptr;
+    const char16_t *m_heap = nullptr;
+    quint32 m_heapLength = 0;
+};
@@ -0,0 +1,231 @@
+#include "PagedAlbumModel.h"
+#include <algorithm>
+#include <vector>
+
+static constexpr int PREFETCH_AHEAD = 2;  // pages past the viewport in the scroll direction
+static constexpr int PREFETCH_BEHIND = 1;
+static constexpr int DEFAULT_PAGE_BUDGET = 20;
+
+PagedAlbumModel::PagedAlbumModel(QObject *parent)
+    : LibraryListModel(parent), m_budget(DEFAULT_PAGE_BUDGET)
+{
+}
+
+int PagedAlbumModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_total;
+}
+
+QVariant PagedAlbumModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_total)
+        return {};
+    const auto page = m_pages.constFind(index.row() / PageSize);
+    const int offset = index.row() % PageSize;
+    if (page == m_pages.constEnd() || offset >= page->size())
+        return {};
+
+    const AlbumEntry &album = page->at(offset);
+    switch (role)
+    {
+    case AlbumListModel::IdRole:
+        return album.id;
+    case AlbumListModel::NameRole:
+    case Qt::DisplayRole:
+        return album.name;
+    case AlbumListModel::ArtistRole:
+        return album.artist;
+    case AlbumListModel::ArtistIdRole:
+        return album.artistId;
+    case AlbumListModel::CoverArtRole:
+        return album.coverArt;
+    case AlbumListModel::YearRole:
+        return album.year;
+    case AlbumListModel::SongCountRole:
+        return album.songCount;
+    case AlbumListModel::DurationRole:
+        return album.duration;
+    case AlbumListModel::PlayCountRole:
+        return album.playCount;
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> PagedAlbumModel::roleNames() const
+{
+    return AlbumListModel::roles();
+}
+
+QVariantMap PagedAlbumModel::get(int row) const
+{
+    if (row < 0 || row >= m_total)
+        return {};
+    const auto page = m_pages.constFind(row / PageSize);
+    const int offset = row % PageSize;
+    if (page == m_pages.constEnd() || offset >= page->size())
+        return {};
+    return AlbumListModel::toVariant(page->at(offset));
+}
+
+void PagedAlbumModel::reset(int total, const AlbumList &firstPage)
+{
+    const QList<int> cancelled = m_inFlight.values();
+    for (const int page : cancelled)
+    {
+        setInFlight(page, false);
+        emit pageCancelled(page);
+    }
+
+    beginResetModel();
+    m_total = qMax(0, total);
+    m_pages.clear();
+    m_pages.squeeze();
+    if (m_total > 0 && !firstPage.isEmpty())
+        m_pages.insert(0, firstPage);
+    m_first = 0;
+    m_last = -1;
+    m_direction = 1;
+    m_firstWanted = 0;
+    m_lastWanted = -1;
+    endResetModel();
+
+    // The view starts at the top; do not wait for it to report that.
+    setViewport(0, qMin(m_total, PageSize) - 1);
+}
+
+void PagedAlbumModel::extend(int total)
+{
+    if (total <= m_total)
+        return;
+    beginInsertRows(QModelIndex(), m_total, total - 1);
+    m_total = total;
+    endInsertRows();
+    update();
+}
+
+void PagedAlbumModel::setPage(int page, const AlbumList &albums)
+{
+    setInFlight(page, false);
+    if (page < 0 || page >= pageCount())
+        return;
+    m_pages.insert(page, albums);
+    const int first = page * PageSize;
+    const int last = qMin(m_total, first + PageSize) - 1;
+    emit dataChanged(index(first), index(last));
+    evict();
+}
+
+void PagedAlbumModel::pageFailed(int page)
+{
+    setInFlight(page, false);
+}
+
+void PagedAlbumModel::setPageBudget(int pages)
+{
+    m_budget = qMax(1, pages);
+    evict();
+}
+
+void PagedAlbumModel::setViewport(int first, int last)
+{
+    if (last < first)
+        return;
+    if (first != m_first)
+        m_direction = first > m_first ? 1 : -1;
+    m_first = first;
+    m_last = last;
+    update();
+}
+
+void PagedAlbumModel::update()
+{
+    if (m_total == 0)
+        return;
+    const int lastPage = pageCount() - 1;
+    const int firstVisible = qBound(0, m_first / PageSize, lastPage);
+    const int lastVisible = qBound(firstVisible, m_last / PageSize, lastPage);
+    const int ahead = m_direction > 0 ? PREFETCH_AHEAD : PREFETCH_BEHIND;
+    const int behind = m_direction > 0 ? PREFETCH_BEHIND : PREFETCH_AHEAD;
+    m_firstWanted = qMax(0, firstVisible - behind);
+    m_lastWanted = qMin(lastPage, lastVisible + ahead);
+
+    // A jump leaves earlier requests behind; they would only delay the
+    // pages now on screen.
+    const QList<int> inFlight = m_inFlight.values();
+    for (const int page : inFlight)
+    {
+        if (page >= m_firstWanted && page <= m_lastWanted)
+            continue;
+        setInFlight(page, false);
+        emit pageCancelled(page);
+    }
+
+    const auto request = [this](int page, bool prefetch)
+    {
+        if (m_pages.contains(page) || m_inFlight.contains(page))
+            return;
+        setInFlight(page, true);
+        emit pageRequested(page, prefetch);
+    };
+    for (int page = firstVisible; page <= lastVisible; ++page)
+        request(page, false);
+    if (m_direction > 0)
+    {
+        for (int page = lastVisible + 1; page <= m_lastWanted; ++page)
+            request(page, true);
+        for (int page = firstVisible - 1; page >= m_firstWanted; --page)
+            request(page, true);
+    }
+    else
+    {
+        for (int page = firstVisible - 1; page >= m_firstWanted; --page)
+            request(page, true);
+        for (int page = lastVisible + 1; page <= m_lastWanted; ++page)
+            request(page, true);
+    }
+
+    evict();
+}
+
+void PagedAlbumModel::evict()
+{
+    const int budget = qMax(m_budget, m_lastWanted - m_firstWanted + 1);
+    if (m_pages.size() <= budget)
+        return;
+
+    const auto distance = [this](int page)
+    {
+        if (page < m_firstWanted)
+            return m_firstWanted - page;
+        return page > m_lastWanted ? page - m_lastWanted : 0;
+    };
+    std::vector<int> candidates;
+    for (auto it = m_pages.cbegin(); it != m_pages.cend(); ++it)
+    {
+        if (distance(it.key()) > 0)
+            candidates.push_back(it.key());
+    }
+    std::sort(candidates.begin(), candidates.end(), [&distance](int a, int b)
+              { return distance(a) > distance(b); });
+
+    for (const int page : candidates)
+    {
+        if (m_pages.size() <= budget)
+            break;
+        m_pages.remove(page);
+        const int first = page * PageSize;
+        emit dataChanged(index(first), index(qMin(m_total, first + PageSize) - 1));
+    }
+}
+
+void PagedAlbumModel::setInFlight(int page, bool inFlight)
+{
+    const bool wasLoading = loading();
+    if (inFlight)
+        m_inFlight.insert(page);
+    else
+        m_inFlight.remove(page);
+    if (wasLoading != loading())
+        emit loadingChanged();
+}
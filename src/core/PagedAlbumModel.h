@@ -0,0 +1,69 @@
+#pragma once
+#include <QHash>
+#include <QSet>
+#include "LibraryModels.h"
+
+// Album grid over the whole library without holding the whole library.
+// The row count is the full total, or a provisional one that only grows
+// while the total is still being worked out; rows are filled a page at a
+// time as the view reaches them, through pageRequested(). Pages
+// around the viewport are requested first, then a few more in the scroll
+// direction. Once more than the budget is resident, the pages farthest
+// from the viewport are dropped and become placeholders again.
+//
+// Entries live in the pages rather than the LibraryCatalog, so evicting a
+// page really frees it.
+class PagedAlbumModel : public LibraryListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+public:
+    static constexpr int PageSize = 100;
+
+    explicit PagedAlbumModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    // Empty for rows whose page is not loaded.
+    QVariantMap get(int row) const override;
+
+    bool loading() const { return !m_inFlight.isEmpty(); }
+    int pageCount() const { return (m_total + PageSize - 1) / PageSize; }
+
+    // Starts over with total rows, all placeholders but firstPage.
+    void reset(int total, const AlbumList &firstPage = {});
+    // Adds rows up to total, keeping what is loaded; never removes any.
+    void extend(int total);
+    void setPage(int page, const AlbumList &albums);
+    // The request failed; the page is asked for again when next in view.
+    void pageFailed(int page);
+    // Maximum resident pages; at least what fits on screen plus prefetch.
+    void setPageBudget(int pages);
+
+    // Rows on screen, from the view as it scrolls or jumps.
+    Q_INVOKABLE void setViewport(int first, int last);
+
+signals:
+    // Fetch albums [page * PageSize, (page + 1) * PageSize). Prefetches can
+    // go out at a lower priority than pages on screen.
+    void pageRequested(int page, bool prefetch);
+    // Requested earlier but no longer near the viewport.
+    void pageCancelled(int page);
+    void loadingChanged();
+
+private:
+    void update();
+    void evict();
+    void setInFlight(int page, bool inFlight);
+
+    int m_total = 0;
+    QHash<int, AlbumList> m_pages;
+    QSet<int> m_inFlight;
+    int m_first = 0;
+    int m_last = -1;
+    int m_direction = 1; // +1 scrolling down, -1 up
+    int m_firstWanted = 0;
+    int m_lastWanted = -1;
+    int m_budget;
+};
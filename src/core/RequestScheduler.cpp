@@ -0,0 +1,364 @@
+#include "RequestScheduler.h"
+
+#include <QMetaObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+// Interactive requests queued or running in any scheduler of the process.
+std::atomic<int> g_interactivePending{0};
+
+QMutex g_schedulersMutex;
+QList<RequestScheduler *> g_schedulers;
+
+QString hostKeyFor(const QUrl &url) {
+    const int defaultPort = url.scheme() == QLatin1String("https") ? 443 : 80;
+    return url.host() + QLatin1Char(':') + QString::number(url.port(defaultPort));
+}
+
+}
+
+// ScheduledReply
+
+ScheduledReply::ScheduledReply(RequestScheduler *scheduler, QNetworkAccessManager *nam,
+                               const QNetworkRequest &request, RequestPriority priority)
+    : QNetworkReply(nam),
+      m_scheduler(scheduler),
+      m_hostKey(hostKeyFor(request.url())),
+      m_priority(priority) {
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(QNetworkAccessManager::GetOperation);
+    open(QIODevice::ReadOnly);
+}
+
+ScheduledReply::~ScheduledReply() {
+    dropInner();
+    if (m_scheduler)
+        m_scheduler->release(this);
+}
+
+void ScheduledReply::start(QNetworkAccessManager *nam) {
+    QNetworkRequest inner(request());
+    inner.setAttribute(RequestScheduler::ScheduledAttribute, true);
+    m_inner = nam->get(inner);
+
+    connect(m_inner, &QNetworkReply::metaDataChanged, this, &ScheduledReply::copyMetaData);
+    connect(m_inner, &QNetworkReply::readyRead, this, &ScheduledReply::onInnerReadyRead);
+    connect(m_inner, &QNetworkReply::downloadProgress, this, &QNetworkReply::downloadProgress);
+    connect(m_inner, &QNetworkReply::finished, this, &ScheduledReply::onInnerFinished);
+}
+
+bool ScheduledReply::preempt() {
+    if (m_delivered || !m_inner)
+        return false;
+    dropInner();
+    m_buffer.clear();
+    return true;
+}
+
+void ScheduledReply::dropInner() {
+    if (!m_inner)
+        return;
+    QNetworkReply *inner = m_inner;
+    m_inner = nullptr;
+    disconnect(inner, nullptr, this, nullptr);
+    inner->abort();
+    inner->deleteLater();
+}
+
+void ScheduledReply::copyMetaData() {
+    if (!m_inner)
+        return;
+
+    const auto headers = m_inner->rawHeaderPairs();
+    for (const auto &header : headers)
+        setRawHeader(header.first, header.second);
+
+    static constexpr QNetworkRequest::Attribute forwarded[] = {
+        QNetworkRequest::HttpStatusCodeAttribute,
+        QNetworkRequest::HttpReasonPhraseAttribute,
+        QNetworkRequest::RedirectionTargetAttribute,
+        QNetworkRequest::SourceIsFromCacheAttribute,
+    };
+    for (const auto attribute : forwarded) {
+        const QVariant value = m_inner->attribute(attribute);
+        if (value.isValid())
+            setAttribute(attribute, value);
+    }
+    setUrl(m_inner->url());
+
+    m_delivered = true;
+    emit metaDataChanged();
+}
+
+void ScheduledReply::onInnerReadyRead() {
+    if (!m_inner)
+        return;
+    if (!m_delivered)
+        copyMetaData();
+    m_buffer.append(m_inner->readAll());
+    emit readyRead();
+}
+
+void ScheduledReply::onInnerFinished() {
+    if (!m_inner)
+        return;
+    if (!m_delivered)
+        copyMetaData();
+
+    QNetworkReply *inner = m_inner;
+    m_inner = nullptr;
+    const QByteArray tail = inner->readAll();
+    m_buffer.append(tail);
+    const auto error = inner->error();
+    if (error != NoError)
+        setError(error, inner->errorString());
+    inner->deleteLater();
+
+    setFinished(true);
+    if (m_scheduler)
+        m_scheduler->release(this);
+
+    if (error != NoError)
+        emit errorOccurred(error);
+    if (!tail.isEmpty())
+        emit readyRead();
+    emit finished();
+}
+
+void ScheduledReply::abort() {
+    if (isFinished())
+        return;
+    dropInner();
+
+    setError(OperationCanceledError, tr("Operation canceled"));
+    setFinished(true);
+    if (m_scheduler)
+        m_scheduler->release(this);
+
+    emit errorOccurred(OperationCanceledError);
+    emit finished();
+}
+
+void ScheduledReply::close() {
+    // QtQuick closes the replies of images that went away. Nobody listens
+    // any more, so drop the request quietly; if it was still queued it
+    // never goes out at all.
+    if (!isFinished()) {
+        dropInner();
+        setError(OperationCanceledError, tr("Operation canceled"));
+        setFinished(true);
+        if (m_scheduler)
+            m_scheduler->release(this);
+    }
+    QNetworkReply::close();
+}
+
+qint64 ScheduledReply::bytesAvailable() const {
+    return m_buffer.size() + QNetworkReply::bytesAvailable();
+}
+
+qint64 ScheduledReply::readData(char *data, qint64 maxSize) {
+    const qint64 count = qMin<qint64>(maxSize, m_buffer.size());
+    if (count == 0)
+        return isFinished() ? -1 : 0;
+    std::memcpy(data, m_buffer.constData(), static_cast<size_t>(count));
+    m_buffer.remove(0, count);
+    return count;
+}
+
+// RequestScheduler
+
+RequestScheduler::RequestScheduler(QNetworkAccessManager *nam, QObject *parent)
+    : QObject(parent), m_nam(nam) {
+    QMutexLocker locker(&g_schedulersMutex);
+    g_schedulers.append(this);
+}
+
+RequestScheduler::~RequestScheduler() {
+    {
+        QMutexLocker locker(&g_schedulersMutex);
+        g_schedulers.removeOne(this);
+    }
+
+    // Outstanding replies stay with their consumers but are no longer
+    // tracked; give back their share of the interactive count.
+    auto detach = [](ScheduledReply *reply) {
+        if (!reply || reply->m_done)
+            return;
+        reply->m_done = true;
+        reply->m_scheduler = nullptr;
+        if (reply->m_priority == RequestPriority::Interactive)
+            g_interactivePending.fetch_sub(1);
+    };
+    for (auto &queue : m_queues) {
+        for (const auto &reply : queue)
+            detach(reply);
+    }
+    for (auto *reply : std::as_const(m_running))
+        detach(reply);
+}
+
+QNetworkReply *RequestScheduler::get(const QNetworkRequest &request, RequestPriority priority, QObject *owner) {
+    auto *reply = new ScheduledReply(this, m_nam, request, priority);
+    if (owner)
+        connect(owner, &QObject::destroyed, reply, &ScheduledReply::abort);
+
+    m_queues[static_cast<int>(priority)].append(reply);
+    if (priority == RequestPriority::Interactive)
+        interactiveStarted();
+
+    requestSchedule();
+    return reply;
+}
+
+void RequestScheduler::promote(QNetworkReply *reply, RequestPriority priority) {
+    auto *scheduled = qobject_cast<ScheduledReply *>(reply);
+    if (!scheduled || scheduled->m_done || scheduled->m_scheduler != this)
+        return;
+    if (static_cast<int>(priority) >= static_cast<int>(scheduled->m_priority))
+        return;
+
+    auto &from = m_queues[static_cast<int>(scheduled->m_priority)];
+    const bool queued = from.removeOne(scheduled);
+    scheduled->m_priority = priority;
+    if (queued)
+        m_queues[static_cast<int>(priority)].append(scheduled);
+
+    if (priority == RequestPriority::Interactive)
+        interactiveStarted();
+    requestSchedule();
+}
+
+void RequestScheduler::setMaxPerHost(int limit) {
+    m_maxPerHost = qMax(1, limit);
+    requestSchedule();
+}
+
+RequestPriority RequestScheduler::priorityFor(const QNetworkRequest &request) {
+    switch (request.priority()) {
+    case QNetworkRequest::HighPriority:
+        return RequestPriority::Interactive;
+    case QNetworkRequest::LowPriority:
+        return RequestPriority::Prefetch;
+    default:
+        return RequestPriority::Visible;
+    }
+}
+
+void RequestScheduler::requestSchedule() {
+    // Deferred so that a burst of requests from one event-loop turn is
+    // ordered by priority before any of it starts.
+    if (m_scheduleQueued)
+        return;
+    m_scheduleQueued = true;
+    QMetaObject::invokeMethod(this, &RequestScheduler::schedule, Qt::QueuedConnection);
+}
+
+int RequestScheduler::limitFor(RequestPriority priority) const {
+    const bool interactiveBusy = g_interactivePending.load() > 0;
+    switch (priority) {
+    case RequestPriority::Interactive:
+        // A little headroom so a click never waits behind a full host.
+        return m_maxPerHost + 2;
+    case RequestPriority::Visible:
+        return interactiveBusy ? qMax(1, m_maxPerHost / 2) : m_maxPerHost;
+    case RequestPriority::Prefetch:
+        return interactiveBusy ? 0 : qMax(1, m_maxPerHost - 1);
+    case RequestPriority::Background:
+        return interactiveBusy ? 0 : qMax(1, m_maxPerHost / 3);
+    }
+    return m_maxPerHost;
+}
+
+void RequestScheduler::schedule() {
+    m_scheduleQueued = false;
+
+    for (int p = 0; p < PRIORITY_COUNT; ++p) {
+        const int limit = limitFor(static_cast<RequestPriority>(p));
+        auto &queue = m_queues[p];
+        for (auto it = queue.begin(); it != queue.end();) {
+            ScheduledReply *reply = *it;
+            if (!reply || reply->m_done) {
+                it = queue.erase(it);
+                continue;
+            }
+            int &active = m_activePerHost[reply->m_hostKey];
+            if (active >= limit) {
+                ++it;
+                continue;
+            }
+            it = queue.erase(it);
+            ++active;
+            m_running.append(reply);
+            reply->start(m_nam);
+        }
+    }
+}
+
+void RequestScheduler::release(ScheduledReply *reply) {
+    if (reply->m_done)
+        return;
+    reply->m_done = true;
+
+    if (m_running.removeOne(reply)) {
+        auto it = m_activePerHost.find(reply->m_hostKey);
+        if (it != m_activePerHost.end() && --it.value() <= 0)
+            m_activePerHost.erase(it);
+    } else {
+        m_queues[static_cast<int>(reply->m_priority)].removeOne(reply);
+    }
+
+    if (reply->m_priority == RequestPriority::Interactive)
+        interactiveFinished();
+    requestSchedule();
+}
+
+void RequestScheduler::preemptLowPriority() {
+    for (qsizetype i = m_running.size() - 1; i >= 0; --i) {
+        ScheduledReply *reply = m_running.at(i);
+        if (static_cast<int>(reply->m_priority) < static_cast<int>(RequestPriority::Prefetch))
+            continue;
+        if (!reply->preempt())
+            continue;
+
+        m_running.removeAt(i);
+        auto it = m_activePerHost.find(reply->m_hostKey);
+        if (it != m_activePerHost.end() && --it.value() <= 0)
+            m_activePerHost.erase(it);
+        m_queues[static_cast<int>(reply->m_priority)].prepend(reply);
+    }
+}
+
+void RequestScheduler::interactiveStarted() {
+    g_interactivePending.fetch_add(1);
+    preemptLowPriority();
+
+    QMutexLocker locker(&g_schedulersMutex);
+    for (RequestScheduler *scheduler : std::as_const(g_schedulers)) {
+        if (scheduler == this)
+            continue;
+        QMetaObject::invokeMethod(scheduler, [scheduler] {
+            scheduler->preemptLowPriority();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void RequestScheduler::interactiveFinished() {
+    if (g_interactivePending.fetch_sub(1) != 1)
+        return;
+
+    // Last interactive request in the process: let held-back work resume.
+    QMutexLocker locker(&g_schedulersMutex);
+    for (RequestScheduler *scheduler : std::as_const(g_schedulers)) {
+        if (scheduler == this)
+            continue;
+        QMetaObject::invokeMethod(scheduler, [scheduler] {
+            scheduler->requestSchedule();
+        }, Qt::QueuedConnection);
+    }
+}
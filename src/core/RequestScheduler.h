@@ -0,0 +1,104 @@
+#pragma once
+
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QHash>
+#include <QList>
+#include <array>
+
+enum class RequestPriority {
+    Interactive, // the user just asked for it: opening an album, searching
+    Visible,     // content on screen right now
+    Prefetch,    // likely to be needed soon
+    Background   // scrobbles, stars, maintenance
+};
+
+class RequestScheduler;
+
+// Reply handed out as soon as a request is scheduled. The real request is
+// issued once its host has a free slot and its data is forwarded here, so
+// consumers can abort or drop it before anything went over the wire.
+class ScheduledReply : public QNetworkReply {
+    Q_OBJECT
+public:
+    ~ScheduledReply() override;
+
+    RequestPriority priority() const { return m_priority; }
+
+    void abort() override;
+    void close() override;
+    qint64 bytesAvailable() const override;
+    bool isSequential() const override { return true; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    friend class RequestScheduler;
+    ScheduledReply(RequestScheduler *scheduler, QNetworkAccessManager *nam,
+                   const QNetworkRequest &request, RequestPriority priority);
+
+    void start(QNetworkAccessManager *nam);
+    bool preempt();
+    void dropInner();
+    void copyMetaData();
+    void onInnerReadyRead();
+    void onInnerFinished();
+
+    QPointer<RequestScheduler> m_scheduler;
+    QPointer<QNetworkReply> m_inner;
+    QByteArray m_buffer;
+    QString m_hostKey;
+    RequestPriority m_priority;
+    bool m_delivered = false; // headers or data reached the consumer; can no longer be preempted
+    bool m_done = false;      // released by the scheduler
+};
+
+// Orders GET requests by priority class and caps concurrent requests per
+// host. Interactive requests preempt prefetch and background transfers that
+// have not delivered anything yet, in this scheduler and in every other
+// one (QML image loading runs its own manager on a separate thread), and
+// hold them back until the interactive work is done.
+class RequestScheduler : public QObject {
+    Q_OBJECT
+public:
+    // Set on requests the scheduler issues itself, so a manager that routes
+    // its createRequest() through a scheduler can let them pass.
+    static constexpr QNetworkRequest::Attribute ScheduledAttribute =
+        static_cast<QNetworkRequest::Attribute>(QNetworkRequest::User + 0x5c);
+
+    explicit RequestScheduler(QNetworkAccessManager *nam, QObject *parent = nullptr);
+    ~RequestScheduler() override;
+
+    // The reply is aborted automatically when owner is destroyed.
+    QNetworkReply *get(const QNetworkRequest &request, RequestPriority priority, QObject *owner = nullptr);
+    void promote(QNetworkReply *reply, RequestPriority priority);
+
+    void setMaxPerHost(int limit);
+    int maxPerHost() const { return m_maxPerHost; }
+
+    static RequestPriority priorityFor(const QNetworkRequest &request);
+
+private:
+    friend class ScheduledReply;
+    static constexpr int PRIORITY_COUNT = 4;
+
+    void requestSchedule();
+    void schedule();
+    int limitFor(RequestPriority priority) const;
+    void release(ScheduledReply *reply);
+    void preemptLowPriority();
+    void interactiveStarted();
+    void interactiveFinished();
+
+    QNetworkAccessManager *m_nam;
+    std::array<QList<QPointer<ScheduledReply>>, PRIORITY_COUNT> m_queues;
+    QList<ScheduledReply *> m_running;
+    QHash<QString, int> m_activePerHost;
+    int m_maxPerHost = 6;
+    bool m_scheduleQueued = false;
+};
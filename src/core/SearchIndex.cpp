@@ -0,0 +1,278 @@
+#include "SearchIndex.h"
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+constexpr int MAX_QUERY_WORDS = 16;
+
+// Per query word; a word matched in the name outranks one matched in the
+// artist or album text, an exact word outranks a prefix or infix.
+constexpr quint8 EXACT_PRIMARY = 12, EXACT_SECONDARY = 5;
+constexpr quint8 PREFIX_PRIMARY = 8, PREFIX_SECONDARY = 3;
+constexpr quint8 INFIX_PRIMARY = 3, INFIX_SECONDARY = 1;
+
+quint64 trigramKey(const QString &text, qsizetype i)
+{
+    return quint64(text.at(i).unicode()) << 32 | quint64(text.at(i + 1).unicode()) << 16
+           | text.at(i + 2).unicode();
+}
+
+bool containsSorted(const std::vector<quint32> &list, quint32 value)
+{
+    return std::binary_search(list.begin(), list.end(), value);
+}
+} // namespace
+
+QString SearchIndex::fold(const QString &text)
+{
+    const QString decomposed = text.normalized(QString::NormalizationForm_KD);
+    QString folded;
+    folded.reserve(decomposed.size());
+    for (const QChar c : decomposed)
+    {
+        if (c.category() != QChar::Mark_NonSpacing)
+            folded.append(c);
+    }
+    return folded.toCaseFolded();
+}
+
+QStringList SearchIndex::words(const QString &text)
+{
+    const QString folded = fold(text);
+    QStringList words;
+    QString word;
+    for (const QChar c : folded)
+    {
+        if (c.isLetterOrNumber())
+        {
+            word.append(c);
+        }
+        else if (c == QLatin1Char('\'') || c == QChar(0x2019))
+        {
+            // "don't" is one word
+        }
+        else if (!word.isEmpty())
+        {
+            words.append(word);
+            word.clear();
+        }
+    }
+    if (!word.isEmpty())
+        words.append(word);
+    return words;
+}
+
+void SearchIndex::Builder::add(Kind kind, const QString &id, const QString &primary, const QString &secondary)
+{
+    const quint32 doc = static_cast<quint32>(m_ids.size());
+    m_kinds.push_back(kind);
+    m_lengths.push_back(static_cast<quint16>(qMin<qsizetype>(primary.size(), 0xffff)));
+    m_ids.append(id);
+
+    const auto index = [this, doc](const QString &text, quint32 secondaryBit)
+    {
+        for (const QString &word : words(text))
+        {
+            auto it = m_tokenIds.constFind(word);
+            if (it == m_tokenIds.constEnd())
+            {
+                it = m_tokenIds.insert(word, static_cast<quint32>(m_tokens.size()));
+                m_tokens.append(word);
+            }
+            m_postings.push_back(quint64(*it) << 32 | (doc << 1 | secondaryBit));
+        }
+    };
+    index(primary, 0);
+    if (!secondary.isEmpty())
+        index(secondary, 1);
+}
+
+SearchIndex SearchIndex::Builder::build()
+{
+    SearchIndex index;
+    index.m_kinds = std::move(m_kinds);
+    index.m_lengths = std::move(m_lengths);
+    index.m_ids = std::move(m_ids);
+
+    // Sort the vocabulary so prefixes are contiguous, then renumber.
+    const quint32 tokenCount = static_cast<quint32>(m_tokens.size());
+    std::vector<quint32> order(tokenCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](quint32 a, quint32 b)
+              { return m_tokens.at(a) < m_tokens.at(b); });
+    std::vector<quint32> rank(tokenCount);
+    index.m_tokens.reserve(tokenCount);
+    for (quint32 i = 0; i < tokenCount; ++i)
+    {
+        rank[order[i]] = i;
+        index.m_tokens.append(m_tokens.at(order[i]));
+    }
+
+    for (quint64 &posting : m_postings)
+        posting = quint64(rank[posting >> 32]) << 32 | (posting & 0xffffffffu);
+    std::sort(m_postings.begin(), m_postings.end());
+    m_postings.erase(std::unique(m_postings.begin(), m_postings.end()), m_postings.end());
+
+    index.m_tokenOffsets.assign(tokenCount + 1, 0);
+    index.m_postings.reserve(m_postings.size());
+    for (const quint64 posting : m_postings)
+    {
+        ++index.m_tokenOffsets[(posting >> 32) + 1];
+        index.m_postings.push_back(static_cast<quint32>(posting));
+    }
+    std::partial_sum(index.m_tokenOffsets.begin(), index.m_tokenOffsets.end(), index.m_tokenOffsets.begin());
+
+    for (quint32 token = 0; token < tokenCount; ++token)
+    {
+        const QString &text = index.m_tokens.at(token);
+        for (qsizetype i = 0; i + 2 < text.size(); ++i)
+        {
+            std::vector<quint32> &tokens = index.m_trigrams[trigramKey(text, i)];
+            if (tokens.empty() || tokens.back() != token)
+                tokens.push_back(token);
+        }
+    }
+
+    const size_t docs = index.m_ids.size();
+    index.m_matchedWords.assign(docs, 0);
+    index.m_wordScores.assign(docs, 0);
+    index.m_scores.assign(docs, 0);
+
+    m_tokenIds.clear();
+    m_tokens.clear();
+    m_postings = {};
+    return index;
+}
+
+SearchIndex::Hits SearchIndex::search(const QString &query, int artistLimit, int albumLimit, int trackLimit) const
+{
+    Hits hits;
+    QStringList queryWords = words(query);
+    if (queryWords.isEmpty() || isEmpty())
+        return hits;
+
+    // Longest words first: they match the fewest documents, which keeps the
+    // candidate set small for the rest.
+    std::stable_sort(queryWords.begin(), queryWords.end(), [](const QString &a, const QString &b)
+                     { return a.size() > b.size(); });
+    if (queryWords.size() > MAX_QUERY_WORDS)
+        queryWords.resize(MAX_QUERY_WORDS);
+
+    for (int i = 0; i < queryWords.size(); ++i)
+    {
+        addMatches(queryWords.at(i), i);
+        if (i == 0)
+            continue;
+        // Drop documents that missed this word.
+        const auto missed = std::partition(m_candidates.begin(), m_candidates.end(), [this, i](quint32 doc)
+                                           { return m_matchedWords[doc] == i + 1; });
+        for (auto it = missed; it != m_candidates.end(); ++it)
+        {
+            m_matchedWords[*it] = 0;
+            m_scores[*it] = 0;
+        }
+        m_candidates.erase(missed, m_candidates.end());
+        if (m_candidates.empty())
+            break;
+    }
+
+    std::vector<quint32> ranked[3];
+    for (const quint32 doc : m_candidates)
+        ranked[static_cast<int>(m_kinds[doc])].push_back(doc);
+
+    const auto better = [this](quint32 a, quint32 b)
+    {
+        if (m_scores[a] != m_scores[b])
+            return m_scores[a] > m_scores[b];
+        if (m_lengths[a] != m_lengths[b])
+            return m_lengths[a] < m_lengths[b];
+        return a < b;
+    };
+    const auto collect = [this, &better](std::vector<quint32> &docs, int limit, QStringList &ids)
+    {
+        const auto end = docs.begin() + qMin<qsizetype>(qMax(limit, 0), docs.size());
+        std::partial_sort(docs.begin(), end, docs.end(), better);
+        ids.reserve(end - docs.begin());
+        for (auto it = docs.begin(); it != end; ++it)
+            ids.append(m_ids.at(*it));
+    };
+    collect(ranked[static_cast<int>(Kind::Artist)], artistLimit, hits.artistIds);
+    collect(ranked[static_cast<int>(Kind::Album)], albumLimit, hits.albumIds);
+    collect(ranked[static_cast<int>(Kind::Track)], trackLimit, hits.trackIds);
+
+    for (const quint32 doc : m_candidates)
+    {
+        m_matchedWords[doc] = 0;
+        m_scores[doc] = 0;
+    }
+    m_candidates.clear();
+    return hits;
+}
+
+void SearchIndex::addMatches(const QString &word, int wordIndex) const
+{
+    // Exact and prefix matches are one contiguous run of the vocabulary,
+    // starting with the word itself if it is indexed.
+    const auto first = std::lower_bound(m_tokens.begin(), m_tokens.end(), word);
+    for (auto it = first; it != m_tokens.end() && it->startsWith(word); ++it)
+    {
+        const quint32 token = static_cast<quint32>(it - m_tokens.begin());
+        if (it->size() == word.size())
+            visitToken(token, EXACT_PRIMARY, EXACT_SECONDARY, wordIndex);
+        else
+            visitToken(token, PREFIX_PRIMARY, PREFIX_SECONDARY, wordIndex);
+    }
+
+    if (word.size() < 3)
+        return;
+
+    // Infix: tokens holding every trigram of the word, checked with contains().
+    std::vector<const std::vector<quint32> *> lists;
+    for (qsizetype i = 0; i + 2 < word.size(); ++i)
+    {
+        const auto it = m_trigrams.constFind(trigramKey(word, i));
+        if (it == m_trigrams.constEnd())
+            return;
+        lists.push_back(&it.value());
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto *a, const auto *b)
+              { return a->size() < b->size(); });
+    for (const quint32 token : *lists.front())
+    {
+        const QString &text = m_tokens.at(token);
+        if (text.startsWith(word))
+            continue;
+        const bool all = std::all_of(lists.begin() + 1, lists.end(), [token](const auto *list)
+                                     { return containsSorted(*list, token); });
+        if (all && text.contains(word))
+            visitToken(token, INFIX_PRIMARY, INFIX_SECONDARY, wordIndex);
+    }
+}
+
+void SearchIndex::visitToken(quint32 token, quint8 primaryScore, quint8 secondaryScore, int wordIndex) const
+{
+    const quint8 matched = static_cast<quint8>(wordIndex + 1);
+    for (quint32 i = m_tokenOffsets[token]; i < m_tokenOffsets[token + 1]; ++i)
+    {
+        const quint32 posting = m_postings[i];
+        const quint32 doc = posting >> 1;
+        const quint8 score = (posting & 1) ? secondaryScore : primaryScore;
+
+        if (m_matchedWords[doc] == wordIndex)
+        {
+            // First match of this word; only documents that matched every
+            // earlier word get here.
+            if (wordIndex == 0)
+                m_candidates.push_back(doc);
+            m_matchedWords[doc] = matched;
+            m_wordScores[doc] = score;
+            m_scores[doc] += score;
+        }
+        else if (m_matchedWords[doc] == matched && score > m_wordScores[doc])
+        {
+            m_scores[doc] += score - m_wordScores[doc];
+            m_wordScores[doc] = score;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+// In-memory full-text index over artists, albums and tracks, for search as
+// you type without a server round trip. Text is folded (case, diacritics,
+// compatibility forms) and split into words. Query words match indexed
+// words exactly, by prefix (binary search over the sorted vocabulary) or as
+// an infix (trigram lookup), and every query word has to match for a result
+// to count. Results are ranked by how well and in which field they matched.
+//
+// Only ids are kept; callers resolve them to entries. Built on a worker
+// thread, then read-only; search() reuses scratch buffers and so must only
+// be called from one thread at a time.
+class SearchIndex
+{
+public:
+    enum class Kind : quint8
+    {
+        Artist,
+        Album,
+        Track
+    };
+
+    struct Hits
+    {
+        QStringList artistIds, albumIds, trackIds;
+    };
+
+    class Builder
+    {
+    public:
+        // primary is the name or title, secondary the artist and album text.
+        void add(Kind kind, const QString &id, const QString &primary, const QString &secondary = {});
+        SearchIndex build();
+
+    private:
+        friend class SearchIndex;
+        std::vector<Kind> m_kinds;
+        std::vector<quint16> m_lengths;
+        QStringList m_ids;
+        QHash<QString, quint32> m_tokenIds;
+        QStringList m_tokens;
+        // token id << 32 | posting
+        std::vector<quint64> m_postings;
+    };
+
+    bool isEmpty() const { return m_ids.isEmpty(); }
+    qsizetype size() const { return m_ids.size(); }
+    Hits search(const QString &query, int artistLimit, int albumLimit, int trackLimit) const;
+
+    // Lower case, no diacritics, compatibility forms decomposed.
+    static QString fold(const QString &text);
+    static QStringList words(const QString &text);
+
+private:
+    void addMatches(const QString &word, int wordIndex) const;
+    void visitToken(quint32 token, quint8 primaryScore, quint8 secondaryScore, int wordIndex) const;
+
+    std::vector<Kind> m_kinds;
+    std::vector<quint16> m_lengths;  // of the primary text, for tie breaks
+    QStringList m_ids;
+
+    // Sorted vocabulary; token ids are positions in it.
+    QStringList m_tokens;
+    // Postings of token t are m_postings[m_tokenOffsets[t], m_tokenOffsets[t + 1]),
+    // each doc << 1 | (matched in secondary text), ascending.
+    std::vector<quint32> m_tokenOffsets;
+    std::vector<quint32> m_postings;
+    // Trigram -> ascending token ids containing it.
+    QHash<quint64, std::vector<quint32>> m_trigrams;
+
+    // Per-query scratch, sized to the document count and reset after use.
+    mutable std::vector<quint8> m_matchedWords;
+    mutable std::vector<quint8> m_wordScores;  // best score for the current word
+    mutable std::vector<quint16> m_scores;
+    mutable std::vector<quint32> m_candidates;
+};
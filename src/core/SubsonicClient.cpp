@@ -1,5 +1,6 @@
 #include "SubsonicClient.h"
 #include "CacheManager.h"
+#include "LibrarySync.h"
 #include <set>
 #include <QCryptographicHash>
 #include <QRandomGenerator>
@@ -7,33 +8,31 @@
 #include <QNetworkReply>
 #include <QNetworkDiskCache>
 #include <QSettings>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QStandardPaths>
 #include <QDateTime>
 #include <QUrl>
 #include <QDir>
 #include <QDebug>
 #include <QTimer>
 #include <functional>
+#include <initializer_list>
 #include <memory>
 #include <algorithm>
+#include <utility>
 #include <QSet>
+#include <QFuture>
 
 static constexpr auto API_VERSION = "1.16.1";
 static constexpr auto CLIENT_NAME = "ShibaMusicQt";
 static constexpr int ALBUM_LIST_PAGE_SIZE = 50;
 static constexpr int RECENTLY_PLAYED_ALBUM_LIMIT = 20;
 static constexpr int MOST_PLAYED_ALBUM_LIMIT = 10;
-
-static QHash<QString, QString> g_stringPool;
-static QString internString(const QString &str) {
-    if (str.isEmpty()) return str;
-    auto it = g_stringPool.constFind(str);
-    if (it != g_stringPool.constEnd()) return *it;
-    g_stringPool.insert(str, str);
-    return str;
-}
+static constexpr int ALBUM_BATCH_PARALLELISM = 4;
+static constexpr int SEARCH_ARTIST_COUNT = 20;
+static constexpr int SEARCH_ALBUM_COUNT = 40;
+static constexpr int SEARCH_SONG_COUNT = 100;
+// The catalog is compacted once it holds at least this many records and
+// more than twice as many as the models still show.
+static constexpr qsizetype CATALOG_COMPACT_MIN_RECORDS = 20000;
 
 static inline QString ensureNoTrailingSlash(QString s)
 {
@@ -60,63 +59,17 @@ static void clearAndShrink(List &list)
     list.squeeze();
 }
 
-QVariantList SubsonicClient::tracksToVariantList(const TrackList &list)
-{
-    QVariantList result;
-    result.reserve(list.size());
-    for (const auto &entry : list)
-        result.append(trackEntryToVariant(entry));
-    return result;
-}
-
-SubsonicClient::TrackList SubsonicClient::tracksFromVariantList(const QVariantList &list)
-{
-    TrackList result;
-    result.reserve(list.size());
-    for (const QVariant &value : list)
-        result.append(trackEntryFromVariant(value.toMap()));
-    return result;
-}
-
-QVariantMap SubsonicClient::trackEntryToVariant(const TrackEntry &entry)
+QVariantMap SubsonicClient::playlistEntryToVariant(const PlaylistEntry &entry)
 {
     QVariantMap map;
     map.insert(QStringLiteral("id"), entry.id);
-    map.insert(QStringLiteral("title"), entry.title);
-    map.insert(QStringLiteral("artist"), entry.artist);
-    map.insert(QStringLiteral("artistId"), entry.artistId);
-    map.insert(QStringLiteral("album"), entry.album);
-    map.insert(QStringLiteral("albumId"), entry.albumId);
+    map.insert(QStringLiteral("name"), entry.name);
+    map.insert(QStringLiteral("songCount"), entry.songCount);
     map.insert(QStringLiteral("duration"), entry.duration);
-    if (entry.track > 0)
-        map.insert(QStringLiteral("track"), entry.track);
-    if (entry.year > 0)
-        map.insert(QStringLiteral("year"), entry.year);
-    if (!entry.coverArt.isEmpty())
-        map.insert(QStringLiteral("coverArt"), entry.coverArt);
-    map.insert(QStringLiteral("replayGainTrackGain"), entry.replayGainTrackGain);
-    map.insert(QStringLiteral("replayGainAlbumGain"), entry.replayGainAlbumGain);
+    map.insert(QStringLiteral("coverArt"), entry.coverArt);
     return map;
 }
 
-SubsonicClient::TrackEntry SubsonicClient::trackEntryFromVariant(const QVariantMap &map)
-{
-    TrackEntry entry;
-    entry.id = internString(map.value(QStringLiteral("id")).toString());
-    entry.title = internString(map.value(QStringLiteral("title")).toString());
-    entry.artist = internString(map.value(QStringLiteral("artist")).toString());
-    entry.artistId = internString(map.value(QStringLiteral("artistId")).toString());
-    entry.album = internString(map.value(QStringLiteral("album")).toString());
-    entry.albumId = internString(map.value(QStringLiteral("albumId")).toString());
-    entry.coverArt = internString(map.value(QStringLiteral("coverArt")).toString());
-    entry.duration = map.value(QStringLiteral("duration")).toInt();
-    entry.track = static_cast<qint16>(map.value(QStringLiteral("track")).toInt());
-    entry.year = static_cast<qint16>(map.value(QStringLiteral("year")).toInt());
-    entry.replayGainTrackGain = static_cast<float>(map.value(QStringLiteral("replayGainTrackGain")).toDouble());
-    entry.replayGainAlbumGain = static_cast<float>(map.value(QStringLiteral("replayGainAlbumGain")).toDouble());
-    return entry;
-}
-
 static QString credentialKeyFor(const QString &serverUrl, const QString &username)
 {
     const QString normalizedUrl = normalizedCredentialUrl(serverUrl);
@@ -325,17 +278,91 @@ static void migrateLegacyCredentials(QSettings &settings)
     settings.remove("password");
 }
 
-SubsonicClient::SubsonicClient(QObject *parent) : QObject(parent)
+SubsonicClient::SubsonicClient(QObject *parent)
+    : QObject(parent),
+      m_scheduler(&m_nam),
+      m_artistsModel(&m_catalog),
+      m_albumListModel(&m_catalog),
+      m_tracksModel(&m_catalog),
+      m_randomSongsModel(&m_catalog),
+      m_favoritesModel(&m_catalog)
 {
     loadRecentlyPlayed();
 
     auto *diskCache = new QNetworkDiskCache(this);
-    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/network";
+    const QString cacheDir = CacheManager::networkCacheDirectory();
     QDir().mkpath(cacheDir);
     diskCache->setCacheDirectory(cacheDir);
     diskCache->setMaximumCacheSize(30 * 1024 * 1024);
     m_nam.setCache(diskCache);
     m_nam.setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+
+    connect(&m_pagedAlbumModel, &PagedAlbumModel::pageRequested, this, &SubsonicClient::fetchAlbumPage);
+    connect(&m_pagedAlbumModel, &PagedAlbumModel::pageCancelled, this, [this](int page)
+            {
+        const auto it = m_albumPageRequests.find(page);
+        if (it == m_albumPageRequests.end())
+            return;
+        abortRequest(**it);
+        m_albumPageRequests.erase(it); });
+
+    // Records are released whenever a model drops or replaces rows.
+    for (LibraryListModel *model : std::initializer_list<LibraryListModel *>{
+             &m_artistsModel, &m_albumListModel, &m_tracksModel, &m_randomSongsModel, &m_favoritesModel})
+    {
+        connect(model, &QAbstractItemModel::modelReset, this, &SubsonicClient::scheduleCatalogCompaction);
+        connect(model, &QAbstractItemModel::rowsRemoved, this, &SubsonicClient::scheduleCatalogCompaction);
+        connect(model, &QAbstractItemModel::dataChanged, this, &SubsonicClient::scheduleCatalogCompaction);
+    }
+}
+
+static qsizetype catalogRecords(const LibraryCatalog &catalog)
+{
+    return catalog.trackCount() + catalog.albumCount() + catalog.artistCount();
+}
+
+void SubsonicClient::scheduleCatalogCompaction()
+{
+    if (m_catalogCompactionQueued || catalogRecords(m_catalog) < std::max(CATALOG_COMPACT_MIN_RECORDS, m_catalogCompactAt))
+        return;
+    // Queued so whoever is updating a model finishes with its handles first.
+    m_catalogCompactionQueued = true;
+    QMetaObject::invokeMethod(this, &SubsonicClient::compactCatalog, Qt::QueuedConnection);
+}
+
+void SubsonicClient::compactCatalog()
+{
+    m_catalogCompactionQueued = false;
+    const auto mark = [](QList<bool> &live, const QList<LibraryCatalog::Handle> &handles)
+    {
+        qsizetype added = 0;
+        for (const LibraryCatalog::Handle handle : handles)
+        {
+            if (!live.at(handle))
+                ++added;
+            live[handle] = true;
+        }
+        return added;
+    };
+    QList<bool> tracks(m_catalog.trackCount(), false);
+    QList<bool> albums(m_catalog.albumCount(), false);
+    QList<bool> artists(m_catalog.artistCount(), false);
+    const qsizetype live = mark(tracks, m_tracksModel.handles()) + mark(tracks, m_randomSongsModel.handles())
+                           + mark(tracks, m_favoritesModel.handles()) + mark(albums, m_albumListModel.handles())
+                           + mark(artists, m_artistsModel.handles());
+
+    // Checked again at twice the current size, so the cost of a pass is
+    // spread over the records added since the last one.
+    if (live * 2 <= catalogRecords(m_catalog))
+    {
+        const LibraryCatalog::Remap remap = m_catalog.compact(tracks, albums, artists);
+        m_tracksModel.remapHandles(remap.tracks);
+        m_randomSongsModel.remapHandles(remap.tracks);
+        m_favoritesModel.remapHandles(remap.tracks);
+        m_albumListModel.remapHandles(remap.albums);
+        m_artistsModel.remapHandles(remap.artists);
+    }
+    m_catalogCompactAt = catalogRecords(m_catalog) * 2;
 }
 
 void SubsonicClient::setServerUrl(const QString &url)
@@ -412,9 +439,9 @@ QUrl SubsonicClient::buildUrl(const QString &method, const QUrlQuery &extra, boo
     return url;
 }
 
-bool SubsonicClient::checkOk(const QJsonDocument &doc, QString *err, int *code) const
+bool SubsonicClient::checkOk(const SubsonicResponse &response, QString *err, int *code) const
 {
-    if (doc.isNull())
+    if (!response.valid)
     {
         if (code)
             *code = -1;
@@ -423,8 +450,7 @@ bool SubsonicClient::checkOk(const QJsonDocument &doc, QString *err, int *code)
         return false;
     }
 
-    const QJsonObject root = doc.object().value(QStringLiteral("subsonic-response")).toObject();
-    if (root.value(QStringLiteral("status")).toString() == QLatin1String("ok"))
+    if (response.ok)
     {
         if (code)
             *code = 0;
@@ -433,17 +459,15 @@ bool SubsonicClient::checkOk(const QJsonDocument &doc, QString *err, int *code)
         return true;
     }
 
-    const QJsonObject errorObj = root.value(QStringLiteral("error")).toObject();
-    const int errorCode = errorObj.value(QStringLiteral("code")).toInt();
+    const int errorCode = response.errorCode;
     if (code)
         *code = errorCode;
 
     if (err)
     {
-        const QString message = errorObj.value(QStringLiteral("message")).toString();
-        if (!message.isEmpty())
+        if (!response.errorMessage.isEmpty())
         {
-            *err = QStringLiteral("%1 (code %2)").arg(message, QString::number(errorCode));
+            *err = QStringLiteral("%1 (code %2)").arg(response.errorMessage, QString::number(errorCode));
         }
         else
         {
@@ -454,6 +478,305 @@ bool SubsonicClient::checkOk(const QJsonDocument &doc, QString *err, int *code)
     return false;
 }
 
+// Credentials are left out so a refreshed token keeps the key, but the
+// server and user are kept: the same call means something else elsewhere.
+QString SubsonicClient::canonicalRequestKey(const QString &method, const QUrlQuery &params) const
+{
+    static const QSet<QString> authParams = {
+        QStringLiteral("u"), QStringLiteral("t"), QStringLiteral("s"), QStringLiteral("p"),
+        QStringLiteral("v"), QStringLiteral("c"), QStringLiteral("f")};
+
+    auto items = params.queryItems(QUrl::FullyEncoded);
+    std::sort(items.begin(), items.end());
+
+    QString key = method;
+    for (const auto &item : items)
+    {
+        if (authParams.contains(item.first))
+            continue;
+        key += QLatin1Char('&') + item.first + QLatin1Char('=') + item.second;
+    }
+    return cacheKey(key);
+}
+
+bool SubsonicClient::isWaiterLive(const PendingWaiter &waiter)
+{
+    return !waiter.slot || waiter.slot->generation == waiter.generation;
+}
+
+void SubsonicClient::sendRequest(const QString &method, const QUrlQuery &params, RequestSlot *slot, RequestPriority priority,
+                                 ResponseHandler onSuccess, FailureHandler onFailure)
+{
+    const QString key = canonicalRequestKey(method, params);
+
+    if (slot)
+    {
+        // Detach the slot from its previous request. When it asks for the
+        // same thing again, that reply is kept and simply picked up below.
+        ++slot->generation;
+        if (slot->key != key)
+            releaseRequest(slot->key);
+        slot->key = key;
+    }
+
+    PendingWaiter waiter{slot, slot ? slot->generation : 0, std::move(onSuccess), std::move(onFailure)};
+
+    auto it = m_pendingRequests.find(key);
+    if (it != m_pendingRequests.end())
+    {
+        it->waiters.append(std::move(waiter));
+        ++m_requestsCoalesced;
+        // A background fetch someone now waits on interactively must not
+        // stay queued behind prefetch traffic.
+        m_scheduler.promote(it->reply, priority);
+        return;
+    }
+
+    QNetworkRequest req(buildUrl(method, params, true));
+    auto *reply = m_scheduler.get(req, priority);
+    ++m_requestsSent;
+
+    PendingRequest pending;
+    pending.reply = reply;
+    pending.waiters.append(std::move(waiter));
+    m_pendingRequests.insert(key, std::move(pending));
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, key]
+            { finishRequest(key, reply); });
+}
+
+void SubsonicClient::finishRequest(const QString &key, QNetworkReply *reply)
+{
+    reply->deleteLater();
+
+    // An aborted reply may already have been replaced by a newer one.
+    auto it = m_pendingRequests.find(key);
+    if (it == m_pendingRequests.end() || it->reply != reply)
+        return;
+    QList<PendingWaiter> waiters = std::move(it->waiters);
+    m_pendingRequests.erase(it);
+
+    auto fail = [this](const PendingWaiter &waiter, const QString &message)
+    {
+        if (waiter.onFailure)
+            waiter.onFailure(message);
+        else
+            emit errorOccurred(message);
+    };
+
+    const auto error = reply->error();
+    if (error != QNetworkReply::NoError)
+    {
+        if (error == QNetworkReply::OperationCanceledError)
+            return;
+        const QString message = reply->errorString();
+        for (const auto &waiter : waiters)
+        {
+            if (isWaiterLive(waiter))
+                fail(waiter, message);
+        }
+        return;
+    }
+
+    // The body is parsed once on the thread pool and fanned out. Liveness is
+    // checked again because slots may have moved on while parsing.
+    SubsonicParser::parseAsync(reply->readAll(), this, [this, waiters, fail](SubsonicResponse response)
+                               {
+        QString err;
+        const bool ok = checkOk(response, &err);
+        for (const auto &waiter : waiters) {
+            if (!isWaiterLive(waiter))
+                continue;
+            if (ok)
+                waiter.onSuccess(response);
+            else
+                fail(waiter, err);
+        } });
+}
+
+void SubsonicClient::releaseRequest(const QString &key)
+{
+    if (key.isEmpty())
+        return;
+    auto it = m_pendingRequests.find(key);
+    if (it == m_pendingRequests.end())
+        return;
+    if (std::any_of(it->waiters.cbegin(), it->waiters.cend(), &SubsonicClient::isWaiterLive))
+        return;
+
+    QNetworkReply *reply = it->reply;
+    m_pendingRequests.erase(it);
+    reply->abort();
+}
+
+void SubsonicClient::sendRevalidatedRequest(const QString &method, const QUrlQuery &params, RequestSlot *slot,
+                                            RequestPriority priority, ResponseHandler apply, SerializeHandler serialize,
+                                            ApplyHandler applyCached)
+{
+    // Stale-while-revalidate: a cached copy is applied as soon as it is
+    // read, the request still goes out, and its result is applied only if
+    // its body differs from the one behind what is already shown. The
+    // body is hashed where it is parsed, and the response is boxed for the
+    // cache on the cache's writer thread.
+    const QString key = canonicalRequestKey(method, params);
+    slot->contentHash.clear();
+
+    sendRequest(method, params, slot, priority, [this, slot, method, key, serialize, apply](const SubsonicResponse &response)
+                {
+        if (response.bodyHash == slot->contentHash)
+            return;
+        slot->contentHash = response.bodyHash;
+        apply(response);
+        if (m_cacheManager) {
+            m_cacheManager->saveMetadata(method, key, [serialize, response]() {
+                QVariantMap data = serialize(response);
+                data.insert(QStringLiteral("contentHash"), QString::fromLatin1(response.bodyHash));
+                return data;
+            });
+        } });
+
+    if (!m_cacheManager)
+        return;
+    const quint64 generation = slot->generation;
+    m_cacheManager->getMetadataAsync(method, key).then(this, [slot, generation, applyCached](QVariantMap cached)
+                                                       {
+        // Dropped if the slot moved on or the network answered first.
+        if (cached.isEmpty() || slot->generation != generation || !slot->contentHash.isEmpty())
+            return;
+        slot->contentHash = cached.take(QStringLiteral("contentHash")).toString().toLatin1();
+        applyCached(cached); });
+}
+
+QVariantMap SubsonicClient::requestStats() const
+{
+    return {
+        {QStringLiteral("sent"), m_requestsSent},
+        {QStringLiteral("coalesced"), m_requestsCoalesced},
+        {QStringLiteral("inFlight"), static_cast<int>(m_pendingRequests.size())},
+    };
+}
+
+void SubsonicClient::sendStreamingRequest(const QString &method, const QUrlQuery &params, RequestSlot *slot, RequestPriority priority,
+                                          BatchHandler onBatch, ResponseHandler onSuccess, FailureHandler onFailure)
+{
+    const QString key = canonicalRequestKey(method, params);
+
+    // The same stream is already running for this slot; its handlers will
+    // apply the result, so a second download would be wasted.
+    if (slot && slot->reply && slot->key == key)
+    {
+        ++m_requestsCoalesced;
+        return;
+    }
+
+    quint64 generation = 0;
+    if (slot)
+    {
+        abortRequest(*slot);
+        generation = slot->generation;
+    }
+
+    QNetworkRequest req(buildUrl(method, params, true));
+    auto *reply = m_scheduler.get(req, priority);
+    ++m_requestsSent;
+    if (slot)
+    {
+        slot->reply = reply;
+        slot->key = key;
+    }
+
+    auto isCurrent = [slot, generation]()
+    {
+        return !slot || slot->generation == generation;
+    };
+    auto fail = [this, onFailure](const QString &message)
+    {
+        if (onFailure)
+            onFailure(message);
+        else
+            emit errorOccurred(message);
+    };
+
+    auto parser = std::make_shared<SubsonicStreamParser>(
+        this,
+        [isCurrent, onBatch](SubsonicResponse batch)
+        {
+            if (isCurrent())
+                onBatch(batch);
+        },
+        [this, isCurrent, fail, onSuccess](SubsonicResponse response)
+        {
+            if (!isCurrent())
+                return;
+            QString err;
+            if (!checkOk(response, &err))
+            {
+                fail(err);
+                return;
+            }
+            onSuccess(response);
+        });
+
+    // Each chunk is handed to the parse thread as soon as it arrives, so
+    // only the not-yet-parsed bytes are ever buffered.
+    connect(reply, &QNetworkReply::readyRead, this, [reply, parser]
+            { parser->feed(reply->readAll()); });
+    connect(reply, &QNetworkReply::finished, this, [reply, slot, isCurrent, fail, parser]
+            {
+        reply->deleteLater();
+        if (!isCurrent()) {
+            parser->cancel();
+            return;
+        }
+        if (slot)
+            slot->reply = nullptr;
+
+        const auto error = reply->error();
+        if (error != QNetworkReply::NoError) {
+            parser->cancel();
+            if (error != QNetworkReply::OperationCanceledError)
+                fail(reply->errorString());
+            return;
+        }
+
+        parser->feed(reply->readAll());
+        parser->finish(); });
+}
+
+void SubsonicClient::abortRequest(RequestSlot &slot)
+{
+    ++slot.generation;
+    const QString key = std::exchange(slot.key, QString());
+    releaseRequest(key);
+
+    if (!slot.reply)
+        return;
+    QNetworkReply *reply = slot.reply;
+    slot.reply = nullptr;
+    reply->abort();
+}
+
+bool SubsonicClient::mirrorReady() const
+{
+    return m_librarySync && m_librarySync->ready() && m_librarySync->mirror();
+}
+
+template <typename T>
+void SubsonicClient::queryMirror(RequestSlot &slot, QFuture<std::optional<T>> lookup,
+                                 std::function<void(const T &)> apply, std::function<void()> fallback)
+{
+    abortRequest(slot);
+    const quint64 generation = slot.generation;
+    lookup.then(this, [slot = &slot, generation, apply = std::move(apply), fallback = std::move(fallback)](const std::optional<T> &result)
+                {
+        if (slot->generation != generation)
+            return;
+        if (result)
+            apply(*result);
+        else
+            fallback(); });
+}
+
 void SubsonicClient::setAuthenticated(bool ok)
 {
     if (m_authenticated == ok)
@@ -522,7 +845,7 @@ void SubsonicClient::login(const QString &url, const QString &user, const QStrin
             }
 
             QNetworkRequest req(buildUrl("ping", {}, true));
-            auto *reply = m_nam.get(req);
+            auto *reply = m_scheduler.get(req, RequestPriority::Interactive);
             connect(reply, &QNetworkReply::finished, this, [this, reply, context, attempt, mode]()
                     {
                 const auto networkError = reply->error();
@@ -552,10 +875,10 @@ void SubsonicClient::login(const QString &url, const QString &user, const QStrin
                 const QByteArray payload = reply->readAll();
                 reply->deleteLater();
 
-                const QJsonDocument doc = QJsonDocument::fromJson(payload);
+                const SubsonicResponse response = SubsonicParser::parse(payload);
                 QString err;
                 int errCode = 0;
-                const bool ok = checkOk(doc, &err, &errCode);
+                const bool ok = checkOk(response, &err, &errCode);
                 if (!ok) {
                     if (mode == AuthMode::Token && !context->legacyFallbackAttempted && shouldFallbackForError(errCode)) {
                         context->legacyFallbackAttempted = true;
@@ -601,24 +924,25 @@ void SubsonicClient::logout()
     m_passwordHex.clear();
     m_authMode = AuthMode::Token;
 
-    auto abortReply = [](QNetworkReply *&reply)
-    {
-        if (!reply)
-            return;
-        reply->abort();
-        reply->deleteLater();
-        reply = nullptr;
-    };
-
-    abortReply(m_artistReply);
-    abortReply(m_albumListReply);
-    abortReply(m_albumReply);
-    abortReply(m_randomSongsReply);
-    abortReply(m_favoritesReply);
-    abortReply(m_playlistsReply);
-    abortReply(m_playlistReply);
-    abortReply(m_recentlyPlayedReply);
-    abortReply(m_mostPlayedReply);
+    abortRequest(m_artistsRequest);
+    abortRequest(m_artistRequest);
+    abortRequest(m_albumListRequest);
+    abortRequest(m_albumRequest);
+    abortRequest(m_randomSongsRequest);
+    abortRequest(m_favoritesRequest);
+    abortRequest(m_playlistsRequest);
+    abortRequest(m_playlistRequest);
+    abortRequest(m_recentlyPlayedRequest);
+    abortRequest(m_mostPlayedRequest);
+    abortRequest(m_searchRequest);
+
+    // The album batch's requests are dropped below.
+    supersedeAlbumBatch();
+
+    // Requests without a slot (search, queue appends) are dropped as well.
+    const auto pending = std::exchange(m_pendingRequests, {});
+    for (const auto &request : pending)
+        request.reply->abort();
 
     if (!m_artistCover.isEmpty())
     {
@@ -626,33 +950,36 @@ void SubsonicClient::logout()
         emit artistCoverChanged();
     }
 
-    const bool hadArtists = !m_artists.isEmpty();
+    const bool hadArtists = !m_artistsModel.isEmpty();
     const bool hadAlbums = !m_albums.isEmpty();
-    const bool hadAlbumList = !m_albumList.isEmpty();
-    const bool hadTracks = !m_tracks.isEmpty();
+    const bool hadAlbumList = !m_albumListModel.isEmpty();
+    const bool hadTracks = !m_tracksModel.isEmpty();
     const bool hadSearchArtists = !m_searchArtists.isEmpty();
     const bool hadSearchAlbums = !m_searchAlbums.isEmpty();
     const bool hadRecentlyPlayed = !m_recentlyPlayedAlbums.isEmpty();
     const bool hadMostPlayed = !m_mostPlayedAlbums.isEmpty();
-    const bool hadRandomSongs = !m_randomSongs.isEmpty();
-    const bool hadFavorites = !m_favorites.isEmpty();
+    const bool hadRandomSongs = !m_randomSongsModel.isEmpty();
+    const bool hadFavorites = !m_favoritesModel.isEmpty();
     const bool hadPlaylists = !m_playlists.isEmpty();
 
-    clearAndShrink(m_artists);
+    m_artistsModel.clear();
     clearAndShrink(m_albums);
-    clearAndShrink(m_albumList);
-    clearAndShrink(m_tracks);
+    m_albumListModel.clear();
+    ++m_pagedAlbumGeneration;
+    m_pagedAlbumModel.reset(0);
+    m_tracksModel.clear();
     clearAndShrink(m_searchArtists);
     clearAndShrink(m_searchAlbums);
     clearAndShrink(m_recentlyPlayedAlbums);
     clearAndShrink(m_mostPlayedAlbums);
-    clearAndShrink(m_randomSongs);
-    clearAndShrink(m_favorites);
+    m_randomSongsModel.clear();
+    m_favoritesModel.clear();
     clearAndShrink(m_playlists);
-    
-    // Clear string pool on logout to free memory
-    g_stringPool.clear();
-    g_stringPool.squeeze();
+
+    // Nothing references catalog handles any more; release its storage.
+    m_catalog.clear();
+    m_albumListModel.clearSortKeys();
+    m_catalogCompactAt = 0;
 
     if (hadArtists)
         emit artistsChanged();
@@ -688,57 +1015,82 @@ void SubsonicClient::fetchArtists()
     if (!m_authenticated)
         return;
 
-    if (m_cacheManager && m_artists.isEmpty())
+    if (mirrorReady())
     {
-        const auto cached = m_cacheManager->getList(cacheKey("artists"));
-        if (!cached.isEmpty())
-        {
-            m_artists = cached;
-            emit artistsChanged();
-        }
+        queryMirror<ArtistList>(
+            m_artistsRequest, m_librarySync->mirror()->artists(),
+            [this](const ArtistList &artists)
+            {
+                m_artistsModel.setItems(artists);
+                emit artistsChanged();
+            },
+            [this]
+            { fetchArtistsFromServer(); });
+        return;
+    }
+    fetchArtistsFromServer();
+}
+
+void SubsonicClient::fetchArtistsFromServer()
+{
+    if (m_cacheManager && m_artistsModel.isEmpty())
+    {
+        // Decoded on the pool; only interning the entries happens here.
+        m_cacheManager->getListSnapshotAsync(cacheKey("artists"))
+            .then(QtFuture::Launch::Async, [](const ListSnapshot &cached)
+                  { return cached.artists(); })
+            .then(this, [this](const ArtistList &artists)
+                  {
+            // The network may have won the race.
+            if (artists.isEmpty() || !m_artistsModel.isEmpty())
+                return;
+            m_artistsModel.setItems(artists);
+            emit artistsChanged(); });
     }
 
-    QNetworkRequest req(buildUrl("getArtists", {}, true));
-    auto *reply = m_nam.get(req);
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
+    // getArtists can be several megabytes on large servers: stream it and
+    // show each index letter as soon as it is parsed. When a cached list is
+    // already on screen, keep it until the fresh one is complete instead.
+    // That is decided on the first batch, as the cache loads asynchronously.
+    struct ArtistStream
+    {
+        ArtistList pending;
+        bool started = false;
+        bool progressive = false;
+    };
+    auto stream = std::make_shared<ArtistStream>();
+
+    sendStreamingRequest(
+        QStringLiteral("getArtists"), {}, &m_artistsRequest, RequestPriority::Visible,
+        [this, stream](const SubsonicResponse &batch)
+        {
+            if (!stream->started)
             {
-        if (reply->error() != QNetworkReply::NoError) {
-            emit errorOccurred(reply->errorString());
-            reply->deleteLater();
-            return;
-        }
-        const auto doc = QJsonDocument::fromJson(reply->readAll());
-        reply->deleteLater();
-        QString err;
-        if (!checkOk(doc, &err)) { emit errorOccurred(err); return; }
-
-        auto root = doc.object().value("subsonic-response").toObject();
-        auto artists = root.value("artists").toObject().value("index").toArray();
-
-        qsizetype totalArtists = 0;
-        for (const auto &idxVal : artists)
-            totalArtists += idxVal.toObject().value("artist").toArray().size();
-
-        clearAndShrink(m_artists);
-        if (totalArtists > 0)
-            m_artists.reserve(totalArtists);
-
-        for (const auto &idxVal : artists) {
-            auto idx = idxVal.toObject();
-            for (const auto &aVal : idx.value("artist").toArray()) {
-                auto a = aVal.toObject();
-                QVariantMap m {
-                    {"id", a.value("id").toString()},
-                    {"name", a.value("name").toString()},
-                    {"coverArt", a.value("coverArt").toString()}
-                };
-                m_artists.push_back(m);
+                stream->started = true;
+                stream->progressive = m_artistsModel.isEmpty();
             }
-        }
-        emit artistsChanged();
-        if (m_cacheManager) {
-            m_cacheManager->saveList(cacheKey("artists"), m_artists);
-        } });
+            if (stream->progressive)
+            {
+                m_artistsModel.append(batch.artists);
+                emit artistsChanged();
+            }
+            else
+            {
+                stream->pending.append(batch.artists);
+            }
+        },
+        [this, stream](const SubsonicResponse &)
+        {
+            if (!stream->progressive)
+            {
+                m_artistsModel.setItems(std::move(stream->pending));
+                emit artistsChanged();
+            }
+            if (m_cacheManager)
+            {
+                m_cacheManager->saveListSnapshot(cacheKey("artists"), m_artistsModel.entries());
+            }
+        });
 }
 
 void SubsonicClient::fetchArtist(const QString &artistId)
@@ -746,11 +1098,6 @@ void SubsonicClient::fetchArtist(const QString &artistId)
     if (!m_authenticated)
         return;
 
-    if (m_artistReply)
-    {
-        m_artistReply->abort();
-    }
-
     clearAndShrink(m_albums);
     emit albumsChanged();
     clearTracks();
@@ -760,54 +1107,51 @@ void SubsonicClient::fetchArtist(const QString &artistId)
         emit artistCoverChanged();
     }
 
-    QUrlQuery ex;
-    ex.addQueryItem("id", artistId);
-    QNetworkRequest req(buildUrl("getArtist", ex, true));
-    auto *reply = m_nam.get(req);
-    m_artistReply = reply;
-
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
-            {
-        if (reply != m_artistReply) {
-            reply->deleteLater();
-            return;
-        }
-        m_artistReply = nullptr;
-
-        if (reply->error() != QNetworkReply::NoError) {
-            if (reply->error() != QNetworkReply::OperationCanceledError) {
-                emit errorOccurred(reply->errorString());
-            }
-            reply->deleteLater();
-            return;
-        }
-
-        const auto doc = QJsonDocument::fromJson(reply->readAll());
-        reply->deleteLater();
-        QString err;
-        if (!checkOk(doc, &err)) { emit errorOccurred(err); return; }
-
-        auto root = doc.object().value("subsonic-response").toObject();
-        auto artistObj = root.value("artist").toObject();
-        const QString newCover = artistObj.value("coverArt").toString();
-        if (m_artistCover != newCover) {
-            m_artistCover = newCover;
+    auto boxAlbums = [](const AlbumList &albumList)
+    {
+        QVariantList albums;
+        albums.reserve(albumList.size());
+        for (const auto &album : albumList)
+            albums.append(AlbumListModel::toVariant(album));
+        return albums;
+    };
+    auto show = [this](const QString &cover, const QVariantList &albums)
+    {
+        if (m_artistCover != cover)
+        {
+            m_artistCover = cover;
             emit artistCoverChanged();
         }
-        auto albums = artistObj.value("album").toArray();
-        if (!albums.isEmpty())
-            m_albums.reserve(albums.size());
-        for (const auto &av : albums) {
-            auto a = av.toObject();
-            m_albums.push_back(QVariantMap{
-                {"id", a.value("id").toString()},
-                {"name", a.value("name").toString()},
-                {"artistId", a.value("artistId").toString()},
-                {"year", a.value("year").toInt()},
-                {"coverArt", a.value("coverArt").toString()}
-            });
-        }
-        emit albumsChanged(); });
+        m_albums = albums;
+        emit albumsChanged();
+    };
+    auto fromServer = [this, artistId, boxAlbums, show]
+    {
+        QUrlQuery ex;
+        ex.addQueryItem("id", artistId);
+        sendRevalidatedRequest(
+            QStringLiteral("getArtist"), ex, &m_artistRequest, RequestPriority::Interactive,
+            [boxAlbums, show](const SubsonicResponse &response)
+            { show(response.artistCoverArt, boxAlbums(response.albums)); },
+            [boxAlbums](const SubsonicResponse &response)
+            {
+                return QVariantMap{{QStringLiteral("coverArt"), response.artistCoverArt},
+                                   {QStringLiteral("albums"), boxAlbums(response.albums)}};
+            },
+            [show](const QVariantMap &data)
+            { show(data.value(QStringLiteral("coverArt")).toString(), data.value(QStringLiteral("albums")).toList()); });
+    };
+
+    if (mirrorReady())
+    {
+        queryMirror<ArtistDetail>(
+            m_artistRequest, m_librarySync->mirror()->artist(artistId),
+            [boxAlbums, show](const ArtistDetail &artist)
+            { show(artist.coverArt, boxAlbums(artist.albums)); },
+            fromServer);
+        return;
+    }
+    fromServer();
 }
 
 void SubsonicClient::fetchAlbum(const QString &albumId)
@@ -815,63 +1159,30 @@ void SubsonicClient::fetchAlbum(const QString &albumId)
     if (!m_authenticated)
         return;
 
-    if (m_albumReply)
-    {
-        m_albumReply->abort();
-    }
-
     clearTracks();
 
-    QUrlQuery ex;
-    ex.addQueryItem("id", albumId);
-    QNetworkRequest req(buildUrl("getAlbum", ex, true));
-    auto *reply = m_nam.get(req);
-    m_albumReply = reply;
-
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
-            {
-        if (reply != m_albumReply) {
-            reply->deleteLater();
-            return;
-        }
-        m_albumReply = nullptr;
-
-        if (reply->error() != QNetworkReply::NoError) {
-            if (reply->error() != QNetworkReply::OperationCanceledError) {
-                emit errorOccurred(reply->errorString());
-            }
-            reply->deleteLater();
-            return;
-        }
+    auto fromServer = [this, albumId]
+    {
+        QUrlQuery ex;
+        ex.addQueryItem("id", albumId);
+        sendRevalidatedRequest(
+            QStringLiteral("getAlbum"), ex, &m_albumRequest, RequestPriority::Interactive,
+            [this](const SubsonicResponse &response)
+            { showTracks(response.tracks); },
+            &SubsonicClient::tracksToCache, [this](const QVariantMap &data)
+            { applyCachedTracks(data); });
+    };
 
-        const auto doc = QJsonDocument::fromJson(reply->readAll());
-        reply->deleteLater();
-        QString err;
-        if (!checkOk(doc, &err)) { emit errorOccurred(err); return; }
-
-        auto root = doc.object().value("subsonic-response").toObject();
-        auto songs = root.value("album").toObject().value("song").toArray();
-        if (!songs.isEmpty())
-            m_tracks.reserve(songs.size());
-        for (const auto &sv : songs) {
-            auto s = sv.toObject();
-            auto rg = s.value("replayGain").toObject();
-            TrackEntry entry;
-            entry.id = internString(s.value("id").toString());
-            entry.title = internString(s.value("title").toString());
-            entry.artist = internString(s.value("artist").toString());
-            entry.artistId = internString(s.value("artistId").toString());
-            entry.album = internString(s.value("album").toString());
-            entry.albumId = internString(s.value("albumId").toString());
-            entry.track = static_cast<qint16>(s.value("track").toInt());
-            entry.duration = s.value("duration").toInt();
-            entry.coverArt = internString(s.value("coverArt").toString());
-            entry.replayGainTrackGain = static_cast<float>(rg.value("trackGain").toDouble());
-            entry.replayGainAlbumGain = static_cast<float>(rg.value("albumGain").toDouble());
-            entry.year = static_cast<qint16>(s.value("year").toInt());
-            m_tracks.push_back(entry);
-        }
-        emit tracksChanged(); });
+    if (mirrorReady())
+    {
+        queryMirror<TrackList>(
+            m_albumRequest, m_librarySync->mirror()->albumTracks(albumId),
+            [this](const TrackList &tracks)
+            { showTracks(tracks); },
+            fromServer);
+        return;
+    }
+    fromServer();
 }
 
 void SubsonicClient::fetchAlbumList(const QString &type)
@@ -879,36 +1190,30 @@ void SubsonicClient::fetchAlbumList(const QString &type)
     if (!m_authenticated)
         return;
 
-    if (m_pendingAlbumListType != type && !m_albumList.isEmpty())
+    if (m_pendingAlbumListType != type && !m_albumListModel.isEmpty())
     {
-        clearAndShrink(m_albumList);
+        m_albumListModel.clear();
         emit albumListChanged();
     }
 
     setHasMoreAlbumList(false);
 
-    if (m_cacheManager && m_albumList.isEmpty())
+    if (m_cacheManager && m_albumListModel.isEmpty())
     {
-        const auto cached = m_cacheManager->getList(cacheKey(QStringLiteral("albumList:%1").arg(type)));
-        if (!cached.isEmpty())
-        {
+        m_cacheManager->getListSnapshotAsync(cacheKey(QStringLiteral("albumList:%1").arg(type))).then(this, [this, type](const ListSnapshot &cached)
+                                                                                                     {
+            if (cached.size() == 0 || m_pendingAlbumListType != type || !m_albumListModel.isEmpty())
+                return;
+            // Only the first page is decoded; the rest stays in the mapping.
             const int initialCount = std::min(static_cast<qsizetype>(ALBUM_LIST_PAGE_SIZE), cached.size());
-            m_albumList = cached.mid(0, initialCount);
+            m_albumListModel.setItems(cached.albums(0, initialCount));
             emit albumListChanged();
             if (cached.size() > initialCount)
-            {
-                setHasMoreAlbumList(true);
-            }
-        }
+                setHasMoreAlbumList(true); });
     }
 
-    if (m_albumListReply)
-    {
-        m_albumListReply->abort();
-        m_albumListReply->deleteLater();
-        m_albumListReply = nullptr;
-        setAlbumListLoading(false);
-    }
+    abortRequest(m_albumListRequest);
+    setAlbumListLoading(false);
 
     m_pendingAlbumListType = type;
     m_pendingAlbumListOffset = 0;
@@ -927,79 +1232,146 @@ void SubsonicClient::fetchMoreAlbums()
     fetchAlbumListPage(m_pendingAlbumListType, m_pendingAlbumListOffset);
 }
 
-void SubsonicClient::fetchRandomSongs()
+void SubsonicClient::openPagedAlbumList(const QString &type)
 {
     if (!m_authenticated)
         return;
 
-    if (m_cacheManager && m_randomSongs.isEmpty())
+    m_pagedAlbumType = type;
+    const quint64 generation = ++m_pagedAlbumGeneration;
+    m_pagedAlbumModel.reset(0);
+
+    // The mirror knows the total; otherwise a few probes find it.
+    if (mirrorReady() && type == QLatin1String("alphabeticalByName"))
     {
-        const auto cached = m_cacheManager->getList(cacheKey("randomSongs"));
-        if (!cached.isEmpty())
-        {
-            m_randomSongs = tracksFromVariantList(cached);
-            emit randomSongsChanged();
-        }
+        m_librarySync->mirror()->albumCount().then(this, [this, generation](int count)
+                                                   {
+            if (generation != m_pagedAlbumGeneration)
+                return;
+            if (count > 0)
+                m_pagedAlbumModel.reset(count);
+            else
+                probeAlbumCount(generation, 0, 0, -1); });
+        return;
     }
+    probeAlbumCount(generation, 0, 0, -1);
+}
+
+void SubsonicClient::probeAlbumCount(quint64 generation, int offset, int low, int high)
+{
+    // Subsonic has no album count: double the offset until a page comes
+    // back empty, then bisect between the last full and the first empty
+    // page. A partial page gives the exact total. The grid does not wait:
+    // it shows the first page at once and grows to every full page found,
+    // while the rest of the probes run in the background.
+    constexpr int pageSize = PagedAlbumModel::PageSize;
+    QUrlQuery ex;
+    ex.addQueryItem("type", m_pagedAlbumType);
+    ex.addQueryItem("size", QString::number(pageSize));
+    ex.addQueryItem("offset", QString::number(offset));
+    sendRequest(
+        QStringLiteral("getAlbumList2"), ex, nullptr, offset == 0 ? RequestPriority::Interactive : RequestPriority::Background,
+        [this, generation, offset, low, high](const SubsonicResponse &response)
+        {
+            if (generation != m_pagedAlbumGeneration)
+                return;
+            const int received = static_cast<int>(response.albums.size());
+            const auto show = [&](int total)
+            {
+                if (offset == 0)
+                {
+                    m_pagedAlbumModel.reset(total, response.albums);
+                    return;
+                }
+                m_pagedAlbumModel.extend(total);
+                if (received > 0)
+                    m_pagedAlbumModel.setPage(offset / pageSize, response.albums);
+            };
+
+            if (received < pageSize && (received > 0 || offset == 0))
+            {
+                show(offset + received);
+                return;
+            }
+            const int knownRows = received == pageSize ? offset + pageSize : low;
+            const int pastEnd = received == pageSize ? high : offset;
+            show(knownRows);
+            if (pastEnd == knownRows)
+                return;
+            const int next = pastEnd < 0 ? knownRows * 2
+                                         : (knownRows / pageSize + pastEnd / pageSize) / 2 * pageSize;
+            probeAlbumCount(generation, next, knownRows, pastEnd);
+        },
+        [this, generation](const QString &message)
+        {
+            if (generation == m_pagedAlbumGeneration)
+                emit errorOccurred(message);
+        });
+}
 
-    if (m_randomSongsReply)
+void SubsonicClient::fetchAlbumPage(int page, bool prefetch)
+{
+    if (!m_authenticated)
     {
-        m_randomSongsReply->abort();
+        m_pagedAlbumModel.pageFailed(page);
+        return;
     }
 
     QUrlQuery ex;
-    ex.addQueryItem("size", "10");
-    QNetworkRequest req(buildUrl("getRandomSongs", ex, true));
-    auto *reply = m_nam.get(req);
-    m_randomSongsReply = reply;
+    ex.addQueryItem("type", m_pagedAlbumType);
+    ex.addQueryItem("size", QString::number(PagedAlbumModel::PageSize));
+    ex.addQueryItem("offset", QString::number(page * PagedAlbumModel::PageSize));
+    std::shared_ptr<RequestSlot> &slot = m_albumPageRequests[page];
+    if (!slot)
+        slot = std::make_shared<RequestSlot>();
+    // Drops the page's entry once its latest request is answered.
+    auto done = [this, page, slot]
+    {
+        const auto it = m_albumPageRequests.constFind(page);
+        if (it != m_albumPageRequests.cend() && *it == slot)
+            m_albumPageRequests.erase(it);
+    };
+    sendRequest(
+        QStringLiteral("getAlbumList2"), ex, slot.get(),
+        prefetch ? RequestPriority::Background : RequestPriority::Visible,
+        [this, page, done](const SubsonicResponse &response)
+        {
+            done();
+            m_pagedAlbumModel.setPage(page, response.albums);
+        },
+        [this, page, done](const QString &)
+        {
+            done();
+            m_pagedAlbumModel.pageFailed(page);
+        });
+}
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
-            {
-        if (reply != m_randomSongsReply) {
-            reply->deleteLater();
-            return;
-        }
-        m_randomSongsReply = nullptr;
+void SubsonicClient::fetchRandomSongs()
+{
+    if (!m_authenticated)
+        return;
 
-        if (reply->error() != QNetworkReply::NoError) {
-            if (reply->error() != QNetworkReply::OperationCanceledError) {
-                emit errorOccurred(reply->errorString());
-            }
-            reply->deleteLater();
-            return;
-        }
+    if (m_cacheManager && m_randomSongsModel.isEmpty())
+    {
+        m_cacheManager->getListSnapshotAsync(cacheKey("randomSongs"))
+            .then(QtFuture::Launch::Async, [](const ListSnapshot &cached)
+                  { return cached.tracks(); })
+            .then(this, [this](const TrackList &tracks)
+                  {
+            if (tracks.isEmpty() || !m_randomSongsModel.isEmpty())
+                return;
+            m_randomSongsModel.setItems(tracks);
+            emit randomSongsChanged(); });
+    }
 
-        const auto doc = QJsonDocument::fromJson(reply->readAll());
-        reply->deleteLater();
-        QString err;
-        if (!checkOk(doc, &err)) { emit errorOccurred(err); return; }
-
-        clearAndShrink(m_randomSongs);
-        auto root = doc.object().value("subsonic-response").toObject();
-        auto songs = root.value("randomSongs").toObject().value("song").toArray();
-        if (!songs.isEmpty())
-            m_randomSongs.reserve(songs.size());
-        for (const auto &sv : songs) {
-            auto s = sv.toObject();
-            auto rg = s.value("replayGain").toObject();
-            TrackEntry entry;
-            entry.id = internString(s.value("id").toString());
-            entry.title = internString(s.value("title").toString());
-            entry.artist = internString(s.value("artist").toString());
-            entry.artistId = internString(s.value("artistId").toString());
-            entry.album = internString(s.value("album").toString());
-            entry.albumId = internString(s.value("albumId").toString());
-            entry.duration = s.value("duration").toInt();
-            entry.coverArt = internString(s.value("coverArt").toString());
-            entry.track = static_cast<qint16>(s.value("track").toInt());
-            entry.year = static_cast<qint16>(s.value("year").toInt());
-            entry.replayGainTrackGain = static_cast<float>(rg.value("trackGain").toDouble());
-            entry.replayGainAlbumGain = static_cast<float>(rg.value("albumGain").toDouble());
-            m_randomSongs.push_back(entry);
-        }
+    QUrlQuery ex;
+    ex.addQueryItem("size", "10");
+    sendRequest(QStringLiteral("getRandomSongs"), ex, &m_randomSongsRequest, RequestPriority::Visible, [this](const SubsonicResponse &response)
+                {
+        m_randomSongsModel.setItems(response.tracks);
         emit randomSongsChanged();
         if (m_cacheManager) {
-            m_cacheManager->saveList(cacheKey("randomSongs"), tracksToVariantList(m_randomSongs));
+            m_cacheManager->saveListSnapshot(cacheKey("randomSongs"), response.tracks);
         } });
 }
 
@@ -1008,70 +1380,23 @@ void SubsonicClient::fetchRecentlyPlayedAlbums()
     if (!m_authenticated)
         return;
 
-    if (m_recentlyPlayedReply)
-    {
-        m_recentlyPlayedReply->abort();
-    }
-
     QUrlQuery ex;
     ex.addQueryItem(QStringLiteral("type"), QStringLiteral("recent"));
     ex.addQueryItem(QStringLiteral("size"), QString::number(RECENTLY_PLAYED_ALBUM_LIMIT));
 
-    QNetworkRequest req(buildUrl(QStringLiteral("getAlbumList2"), ex, true));
-    auto *reply = m_nam.get(req);
-    m_recentlyPlayedReply = reply;
-
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
-            {
-        if (reply != m_recentlyPlayedReply) {
-            reply->deleteLater();
-            return;
-        }
-        m_recentlyPlayedReply = nullptr;
-
-        const auto error = reply->error();
-        const QString errorString = reply->errorString();
-        const QByteArray payload = (error == QNetworkReply::NoError) ? reply->readAll() : QByteArray();
-        reply->deleteLater();
-
-        if (error != QNetworkReply::NoError) {
-            if (error != QNetworkReply::OperationCanceledError) {
-                emit errorOccurred(errorString);
-            }
-            return;
-        }
-
-        const auto doc = QJsonDocument::fromJson(payload);
-        QString err;
-        if (!checkOk(doc, &err)) {
-            emit errorOccurred(err);
-            return;
-        }
-
-        const auto root = doc.object().value(QStringLiteral("subsonic-response")).toObject();
-        const auto albums = root.value(QStringLiteral("albumList2")).toObject().value(QStringLiteral("album")).toArray();
-
+    sendRequest(QStringLiteral("getAlbumList2"), ex, &m_recentlyPlayedRequest, RequestPriority::Visible, [this](const SubsonicResponse &response)
+                {
         QVariantList fetched;
-        fetched.reserve(albums.size());
-
-        for (const auto &av : albums) {
-            const auto albumObj = av.toObject();
-            QVariantMap album;
-            album.insert(QStringLiteral("id"), internString(albumObj.value(QStringLiteral("id")).toString()));
-            album.insert(QStringLiteral("name"), internString(albumObj.value(QStringLiteral("name")).toString()));
-            album.insert(QStringLiteral("artistId"), internString(albumObj.value(QStringLiteral("artistId")).toString()));
-            album.insert(QStringLiteral("artist"), internString(albumObj.value(QStringLiteral("artist")).toString()));
-            album.insert(QStringLiteral("coverArt"), internString(albumObj.value(QStringLiteral("coverArt")).toString()));
-            fetched.append(album);
-        }
+        fetched.reserve(response.albums.size());
+        for (const auto &album : response.albums)
+            fetched.append(AlbumListModel::toVariant(album));
 
         if (m_recentlyPlayedAlbums != fetched) {
             m_recentlyPlayedAlbums = fetched;
             pruneRecentlyPlayed();
             saveRecentlyPlayed();
             emit recentlyPlayedAlbumsChanged();
-        }
-    });
+        } });
 }
 
 void SubsonicClient::fetchMostPlayedAlbums()
@@ -1079,69 +1404,21 @@ void SubsonicClient::fetchMostPlayedAlbums()
     if (!m_authenticated)
         return;
 
-    if (m_mostPlayedReply)
-    {
-        m_mostPlayedReply->abort();
-    }
-
     QUrlQuery ex;
     ex.addQueryItem(QStringLiteral("type"), QStringLiteral("frequent"));
     ex.addQueryItem(QStringLiteral("size"), QString::number(MOST_PLAYED_ALBUM_LIMIT));
 
-    QNetworkRequest req(buildUrl(QStringLiteral("getAlbumList2"), ex, true));
-    auto *reply = m_nam.get(req);
-    m_mostPlayedReply = reply;
-
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
-            {
-        if (reply != m_mostPlayedReply) {
-            reply->deleteLater();
-            return;
-        }
-        m_mostPlayedReply = nullptr;
-
-        const auto error = reply->error();
-        const QString errorString = reply->errorString();
-        const QByteArray payload = (error == QNetworkReply::NoError) ? reply->readAll() : QByteArray();
-        reply->deleteLater();
-
-        if (error != QNetworkReply::NoError) {
-            if (error != QNetworkReply::OperationCanceledError) {
-                emit errorOccurred(errorString);
-            }
-            return;
-        }
-
-        const auto doc = QJsonDocument::fromJson(payload);
-        QString err;
-        if (!checkOk(doc, &err)) {
-            emit errorOccurred(err);
-            return;
-        }
-
-        const auto root = doc.object().value(QStringLiteral("subsonic-response")).toObject();
-        const auto albums = root.value(QStringLiteral("albumList2")).toObject().value(QStringLiteral("album")).toArray();
-
+    sendRequest(QStringLiteral("getAlbumList2"), ex, &m_mostPlayedRequest, RequestPriority::Visible, [this](const SubsonicResponse &response)
+                {
         QVariantList fetched;
-        fetched.reserve(albums.size());
-
-        for (const auto &av : albums) {
-            const auto albumObj = av.toObject();
-            QVariantMap album;
-            album.insert(QStringLiteral("id"), internString(albumObj.value(QStringLiteral("id")).toString()));
-            album.insert(QStringLiteral("name"), internString(albumObj.value(QStringLiteral("name")).toString()));
-            album.insert(QStringLiteral("artistId"), internString(albumObj.value(QStringLiteral("artistId")).toString()));
-            album.insert(QStringLiteral("artist"), internString(albumObj.value(QStringLiteral("artist")).toString()));
-            album.insert(QStringLiteral("coverArt"), internString(albumObj.value(QStringLiteral("coverArt")).toString()));
-            album.insert(QStringLiteral("playCount"), albumObj.value(QStringLiteral("playCount")).toInt());
-            fetched.append(album);
-        }
+        fetched.reserve(response.albums.size());
+        for (const auto &album : response.albums)
+            fetched.append(AlbumListModel::toVariant(album));
 
         if (m_mostPlayedAlbums != fetched) {
             m_mostPlayedAlbums = fetched;
             emit mostPlayedAlbumsChanged();
-        }
-    });
+        } });
 }
 
 void SubsonicClient::fetchPlaylists()
@@ -1151,62 +1428,32 @@ void SubsonicClient::fetchPlaylists()
 
     if (m_cacheManager && m_playlists.isEmpty())
     {
-        const auto cached = m_cacheManager->getList(cacheKey("playlists"));
-        if (!cached.isEmpty())
-        {
-            m_playlists = cached;
-            emit playlistsChanged();
-        }
-    }
-
-    if (m_playlistsReply)
-    {
-        m_playlistsReply->abort();
+        m_cacheManager->getListSnapshotAsync(cacheKey("playlists"))
+            .then(QtFuture::Launch::Async, [](const ListSnapshot &cached)
+                  {
+            QVariantList playlists;
+            playlists.reserve(cached.size());
+            for (const auto &playlist : cached.playlists())
+                playlists.push_back(playlistEntryToVariant(playlist));
+            return playlists; })
+            .then(this, [this](const QVariantList &playlists)
+                  {
+            if (playlists.isEmpty() || !m_playlists.isEmpty())
+                return;
+            m_playlists = playlists;
+            emit playlistsChanged(); });
     }
 
-    QNetworkRequest req(buildUrl("getPlaylists", {}, true));
-    auto *reply = m_nam.get(req);
-    m_playlistsReply = reply;
-
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
-            {
-        if (reply != m_playlistsReply) {
-            reply->deleteLater();
-            return;
-        }
-        m_playlistsReply = nullptr;
-
-        if (reply->error() != QNetworkReply::NoError) {
-            if (reply->error() != QNetworkReply::OperationCanceledError) {
-                emit errorOccurred(reply->errorString());
-            }
-            reply->deleteLater();
-            return;
-        }
-
-        const auto doc = QJsonDocument::fromJson(reply->readAll());
-        reply->deleteLater();
-        QString err;
-        if (!checkOk(doc, &err)) { emit errorOccurred(err); return; }
-
+    sendRequest(QStringLiteral("getPlaylists"), {}, &m_playlistsRequest, RequestPriority::Visible, [this](const SubsonicResponse &response)
+                {
         clearAndShrink(m_playlists);
-        auto root = doc.object().value("subsonic-response").toObject();
-        auto playlists = root.value("playlists").toObject().value("playlist").toArray();
-        if (!playlists.isEmpty())
-            m_playlists.reserve(playlists.size());
-        for (const auto &pv : playlists) {
-            auto p = pv.toObject();
-            m_playlists.push_back(QVariantMap{
-                {"id", p.value("id").toString()},
-                {"name", p.value("name").toString()},
-                {"songCount", p.value("songCount").toInt()},
-                {"duration", p.value("duration").toInt()},
-                {"coverArt", p.value("coverArt").toString()}
-            });
-        }
+        if (!response.playlists.isEmpty())
+            m_playlists.reserve(response.playlists.size());
+        for (const auto &playlist : response.playlists)
+            m_playlists.push_back(playlistEntryToVariant(playlist));
         emit playlistsChanged();
         if (m_cacheManager) {
-            m_cacheManager->saveList(cacheKey("playlists"), m_playlists);
+            m_cacheManager->saveListSnapshot(cacheKey("playlists"), response.playlists);
         } });
 }
 
@@ -1215,63 +1462,51 @@ void SubsonicClient::fetchPlaylist(const QString &playlistId)
     if (!m_authenticated)
         return;
 
-    if (m_playlistReply)
-    {
-        m_playlistReply->abort();
-    }
-
     clearTracks();
 
-    QUrlQuery ex;
-    ex.addQueryItem("id", playlistId);
-    QNetworkRequest req(buildUrl("getPlaylist", ex, true));
-    auto *reply = m_nam.get(req);
-    m_playlistReply = reply;
+    auto fromServer = [this, playlistId]
+    {
+        QUrlQuery ex;
+        ex.addQueryItem("id", playlistId);
+        sendRevalidatedRequest(
+            QStringLiteral("getPlaylist"), ex, &m_playlistRequest, RequestPriority::Interactive,
+            [this](const SubsonicResponse &response)
+            { showTracks(response.tracks); },
+            &SubsonicClient::tracksToCache, [this](const QVariantMap &data)
+            { applyCachedTracks(data); });
+    };
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
-            {
-        if (reply != m_playlistReply) {
-            reply->deleteLater();
-            return;
-        }
-        m_playlistReply = nullptr;
+    if (mirrorReady())
+    {
+        queryMirror<TrackList>(
+            m_playlistRequest, m_librarySync->mirror()->playlistTracks(playlistId),
+            [this](const TrackList &tracks)
+            { showTracks(tracks); },
+            fromServer);
+        return;
+    }
+    fromServer();
+}
 
-        if (reply->error() != QNetworkReply::NoError) {
-            if (reply->error() != QNetworkReply::OperationCanceledError) {
-                emit errorOccurred(reply->errorString());
-            }
-            reply->deleteLater();
-            return;
-        }
+QVariantMap SubsonicClient::tracksToCache(const SubsonicResponse &response)
+{
+    QVariantList tracks;
+    tracks.reserve(response.tracks.size());
+    for (const auto &track : response.tracks)
+        tracks.append(TrackListModel::toVariant(track));
+    return {{QStringLiteral("tracks"), tracks}};
+}
 
-        const auto doc = QJsonDocument::fromJson(reply->readAll());
-        reply->deleteLater();
-        QString err;
-        if (!checkOk(doc, &err)) { emit errorOccurred(err); return; }
-
-        auto root = doc.object().value("subsonic-response").toObject();
-        auto songs = root.value("playlist").toObject().value("entry").toArray();
-        if (!songs.isEmpty())
-            m_tracks.reserve(songs.size());
-        for (const auto &sv : songs) {
-            auto s = sv.toObject();
-            auto rg = s.value("replayGain").toObject();
-            TrackEntry entry;
-            entry.id = internString(s.value("id").toString());
-            entry.title = internString(s.value("title").toString());
-            entry.artist = internString(s.value("artist").toString());
-            entry.artistId = internString(s.value("artistId").toString());
-            entry.album = internString(s.value("album").toString());
-            entry.albumId = internString(s.value("albumId").toString());
-            entry.duration = s.value("duration").toInt();
-            entry.coverArt = internString(s.value("coverArt").toString());
-            entry.track = static_cast<qint16>(s.value("track").toInt());
-            entry.year = static_cast<qint16>(s.value("year").toInt());
-            entry.replayGainTrackGain = static_cast<float>(rg.value("trackGain").toDouble());
-            entry.replayGainAlbumGain = static_cast<float>(rg.value("albumGain").toDouble());
-            m_tracks.push_back(entry);
-        }
-        emit tracksChanged(); });
+void SubsonicClient::applyCachedTracks(const QVariantMap &data)
+{
+    showTracks(TrackListModel::fromVariantList(data.value(QStringLiteral("tracks")).toList()));
+}
+
+void SubsonicClient::showTracks(const TrackList &tracks)
+{
+    // setItems keeps delegates when a revalidated list has the same length.
+    m_tracksModel.setItems(tracks);
+    emit tracksChanged();
 }
 
 void SubsonicClient::fetchFavorites()
@@ -1279,73 +1514,25 @@ void SubsonicClient::fetchFavorites()
     if (!m_authenticated)
         return;
 
-    if (m_cacheManager && m_favorites.isEmpty())
-    {
-        const auto cached = m_cacheManager->getList(cacheKey("favorites"));
-        if (!cached.isEmpty())
-        {
-            m_favorites = tracksFromVariantList(cached);
-            emit favoritesChanged();
-        }
-    }
-
-    if (m_favoritesReply)
+    if (m_cacheManager && m_favoritesModel.isEmpty())
     {
-        m_favoritesReply->abort();
+        m_cacheManager->getListSnapshotAsync(cacheKey("favorites"))
+            .then(QtFuture::Launch::Async, [](const ListSnapshot &cached)
+                  { return cached.tracks(); })
+            .then(this, [this](const TrackList &tracks)
+                  {
+            if (tracks.isEmpty() || !m_favoritesModel.isEmpty())
+                return;
+            m_favoritesModel.setItems(tracks);
+            emit favoritesChanged(); });
     }
 
-    QNetworkRequest req(buildUrl("getStarred", {}, true));
-    auto *reply = m_nam.get(req);
-    m_favoritesReply = reply;
-
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
-            {
-        if (reply != m_favoritesReply) {
-            reply->deleteLater();
-            return;
-        }
-        m_favoritesReply = nullptr;
-
-        if (reply->error() != QNetworkReply::NoError) {
-            if (reply->error() != QNetworkReply::OperationCanceledError) {
-                emit errorOccurred(reply->errorString());
-            }
-            reply->deleteLater();
-            return;
-        }
-
-        const auto doc = QJsonDocument::fromJson(reply->readAll());
-        reply->deleteLater();
-        QString err;
-        if (!checkOk(doc, &err)) { emit errorOccurred(err); return; }
-
-        clearAndShrink(m_favorites);
-        auto root = doc.object().value("subsonic-response").toObject();
-        auto starred = root.value("starred").toObject();
-        auto songs = starred.value("song").toArray();
-        if (!songs.isEmpty())
-            m_favorites.reserve(songs.size());
-        for (const auto &sv : songs) {
-            auto s = sv.toObject();
-            auto rg = s.value("replayGain").toObject();
-            TrackEntry entry;
-            entry.id = internString(s.value("id").toString());
-            entry.title = internString(s.value("title").toString());
-            entry.artist = internString(s.value("artist").toString());
-            entry.artistId = internString(s.value("artistId").toString());
-            entry.album = internString(s.value("album").toString());
-            entry.albumId = internString(s.value("albumId").toString());
-            entry.duration = s.value("duration").toInt();
-            entry.coverArt = internString(s.value("coverArt").toString());
-            entry.track = static_cast<qint16>(s.value("track").toInt());
-            entry.year = static_cast<qint16>(s.value("year").toInt());
-            entry.replayGainTrackGain = static_cast<float>(rg.value("trackGain").toDouble());
-            entry.replayGainAlbumGain = static_cast<float>(rg.value("albumGain").toDouble());
-            m_favorites.push_back(entry);
-        }
+    sendRequest(QStringLiteral("getStarred"), {}, &m_favoritesRequest, RequestPriority::Visible, [this](const SubsonicResponse &response)
+                {
+        m_favoritesModel.setItems(response.tracks);
         emit favoritesChanged();
         if (m_cacheManager) {
-            m_cacheManager->saveList(cacheKey("favorites"), tracksToVariantList(m_favorites));
+            m_cacheManager->saveListSnapshot(cacheKey("favorites"), response.tracks);
         } });
 }
 
@@ -1353,88 +1540,53 @@ void SubsonicClient::search(const QString &term)
 {
     if (!m_authenticated)
         return;
-    QUrlQuery ex;
-    ex.addQueryItem("query", term);
-    ex.addQueryItem("artistCount", "20");
-    ex.addQueryItem("albumCount", "40");
-    ex.addQueryItem("songCount", "100");
-    QNetworkRequest req(buildUrl("search3", ex, true));
-    auto *reply = m_nam.get(req);
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
-            {
-        if (reply->error() != QNetworkReply::NoError) {
-            emit errorOccurred(reply->errorString());
-            reply->deleteLater();
+
+    // Each keystroke supersedes the previous search; its reply or lookup
+    // is dropped.
+    abortRequest(m_searchRequest);
+    supersedeAlbumBatch();
+
+    if (mirrorReady())
+    {
+        if (const auto index = m_librarySync->searchIndex())
+        {
+            const SearchIndex::Hits hits = index->search(term, SEARCH_ARTIST_COUNT, SEARCH_ALBUM_COUNT, SEARCH_SONG_COUNT);
+            const quint64 generation = m_searchRequest.generation;
+            m_librarySync->mirror()->resolve(hits).then(this, [this, generation](const SearchResults &results)
+                                                        {
+                if (m_searchRequest.generation == generation)
+                    applySearchResults(results.artists, results.albums, results.tracks); });
             return;
         }
-        const auto doc = QJsonDocument::fromJson(reply->readAll());
-        reply->deleteLater();
-        QString err;
-        if (!checkOk(doc, &err)) { emit errorOccurred(err); return; }
-        
-        auto root = doc.object().value("subsonic-response").toObject();
-        auto searchResult = root.value("searchResult3").toObject();
-        
-        // Parse artists
-        clearAndShrink(m_searchArtists);
-        auto artists = searchResult.value("artist").toArray();
-        if (!artists.isEmpty())
-            m_searchArtists.reserve(artists.size());
-        for (const auto &av : artists) {
-            auto a = av.toObject();
-            m_searchArtists.push_back(QVariantMap{
-                {"id", internString(a.value("id").toString())},
-                {"name", internString(a.value("name").toString())},
-                {"albumCount", a.value("albumCount").toInt()},
-                {"coverArt", internString(a.value("coverArt").toString())}
-            });
-        }
-        
-        // Parse albums
-        clearAndShrink(m_searchAlbums);
-        auto albums = searchResult.value("album").toArray();
-        if (!albums.isEmpty())
-            m_searchAlbums.reserve(albums.size());
-        for (const auto &av : albums) {
-            auto a = av.toObject();
-            m_searchAlbums.push_back(QVariantMap{
-                {"id", internString(a.value("id").toString())},
-                {"name", internString(a.value("name").toString())},
-                {"artist", internString(a.value("artist").toString())},
-                {"artistId", internString(a.value("artistId").toString())},
-                {"coverArt", internString(a.value("coverArt").toString())},
-                {"songCount", a.value("songCount").toInt()},
-                {"duration", a.value("duration").toInt()},
-                {"year", a.value("year").toInt()}
-            });
-        }
-        
-        // Parse songs
-        clearAndShrink(m_tracks);
-        auto songs = searchResult.value("song").toArray();
-        if (!songs.isEmpty())
-            m_tracks.reserve(songs.size());
-        for (const auto &sv : songs) {
-            auto s = sv.toObject();
-            auto rg = s.value("replayGain").toObject();
-            TrackEntry entry;
-            entry.id = internString(s.value("id").toString());
-            entry.title = internString(s.value("title").toString());
-            entry.artist = internString(s.value("artist").toString());
-            entry.artistId = internString(s.value("artistId").toString());
-            entry.album = internString(s.value("album").toString());
-            entry.albumId = internString(s.value("albumId").toString());
-            entry.duration = s.value("duration").toInt();
-            entry.coverArt = internString(s.value("coverArt").toString());
-            entry.track = static_cast<qint16>(s.value("track").toInt());
-            entry.year = static_cast<qint16>(s.value("year").toInt());
-            entry.replayGainTrackGain = static_cast<float>(rg.value("trackGain").toDouble());
-            entry.replayGainAlbumGain = static_cast<float>(rg.value("albumGain").toDouble());
-            m_tracks.push_back(entry);
-        }
-        emit searchArtistsChanged();
-        emit searchAlbumsChanged();
-        emit tracksChanged(); });
+    }
+
+    QUrlQuery ex;
+    ex.addQueryItem("query", term);
+    ex.addQueryItem("artistCount", QString::number(SEARCH_ARTIST_COUNT));
+    ex.addQueryItem("albumCount", QString::number(SEARCH_ALBUM_COUNT));
+    ex.addQueryItem("songCount", QString::number(SEARCH_SONG_COUNT));
+    sendRequest(QStringLiteral("search3"), ex, &m_searchRequest, RequestPriority::Interactive, [this](const SubsonicResponse &response)
+                { applySearchResults(response.artists, response.albums, response.tracks); });
+}
+
+void SubsonicClient::applySearchResults(const ArtistList &artists, const AlbumList &albums, const TrackList &tracks)
+{
+    clearAndShrink(m_searchArtists);
+    if (!artists.isEmpty())
+        m_searchArtists.reserve(artists.size());
+    for (const auto &artist : artists)
+        m_searchArtists.push_back(ArtistListModel::toVariant(artist));
+
+    clearAndShrink(m_searchAlbums);
+    if (!albums.isEmpty())
+        m_searchAlbums.reserve(albums.size());
+    for (const auto &album : albums)
+        m_searchAlbums.push_back(AlbumListModel::toVariant(album));
+
+    m_tracksModel.setItems(tracks);
+    emit searchArtistsChanged();
+    emit searchAlbumsChanged();
+    emit tracksChanged();
 }
 
 QUrl SubsonicClient::streamUrl(const QString &songId, int maxBitrateKbps) const
@@ -1457,6 +1609,14 @@ QUrl SubsonicClient::coverArtUrl(const QString &artId, int size) const
     return buildUrl("getCoverArt", ex, false);
 }
 
+QUrl SubsonicClient::coverImageUrl(const QString &artId, int size) const
+{
+    if (artId.isEmpty())
+        return {};
+    const QString encodedId = QString::fromLatin1(QUrl::toPercentEncoding(artId));
+    return QUrl(QStringLiteral("image://cover/%1/%2").arg(encodedId).arg(size));
+}
+
 void SubsonicClient::scrobble(const QString &songId, bool submission, qint64 timeMs)
 {
     if (!m_authenticated || songId.isEmpty())
@@ -1470,7 +1630,7 @@ void SubsonicClient::scrobble(const QString &songId, bool submission, qint64 tim
         ex.addQueryItem("time", QString::number(secs));
     }
     QNetworkRequest req(buildUrl("scrobble", ex, true));
-    auto *reply = m_nam.get(req);
+    auto *reply = m_scheduler.get(req, RequestPriority::Background);
     connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
 }
 
@@ -1481,7 +1641,7 @@ void SubsonicClient::star(const QString &id)
     QUrlQuery ex;
     ex.addQueryItem("id", id);
     QNetworkRequest req(buildUrl("star", ex, true));
-    auto *reply = m_nam.get(req);
+    auto *reply = m_scheduler.get(req, RequestPriority::Background);
     connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
 }
 
@@ -1492,7 +1652,7 @@ void SubsonicClient::unstar(const QString &id)
     QUrlQuery ex;
     ex.addQueryItem("id", id);
     QNetworkRequest req(buildUrl("unstar", ex, true));
-    auto *reply = m_nam.get(req);
+    auto *reply = m_scheduler.get(req, RequestPriority::Background);
     connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
 }
 
@@ -1783,21 +1943,6 @@ QString SubsonicClient::cacheKey(const QString &base) const
     return QStringLiteral("%1|%2|%3").arg(base, m_server, m_user);
 }
 
-QVariantList SubsonicClient::tracks() const
-{
-    return tracksToVariantList(m_tracks);
-}
-
-QVariantList SubsonicClient::randomSongs() const
-{
-    return tracksToVariantList(m_randomSongs);
-}
-
-QVariantList SubsonicClient::favorites() const
-{
-    return tracksToVariantList(m_favorites);
-}
-
 void SubsonicClient::setAlbumListLoading(bool loading)
 {
     if (m_albumListPaging == loading)
@@ -1814,53 +1959,109 @@ void SubsonicClient::setHasMoreAlbumList(bool hasMore)
     emit albumListHasMoreChanged();
 }
 
-void SubsonicClient::fetchAlbumTracksAndAppend(const QString &albumId)
+void SubsonicClient::fetchAlbumsTracks(const QStringList &albumIds)
 {
     if (!m_authenticated)
         return;
 
-    QUrlQuery ex;
-    ex.addQueryItem("id", albumId);
-    QNetworkRequest req(buildUrl("getAlbum", ex, true));
-    auto *reply = m_nam.get(req);
+    // The tracks model is about to be replaced; a late single album must
+    // not land in it.
+    abortRequest(m_albumRequest);
+    abortRequest(m_playlistRequest);
+    clearTracks();
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply]
-            {
-        if (reply->error() != QNetworkReply::NoError) {
-            reply->deleteLater();
-            return;
-        }
+    auto batch = std::make_shared<AlbumBatch>();
+    batch->generation = m_albumBatchGeneration;
+    m_albumBatch = batch;
+    batch->albumIds = albumIds;
+    batch->results.resize(albumIds.size());
+    if (albumIds.isEmpty())
+    {
+        emit albumBatchFinished();
+        return;
+    }
+    pumpAlbumBatch(batch);
+}
 
-        const auto doc = QJsonDocument::fromJson(reply->readAll());
-        reply->deleteLater();
-        QString err;
-        if (!checkOk(doc, &err)) { return; }
-
-        auto root = doc.object().value("subsonic-response").toObject();
-        auto songs = root.value("album").toObject().value("song").toArray();
-        bool tracksAdded = false;
-        for (const auto &sv : songs) {
-            auto s = sv.toObject();
-            auto rg = s.value("replayGain").toObject();
-            TrackEntry entry;
-            entry.id = s.value("id").toString();
-            entry.title = s.value("title").toString();
-            entry.artist = s.value("artist").toString();
-            entry.artistId = s.value("artistId").toString();
-            entry.album = s.value("album").toString();
-            entry.albumId = s.value("albumId").toString();
-            entry.track = s.value("track").toInt();
-            entry.duration = s.value("duration").toInt();
-            entry.coverArt = s.value("coverArt").toString();
-            entry.replayGainTrackGain = rg.value("trackGain").toDouble();
-            entry.replayGainAlbumGain = rg.value("albumGain").toDouble();
-            entry.year = s.value("year").toInt();
-            m_tracks.push_back(entry);
-            tracksAdded = true;
-        }
-        if (tracksAdded) {
-            emit tracksChanged();
-        } });
+void SubsonicClient::pumpAlbumBatch(const std::shared_ptr<AlbumBatch> &batch)
+{
+    while (batch->inFlight < ALBUM_BATCH_PARALLELISM && batch->next < batch->albumIds.size())
+    {
+        const int index = batch->next++;
+        ++batch->inFlight;
+        // The first album gates playback; the rest can wait behind it.
+        const RequestPriority priority = index == 0 ? RequestPriority::Interactive : RequestPriority::Visible;
+        fetchAlbumTracks(batch->albumIds.at(index), priority, [this, batch, index](TrackList tracks)
+                         {
+            if (batch->generation != m_albumBatchGeneration)
+                return;
+            --batch->inFlight;
+            batch->results[index] = std::move(tracks);
+            appendReadyAlbums(batch);
+            pumpAlbumBatch(batch); });
+    }
+}
+
+// Ends the running album batch, if any: the albums it has not appended yet
+// are dropped, and albumBatchFinished is still emitted so nobody waits on
+// it. Called by everything that supersedes a batch.
+void SubsonicClient::supersedeAlbumBatch()
+{
+    const auto batch = m_albumBatch.lock();
+    const bool running = batch && batch->generation == m_albumBatchGeneration
+                         && batch->appended < batch->results.size();
+    ++m_albumBatchGeneration;
+    if (running)
+        emit albumBatchFinished();
+}
+
+void SubsonicClient::appendReadyAlbums(const std::shared_ptr<AlbumBatch> &batch)
+{
+    TrackList ready;
+    while (batch->appended < batch->results.size() && batch->results.at(batch->appended))
+    {
+        ready.append(*batch->results.at(batch->appended));
+        batch->results[batch->appended].reset();
+        ++batch->appended;
+    }
+
+    if (!ready.isEmpty())
+    {
+        const int firstRow = m_tracksModel.rowCount();
+        m_tracksModel.append(ready);
+        emit tracksChanged();
+        emit albumTracksAppended(firstRow, static_cast<int>(ready.size()));
+    }
+    if (batch->appended == batch->results.size())
+        emit albumBatchFinished();
+}
+
+void SubsonicClient::fetchAlbumTracks(const QString &albumId, RequestPriority priority, std::function<void(TrackList)> done)
+{
+    const auto fromServer = [this, albumId, priority, done]
+    {
+        QUrlQuery ex;
+        ex.addQueryItem("id", albumId);
+        // An album that fails to load is skipped rather than stalling the rest.
+        sendRequest(
+            QStringLiteral("getAlbum"), ex, nullptr, priority,
+            [done](const SubsonicResponse &response)
+            { done(response.tracks); },
+            [done](const QString &)
+            { done({}); });
+    };
+
+    if (!mirrorReady())
+    {
+        fromServer();
+        return;
+    }
+    m_librarySync->mirror()->albumTracks(albumId).then(this, [done, fromServer](const std::optional<TrackList> &tracks)
+                                                       {
+        if (tracks)
+            done(*tracks);
+        else
+            fromServer(); });
 }
 
 void SubsonicClient::fetchAlbumListPage(const QString &type, int offset)
@@ -1876,73 +2077,45 @@ void SubsonicClient::fetchAlbumListPage(const QString &type, int offset)
     if (offset > 0)
         ex.addQueryItem("offset", QString::number(offset));
 
-    QNetworkRequest req(buildUrl("getAlbumList2", ex, true));
-    auto *reply = m_nam.get(req);
-    m_albumListReply = reply;
+    // Albums are applied batch by batch while the page is still downloading.
+    auto received = std::make_shared<qsizetype>(0);
+    sendStreamingRequest(
+        QStringLiteral("getAlbumList2"), ex, &m_albumListRequest,
+        offset == 0 ? RequestPriority::Interactive : RequestPriority::Visible,
+        [this, offset, received](const SubsonicResponse &batch)
+        {
+            if (offset == 0 && *received == 0)
+                m_albumListModel.clear();
+            *received += batch.albums.size();
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, type, offset]
+            m_albumListModel.merge(batch.albums);
+            emit albumListChanged();
+        },
+        [this, type, offset, received](const SubsonicResponse &)
+        {
+            if (offset == 0 && *received == 0 && !m_albumListModel.isEmpty())
             {
-        if (reply != m_albumListReply) {
-            reply->deleteLater();
-            return;
-        }
-        m_albumListReply = nullptr;
-
-        const auto error = reply->error();
-        const QString errorString = reply->errorString();
-        const QByteArray payload = (error == QNetworkReply::NoError) ? reply->readAll() : QByteArray();
-        reply->deleteLater();
-
-        if (error != QNetworkReply::NoError) {
-            if (error != QNetworkReply::OperationCanceledError) {
-                emit errorOccurred(errorString);
+                m_albumListModel.clear();
+                emit albumListChanged();
             }
-            setAlbumListLoading(false);
-            return;
-        }
 
-        const auto doc = QJsonDocument::fromJson(payload);
-        QString err;
-        if (!checkOk(doc, &err)) {
-            emit errorOccurred(err);
-            setAlbumListLoading(false);
-            return;
-        }
-
-        auto root = doc.object().value("subsonic-response").toObject();
-        auto albums = root.value("albumList2").toObject().value("album").toArray();
-
-        if (offset == 0) {
-            clearAndShrink(m_albumList);
-        }
+            const bool hasMore = *received == ALBUM_LIST_PAGE_SIZE;
+            setHasMoreAlbumList(hasMore);
+            m_pendingAlbumListOffset = offset + *received;
 
-        if (!albums.isEmpty()) {
-            m_albumList.reserve(m_albumList.size() + albums.size());
-            for (const auto &av : albums) {
-                auto a = av.toObject();
-                m_albumList.push_back(QVariantMap{
-                    {"id", internString(a.value("id").toString())},
-                    {"name", internString(a.value("name").toString())},
-                    {"artistId", internString(a.value("artistId").toString())},
-                    {"artist", internString(a.value("artist").toString())},
-                    {"year", a.value("year").toInt()},
-                    {"coverArt", internString(a.value("coverArt").toString())}
-                });
+            // Re-encoding the whole list after every page would be quadratic:
+            // save the first page for the next start, then the full list once
+            // paging reaches the end.
+            if (m_cacheManager && (offset == 0 || !hasMore))
+            {
+                m_cacheManager->saveListSnapshot(cacheKey(QStringLiteral("albumList:%1").arg(type)), m_albumListModel.entries());
             }
-        }
 
-        std::sort(m_albumList.begin(), m_albumList.end(), [](const QVariant &v1, const QVariant &v2) {
-            return v1.toMap().value("name").toString().localeAwareCompare(v2.toMap().value("name").toString()) < 0;
+            setAlbumListLoading(false);
+        },
+        [this](const QString &message)
+        {
+            emit errorOccurred(message);
+            setAlbumListLoading(false);
         });
-        emit albumListChanged();
-
-        const bool hasMore = albums.size() == ALBUM_LIST_PAGE_SIZE;
-        setHasMoreAlbumList(hasMore);
-        m_pendingAlbumListOffset = offset + albums.size();
-
-        if (m_cacheManager) {
-            m_cacheManager->saveList(cacheKey(QStringLiteral("albumList:%1").arg(type)), m_albumList);
-        }
-
-        setAlbumListLoading(false); });
 }
@@ -1,11 +1,21 @@
 #pragma once
 #include <QObject>
 #include <QNetworkAccessManager>
-#include <QJsonDocument>
 #include <QUrlQuery>
 #include <QList>
+#include <QHash>
+#include <QFuture>
+#include <functional>
+#include <memory>
+#include <optional>
+#include "LibraryTypes.h"
+#include "LibraryModels.h"
+#include "PagedAlbumModel.h"
+#include "RequestScheduler.h"
+#include "SubsonicParser.h"
 
 class CacheManager;
+class LibrarySync;
 
 class SubsonicClient : public QObject
 {
@@ -24,6 +34,12 @@ class SubsonicClient : public QObject
     Q_PROPERTY(QVariantList randomSongs READ randomSongs NOTIFY randomSongsChanged)
     Q_PROPERTY(QVariantList favorites READ favorites NOTIFY favoritesChanged)
     Q_PROPERTY(QVariantList playlists READ playlists NOTIFY playlistsChanged)
+    Q_PROPERTY(ArtistListModel *artistsModel READ artistsModel CONSTANT)
+    Q_PROPERTY(AlbumListModel *albumListModel READ albumListModel CONSTANT)
+    Q_PROPERTY(PagedAlbumModel *pagedAlbumModel READ pagedAlbumModel CONSTANT)
+    Q_PROPERTY(TrackListModel *tracksModel READ tracksModel CONSTANT)
+    Q_PROPERTY(TrackListModel *randomSongsModel READ randomSongsModel CONSTANT)
+    Q_PROPERTY(TrackListModel *favoritesModel READ favoritesModel CONSTANT)
     Q_PROPERTY(QString artistCover READ artistCover NOTIFY artistCoverChanged)
     Q_PROPERTY(bool albumListLoading READ albumListLoading NOTIFY albumListLoadingChanged)
     Q_PROPERTY(bool albumListHasMore READ albumListHasMore NOTIFY albumListHasMoreChanged)
@@ -39,14 +55,27 @@ public:
     void setServerUrl(const QString &url);
     void setUsername(const QString &u);
     void setCacheManager(CacheManager *cache);
+    // Once the sync has a complete mirror, library pages are answered from
+    // it and only fall back to the server for what it does not hold.
+    void setLibrarySync(LibrarySync *sync) { m_librarySync = sync; }
+    // Authenticated JSON endpoint URL, for components sending their own requests.
+    QUrl apiUrl(const QString &method, const QUrlQuery &params = {}) const { return buildUrl(method, params, true); }
 
     Q_INVOKABLE void login(const QString &url, const QString &user, const QString &password);
     Q_INVOKABLE void logout();
     Q_INVOKABLE void fetchArtists();
     Q_INVOKABLE void fetchArtist(const QString &artistId);
     Q_INVOKABLE void fetchAlbum(const QString &albumId);
+    // Tracks of several albums, e.g. a whole artist, into tracksModel in
+    // the given order. A few albums are fetched at a time; each is appended
+    // as soon as every album before it is in, so playback can start with
+    // the first while the rest load.
+    Q_INVOKABLE void fetchAlbumsTracks(const QStringList &albumIds);
     Q_INVOKABLE void fetchAlbumList(const QString &type = "random");
     Q_INVOKABLE void fetchMoreAlbums();
+    // Windowed alternative to fetchAlbumList for very large libraries: the
+    // total is found first, then pagedAlbumModel loads pages on demand.
+    Q_INVOKABLE void openPagedAlbumList(const QString &type = "alphabeticalByName");
     Q_INVOKABLE void fetchRandomSongs();
     Q_INVOKABLE void fetchMostPlayedAlbums();
     Q_INVOKABLE void fetchFavorites();
@@ -64,32 +93,46 @@ public:
 
     Q_INVOKABLE QUrl streamUrl(const QString &songId, int maxBitrateKbps = 0) const;
     Q_INVOKABLE QUrl coverArtUrl(const QString &artId, int size = 300) const;
+    // image://cover URL served by CoverImageProvider; use this from QML.
+    Q_INVOKABLE QUrl coverImageUrl(const QString &artId, int size = 300) const;
+    // Network requests issued vs. calls served by an identical in-flight one.
+    Q_INVOKABLE QVariantMap requestStats() const;
     Q_INVOKABLE void scrobble(const QString &songId, bool submission, qint64 timeMs = 0);
-    Q_INVOKABLE QVariantList artists() const { return m_artists; }
+    Q_INVOKABLE QVariantList artists() const { return m_artistsModel.toVariantList(); }
     Q_INVOKABLE QVariantList albums() const { return m_albums; }
-    Q_INVOKABLE QVariantList albumList() const { return m_albumList; }
-    Q_INVOKABLE QVariantList tracks() const;
+    Q_INVOKABLE QVariantList albumList() const { return m_albumListModel.toVariantList(); }
+    Q_INVOKABLE QVariantList tracks() const { return m_tracksModel.toVariantList(); }
     Q_INVOKABLE QVariantList searchArtists() const { return m_searchArtists; }
     Q_INVOKABLE QVariantList searchAlbums() const { return m_searchAlbums; }
     Q_INVOKABLE QVariantList recentlyPlayedAlbums() const { return m_recentlyPlayedAlbums; }
     Q_INVOKABLE QVariantList mostPlayedAlbums() const { return m_mostPlayedAlbums; }
-    Q_INVOKABLE QVariantList randomSongs() const;
-    Q_INVOKABLE QVariantList favorites() const;
+    Q_INVOKABLE QVariantList randomSongs() const { return m_randomSongsModel.toVariantList(); }
+    Q_INVOKABLE QVariantList favorites() const { return m_favoritesModel.toVariantList(); }
     Q_INVOKABLE QVariantList playlists() const { return m_playlists; }
+    ArtistListModel *artistsModel() { return &m_artistsModel; }
+    AlbumListModel *albumListModel() { return &m_albumListModel; }
+    PagedAlbumModel *pagedAlbumModel() { return &m_pagedAlbumModel; }
+    TrackListModel *tracksModel() { return &m_tracksModel; }
+    TrackListModel *randomSongsModel() { return &m_randomSongsModel; }
+    TrackListModel *favoritesModel() { return &m_favoritesModel; }
     QString artistCover() const { return m_artistCover; }
     bool albumListLoading() const { return m_albumListPaging; }
     bool albumListHasMore() const { return m_hasMoreAlbumList; }
     Q_INVOKABLE void clearTracks()
     {
-        if (!m_tracks.isEmpty())
+        // Whatever replaces the tracks also supersedes a running album batch.
+        supersedeAlbumBatch();
+        if (!m_tracksModel.isEmpty())
         {
-            m_tracks.clear();
-            m_tracks.squeeze();
+            m_tracksModel.clear();
             emit tracksChanged();
         }
     }
 
 signals:
+    // Rows appended to tracksModel by fetchAlbumsTracks, in album order.
+    void albumTracksAppended(int firstRow, int count);
+    void albumBatchFinished();
     void serverUrlChanged();
     void usernameChanged();
     void authenticatedChanged();
@@ -111,72 +154,147 @@ signals:
     void albumListHasMoreChanged();
 
 private:
-    struct TrackEntry
+    enum class AuthMode
+    {
+        Token,
+        Legacy
+    };
+
+    // Tracks the latest request of one kind. Starting a new request or
+    // aborting bumps the generation so late replies and late parse results
+    // of the previous one are dropped.
+    struct RequestSlot
     {
-        QString id;
-        QString title;
-        QString artist;
-        QString artistId;
-        QString album;
-        QString albumId;
-        QString coverArt;
-        qint32 duration = 0;
-        qint16 track = 0;
-        qint16 year = 0;
-        float replayGainTrackGain = 0.0f;
-        float replayGainAlbumGain = 0.0f;
+        QNetworkReply *reply = nullptr; // streaming requests only
+        quint64 generation = 0;
+        QString key;                    // canonical key of the current request
+        QByteArray contentHash;         // of the data on screen, for revalidated requests
     };
 
-    using TrackList = QList<TrackEntry>;
+    using ResponseHandler = std::function<void(const SubsonicResponse &)>;
+    using FailureHandler = std::function<void(const QString &)>;
+    using BatchHandler = std::function<void(const SubsonicResponse &)>;
+    // Detail pages keep their data in metadata_cache as a QVariantMap; only
+    // a cached copy is applied from one.
+    using SerializeHandler = std::function<QVariantMap(const SubsonicResponse &)>;
+    using ApplyHandler = std::function<void(const QVariantMap &)>;
 
-    enum class AuthMode
+    // One caller waiting on a shared reply. It stays live while its slot
+    // (if any) is still at the generation it was issued with.
+    struct PendingWaiter
     {
-        Token,
-        Legacy
+        RequestSlot *slot = nullptr;
+        quint64 generation = 0;
+        ResponseHandler onSuccess;
+        FailureHandler onFailure;
+    };
+
+    // Identical requests issued while one is on the wire share its reply
+    // and its parse.
+    struct PendingRequest
+    {
+        QNetworkReply *reply = nullptr;
+        QList<PendingWaiter> waiters;
     };
+
     QUrl buildUrl(const QString &method, const QUrlQuery &extra = {}, bool isJson = true) const;
     QString randomSalt() const;
     QString md5(const QString &s) const;
-    bool checkOk(const QJsonDocument &doc, QString *err = nullptr, int *code = nullptr) const;
+    bool checkOk(const SubsonicResponse &response, QString *err = nullptr, int *code = nullptr) const;
+    void sendRequest(const QString &method, const QUrlQuery &params, RequestSlot *slot, RequestPriority priority,
+                     ResponseHandler onSuccess, FailureHandler onFailure = {});
+    void sendStreamingRequest(const QString &method, const QUrlQuery &params, RequestSlot *slot, RequestPriority priority,
+                              BatchHandler onBatch, ResponseHandler onSuccess, FailureHandler onFailure = {});
+    void sendRevalidatedRequest(const QString &method, const QUrlQuery &params, RequestSlot *slot, RequestPriority priority,
+                                ResponseHandler apply, SerializeHandler serialize, ApplyHandler applyCached);
+    void abortRequest(RequestSlot &slot);
+    bool mirrorReady() const;
+    // Applies a mirror lookup unless the slot moved on; runs fallback when
+    // the mirror cannot answer.
+    template <typename T>
+    void queryMirror(RequestSlot &slot, QFuture<std::optional<T>> lookup,
+                     std::function<void(const T &)> apply, std::function<void()> fallback);
+    void finishRequest(const QString &key, QNetworkReply *reply);
+    void releaseRequest(const QString &key);
+    QString canonicalRequestKey(const QString &method, const QUrlQuery &params) const;
+    static bool isWaiterLive(const PendingWaiter &waiter);
 
     void loadRecentlyPlayed();
     void saveRecentlyPlayed();
     bool pruneRecentlyPlayed();
-    void fetchAlbumTracksAndAppend(const QString &albumId);
+    struct AlbumBatch
+    {
+        quint64 generation = 0;
+        QStringList albumIds;
+        QList<std::optional<TrackList>> results; // by position in albumIds
+        int next = 0;                            // next album to request
+        int appended = 0;                        // albums already in the model
+        int inFlight = 0;
+    };
+    void pumpAlbumBatch(const std::shared_ptr<AlbumBatch> &batch);
+    void supersedeAlbumBatch();
+    void appendReadyAlbums(const std::shared_ptr<AlbumBatch> &batch);
+    void fetchAlbumTracks(const QString &albumId, RequestPriority priority, std::function<void(TrackList)> done);
 
     void setAuthenticated(bool ok);
+    void fetchArtistsFromServer();
+    void scheduleCatalogCompaction();
+    void compactCatalog();
     void fetchAlbumListPage(const QString &type, int offset);
+    void probeAlbumCount(quint64 generation, int offset, int low, int high);
+    void fetchAlbumPage(int page, bool prefetch);
     QString cacheKey(const QString &base) const;
     void setAlbumListLoading(bool loading);
     void setHasMoreAlbumList(bool hasMore);
-    static QVariantList tracksToVariantList(const TrackList &list);
-    static TrackList tracksFromVariantList(const QVariantList &list);
-    static QVariantMap trackEntryToVariant(const TrackEntry &entry);
-    static TrackEntry trackEntryFromVariant(const QVariantMap &map);
+    static QVariantMap playlistEntryToVariant(const PlaylistEntry &entry);
+    static QVariantMap tracksToCache(const SubsonicResponse &response);
+    void applyCachedTracks(const QVariantMap &data);
+    void showTracks(const TrackList &tracks);
+    void applySearchResults(const ArtistList &artists, const AlbumList &albums, const TrackList &tracks);
 
     QString m_server, m_user, m_token, m_salt;
     bool m_authenticated = false;
     QString m_passwordHex;
     AuthMode m_authMode = AuthMode::Token;
     QNetworkAccessManager m_nam;
-    QNetworkReply *m_artistReply = nullptr;
-    QNetworkReply *m_albumListReply = nullptr;
-    QNetworkReply *m_albumReply = nullptr;
-    QNetworkReply *m_randomSongsReply = nullptr;
-    QNetworkReply *m_favoritesReply = nullptr;
-    QNetworkReply *m_playlistsReply = nullptr;
-    QNetworkReply *m_playlistReply = nullptr;
-    QNetworkReply *m_recentlyPlayedReply = nullptr;
-    QNetworkReply *m_mostPlayedReply = nullptr;
-
-    QVariantList m_artists, m_albums, m_albumList, m_searchArtists, m_searchAlbums, m_recentlyPlayedAlbums, m_mostPlayedAlbums, m_playlists;
-    TrackList m_tracks;
-    TrackList m_randomSongs;
-    TrackList m_favorites;
+    RequestScheduler m_scheduler;
+    RequestSlot m_artistsRequest;
+    RequestSlot m_artistRequest;
+    RequestSlot m_albumListRequest;
+    RequestSlot m_albumRequest;
+    RequestSlot m_randomSongsRequest;
+    RequestSlot m_favoritesRequest;
+    RequestSlot m_playlistsRequest;
+    RequestSlot m_playlistRequest;
+    RequestSlot m_recentlyPlayedRequest;
+    RequestSlot m_mostPlayedRequest;
+    RequestSlot m_searchRequest;
+    QHash<QString, PendingRequest> m_pendingRequests;
+    quint64 m_requestsSent = 0;
+    quint64 m_requestsCoalesced = 0;
+
+    QVariantList m_albums, m_searchArtists, m_searchAlbums, m_recentlyPlayedAlbums, m_mostPlayedAlbums, m_playlists;
+    LibraryCatalog m_catalog;
+    qsizetype m_catalogCompactAt = 0;  // record count that triggers the next check
+    bool m_catalogCompactionQueued = false;
+    ArtistListModel m_artistsModel;
+    AlbumListModel m_albumListModel;
+    PagedAlbumModel m_pagedAlbumModel;
+    QString m_pagedAlbumType;
+    quint64 m_pagedAlbumGeneration = 0;
+    // By page, while it is being fetched. A page's handlers share ownership of
+    // its slot, so waiters outlive the entry being dropped.
+    QHash<int, std::shared_ptr<RequestSlot>> m_albumPageRequests;
+    quint64 m_albumBatchGeneration = 0;
+    std::weak_ptr<AlbumBatch> m_albumBatch; // the latest one
+    TrackListModel m_tracksModel;
+    TrackListModel m_randomSongsModel;
+    TrackListModel m_favoritesModel;
     QString m_artistCover;
     QString m_pendingAlbumListType;
     qint32 m_pendingAlbumListOffset = 0;
     bool m_albumListPaging = false;
     bool m_hasMoreAlbumList = false;
     CacheManager *m_cacheManager = nullptr;
+    LibrarySync *m_librarySync = nullptr;
 };
@@ -1,18 +1,10 @@
 #include "SubsonicNetworkAccessManagerFactory.h"
-
-#include <QNetworkDiskCache>
-#include <QStandardPaths>
-#include <QDir>
+#include "RequestScheduler.h"
 
 SubsonicNetworkAccessManager::SubsonicNetworkAccessManager(QObject *parent)
-    : QNetworkAccessManager(parent)
+    : QNetworkAccessManager(parent),
+      m_scheduler(new RequestScheduler(this, this))
 {
-    auto *diskCache = new QNetworkDiskCache(this);
-    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/network";
-    QDir().mkpath(cacheDir);
-    diskCache->setCacheDirectory(cacheDir);
-    diskCache->setMaximumCacheSize(100 * 1024 * 1024); // 100 MB cap
-    setCache(diskCache);
 }
 
 QNetworkReply *SubsonicNetworkAccessManager::createRequest(Operation op,
@@ -23,6 +15,11 @@ QNetworkReply *SubsonicNetworkAccessManager::createRequest(Operation op,
     if (path.contains("/rest/getCoverArt.view")) {
         request.setRawHeader("Accept", "image/jpeg,image/png;q=0.9,*/*;q=0.8");
     }
+    // QML image loads go through the scheduler so they yield to interactive
+    // API calls and are dropped before sending when their delegate goes away.
+    if (op == GetOperation && !request.attribute(RequestScheduler::ScheduledAttribute).toBool()) {
+        return m_scheduler->get(request, RequestScheduler::priorityFor(request));
+    }
     return QNetworkAccessManager::createRequest(op, request, outgoingData);
 }
 
@@ -7,6 +7,8 @@
 #include <QQmlNetworkAccessManagerFactory>
 #include <QIODevice>
 
+class RequestScheduler;
+
 class SubsonicNetworkAccessManager : public QNetworkAccessManager {
 
 
@@ -17,6 +19,9 @@ protected:
     QNetworkReply *createRequest(Operation op,
                                  const QNetworkRequest &request,
                                  QIODevice *outgoingData = nullptr) override;
+
+private:
+    RequestScheduler *m_scheduler;
 };
 
 class SubsonicNetworkAccessManagerFactory : public QQmlNetworkAccessManagerFactory {
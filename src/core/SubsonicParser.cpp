@@ -0,0 +1,631 @@
+#include "SubsonicParser.h"
+#include <QCryptographicHash>
+#include <QThreadPool>
+#include <QPointer>
+#include <QMetaObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <rapidjson/reader.h>
+
+namespace {
+
+using rapidjson::SizeType;
+
+// Records handed out per partial batch when streaming and no natural group
+// boundary (an artist index letter) comes first.
+constexpr qsizetype STREAM_BATCH_SIZE = 64;
+
+enum class RecordKind
+{
+    None,
+    Track,
+    Album,
+    Artist,
+    Playlist
+};
+
+// Keys are resolved once in Key() so that nothing keeps pointers into the
+// reader's buffers; with a chunked stream those are only valid per callback.
+enum class JsonKey : quint8
+{
+    Other,
+    SubsonicResponse,
+    Status,
+    Error,
+    Code,
+    Message,
+    Id,
+    Title,
+    Name,
+    Artist,
+    ArtistId,
+    Album,
+    AlbumId,
+    CoverArt,
+    Duration,
+    Track,
+    Year,
+    SongCount,
+    AlbumCount,
+    PlayCount,
+    ReplayGain,
+    TrackGain,
+    AlbumGain,
+    Song,
+    Entry,
+    Playlist,
+    Index,
+    Indexes,
+    LastModified,
+    Created,
+    Changed
+};
+
+struct KeyName
+{
+    const char *name;
+    JsonKey key;
+};
+
+constexpr KeyName KEY_NAMES[] = {
+    {"subsonic-response", JsonKey::SubsonicResponse},
+    {"status", JsonKey::Status},
+    {"error", JsonKey::Error},
+    {"code", JsonKey::Code},
+    {"message", JsonKey::Message},
+    {"id", JsonKey::Id},
+    {"title", JsonKey::Title},
+    {"name", JsonKey::Name},
+    {"artist", JsonKey::Artist},
+    {"artistId", JsonKey::ArtistId},
+    {"album", JsonKey::Album},
+    {"albumId", JsonKey::AlbumId},
+    {"coverArt", JsonKey::CoverArt},
+    {"duration", JsonKey::Duration},
+    {"track", JsonKey::Track},
+    {"year", JsonKey::Year},
+    {"songCount", JsonKey::SongCount},
+    {"albumCount", JsonKey::AlbumCount},
+    {"playCount", JsonKey::PlayCount},
+    {"replayGain", JsonKey::ReplayGain},
+    {"trackGain", JsonKey::TrackGain},
+    {"albumGain", JsonKey::AlbumGain},
+    {"song", JsonKey::Song},
+    {"entry", JsonKey::Entry},
+    {"playlist", JsonKey::Playlist},
+    {"index", JsonKey::Index},
+    {"indexes", JsonKey::Indexes},
+    {"lastModified", JsonKey::LastModified},
+    {"created", JsonKey::Created},
+    {"changed", JsonKey::Changed},
+};
+
+JsonKey resolveKey(const char *str, SizeType length)
+{
+    for (const auto &entry : KEY_NAMES) {
+        if (std::strlen(entry.name) == length && std::memcmp(entry.name, str, length) == 0)
+            return entry.key;
+    }
+    return JsonKey::Other;
+}
+
+struct Frame
+{
+    JsonKey key = JsonKey::Other;  // key of the container, or of the enclosing array for elements
+    bool isArray = false;
+};
+
+// Records are short-lived transfer objects; deduplication happens when
+// they are added to the LibraryCatalog.
+inline QString utf8String(const char *str, SizeType length)
+{
+    return QString::fromUtf8(str, static_cast<qsizetype>(length));
+}
+
+// SAX handler for the Subsonic JSON envelope. Objects that are elements of
+// "song"/"entry"/"album"/"artist"/"playlist" arrays become records; every
+// other container is walked only to keep track of the current path.
+//
+// With a batch sink set, finished records are moved out in partial batches:
+// at the end of every getArtists index group, or every STREAM_BATCH_SIZE
+// records otherwise.
+class ResponseHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, ResponseHandler>
+{
+public:
+    using BatchSink = std::function<void(SubsonicResponse &&)>;
+
+    explicit ResponseHandler(SubsonicResponse &response, BatchSink sink = {})
+        : m_response(response), m_sink(std::move(sink))
+    {
+        m_stack.reserve(16);
+    }
+
+    bool Null() { return true; }
+    bool Bool(bool) { return true; }
+    bool Int(int value) { return number(value); }
+    bool Uint(unsigned value) { return number(value); }
+    bool Int64(int64_t value) { return number(static_cast<double>(value)); }
+    bool Uint64(uint64_t value) { return number(static_cast<double>(value)); }
+    bool Double(double value) { return number(value); }
+
+    bool String(const char *str, SizeType length, bool)
+    {
+        if (m_recordDepth != 0) {
+            if (m_stack.size() == m_recordDepth)
+                recordString(str, length);
+            return true;
+        }
+
+        if (m_stack.empty())
+            return true;
+        const size_t depth = m_stack.size();
+        const Frame &top = m_stack.back();
+        if (depth == 2 && m_key == JsonKey::Status) {
+            m_response.ok = length == 2 && std::memcmp(str, "ok", 2) == 0;
+        } else if (depth == 3 && top.key == JsonKey::Error && m_key == JsonKey::Message) {
+            m_response.errorMessage = QString::fromUtf8(str, static_cast<qsizetype>(length));
+        } else if (depth == 3 && !top.isArray && top.key == JsonKey::Artist && m_key == JsonKey::CoverArt) {
+            m_response.artistCoverArt = utf8String(str, length);
+        }
+        return true;
+    }
+
+    bool Key(const char *str, SizeType length, bool)
+    {
+        m_key = resolveKey(str, length);
+        return true;
+    }
+
+    bool StartObject()
+    {
+        Frame frame;
+        const bool inArray = !m_stack.empty() && m_stack.back().isArray;
+        frame.key = inArray ? m_stack.back().key : m_key;
+        m_stack.push_back(frame);
+
+        if (m_stack.size() == 2 && frame.key == JsonKey::SubsonicResponse) {
+            m_response.valid = true;
+        }
+
+        if (m_recordDepth == 0 && inArray) {
+            m_kind = kindForArray(frame.key);
+            if (m_kind != RecordKind::None) {
+                m_recordDepth = m_stack.size();
+                beginRecord();
+            }
+        }
+        return true;
+    }
+
+    bool EndObject(SizeType)
+    {
+        if (m_recordDepth != 0 && m_stack.size() == m_recordDepth) {
+            endRecord();
+            m_recordDepth = 0;
+            m_kind = RecordKind::None;
+            if (m_sink && ++m_pendingRecords >= STREAM_BATCH_SIZE)
+                flush();
+        } else if (m_sink && m_recordDepth == 0 && m_stack.back().key == JsonKey::Index
+                   && m_stack.size() >= 2 && m_stack[m_stack.size() - 2].isArray) {
+            flush();
+        }
+        m_stack.pop_back();
+        return true;
+    }
+
+    bool StartArray()
+    {
+        Frame frame;
+        frame.isArray = true;
+        frame.key = m_key;
+        m_stack.push_back(frame);
+        return true;
+    }
+
+    bool EndArray(SizeType)
+    {
+        m_stack.pop_back();
+        return true;
+    }
+
+    // Hands the records collected since the last flush to the batch sink.
+    void flush()
+    {
+        m_pendingRecords = 0;
+        if (!m_sink)
+            return;
+        if (m_response.tracks.isEmpty() && m_response.albums.isEmpty()
+            && m_response.artists.isEmpty() && m_response.playlists.isEmpty())
+            return;
+
+        SubsonicResponse batch;
+        batch.valid = true;
+        batch.ok = true;
+        batch.tracks.swap(m_response.tracks);
+        batch.albums.swap(m_response.albums);
+        batch.artists.swap(m_response.artists);
+        batch.playlists.swap(m_response.playlists);
+        m_sink(std::move(batch));
+    }
+
+private:
+    static RecordKind kindForArray(JsonKey key)
+    {
+        switch (key) {
+        case JsonKey::Song:
+        case JsonKey::Entry:
+            return RecordKind::Track;
+        case JsonKey::Album:
+            return RecordKind::Album;
+        case JsonKey::Artist:
+            return RecordKind::Artist;
+        case JsonKey::Playlist:
+            return RecordKind::Playlist;
+        default:
+            return RecordKind::None;
+        }
+    }
+
+    void beginRecord()
+    {
+        switch (m_kind) {
+        case RecordKind::Track: m_track = TrackEntry(); break;
+        case RecordKind::Album: m_album = AlbumEntry(); break;
+        case RecordKind::Artist: m_artist = ArtistEntry(); break;
+        case RecordKind::Playlist: m_playlist = PlaylistEntry(); break;
+        case RecordKind::None: break;
+        }
+    }
+
+    void endRecord()
+    {
+        switch (m_kind) {
+        case RecordKind::Track: m_response.tracks.append(std::move(m_track)); break;
+        case RecordKind::Album: m_response.albums.append(std::move(m_album)); break;
+        case RecordKind::Artist: m_response.artists.append(std::move(m_artist)); break;
+        case RecordKind::Playlist: m_response.playlists.append(std::move(m_playlist)); break;
+        case RecordKind::None: break;
+        }
+    }
+
+    void recordString(const char *str, SizeType length)
+    {
+        switch (m_kind) {
+        case RecordKind::Track:
+            switch (m_key) {
+            case JsonKey::Id: m_track.id = utf8String(str, length); break;
+            case JsonKey::Title: m_track.title = utf8String(str, length); break;
+            case JsonKey::Artist: m_track.artist = utf8String(str, length); break;
+            case JsonKey::ArtistId: m_track.artistId = utf8String(str, length); break;
+            case JsonKey::Album: m_track.album = utf8String(str, length); break;
+            case JsonKey::AlbumId: m_track.albumId = utf8String(str, length); break;
+            case JsonKey::CoverArt: m_track.coverArt = utf8String(str, length); break;
+            default: break;
+            }
+            break;
+        case RecordKind::Album:
+            switch (m_key) {
+            case JsonKey::Id: m_album.id = utf8String(str, length); break;
+            case JsonKey::Name: m_album.name = utf8String(str, length); break;
+            case JsonKey::Artist: m_album.artist = utf8String(str, length); break;
+            case JsonKey::ArtistId: m_album.artistId = utf8String(str, length); break;
+            case JsonKey::CoverArt: m_album.coverArt = utf8String(str, length); break;
+            case JsonKey::Created: m_album.created = utf8String(str, length); break;
+            case JsonKey::Changed: m_album.changed = utf8String(str, length); break;
+            default: break;
+            }
+            break;
+        case RecordKind::Artist:
+            switch (m_key) {
+            case JsonKey::Id: m_artist.id = utf8String(str, length); break;
+            case JsonKey::Name: m_artist.name = utf8String(str, length); break;
+            case JsonKey::CoverArt: m_artist.coverArt = utf8String(str, length); break;
+            default: break;
+            }
+            break;
+        case RecordKind::Playlist:
+            switch (m_key) {
+            case JsonKey::Id: m_playlist.id = utf8String(str, length); break;
+            case JsonKey::Name: m_playlist.name = utf8String(str, length); break;
+            case JsonKey::CoverArt: m_playlist.coverArt = utf8String(str, length); break;
+            case JsonKey::Changed: m_playlist.changed = utf8String(str, length); break;
+            default: break;
+            }
+            break;
+        case RecordKind::None:
+            break;
+        }
+    }
+
+    bool number(double value)
+    {
+        if (m_recordDepth == 0) {
+            if (m_stack.size() == 3 && m_stack.back().key == JsonKey::Error && m_key == JsonKey::Code)
+                m_response.errorCode = static_cast<int>(value);
+            else if (m_stack.size() == 3 && m_stack.back().key == JsonKey::Indexes && m_key == JsonKey::LastModified)
+                m_response.lastModified = static_cast<qint64>(value);
+            return true;
+        }
+
+        if (m_stack.size() == m_recordDepth) {
+            recordNumber(value);
+        } else if (m_kind == RecordKind::Track && m_stack.size() == m_recordDepth + 1) {
+            const Frame &top = m_stack.back();
+            if (!top.isArray && top.key == JsonKey::ReplayGain) {
+                if (m_key == JsonKey::TrackGain)
+                    m_track.replayGainTrackGain = static_cast<float>(value);
+                else if (m_key == JsonKey::AlbumGain)
+                    m_track.replayGainAlbumGain = static_cast<float>(value);
+            }
+        }
+        return true;
+    }
+
+    void recordNumber(double value)
+    {
+        const auto asInt = static_cast<qint32>(value);
+        switch (m_kind) {
+        case RecordKind::Track:
+            switch (m_key) {
+            case JsonKey::Duration: m_track.duration = asInt; break;
+            case JsonKey::Track: m_track.track = static_cast<qint16>(asInt); break;
+            case JsonKey::Year: m_track.year = static_cast<qint16>(asInt); break;
+            default: break;
+            }
+            break;
+        case RecordKind::Album:
+            switch (m_key) {
+            case JsonKey::Year: m_album.year = static_cast<qint16>(asInt); break;
+            case JsonKey::SongCount: m_album.songCount = asInt; break;
+            case JsonKey::Duration: m_album.duration = asInt; break;
+            case JsonKey::PlayCount: m_album.playCount = asInt; break;
+            default: break;
+            }
+            break;
+        case RecordKind::Artist:
+            if (m_key == JsonKey::AlbumCount)
+                m_artist.albumCount = asInt;
+            break;
+        case RecordKind::Playlist:
+            switch (m_key) {
+            case JsonKey::SongCount: m_playlist.songCount = asInt; break;
+            case JsonKey::Duration: m_playlist.duration = asInt; break;
+            default: break;
+            }
+            break;
+        case RecordKind::None:
+            break;
+        }
+    }
+
+    SubsonicResponse &m_response;
+    BatchSink m_sink;
+    std::vector<Frame> m_stack;
+    JsonKey m_key = JsonKey::Other;
+    size_t m_recordDepth = 0;
+    RecordKind m_kind = RecordKind::None;
+    qsizetype m_pendingRecords = 0;
+
+    TrackEntry m_track;
+    AlbumEntry m_album;
+    ArtistEntry m_artist;
+    PlaylistEntry m_playlist;
+};
+
+}
+
+// Chunks handed over from the GUI thread to the streaming parse thread.
+// Consumed chunks are released immediately, so at most the chunks that have
+// arrived but not been parsed yet are held in memory.
+struct SubsonicStreamParser::State
+{
+    QMutex mutex;
+    QWaitCondition wakeup;
+    std::deque<QByteArray> chunks;
+    bool finished = false;
+    bool cancelled = false;
+};
+
+namespace {
+
+// Blocking RapidJSON input stream over SubsonicStreamParser::State. Peek()
+// waits for the next chunk and reports end of input with '\0' once the
+// producer has finished (or cancelled), which the reader turns into an error
+// if the document is incomplete.
+class ChunkStream
+{
+public:
+    typedef char Ch;
+
+    explicit ChunkStream(SubsonicStreamParser::State &state) : m_state(state) {}
+
+    Ch Peek()
+    {
+        if (m_pos >= m_current.size() && !advance())
+            return '\0';
+        return m_current.at(m_pos);
+    }
+
+    Ch Take()
+    {
+        if (m_pos >= m_current.size() && !advance())
+            return '\0';
+        ++m_count;
+        return m_current.at(m_pos++);
+    }
+
+    size_t Tell() const { return m_count; }
+
+    Ch *PutBegin() { RAPIDJSON_ASSERT(false); return nullptr; }
+    void Put(Ch) { RAPIDJSON_ASSERT(false); }
+    void Flush() { RAPIDJSON_ASSERT(false); }
+    size_t PutEnd(Ch *) { RAPIDJSON_ASSERT(false); return 0; }
+
+private:
+    bool advance()
+    {
+        QMutexLocker locker(&m_state.mutex);
+        for (;;) {
+            while (m_state.chunks.empty() && !m_state.finished && !m_state.cancelled)
+                m_state.wakeup.wait(&m_state.mutex);
+            if (m_state.cancelled || m_state.chunks.empty())
+                return false;
+            m_current = std::move(m_state.chunks.front());
+            m_state.chunks.pop_front();
+            m_pos = 0;
+            if (!m_current.isEmpty())
+                return true;
+        }
+    }
+
+    SubsonicStreamParser::State &m_state;
+    QByteArray m_current;
+    qsizetype m_pos = 0;
+    size_t m_count = 0;
+};
+
+}
+
+namespace SubsonicParser {
+
+SubsonicResponse parse(QByteArray payload)
+{
+    SubsonicResponse response;
+    if (payload.isEmpty())
+        return response;
+
+    // In-situ parsing decodes strings inside the payload buffer itself, so
+    // the buffer must be writable and NUL-terminated (QByteArray always is).
+    char *buffer = payload.data();
+    rapidjson::InsituStringStream stream(buffer);
+    ResponseHandler handler(response);
+    rapidjson::Reader reader;
+    if (reader.Parse<rapidjson::kParseInsituFlag>(stream, handler).IsError()) {
+        response.valid = false;
+        response.ok = false;
+    }
+    return response;
+}
+
+void parseAsync(QByteArray payload, QObject *context,
+                std::function<void(SubsonicResponse)> callback)
+{
+    QPointer<QObject> guard(context);
+    QThreadPool::globalInstance()->start([payload, guard, callback]() mutable {
+        // parse() works in place, so the body is hashed before it.
+        const QByteArray hash = QCryptographicHash::hash(payload, QCryptographicHash::Sha1).toHex();
+        auto response = std::make_shared<SubsonicResponse>(parse(std::move(payload)));
+        response->bodyHash = hash;
+        if (!guard)
+            return;
+        QMetaObject::invokeMethod(guard.data(), [response, callback]() {
+            callback(std::move(*response));
+        }, Qt::QueuedConnection);
+    });
+}
+
+}
+
+namespace {
+
+// Few streaming requests run at once (artists, album list pages); more
+// wait their turn with their chunks buffered. The pool is never destroyed:
+// a parse may still be waiting for data at exit.
+constexpr int STREAM_PARSE_THREADS = 4;
+
+QThreadPool *streamParsePool()
+{
+    static QThreadPool *pool = [] {
+        auto *p = new QThreadPool;
+        p->setMaxThreadCount(STREAM_PARSE_THREADS);
+        return p;
+    }();
+    return pool;
+}
+
+}
+
+SubsonicStreamParser::SubsonicStreamParser(QObject *context, BatchHandler onBatch, BatchHandler onFinished)
+    : m_state(std::make_shared<State>())
+{
+    QPointer<QObject> guard(context);
+    auto state = m_state;
+
+    // A pool of its own rather than the global one: a stream parse blocks
+    // waiting for network data and must not starve the short-lived parse
+    // tasks. Its threads are reused across requests.
+    streamParsePool()->start([state, guard, onBatch, onFinished]() {
+        auto deliver = [guard](const BatchHandler &handler, SubsonicResponse &&response) {
+            if (!guard || !handler)
+                return;
+            auto shared = std::make_shared<SubsonicResponse>(std::move(response));
+            QMetaObject::invokeMethod(guard.data(), [handler, shared]() {
+                handler(std::move(*shared));
+            }, Qt::QueuedConnection);
+        };
+
+        SubsonicResponse response;
+        ResponseHandler handler(response, [&deliver, &onBatch](SubsonicResponse &&batch) {
+            deliver(onBatch, std::move(batch));
+        });
+        ChunkStream stream(*state);
+        rapidjson::Reader reader;
+        const bool failed = reader.Parse(stream, handler).IsError();
+
+        {
+            QMutexLocker locker(&state->mutex);
+            if (state->cancelled)
+                return;
+        }
+        if (failed) {
+            response.valid = false;
+            response.ok = false;
+        } else {
+            handler.flush();
+        }
+        deliver(onFinished, std::move(response));
+    });
+}
+
+SubsonicStreamParser::~SubsonicStreamParser()
+{
+    // Once finish() was called the parse thread completes on its own and
+    // delivers through the guarded context; only abandon unfinished input.
+    QMutexLocker locker(&m_state->mutex);
+    if (m_state->finished)
+        return;
+    m_state->cancelled = true;
+    m_state->chunks.clear();
+    m_state->wakeup.wakeOne();
+}
+
+void SubsonicStreamParser::feed(const QByteArray &chunk)
+{
+    if (chunk.isEmpty())
+        return;
+    QMutexLocker locker(&m_state->mutex);
+    if (m_state->finished || m_state->cancelled)
+        return;
+    m_state->chunks.push_back(chunk);
+    m_state->wakeup.wakeOne();
+}
+
+void SubsonicStreamParser::finish()
+{
+    QMutexLocker locker(&m_state->mutex);
+    m_state->finished = true;
+    m_state->wakeup.wakeOne();
+}
+
+void SubsonicStreamParser::cancel()
+{
+    QMutexLocker locker(&m_state->mutex);
+    m_state->cancelled = true;
+    m_state->chunks.clear();
+    m_state->wakeup.wakeOne();
+}
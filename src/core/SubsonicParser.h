@@ -0,0 +1,64 @@
+#pragma once
+#include <QByteArray>
+#include <QObject>
+#include <functional>
+#include <memory>
+#include "LibraryTypes.h"
+
+// Result of parsing one "subsonic-response" envelope. Only the collections
+// that the request actually returned are filled; everything else stays empty.
+struct SubsonicResponse
+{
+    bool valid = false;          // well-formed JSON with a subsonic-response object
+    bool ok = false;             // status == "ok"
+    int errorCode = 0;
+    QString errorMessage;
+
+    QString artistCoverArt;      // getArtist: coverArt of the artist itself
+    qint64 lastModified = 0;     // getIndexes: library modification time (ms)
+    TrackList tracks;            // song / entry arrays
+    AlbumList albums;            // album arrays
+    ArtistList artists;          // artist arrays (getArtists, search3, getStarred)
+    PlaylistList playlists;      // getPlaylists
+    QByteArray bodyHash;         // hex SHA-1 of the reply body; parseAsync only
+};
+
+namespace SubsonicParser {
+
+// Parses the reply body with RapidJSON's SAX reader, in place, straight into
+// the records above. No DOM or QVariant tree is built.
+SubsonicResponse parse(QByteArray payload);
+
+// Runs parse() on the global thread pool, hashing the body first, and
+// invokes the callback on the thread of the context object. The callback
+// is dropped if the context dies.
+void parseAsync(QByteArray payload, QObject *context,
+                std::function<void(SubsonicResponse)> callback);
+
+}
+
+// Push parser for large responses. Chunks from QNetworkReply::readyRead are
+// fed in as they arrive and parsed on a dedicated thread while the download
+// continues. Records are delivered to onBatch in partial batches (one
+// getArtists index group at a time, or every few dozen records); onFinished
+// then receives the envelope status only, with no records left in it.
+// Both callbacks run on the context object's thread.
+class SubsonicStreamParser
+{
+public:
+    using BatchHandler = std::function<void(SubsonicResponse)>;
+    struct State;
+
+    SubsonicStreamParser(QObject *context, BatchHandler onBatch, BatchHandler onFinished);
+    ~SubsonicStreamParser();
+
+    SubsonicStreamParser(const SubsonicStreamParser &) = delete;
+    SubsonicStreamParser &operator=(const SubsonicStreamParser &) = delete;
+
+    void feed(const QByteArray &chunk);
+    void finish();
+    void cancel();
+
+private:
+    std::shared_ptr<State> m_state;
+};
@@ -6,7 +6,9 @@
 #include <QIcon>
 #include "core/SubsonicClient.h"
 #include "core/SubsonicNetworkAccessManagerFactory.h"
+#include "core/CoverImageProvider.h"
 #include "core/CacheManager.h"
+#include "core/LibrarySync.h"
 #include "core/AppInfo.h"
 #include "core/WindowStateManager.h"
 #include "playback/PlayerController.h"
@@ -44,6 +46,8 @@ int main(int argc, char *argv[]) {
     TranslationManager translationManager;
     SubsonicClient api;
     api.setCacheManager(&cacheManager);
+    LibrarySync librarySync(&api, &cacheManager);
+    api.setLibrarySync(&librarySync);
     DiscordRPC discord;
     PlayerController player(&api, &discord);
     AppInfo appInfo;
@@ -54,9 +58,11 @@ int main(int argc, char *argv[]) {
     translationManager.setEngine(&engine);
     
     engine.setNetworkAccessManagerFactory(new SubsonicNetworkAccessManagerFactory);
+    engine.addImageProvider("cover", new CoverImageProvider(&api, &cacheManager));
     engine.rootContext()->setContextProperty("cacheManager", &cacheManager);
     engine.rootContext()->setContextProperty("translationManager", &translationManager);
     engine.rootContext()->setContextProperty("api", &api);
+    engine.rootContext()->setContextProperty("librarySync", &librarySync);
     engine.rootContext()->setContextProperty("player", &player);
     engine.rootContext()->setContextProperty("discord", &discord);
     engine.rootContext()->setContextProperty("appInfo", &appInfo);
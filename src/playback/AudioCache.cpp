@@ -0,0 +1,129 @@
+#include "AudioCache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
+
+namespace {
+const QString PART_SUFFIX = QStringLiteral(".part");
+}
+
+AudioCache::AudioCache(const QString &directory, qint64 limit)
+    : m_directory(directory), m_limit(limit) {
+    QDir().mkpath(m_directory);
+    load();
+    trim();
+}
+
+void AudioCache::setLimit(qint64 bytes) {
+    m_limit = bytes;
+    trim();
+}
+
+QString AudioCache::baseName(const QString &key) {
+    return QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+// Entries from earlier runs, ranked by modification time, which touch()
+// keeps at the last play. Parts of interrupted downloads are dropped.
+void AudioCache::load() {
+    const QFileInfoList files = QDir(m_directory).entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+    for (const QFileInfo &info : files) {
+        const QString name = info.fileName();
+        const QString base = name.section(QLatin1Char('.'), 0, 0);
+        if (name.endsWith(PART_SUFFIX) || m_entries.contains(base)) {
+            QFile::remove(info.filePath());
+            continue;
+        }
+        Entry entry;
+        entry.fileName = name;
+        entry.size = info.size();
+        entry.contentType = QByteArray::fromPercentEncoding(name.section(QLatin1Char('.'), 1).toLatin1());
+        entry.stamp = ++m_clock;
+        m_entries.insert(base, entry);
+        m_lru.insert(entry.stamp, base);
+        m_size += entry.size;
+    }
+}
+
+bool AudioCache::contains(const QString &key) const {
+    const auto it = m_entries.constFind(baseName(key));
+    return it != m_entries.constEnd() && QFile::exists(path(*it));
+}
+
+std::optional<AudioCache::File> AudioCache::find(const QString &key) {
+    const QString name = baseName(key);
+    auto it = m_entries.find(name);
+    if (it == m_entries.end()) return std::nullopt;
+    if (!QFile::exists(path(*it))) {
+        // Deleted behind our back, usually by CacheManager's eviction.
+        m_size -= it->size;
+        m_lru.remove(it->stamp);
+        m_entries.erase(it);
+        return std::nullopt;
+    }
+    touch(name, *it);
+    return File{path(*it), it->size, it->contentType};
+}
+
+QString AudioCache::partPath(const QString &key) const {
+    return m_directory + QLatin1Char('/') + baseName(key) + PART_SUFFIX;
+}
+
+bool AudioCache::commit(const QString &key, const QByteArray &contentType) {
+    const QString name = baseName(key);
+    remove(name);
+    Entry entry;
+    entry.fileName = name;
+    if (!contentType.isEmpty()) {
+        entry.fileName += QLatin1Char('.') + QString::fromLatin1(QUrl::toPercentEncoding(QString::fromLatin1(contentType)));
+    }
+    const QString part = partPath(key);
+    if (!QFile::rename(part, path(entry))) {
+        QFile::remove(part);
+        return false;
+    }
+    entry.size = QFileInfo(path(entry)).size();
+    entry.contentType = contentType;
+    entry.stamp = ++m_clock;
+    m_entries.insert(name, entry);
+    m_lru.insert(entry.stamp, name);
+    m_size += entry.size;
+    return true;
+}
+
+void AudioCache::trim(const QSet<QString> &inUse) {
+    if (m_size <= m_limit) return;
+    QSet<QString> keep;
+    for (const QString &key : inUse) {
+        keep.insert(baseName(key));
+    }
+    for (auto it = m_lru.begin(); it != m_lru.end() && m_size > m_limit;) {
+        const QString name = it.value();
+        ++it;
+        if (!keep.contains(name)) remove(name);
+    }
+}
+
+void AudioCache::touch(const QString &name, Entry &entry) {
+    m_lru.remove(entry.stamp);
+    entry.stamp = ++m_clock;
+    m_lru.insert(entry.stamp, name);
+    QFile file(path(entry));
+    if (file.open(QIODevice::ReadWrite)) {
+        file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+    }
+}
+
+void AudioCache::remove(const QString &name) {
+    const auto it = m_entries.constFind(name);
+    if (it == m_entries.constEnd()) return;
+    // An entry CacheManager already evicted only needs forgetting.
+    const QString file = path(*it);
+    if (!QFile::remove(file) && QFile::exists(file)) return;
+    m_size -= it->size;
+    m_lru.remove(it->stamp);
+    m_entries.erase(it);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <optional>
+
+// Whole audio files fetched by StreamProxy. A download is written to a
+// .part file and only becomes an entry once it is complete; the least
+// recently played entries are deleted first. The directory also counts
+// toward CacheManager's budget, which may evict entries behind our back;
+// the limit here caps audio's share of it.
+//
+// An entry is named after the SHA-1 of its key, with the percent-encoded
+// content type as extension, so the type survives a restart.
+class AudioCache {
+public:
+    struct File {
+        QString path;
+        qint64 size = 0;
+        QByteArray contentType;
+    };
+
+    AudioCache(const QString &directory, qint64 limit);
+
+    qint64 size() const { return m_size; }
+    qint64 limit() const { return m_limit; }
+    void setLimit(qint64 bytes);
+
+    bool contains(const QString &key) const;
+    // Marks the entry as just played.
+    std::optional<File> find(const QString &key);
+    QString partPath(const QString &key) const;
+    // The part file for key is complete and replaces any older entry.
+    bool commit(const QString &key, const QByteArray &contentType);
+    // Deletes entries until the cache is within its limit, skipping the
+    // keys in use (an open file cannot be deleted everywhere).
+    void trim(const QSet<QString> &inUse = {});
+
+private:
+    struct Entry {
+        QString fileName;  // base name plus the content type extension
+        qint64 size = 0;
+        qint64 stamp = 0;
+        QByteArray contentType;
+    };
+
+    static QString baseName(const QString &key);
+    QString path(const Entry &entry) const { return m_directory + QLatin1Char('/') + entry.fileName; }
+    void load();
+    void touch(const QString &name, Entry &entry);
+    void remove(const QString &name);
+
+    QString m_directory;
+    qint64 m_limit;
+    qint64 m_size = 0;
+    qint64 m_clock = 0;
+    QHash<QString, Entry> m_entries;  // by base name
+    QMap<qint64, QString> m_lru;      // stamp -> base name, oldest first
+};
@@ -0,0 +1,129 @@
+#include "MpvEventPump.h"
+#include <QMutexLocker>
+#include <QThread>
+#include <chrono>
+#include <cstring>
+
+namespace {
+MpvEvent copyEvent(const mpv_event *event) {
+    MpvEvent copy;
+    copy.id = event->event_id;
+    copy.userdata = event->reply_userdata;
+    copy.error = event->error;
+    copy.receivedNs = MpvEventPump::nowNs();
+
+    if (event->event_id == MPV_EVENT_PROPERTY_CHANGE) {
+        const auto *prop = static_cast<const mpv_event_property *>(event->data);
+        copy.format = prop->format;
+        if (prop->format == MPV_FORMAT_DOUBLE) {
+            copy.real = *static_cast<const double *>(prop->data);
+        } else if (prop->format == MPV_FORMAT_INT64) {
+            copy.integer = *static_cast<const int64_t *>(prop->data);
+        } else if (prop->format == MPV_FORMAT_FLAG) {
+            copy.integer = *static_cast<const int *>(prop->data);
+        }
+    } else if (event->event_id == MPV_EVENT_COMMAND_REPLY && event->data) {
+        // loadfile answers with the id of the playlist entry it created.
+        const mpv_node &result = static_cast<const mpv_event_command *>(event->data)->result;
+        if (result.format == MPV_FORMAT_NODE_MAP) {
+            const mpv_node_list *map = result.u.list;
+            for (int i = 0; i < map->num; ++i) {
+                if (std::strcmp(map->keys[i], "playlist_entry_id") == 0 && map->values[i].format == MPV_FORMAT_INT64) {
+                    copy.integer = map->values[i].u.int64;
+                }
+            }
+        }
+    } else if (event->event_id == MPV_EVENT_START_FILE && event->data) {
+        copy.integer = static_cast<const mpv_event_start_file *>(event->data)->playlist_entry_id;
+    } else if (event->event_id == MPV_EVENT_END_FILE) {
+        const auto *endFile = static_cast<const mpv_event_end_file *>(event->data);
+        copy.endReason = endFile->reason;
+        copy.error = endFile->error;
+    }
+    return copy;
+}
+} // namespace
+
+MpvEventPump::MpvEventPump(mpv_handle *mpv, std::function<void()> notify)
+    : m_mpv(mpv), m_notify(std::move(notify)) {
+}
+
+MpvEventPump::~MpvEventPump() {
+    stop();
+}
+
+qint64 MpvEventPump::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void MpvEventPump::start() {
+    if (m_thread || !m_mpv) return;
+    m_thread.reset(QThread::create([this]() { run(); }));
+    m_thread->setObjectName(QStringLiteral("mpv-events"));
+    mpv_set_wakeup_callback(m_mpv, &MpvEventPump::onWakeup, this);
+    m_thread->start();
+}
+
+void MpvEventPump::stop() {
+    if (!m_thread) return;
+    mpv_set_wakeup_callback(m_mpv, nullptr, nullptr);
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wakeup.wakeOne();
+    }
+    m_thread->wait();
+    m_thread.reset();
+}
+
+void MpvEventPump::onWakeup(void *self) {
+    // Called by mpv on one of its own threads; must not call back into mpv.
+    static_cast<MpvEventPump *>(self)->wake();
+}
+
+void MpvEventPump::wake() {
+    QMutexLocker locker(&m_mutex);
+    m_pending = true;
+    m_wakeup.wakeOne();
+}
+
+bool MpvEventPump::push(const MpvEvent &event) {
+    if (!m_queue.push(event)) {
+        // Ask the consumer for a wake-up, then retry in case it drained
+        // the queue before seeing the flag.
+        m_stalled.store(true);
+        if (!m_queue.push(event)) return false;
+        m_stalled.store(false);
+    }
+    if (!m_notified.exchange(true)) m_notify();
+    return true;
+}
+
+void MpvEventPump::run() {
+    while (true) {
+        {
+            QMutexLocker locker(&m_mutex);
+            while (!m_pending && !m_stopping) m_wakeup.wait(&m_mutex);
+            if (m_stopping) return;
+            m_pending = false;
+        }
+
+        if (m_held) {
+            if (!push(*m_held)) continue;
+            if (m_held->id == MPV_EVENT_SHUTDOWN) return;
+            m_held.reset();
+        }
+        while (true) {
+            const mpv_event *event = mpv_wait_event(m_mpv, 0);
+            if (event->event_id == MPV_EVENT_NONE) break;
+            MpvEvent copy = copyEvent(event);
+            if (!push(copy)) {
+                m_held = copy;
+                break;
+            }
+            // mpv keeps returning the shutdown event from here on.
+            if (copy.id == MPV_EVENT_SHUTDOWN) return;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <mpv/client.h>
+#include "SpscQueue.h"
+
+class QThread;
+
+// An mpv event copied out of mpv's buffer, which is only valid until the
+// next mpv_wait_event(). Property values are kept for the formats the
+// player observes.
+struct MpvEvent {
+    mpv_event_id id = MPV_EVENT_NONE;
+    quint64 userdata = 0;   // observed property or request serial
+    int error = 0;
+    mpv_format format = MPV_FORMAT_NONE;
+    double real = 0.0;      // MPV_FORMAT_DOUBLE
+    qint64 integer = 0;     // MPV_FORMAT_INT64 and MPV_FORMAT_FLAG, or a playlist entry id
+    int endReason = 0;      // MPV_EVENT_END_FILE
+    qint64 receivedNs = 0;  // steady clock, when taken from mpv
+};
+
+// Reads mpv events on a thread of its own. mpv's wakeup callback wakes the
+// thread, which drains mpv into a lock-free queue and then calls notify()
+// once until the consumer has drained it, so nothing runs while mpv is
+// quiet. If the queue is full the thread waits for the consumer instead of
+// dropping events.
+class MpvEventPump {
+public:
+    static constexpr std::size_t Capacity = 256;
+
+    // notify is called on the pump thread; it should schedule drain() on
+    // the consumer thread.
+    MpvEventPump(mpv_handle *mpv, std::function<void()> notify);
+    ~MpvEventPump();
+
+    void start();
+    // Joins the thread; mpv must not be destroyed before this returns.
+    void stop();
+
+    // Consumer side: hands every queued event to fn.
+    template <typename Fn>
+    void drain(Fn &&fn) {
+        m_notified.store(false, std::memory_order_seq_cst);
+        MpvEvent event;
+        while (m_queue.pop(event)) fn(event);
+        if (m_stalled.exchange(false)) wake();
+    }
+
+    static qint64 nowNs();
+
+private:
+    static void onWakeup(void *self);
+    void wake();
+    void run();
+    bool push(const MpvEvent &event);
+
+    mpv_handle *m_mpv;
+    std::function<void()> m_notify;
+    std::unique_ptr<QThread> m_thread;
+    SpscQueue<MpvEvent, Capacity> m_queue;
+    std::optional<MpvEvent> m_held;  // taken from mpv while the queue was full
+
+    QMutex m_mutex;
+    QWaitCondition m_wakeup;
+    bool m_pending = false;
+    bool m_stopping = false;
+
+    std::atomic<bool> m_notified{false};
+    std::atomic<bool> m_stalled{false};
+};
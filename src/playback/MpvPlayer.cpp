@@ -1,7 +1,12 @@
 #include "MpvPlayer.h"
 #include <QDebug>
+#include <QLoggingCategory>
 #include <QVariantList>
-#include <cstring>
+#include <iterator>
+
+// Off by default; QT_LOGGING_RULES="shibamusic.mpv.latency.debug=true"
+// prints the reply and event dispatch latencies on exit.
+Q_LOGGING_CATEGORY(lcMpvLatency, "shibamusic.mpv.latency", QtInfoMsg)
 
 MpvPlayer::MpvPlayer(QObject *parent) : QObject(parent) {
     m_mpv = mpv_create();
@@ -42,33 +47,99 @@ MpvPlayer::MpvPlayer(QObject *parent) : QObject(parent) {
     mpv_set_property_string(m_mpv, "loop-file", "no");
     mpv_set_property_string(m_mpv, "loop-playlist", "no");
 
-    mpv_observe_property(m_mpv, 0, "time-pos", MPV_FORMAT_DOUBLE);
-    mpv_observe_property(m_mpv, 0, "duration", MPV_FORMAT_DOUBLE);
-    mpv_observe_property(m_mpv, 0, "pause", MPV_FORMAT_FLAG);
-    mpv_observe_property(m_mpv, 0, "playlist-pos", MPV_FORMAT_INT64);
+    mpv_observe_property(m_mpv, TimePosProperty, "time-pos", MPV_FORMAT_DOUBLE);
+    mpv_observe_property(m_mpv, DurationProperty, "duration", MPV_FORMAT_DOUBLE);
+    mpv_observe_property(m_mpv, PauseProperty, "pause", MPV_FORMAT_FLAG);
+
+    int paused = 1;
+    mpv_get_property(m_mpv, "pause", MPV_FORMAT_FLAG, &paused);
+    m_paused = paused;
+
+    m_positionTimer.setSingleShot(true);
+    m_positionTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_positionTimer, &QTimer::timeout, this, [this]() {
+        if (m_positionDirty) flushPosition();
+    });
 
-    m_eventTimer = new QTimer(this);
-    connect(m_eventTimer, &QTimer::timeout, this, &MpvPlayer::processEvents);
-    m_eventTimer->start(50);
+    m_pump = std::make_unique<MpvEventPump>(m_mpv, [this]() {
+        QMetaObject::invokeMethod(this, &MpvPlayer::processEvents, Qt::QueuedConnection);
+    });
+    m_pump->start();
 }
 
 MpvPlayer::~MpvPlayer() {
+    m_pump.reset();
+    if (m_replyLatency.count > 0) {
+        qCDebug(lcMpvLatency) << "reply latency: avg" << m_replyLatency.totalNs / m_replyLatency.count / 1000
+                 << "us, max" << m_replyLatency.maxNs / 1000 << "us over" << m_replyLatency.count << "requests";
+    }
+    if (m_dispatchLatency.count > 0) {
+        qCDebug(lcMpvLatency) << "event dispatch latency: avg" << m_dispatchLatency.totalNs / m_dispatchLatency.count / 1000
+                 << "us, max" << m_dispatchLatency.maxNs / 1000 << "us over" << m_dispatchLatency.count << "events";
+    }
     if (m_mpv) {
         mpv_terminate_destroy(m_mpv);
     }
 }
 
+void MpvPlayer::Latency::add(qint64 ns) {
+    ++count;
+    totalNs += ns;
+    maxNs = qMax(maxNs, ns);
+}
+
+quint64 MpvPlayer::trackRequest() {
+    const quint64 id = ++m_nextRequest;
+    m_requestSentNs.insert(id, MpvEventPump::nowNs());
+    return id;
+}
+
 void MpvPlayer::command(const QVariant &args) {
-    if (!m_mpv) return;
-    QVariantList list = args.value<QVariantList>();
+    sendCommand(args.value<QVariantList>());
+}
+
+quint64 MpvPlayer::sendCommand(const QVariantList &args) {
+    if (!m_mpv) return 0;
     QVector<const char*> cargs;
     QVector<QByteArray> storage;
-    for (const auto &arg : list) {
+    for (const auto &arg : args) {
         storage.append(arg.toString().toUtf8());
         cargs.append(storage.last().constData());
     }
     cargs.append(nullptr);
-    mpv_command_async(m_mpv, 0, cargs.data());
+    const quint64 request = trackRequest();
+    if (mpv_command_async(m_mpv, request, cargs.data()) < 0) {
+        m_requestSentNs.remove(request);
+        return 0;
+    }
+    return request;
+}
+
+void MpvPlayer::appendFile(const QString &url, quint64 tag) {
+    const quint64 request = sendCommand(QVariantList{"loadfile", url, "append"});
+    if (request) m_loadRequests.insert(request, tag);
+}
+
+void MpvPlayer::removeFile(int index, quint64 tag) {
+    sendCommand(QVariantList{"playlist-remove", QString::number(index)});
+    for (auto it = m_loadRequests.begin(); it != m_loadRequests.end();) {
+        it = it.value() == tag ? m_loadRequests.erase(it) : std::next(it);
+    }
+    for (auto it = m_entryTags.begin(); it != m_entryTags.end();) {
+        it = it.value() == tag ? m_entryTags.erase(it) : std::next(it);
+    }
+}
+
+void MpvPlayer::moveFile(int from, int to) {
+    sendCommand(QVariantList{"playlist-move", QString::number(from), QString::number(to)});
+}
+
+void MpvPlayer::clearFiles() {
+    sendCommand(QVariantList{"stop"});
+    sendCommand(QVariantList{"playlist-clear"});
+    m_loadRequests.clear();
+    m_entryTags.clear();
+    m_unmatchedStart = 0;
 }
 
 void MpvPlayer::setProperty(const QString &name, const QVariant &value) {
@@ -76,13 +147,22 @@ void MpvPlayer::setProperty(const QString &name, const QVariant &value) {
     QByteArray nameUtf8 = name.toUtf8();
     if (value.metaType().id() == QMetaType::Double) {
         double val = value.toDouble();
-        mpv_set_property_async(m_mpv, 0, nameUtf8.constData(), MPV_FORMAT_DOUBLE, &val);
+        const quint64 request = trackRequest();
+        if (mpv_set_property_async(m_mpv, request, nameUtf8.constData(), MPV_FORMAT_DOUBLE, &val) < 0) {
+            m_requestSentNs.remove(request);
+        }
     } else if (value.metaType().id() == QMetaType::Int || value.metaType().id() == QMetaType::LongLong) {
         int64_t val = value.toLongLong();
-        mpv_set_property_async(m_mpv, 0, nameUtf8.constData(), MPV_FORMAT_INT64, &val);
+        const quint64 request = trackRequest();
+        if (mpv_set_property_async(m_mpv, request, nameUtf8.constData(), MPV_FORMAT_INT64, &val) < 0) {
+            m_requestSentNs.remove(request);
+        }
     } else if (value.metaType().id() == QMetaType::Bool) {
         int val = value.toBool() ? 1 : 0;
-        mpv_set_property_async(m_mpv, 0, nameUtf8.constData(), MPV_FORMAT_FLAG, &val);
+        const quint64 request = trackRequest();
+        if (mpv_set_property_async(m_mpv, request, nameUtf8.constData(), MPV_FORMAT_FLAG, &val) < 0) {
+            m_requestSentNs.remove(request);
+        }
     } else {
         QByteArray valUtf8 = value.toString().toUtf8();
         mpv_set_property_string(m_mpv, nameUtf8.constData(), valUtf8.constData());
@@ -99,21 +179,15 @@ QVariant MpvPlayer::getProperty(const QString &name) const {
     return QVariant();
 }
 
-qint64 MpvPlayer::position() const {
-    return getProperty("time-pos").toDouble() * 1000;
+void MpvPlayer::setPositionInterval(int ms) {
+    m_positionTimer.setInterval(qMax(0, ms));
 }
 
-qint64 MpvPlayer::duration() const {
-    return getProperty("duration").toDouble() * 1000;
-}
-
-bool MpvPlayer::isPaused() const {
-    if (!m_mpv) return true;
-    int paused = 0;
-    if (mpv_get_property(m_mpv, "pause", MPV_FORMAT_FLAG, &paused) < 0) {
-        return true;
-    }
-    return paused;
+void MpvPlayer::flushPosition() {
+    // Report now, then hold further reports for one interval.
+    m_positionDirty = false;
+    emit positionChanged(m_position);
+    if (m_positionTimer.interval() > 0) m_positionTimer.start();
 }
 
 double MpvPlayer::volume() const {
@@ -138,46 +212,100 @@ void MpvPlayer::setReplayGainPreamp(double db) {
 }
 
 void MpvPlayer::processEvents() {
-    if (!m_mpv) return;
-    
-    while (true) {
-        mpv_event *event = mpv_wait_event(m_mpv, 0);
-        if (event->event_id == MPV_EVENT_NONE) break;
-        
-        switch (event->event_id) {
-        case MPV_EVENT_PROPERTY_CHANGE: {
-            mpv_event_property *prop = (mpv_event_property *)event->data;
-            if (prop->format == MPV_FORMAT_NONE) break;
-            if (strcmp(prop->name, "time-pos") == 0) {
-                emit positionChanged(position());
-            } else if (strcmp(prop->name, "duration") == 0) {
-                emit durationChanged(duration());
-            } else if (strcmp(prop->name, "pause") == 0) {
-                emit playbackStateChanged();
-            } else if (strcmp(prop->name, "playlist-pos") == 0 && prop->format == MPV_FORMAT_INT64) {
-                int64_t pos = *(int64_t *)prop->data;
-                qDebug() << "[MPV] playlist-pos:" << pos;
-                emit playlistPosChanged((int)pos);
-            }
-            break;
+    if (!m_pump) return;
+    m_pump->drain([this](const MpvEvent &event) {
+        handleEvent(event);
+        m_dispatchLatency.add(MpvEventPump::nowNs() - event.receivedNs);
+    });
+}
+
+void MpvPlayer::handleEvent(const MpvEvent &event) {
+    switch (event.id) {
+    case MPV_EVENT_PROPERTY_CHANGE:
+        updateProperty(event);
+        break;
+    case MPV_EVENT_COMMAND_REPLY:
+    case MPV_EVENT_SET_PROPERTY_REPLY: {
+        const auto sent = m_requestSentNs.constFind(event.userdata);
+        if (sent != m_requestSentNs.constEnd()) {
+            m_replyLatency.add(MpvEventPump::nowNs() - sent.value());
+            m_requestSentNs.erase(sent);
         }
-        case MPV_EVENT_END_FILE: {
-            mpv_event_end_file *ef = (mpv_event_end_file *)event->data;
-            if (ef->reason == MPV_END_FILE_REASON_EOF) {
-                qDebug() << "[MPV] END_FILE (EOF)";
-                emit endOfFile();
-            } else if (ef->reason == MPV_END_FILE_REASON_ERROR) {
-                qWarning() << "MPV playback error:" << ef->error;
-            } else if (ef->reason == MPV_END_FILE_REASON_STOP) {
-                qDebug() << "[MPV] END_FILE (STOP)";
+        const auto load = m_loadRequests.constFind(event.userdata);
+        if (load != m_loadRequests.constEnd()) {
+            const quint64 tag = load.value();
+            m_loadRequests.erase(load);
+            if (event.error >= 0 && event.integer > 0) {
+                m_entryTags.insert(event.integer, tag);
+                if (m_unmatchedStart == event.integer) {
+                    m_unmatchedStart = 0;
+                    emit fileStarted(tag);
+                }
             }
-            break;
         }
-        case MPV_EVENT_PLAYBACK_RESTART:
-            emit playbackStateChanged();
-            break;
-        default:
-            break;
+        if (event.error < 0) {
+            qWarning() << "[MPV] request failed:" << mpv_error_string(event.error);
+        }
+        break;
+    }
+    case MPV_EVENT_START_FILE: {
+        const auto tag = m_entryTags.constFind(event.integer);
+        if (tag != m_entryTags.constEnd()) {
+            emit fileStarted(tag.value());
+        } else {
+            m_unmatchedStart = event.integer;
+        }
+        break;
+    }
+    case MPV_EVENT_END_FILE:
+        if (event.endReason == MPV_END_FILE_REASON_EOF) {
+            qDebug() << "[MPV] END_FILE (EOF)";
+            emit endOfFile();
+        } else if (event.endReason == MPV_END_FILE_REASON_ERROR) {
+            qWarning() << "MPV playback error:" << event.error;
+        } else if (event.endReason == MPV_END_FILE_REASON_STOP) {
+            qDebug() << "[MPV] END_FILE (STOP)";
         }
+        break;
+    case MPV_EVENT_PLAYBACK_RESTART:
+        // A seek or a new file: show where playback is without waiting.
+        flushPosition();
+        emit playbackStateChanged();
+        break;
+    default:
+        break;
+    }
+}
+
+void MpvPlayer::updateProperty(const MpvEvent &event) {
+    // MPV_FORMAT_NONE means unavailable, e.g. between files.
+    const bool available = event.format != MPV_FORMAT_NONE;
+    switch (event.userdata) {
+    case TimePosProperty: {
+        const qint64 position = available ? static_cast<qint64>(event.real * 1000) : 0;
+        if (position == m_position) break;
+        m_position = position;
+        if (m_positionTimer.isActive()) {
+            m_positionDirty = true;
+        } else {
+            flushPosition();
+        }
+        break;
+    }
+    case DurationProperty: {
+        const qint64 duration = available ? static_cast<qint64>(event.real * 1000) : 0;
+        if (duration == m_duration) break;
+        m_duration = duration;
+        emit durationChanged(m_duration);
+        break;
+    }
+    case PauseProperty:
+        if (!available) break;
+        m_paused = event.integer != 0;
+        if (m_positionDirty) flushPosition();
+        emit playbackStateChanged();
+        break;
+    default:
+        break;
     }
 }
@@ -1,8 +1,11 @@
 #pragma once
+#include <QHash>
 #include <QObject>
 #include <QTimer>
 #include <QVariant>
+#include <memory>
 #include <mpv/client.h>
+#include "MpvEventPump.h"
 
 class MpvPlayer : public QObject {
     Q_OBJECT
@@ -11,12 +14,24 @@ public:
     ~MpvPlayer();
 
     void command(const QVariant &args);
+    // Playlist entries carry a caller-chosen tag, reported back through
+    // fileStarted() whatever index the entry has by then. Indexes are
+    // those after every earlier call has been applied.
+    void appendFile(const QString &url, quint64 tag);
+    void removeFile(int index, quint64 tag);
+    void moveFile(int from, int to);
+    // Stops playback and empties the playlist.
+    void clearFiles();
     void setProperty(const QString &name, const QVariant &value);
     QVariant getProperty(const QString &name) const;
     
-    qint64 position() const;
-    qint64 duration() const;
-    bool isPaused() const;
+    // Last values mpv reported; no round trip to mpv.
+    qint64 position() const { return m_position; }
+    qint64 duration() const { return m_duration; }
+    bool isPaused() const { return m_paused; }
+    // Minimum time between positionChanged signals; 0 passes every change.
+    // Seeks and pause changes are always reported right away.
+    void setPositionInterval(int ms);
     double volume() const;
     void setVolume(double vol);
     void setReplayGainMode(const QString &mode);
@@ -27,12 +42,49 @@ signals:
     void durationChanged(qint64 dur);
     void playbackStateChanged();
     void endOfFile();
-    void playlistPosChanged(int pos);
+    void fileStarted(quint64 tag);
 
 private slots:
     void processEvents();
 
 private:
+    // reply_userdata of the observed properties.
+    enum ObservedProperty : quint64 {
+        TimePosProperty = 1,
+        DurationProperty,
+        PauseProperty
+    };
+
+    struct Latency {
+        qint64 count = 0;
+        qint64 totalNs = 0;
+        qint64 maxNs = 0;
+        void add(qint64 ns);
+    };
+
+    void handleEvent(const MpvEvent &event);
+    void updateProperty(const MpvEvent &event);
+    void flushPosition();
+    quint64 trackRequest();
+    quint64 sendCommand(const QVariantList &args);
+
     mpv_handle *m_mpv = nullptr;
-    QTimer *m_eventTimer = nullptr;
+    std::unique_ptr<MpvEventPump> m_pump;
+
+    qint64 m_position = 0;
+    qint64 m_duration = 0;
+    bool m_paused = true;
+    QTimer m_positionTimer;
+    bool m_positionDirty = false;
+
+    QHash<quint64, quint64> m_loadRequests;  // loadfile request -> tag
+    QHash<qint64, quint64> m_entryTags;      // mpv playlist entry id -> tag
+    qint64 m_unmatchedStart = 0;             // started before its loadfile reply
+
+    // Command or property write sent -> its reply handled here, and event
+    // taken from mpv -> handled here. Logged on shutdown.
+    QHash<quint64, qint64> m_requestSentNs;
+    quint64 m_nextRequest = 0;
+    Latency m_replyLatency;
+    Latency m_dispatchLatency;
 };
@@ -0,0 +1,195 @@
+#include "PlaybackQueue.h"
+#include <QHash>
+#include <QRandomGenerator>
+#include <algorithm>
+
+namespace {
+// Counts over 0..size-1 with O(log n) updates and prefix sums.
+class Fenwick {
+public:
+    explicit Fenwick(int size) : m_tree(size + 1, 0) {}
+    void add(int index, int delta) {
+        for (++index; index < int(m_tree.size()); index += index & -index) m_tree[index] += delta;
+    }
+    // Sum over [0, index).
+    int before(int index) const {
+        int sum = 0;
+        for (; index > 0; index -= index & -index) sum += m_tree[index];
+        return sum;
+    }
+private:
+    std::vector<int> m_tree;
+};
+}
+
+int PlaybackQueue::indexOf(const QString &id) const {
+    int first = -1;
+    for (auto it = m_byId.constFind(id); it != m_byId.constEnd() && it.key() == id; ++it) {
+        const int position = positionOf(it.value());
+        if (first < 0 || position < first) first = position;
+    }
+    return first;
+}
+
+PlaybackQueue::Handle PlaybackQueue::allocate(const TrackEntry &track) {
+    Handle handle;
+    if (!m_free.empty()) {
+        handle = m_free.back();
+        m_free.pop_back();
+    } else {
+        handle = static_cast<Handle>(m_slots.size());
+        m_slots.emplace_back();
+    }
+    Slot &slot = m_slots[handle];
+    slot.track = track;
+    m_byId.insert(track.id, handle);
+    return handle;
+}
+
+void PlaybackQueue::renumber(int from) {
+    for (int i = from; i < m_order.size(); ++i) {
+        m_slots[m_order.at(i)].position = i;
+    }
+}
+
+void PlaybackQueue::renumberShuffle(int from) {
+    for (int i = from; i < m_shuffle.size(); ++i) {
+        m_slots[m_shuffle.at(i)].shufflePosition = i;
+    }
+}
+
+void PlaybackQueue::swapShuffle(int a, int b) {
+    if (a == b) return;
+    m_shuffle.swapItemsAt(a, b);
+    m_slots[m_shuffle.at(a)].shufflePosition = a;
+    m_slots[m_shuffle.at(b)].shufflePosition = b;
+}
+
+void PlaybackQueue::append(const TrackList &tracks, int shuffleFrom) {
+    m_order.reserve(m_order.size() + tracks.size());
+    m_shuffle.reserve(m_order.size() + tracks.size());
+    for (const TrackEntry &track : tracks) {
+        const Handle handle = allocate(track);
+        m_slots[handle].position = m_order.size();
+        m_order.append(handle);
+        // Inside-out Fisher-Yates over [shuffleFrom, end].
+        const int last = m_shuffle.size();
+        m_slots[handle].shufflePosition = last;
+        m_shuffle.append(handle);
+        const int from = qBound(0, shuffleFrom, last);
+        swapShuffle(last, from + static_cast<int>(QRandomGenerator::global()->bounded(last - from + 1)));
+    }
+}
+
+void PlaybackQueue::removeAt(int position) {
+    const Handle handle = handleAt(position);
+    Slot &slot = m_slots[handle];
+    const int queued = slot.position;
+    const int shuffled = slot.shufflePosition;
+    m_order.removeAt(queued);
+    m_shuffle.removeAt(shuffled);
+    m_byId.remove(slot.track.id, handle);
+    slot = Slot();
+    m_free.push_back(handle);
+    renumber(queued);
+    renumberShuffle(shuffled);
+}
+
+void PlaybackQueue::clear() {
+    m_slots.clear();
+    m_free.clear();
+    m_order.clear();
+    m_shuffle.clear();
+    m_byId.clear();
+}
+
+void PlaybackQueue::setShuffled(bool shuffled, Handle front) {
+    m_shuffled = shuffled;
+    if (shuffled && front != InvalidHandle) {
+        swapShuffle(0, m_slots[front].shufflePosition);
+    }
+}
+
+QList<PlaybackQueue::Move> PlaybackQueue::minimalMoves(const QList<Handle> &from, const QList<Handle> &to) {
+    Q_ASSERT(from.size() == to.size());
+    const int n = from.size();
+    QHash<Handle, int> target;
+    target.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        target.insert(to.at(i), i);
+    }
+
+    // Longest increasing run of target positions, in from's order
+    // (patience sorting, O(n log n)).
+    std::vector<int> tails;        // index into from of the smallest tail per length
+    std::vector<int> previous(n, -1);
+    for (int i = 0; i < n; ++i) {
+        const int value = target.value(from.at(i));
+        const auto it = std::lower_bound(tails.begin(), tails.end(), value, [&](int index, int v) {
+            return target.value(from.at(index)) < v;
+        });
+        if (it != tails.begin()) previous[i] = *(it - 1);
+        if (it == tails.end()) {
+            tails.push_back(i);
+        } else {
+            *it = i;
+        }
+    }
+    std::vector<bool> stays(n, false);
+    for (int i = tails.empty() ? -1 : tails.back(); i >= 0; i = previous[i]) {
+        stays[i] = true;
+    }
+
+    // Every other entry goes right after its predecessor in to, in order;
+    // the entries that stay are already in the right relative order. The
+    // list is never simulated: each entry gets a key that orders it among
+    // all the others at every step. Those not yet moved keep their place
+    // in from, (i + 1, 0); a moved one is keyed right behind its
+    // predecessor, so entries moved in a row form a chain (b, 1), (b, 2)...
+    // behind the entry that started it, or behind the front for b = 0.
+    QHash<Handle, int> source;
+    source.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        source.insert(from.at(i), i);
+    }
+    std::vector<std::pair<int, int>> key(n);   // by position in to
+    std::vector<int> chain(n + 1, 0);          // longest chain behind each b
+    for (int t = 0; t < n; ++t) {
+        const int i = source.value(to.at(t));
+        if (stays[i]) {
+            key[t] = {i + 1, 0};
+            continue;
+        }
+        const auto behind = t == 0 ? std::pair<int, int>{0, 0} : key[t - 1];
+        key[t] = {behind.first, behind.second + 1};
+        chain[behind.first] = std::max(chain[behind.first], key[t].second);
+    }
+    std::vector<int> start(n + 2, 0);
+    for (int b = 0; b <= n; ++b) {
+        start[b + 1] = start[b] + (b > 0 ? 1 : 0) + chain[b];
+    }
+    const auto rank = [&](std::pair<int, int> k) { return start[k.first] + k.second - (k.first == 0 ? 1 : 0); };
+
+    // Live entries per key rank; a position is the number of live keys
+    // before it.
+    Fenwick live(start[n + 1]);
+    for (int i = 0; i < n; ++i) {
+        live.add(rank({i + 1, 0}), 1);
+    }
+    QList<Move> moves;
+    for (int t = 0; t < n; ++t) {
+        const int i = source.value(to.at(t));
+        if (stays[i]) continue;
+        const int original = rank({i + 1, 0});
+        const int index = live.before(original);
+        const int predecessor = t == 0 ? -1 : live.before(rank(key[t - 1]));
+        // Final index once it has been taken out of the list.
+        const int place = predecessor < index ? predecessor + 1 : predecessor;
+        if (place != index) {
+            moves.append(Move{index, index < place ? place + 1 : place});
+        }
+        live.add(original, -1);
+        live.add(rank(key[t]), 1);
+    }
+    return moves;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <QList>
+#include <QMultiHash>
+#include <QString>
+#include <vector>
+#include "../core/LibraryTypes.h"
+
+// The play queue. Each entry gets a handle that stays valid while the
+// entry is queued, however the queue is reordered, so the player can
+// refer to "this track" instead of "position 12". Positions and handles
+// convert both ways in O(1), and a track id finds its position through a
+// hash instead of a scan. Tracks are kept as plain TrackEntry records;
+// boxing them into QVariantMaps is left to the QML-facing code.
+//
+// Entries are stored in the order they were queued. Shuffle is a second
+// order over the same handles, drawn as tracks are queued and kept up to
+// date as they come and go, so toggling shuffle only switches which order
+// positions refer to. The trade-off: turning shuffle off and on again
+// within one queue brings back the same shuffled order (bar the current
+// track moving first) instead of drawing a new one; a new queue gets a
+// new order.
+class PlaybackQueue {
+public:
+    using Handle = int;
+    static constexpr Handle InvalidHandle = -1;
+
+    // One mpv playlist-move: the entry at from takes the place of the entry
+    // at to, or goes last when to is the list size.
+    struct Move {
+        int from;
+        int to;
+    };
+
+    int size() const { return m_order.size(); }
+    bool isEmpty() const { return m_order.isEmpty(); }
+    bool isShuffled() const { return m_shuffled; }
+    // Play order: the shuffled one while shuffle is on.
+    const QList<Handle> &order() const { return m_shuffled ? m_shuffle : m_order; }
+
+    Handle handleAt(int position) const { return order().at(position); }
+    int positionOf(Handle handle) const {
+        return m_shuffled ? m_slots[handle].shufflePosition : m_slots[handle].position;
+    }
+    const TrackEntry &track(Handle handle) const { return m_slots[handle].track; }
+    const QString &id(Handle handle) const { return m_slots[handle].track.id; }
+    const TrackEntry &trackAt(int position) const { return track(handleAt(position)); }
+    // First position holding the track, or -1.
+    int indexOf(const QString &id) const;
+
+    // New tracks go last in queued order and to random places at or after
+    // shuffleFrom in the shuffled order, so tracks already played in
+    // shuffle stay behind.
+    void append(const TrackList &tracks, int shuffleFrom = 0);
+    void removeAt(int position);
+    void clear();
+    // O(1) either way. Turning shuffle on puts front at the start of the
+    // shuffled order, so everything else is still ahead of it.
+    void setShuffled(bool shuffled, Handle front = InvalidHandle);
+
+    // Fewest moves turning from into to (the same handles, reordered):
+    // everything on a longest increasing subsequence stays put.
+    static QList<Move> minimalMoves(const QList<Handle> &from, const QList<Handle> &to);
+
+private:
+    struct Slot {
+        TrackEntry track;
+        int position = -1;  // in queued order; -1 while free
+        int shufflePosition = -1;
+    };
+
+    Handle allocate(const TrackEntry &track);
+    void renumber(int from);
+    void renumberShuffle(int from);
+    void swapShuffle(int a, int b);
+
+    std::vector<Slot> m_slots;  // by handle
+    std::vector<Handle> m_free;
+    QList<Handle> m_order;
+    QList<Handle> m_shuffle;
+    bool m_shuffled = false;
+    QMultiHash<QString, Handle> m_byId;
+};
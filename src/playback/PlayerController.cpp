@@ -2,24 +2,35 @@
 #include "../core/SubsonicClient.h"
 #include "../discord/DiscordRPC.h"
 #include "MediaControls.h"
+#include "QueueModel.h"
+#include "StreamProxy.h"
 #include <QDebug>
+#include <QGuiApplication>
+#include <QLoggingCategory>
+#include <QScreen>
 #include <QtMath>
-#include <QRandomGenerator>
+#include <QSet>
 #include <QVector>
 
 namespace {
-QString trackIdFromVariant(const QVariant &variant)
-{
-    return variant.toMap().value(QStringLiteral("id")).toString();
-}
+// Tracks kept in mpv's playlist around the current one. Enough ahead for
+// gapless playback and prefetch-playlist, a few behind for previous().
+constexpr int WINDOW_AHEAD = 3;
+constexpr int WINDOW_BEHIND = 2;
 }
 
+// Playlist window bookkeeping; enable with
+// QT_LOGGING_RULES="shibamusic.player.window.debug=true".
+Q_LOGGING_CATEGORY(lcPlayerWindow, "shibamusic.player.window", QtInfoMsg)
+
 PlayerController::PlayerController(SubsonicClient *api, DiscordRPC *discord, QObject *parent)
     : QObject(parent), m_api(api), m_mpv(new MpvPlayer(this)), m_discord(discord), m_mediaControls(nullptr)
 {
     Q_ASSERT(m_discord);
     
     m_mediaControls = new MediaControls(this, this);
+    m_queueModel = new QueueModel(&m_queue, this);
+    m_proxy = new StreamProxy(m_api, this);
     
     connect(m_mpv, &MpvPlayer::positionChanged, this, &PlayerController::positionChanged);
     connect(m_mpv, &MpvPlayer::durationChanged, this, [this](qint64) {
@@ -33,17 +44,26 @@ PlayerController::PlayerController(SubsonicClient *api, DiscordRPC *discord, QOb
         }
         updateDiscordPresence();
     });
-    connect(m_mpv, &MpvPlayer::endOfFile, this, &PlayerController::onEndOfFile);
-    connect(m_mpv, &MpvPlayer::playlistPosChanged, this, &PlayerController::onPlaylistPosChanged);
+    connect(m_mpv, &MpvPlayer::fileStarted, this, &PlayerController::onFileStarted);
     
     QSettings settings;
     m_volume = settings.value("player/volume", 1.0).toDouble();
     m_replayGainEnabled = settings.value("player/replayGainEnabled", true).toBool();
     m_replayGainMode = settings.value("player/replayGainMode", 1).toInt();
     m_shuffleEnabled = settings.value("player/shuffleEnabled", false).toBool();
+    m_queue.setShuffled(m_shuffleEnabled);
     const int storedRepeat = settings.value("player/repeatMode", static_cast<int>(RepeatOff)).toInt();
     m_repeatMode = RepeatOff;
     setRepeatMode(storedRepeat);
+
+    // Position updates at most once per frame of the primary screen, and
+    // once a second while the window is not shown; both can be overridden.
+    const QScreen *screen = QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60.0;
+    m_visiblePositionInterval = settings.value("player/positionUpdateInterval",
+                                               qRound(1000.0 / refreshRate)).toInt();
+    m_hiddenPositionInterval = settings.value("player/hiddenPositionUpdateInterval", 1000).toInt();
+    updatePositionInterval();
     
     // Initialize ReplayGain in MPV
     if (m_replayGainEnabled) {
@@ -57,99 +77,226 @@ PlayerController::PlayerController(SubsonicClient *api, DiscordRPC *discord, QOb
 }
 
 void PlayerController::playAlbum(const QVariantList& tracks, int index) {
+    playTracks(TrackListModel::fromVariantList(tracks), index);
+}
+
+void PlayerController::playTracks(const TrackList& tracks, int index) {
     if (tracks.isEmpty() || index < 0 || index >= tracks.size()) {
         return;
     }
-    m_queue = tracks;
-    m_originalQueue = m_queue;
-    if (m_shuffleEnabled && m_queue.size() > 1) {
-        m_index = index;
-        m_current = m_queue[m_index].toMap();
-        applyShuffleOrder();
-        return;
-    }
-    emit queueChanged();
-    m_index = index;
-    m_current = tracks.at(index).toMap();
+    m_queueModel->beginReset();
+    m_queue.clear();
+    m_queue.append(tracks);
+    // index is in the order given; with shuffle on, that track goes first.
+    m_queue.setShuffled(false);
+    const Handle current = m_queue.handleAt(index);
+    m_queue.setShuffled(m_shuffleEnabled, current);
+    m_queueModel->endReset();
+    notifyQueueChanged();
+
+    m_index = m_queue.positionOf(current);
+    setCurrent(m_queue.track(current));
+    // Nothing of the old queue is kept in mpv.
+    m_window.clear();
+    m_windowPos = -1;
     emit currentTrackChanged();
     if (m_mediaControls) {
-        m_mediaControls->updateMetadata(m_current);
+        m_mediaControls->updateMetadata(m_currentVariant);
     }
     rebuildPlaylist();
     updateDiscordPresence();
 }
 
 void PlayerController::addToQueue(const QVariantMap& track) {
-    m_queue.push_back(track);
-    if (m_shuffleEnabled) {
-        m_originalQueue.push_back(track);
-        if (m_queue.size() > 1) {
-            if (!m_current.isEmpty()) {
-                const QString currentId = m_current.value("id").toString();
-                for (int i = 0; i < m_queue.size(); ++i) {
-                    if (m_queue[i].toMap().value("id").toString() == currentId) {
-                        m_index = i;
-                        break;
-                    }
-                }
-            }
-            applyShuffleOrder();
-            return;
-        }
+    appendToQueue(QVariantList{track});
+}
+
+void PlayerController::appendToQueue(const QVariantList& list) {
+    const TrackList tracks = TrackListModel::fromVariantList(list);
+    if (tracks.isEmpty()) {
+        return;
+    }
+    if (m_queue.isShuffled()) {
+        // New tracks are mixed into what has not been played yet, which
+        // moves some rows; cheaper to reset than to describe.
+        m_queueModel->beginReset();
+        m_queue.append(tracks, m_index + 1);
+        m_queueModel->endReset();
     } else {
-        m_originalQueue = m_queue;
+        m_queueModel->beginAppend(tracks.size());
+        m_queue.append(tracks);
+        m_queueModel->endAppend();
     }
-    emit queueChanged();
+    notifyQueueChanged();
     if (m_index < 0) {
         m_index = 0;
-        m_current = track;
+        setCurrent(m_queue.trackAt(m_index));
         emit currentTrackChanged();
         rebuildPlaylist();
     } else {
-        const auto id = track.value("id").toString();
-        const QString url = m_api->streamUrl(id).toString();
-        m_mpv->command(QVariantList{"loadfile", url, "append"});
+        syncWindow();
     }
 }
 
 void PlayerController::rebuildPlaylist() {
-    m_lastPlaylistPos = -1;
-    m_mpv->command(QVariantList{"stop"});
-    m_mpv->command(QVariantList{"playlist-clear"});
-    
-    for (int i = 0; i < m_queue.size(); ++i) {
-        const auto track = m_queue[i].toMap();
-        const auto id = track.value("id").toString();
-        const QString url = m_api->streamUrl(id).toString();
-        m_mpv->command(QVariantList{"loadfile", url, "append"});
-    }
-    
     if (m_index >= 0 && m_index < m_queue.size()) {
-        m_mpv->setProperty("playlist-pos", m_index);
-        m_mpv->setProperty("pause", false);
+        loadWindow();
         updateVolume();
         
-        m_api->addToRecentlyPlayed(m_current);
-        const auto id = m_current.value("id").toString();
+        m_api->addToRecentlyPlayed(m_currentVariant);
+        const auto id = m_current.id;
         m_api->scrobble(id, true, 0);
+    } else {
+        m_mpv->clearFiles();
+        m_window.clear();
+        m_windowPos = -1;
     }
 }
 
+// Starts m_index from scratch: the current track and the ones after it,
+// independent of the queue length.
+void PlayerController::loadWindow() {
+    m_mpv->clearFiles();
+    m_window.clear();
+    m_windowPos = -1;
+    const Handle current = m_queue.handleAt(m_index);
+    for (const Handle handle : windowHandles()) {
+        if (handle == current) m_windowPos = m_window.size();
+        appendWindowEntry(handle);
+    }
+    updateWindowLoop();
+    m_mpv->setProperty("playlist-pos", m_windowPos);
+    m_mpv->setProperty("pause", false);
+    updateReadAhead();
+}
+
+// Brings mpv's playlist in line with windowHandles() after the queue
+// changed or playback moved: unwanted entries are removed, missing ones
+// appended, and the result put in order with as few moves as possible.
+// The entry at m_windowPos is the current track and is never reloaded.
+void PlayerController::syncWindow() {
+    if (m_windowPos < 0 || m_windowPos >= m_window.size() || m_index < 0 || m_index >= m_queue.size()) {
+        return;
+    }
+    const Handle current = m_queue.handleAt(m_index);
+    m_window[m_windowPos].handle = current;
+
+    const QList<Handle> wanted = windowHandles();
+    const QSet<Handle> wantedSet(wanted.cbegin(), wanted.cend());
+    for (int i = m_window.size() - 1; i >= 0; --i) {
+        if (i != m_windowPos && !wantedSet.contains(m_window.at(i).handle)) {
+            removeWindowEntry(i);
+        }
+    }
+    QSet<Handle> present;
+    for (const WindowEntry &entry : std::as_const(m_window)) {
+        present.insert(entry.handle);
+    }
+    for (const Handle handle : wanted) {
+        if (!present.contains(handle)) appendWindowEntry(handle);
+    }
+
+    QList<Handle> have;
+    have.reserve(m_window.size());
+    for (const WindowEntry &entry : std::as_const(m_window)) {
+        have.append(entry.handle);
+    }
+    // Sent back to back, so mpv applies them before any later command.
+    for (const PlaybackQueue::Move &move : PlaybackQueue::minimalMoves(have, wanted)) {
+        m_mpv->moveFile(move.from, move.to);
+        const WindowEntry entry = m_window.takeAt(move.from);
+        m_window.insert(move.to > move.from ? move.to - 1 : move.to, entry);
+    }
+    m_windowPos = windowIndexOf(current);
+    updateWindowLoop();
+    updateReadAhead();
+}
+
+// The current track with the ones before and after it, in queue order. A
+// queue that fits is held whole, so mpv can loop it for repeat-all.
+QList<PlayerController::Handle> PlayerController::windowHandles() const {
+    if (m_queue.size() <= WINDOW_BEHIND + 1 + WINDOW_AHEAD) {
+        return m_queue.order();
+    }
+    QList<Handle> handles;
+    for (int p = qMax(0, m_index - WINDOW_BEHIND); p <= m_index; ++p) {
+        handles.append(m_queue.handleAt(p));
+    }
+    int p = m_index;
+    for (int i = 0; i < WINDOW_AHEAD; ++i) {
+        p = nextQueueIndex(p);
+        if (p < 0) break;
+        handles.append(m_queue.handleAt(p));
+    }
+    return handles;
+}
+
+void PlayerController::updateWindowLoop() {
+    const bool loop = m_repeatMode == RepeatAll && m_window.size() == m_queue.size();
+    if (loop == m_windowLoops) return;
+    m_windowLoops = loop;
+    m_mpv->setProperty("loop-playlist", loop ? "inf" : "no");
+}
+
+// The current track and the next few, for the proxy to have on disk
+// before mpv asks for them.
+void PlayerController::updateReadAhead() {
+    QStringList ids;
+    for (int i = 0, p = m_index; i <= m_proxy->readAhead() && p >= 0 && p < m_queue.size(); ++i) {
+        ids.append(m_queue.id(m_queue.handleAt(p)));
+        p = nextQueueIndex(p);
+        if (p == m_index) break;
+    }
+    m_proxy->prefetch(ids);
+}
+
+void PlayerController::appendWindowEntry(Handle handle) {
+    const quint64 tag = ++m_nextWindowTag;
+    m_mpv->appendFile(m_proxy->streamUrl(m_queue.id(handle)).toString(), tag);
+    m_window.append(WindowEntry{tag, handle});
+}
+
+void PlayerController::removeWindowEntry(int windowIndex) {
+    m_mpv->removeFile(windowIndex, m_window.at(windowIndex).tag);
+    m_window.removeAt(windowIndex);
+    if (windowIndex < m_windowPos) --m_windowPos;
+}
+
+int PlayerController::windowIndexOf(Handle handle) const {
+    for (int i = 0; i < m_window.size(); ++i) {
+        if (m_window.at(i).handle == handle) return i;
+    }
+    return -1;
+}
+
+int PlayerController::nextQueueIndex(int index) const {
+    if (index + 1 < m_queue.size()) return index + 1;
+    // Repeat-all wraps here when the queue is longer than the window;
+    // loop-playlist would only loop the window.
+    return (m_repeatMode == RepeatAll && !m_queue.isEmpty()) ? 0 : -1;
+}
+
 void PlayerController::next() {
     if (m_index + 1 < m_queue.size()) {
-        const auto id = m_current.value("id").toString();
+        const auto id = m_current.id;
         if (!id.isEmpty()) m_api->scrobble(id, true, m_mpv->position());
         
         m_index++;
-        m_current = m_queue[m_index].toMap();
+        setCurrent(m_queue.trackAt(m_index));
         emit currentTrackChanged();
         if (m_mediaControls) {
-            m_mediaControls->updateMetadata(m_current);
+            m_mediaControls->updateMetadata(m_currentVariant);
+        }
+        if (m_windowPos + 1 < m_window.size() && m_window[m_windowPos + 1].handle == m_queue.handleAt(m_index)) {
+            ++m_windowPos;
+            m_mpv->command(QVariantList{"playlist-next"});
+            syncWindow();
+        } else {
+            loadWindow();
         }
-        m_mpv->command(QVariantList{"playlist-next"});
         
-        m_api->addToRecentlyPlayed(m_current);
-        m_api->scrobble(m_current.value("id").toString(), true, 0);
+        m_api->addToRecentlyPlayed(m_currentVariant);
+        m_api->scrobble(m_current.id, true, 0);
     }
 }
 
@@ -160,25 +307,43 @@ void PlayerController::previous() {
     }
     if (m_index > 0) {
         m_index--;
-        m_current = m_queue[m_index].toMap();
+        setCurrent(m_queue.trackAt(m_index));
         emit currentTrackChanged();
         if (m_mediaControls) {
-            m_mediaControls->updateMetadata(m_current);
+            m_mediaControls->updateMetadata(m_currentVariant);
+        }
+        if (m_windowPos > 0 && m_window[m_windowPos - 1].handle == m_queue.handleAt(m_index)) {
+            --m_windowPos;
+            m_mpv->command(QVariantList{"playlist-prev"});
+            syncWindow();
+        } else {
+            loadWindow();
         }
-        m_mpv->command(QVariantList{"playlist-prev"});
         
-        m_api->addToRecentlyPlayed(m_current);
-        m_api->scrobble(m_current.value("id").toString(), true, 0);
+        m_api->addToRecentlyPlayed(m_currentVariant);
+        m_api->scrobble(m_current.id, true, 0);
     }
 }
 
 void PlayerController::toggle() {
     if (m_queue.isEmpty() || m_index < 0) return;
-    bool paused = m_mpv->isPaused();
-    m_mpv->setProperty("pause", !paused);
+    // Cycled in mpv, so a second toggle before the first is reported
+    // still flips it back.
+    m_mpv->command(QVariantList{"cycle", "pause"});
     updateDiscordPresence();
 }
 
+void PlayerController::setWindowVisible(bool visible) {
+    if (m_windowVisible == visible) return;
+    m_windowVisible = visible;
+    updatePositionInterval();
+    emit windowVisibleChanged();
+}
+
+void PlayerController::updatePositionInterval() {
+    m_mpv->setPositionInterval(m_windowVisible ? m_visiblePositionInterval : m_hiddenPositionInterval);
+}
+
 void PlayerController::seek(qint64 ms) {
     m_mpv->setProperty("time-pos", ms / 1000.0);
 }
@@ -186,38 +351,44 @@ void PlayerController::seek(qint64 ms) {
 void PlayerController::playFromQueue(int index) {
     if (index < 0 || index >= m_queue.size()) return;
     m_index = index;
-    m_current = m_queue[m_index].toMap();
+    setCurrent(m_queue.trackAt(m_index));
     emit currentTrackChanged();
-    m_mpv->setProperty("playlist-pos", index);
+    const int windowIndex = windowIndexOf(m_queue.handleAt(index));
+    if (windowIndex >= 0) {
+        m_windowPos = windowIndex;
+        m_mpv->setProperty("playlist-pos", windowIndex);
+        syncWindow();
+    } else {
+        loadWindow();
+    }
     
-    m_api->addToRecentlyPlayed(m_current);
-    m_api->scrobble(m_current.value("id").toString(), true, 0);
+    m_api->addToRecentlyPlayed(m_currentVariant);
+    m_api->scrobble(m_current.id, true, 0);
 }
 
 void PlayerController::removeFromQueue(int index) {
     if (index < 0 || index >= m_queue.size()) return;
 
-    const QString removedId = m_queue[index].toMap().value("id").toString();
+    const Handle removed = m_queue.handleAt(index);
     const bool wasCurrent = (index == m_index);
     const bool beforeCurrent = (index < m_index);
-    m_queue.removeAt(index);
-    if (!removedId.isEmpty()) {
-        for (int i = 0; i < m_originalQueue.size(); ++i) {
-            if (m_originalQueue[i].toMap().value("id").toString() == removedId) {
-                m_originalQueue.removeAt(i);
-                break;
-            }
-        }
-    }
-    if (!m_shuffleEnabled) {
-        m_originalQueue = m_queue;
+    // Out of mpv before the handle can be reused.
+    const int windowIndex = windowIndexOf(removed);
+    if (windowIndex >= 0 && windowIndex != m_windowPos) {
+        removeWindowEntry(windowIndex);
     }
-    emit queueChanged();
+    m_queueModel->beginRemove(index);
+    m_queue.removeAt(index);
+    m_queueModel->endRemove();
+    notifyQueueChanged();
 
     if (m_queue.isEmpty()) {
         m_index = -1;
-        m_current.clear();
-        m_mpv->command(QVariantList{"stop"});
+        setCurrent({});
+        m_mpv->clearFiles();
+        m_window.clear();
+        m_windowPos = -1;
+        updateReadAhead();
         emit currentTrackChanged();
         emit playingChanged();
         return;
@@ -228,24 +399,31 @@ void PlayerController::removeFromQueue(int index) {
     } else if (wasCurrent) {
         if (m_index >= m_queue.size())
             m_index = m_queue.size() - 1;
-        m_current = m_queue[m_index].toMap();
+        setCurrent(m_queue.trackAt(m_index));
         emit currentTrackChanged();
+        rebuildPlaylist();
+        return;
     }
-    
-    rebuildPlaylist();
+
+    // The current track keeps playing; only the tracks around it change.
+    syncWindow();
 }
 
 void PlayerController::clearQueue() {
     if (m_queue.isEmpty()) return;
+    m_queueModel->beginReset();
     m_queue.clear();
-    m_originalQueue.clear();
+    m_queueModel->endReset();
     m_index = -1;
-    m_current.clear();
-    m_mpv->command(QVariantList{"stop"});
+    setCurrent({});
+    m_mpv->clearFiles();
+    m_window.clear();
+    m_windowPos = -1;
+    updateReadAhead();
     if (m_mediaControls) {
         m_mediaControls->updatePlaybackState(false);
     }
-    emit queueChanged();
+    notifyQueueChanged();
     emit currentTrackChanged();
     emit playingChanged();
     m_discord->clearPresence();
@@ -253,14 +431,14 @@ void PlayerController::clearQueue() {
 
 void PlayerController::playCurrentTracks(int index)
 {
-    const QVariantList currentTracks = m_api->tracks();
+    const TrackList currentTracks = m_api->tracksModel()->entries();
     if (currentTracks.isEmpty()) {
         return;
     }
     if (index < 0 || index >= currentTracks.size()) {
         index = 0;
     }
-    playAlbum(currentTracks, index);
+    playTracks(currentTracks, index);
 }
 
 void PlayerController::playTrack(const QVariantMap &track, int indexHint)
@@ -270,9 +448,7 @@ void PlayerController::playTrack(const QVariantMap &track, int indexHint)
         return;
     }
 
-    QVariantList singleTrackList;
-    singleTrackList.append(track);
-    playAlbum(singleTrackList, 0);
+    playTracks(TrackList{TrackListModel::fromVariant(track)}, 0);
 }
 
 void PlayerController::toggleShuffle() {
@@ -345,27 +521,17 @@ void PlayerController::setShuffleEnabled(bool enabled) {
     QSettings settings;
     settings.setValue("player/shuffleEnabled", m_shuffleEnabled);
 
-    if (m_shuffleEnabled) {
-        if (m_originalQueue.isEmpty()) {
-            m_originalQueue = m_queue;
-        }
-        applyShuffleOrder();
-    } else {
-        if (!m_originalQueue.isEmpty() && !m_queue.isEmpty()) {
-            const QString currentId = m_current.value("id").toString();
-            const QVariantList targetOrder = m_originalQueue;
-            int targetIndex = 0;
-            if (!currentId.isEmpty()) {
-                for (int i = 0; i < targetOrder.size(); ++i) {
-                    if (targetOrder[i].toMap().value("id").toString() == currentId) {
-                        targetIndex = i;
-                        break;
-                    }
-                }
-            }
-            applyQueueOrder(targetOrder, targetIndex);
-        }
-        m_originalQueue = m_queue;
+    // Only the order positions refer to changes; the current track keeps
+    // playing and mpv's window is adjusted around it.
+    const Handle current = (m_index >= 0 && m_index < m_queue.size()) ? m_queue.handleAt(m_index)
+                                                                      : PlaybackQueue::InvalidHandle;
+    m_queueModel->beginReset();
+    m_queue.setShuffled(enabled, current);
+    m_queueModel->endReset();
+    notifyQueueChanged();
+    if (current != PlaybackQueue::InvalidHandle) {
+        m_index = m_queue.positionOf(current);
+        syncWindow();
     }
 
     emit shuffleEnabledChanged();
@@ -377,14 +543,16 @@ void PlayerController::setRepeatMode(int mode) {
     m_repeatMode = clamped;
 
     if (m_mpv) {
+        m_windowLoops = false;
         switch (m_repeatMode) {
         case RepeatOff:
             m_mpv->setProperty("loop-file", "no");
             m_mpv->setProperty("loop-playlist", "no");
             break;
         case RepeatAll:
+            // Looped by mpv or wrapped in windowHandles(); see updateWindowLoop().
             m_mpv->setProperty("loop-file", "no");
-            m_mpv->setProperty("loop-playlist", "inf");
+            m_mpv->setProperty("loop-playlist", "no");
             break;
         case RepeatOne:
             m_mpv->setProperty("loop-playlist", "no");
@@ -393,6 +561,7 @@ void PlayerController::setRepeatMode(int mode) {
         }
     }
 
+    syncWindow();
     if (changed) {
         QSettings settings;
         settings.setValue("player/repeatMode", m_repeatMode);
@@ -411,156 +580,79 @@ void PlayerController::updateVolume() {
     m_mpv->setVolume(m_volume * 100.0);
 }
 
-void PlayerController::onPlaylistPosChanged(int pos) {
-    qDebug() << "[CTRL] onPlaylistPosChanged:" << pos << "current m_index:" << m_index;
-    if (pos == -1) {
-        qDebug() << "[CTRL] Playlist ended";
-        return;
+// mpv moves on by itself at the end of a file; the tag of the entry it
+// starts tells which queued track is now playing, so nothing needs to
+// happen on end-of-file.
+void PlayerController::onFileStarted(quint64 tag) {
+    int windowIndex = -1;
+    for (int i = 0; i < m_window.size(); ++i) {
+        if (m_window.at(i).tag == tag) {
+            windowIndex = i;
+            break;
+        }
     }
-    
-    if (pos < 0 || pos >= m_queue.size()) {
-        qDebug() << "[CTRL] Invalid pos, ignoring";
+    if (windowIndex < 0) {
+        qCDebug(lcPlayerWindow) << "Started an entry no longer in the window, ignoring";
         return;
     }
+    m_windowPos = windowIndex;
+    const int pos = m_queue.positionOf(m_window.at(windowIndex).handle);
     if (pos == m_index) {
-        qDebug() << "[CTRL] Same pos, ignoring";
+        syncWindow();
         return;
     }
     
-    const auto oldId = m_current.value("id").toString();
+    const auto oldId = m_current.id;
     if (!oldId.isEmpty() && m_index >= 0) {
         m_api->scrobble(oldId, true, 0);
     }
     
     qDebug() << "[CTRL] Changing track from" << m_index << "to" << pos;
     m_index = pos;
-    m_current = m_queue[m_index].toMap();
+    setCurrent(m_queue.trackAt(m_index));
     emit currentTrackChanged();
     if (m_mediaControls) {
-        m_mediaControls->updateMetadata(m_current);
+        m_mediaControls->updateMetadata(m_currentVariant);
     }
+    syncWindow();
     
-    m_api->addToRecentlyPlayed(m_current);
-    m_api->scrobble(m_current.value("id").toString(), true, 0);
+    m_api->addToRecentlyPlayed(m_currentVariant);
+    m_api->scrobble(m_current.id, true, 0);
     updateVolume();
     updateDiscordPresence();
 }
 
-void PlayerController::onEndOfFile() {
-    // Não fazer nada aqui - deixar onPlaylistPosChanged gerenciar
-}
-
 void PlayerController::updateDiscordPresence() {
-    if (m_current.isEmpty()) {
+    if (m_current.id.isEmpty()) {
         m_discord->clearPresence();
         return;
     }
     
-    QString title = m_current.value("title").toString();
-    QString artist = m_current.value("artist").toString();
-    QString album = m_current.value("album").toString();
-    const QString coverArtId = m_current.value("coverArt").toString();
-    const QString coverUrl = m_api->coverArtUrl(coverArtId, 512).toString();
-    const QString trackId = m_current.value("id").toString();
-    
-    m_discord->updatePresence(title, artist, album, playing(), position(), duration(), coverUrl, trackId);
+    const QString coverUrl = m_api->coverArtUrl(m_current.coverArt, 512).toString();
+    m_discord->updatePresence(m_current.title, m_current.artist, m_current.album, playing(), position(), duration(),
+                              coverUrl, m_current.id);
 }
 
-void PlayerController::applyShuffleOrder() {
-    if (!m_shuffleEnabled || m_queue.size() <= 1 || m_index < 0 || m_index >= m_queue.size()) {
-        return;
-    }
-
-    const QVariant currentVariant = m_queue.at(m_index);
-    QVariantList remaining;
-    remaining.reserve(m_queue.size() - 1);
-    for (int i = 0; i < m_queue.size(); ++i) {
-        if (i == m_index) {
-            continue;
+QVariantList PlayerController::queue() const {
+    if (!m_queueCacheValid) {
+        m_queueCache.reserve(m_queue.size());
+        for (const Handle handle : m_queue.order()) {
+            m_queueCache.append(TrackListModel::toVariant(m_queue.track(handle)));
         }
-        remaining.append(m_queue.at(i));
-    }
-
-    for (int i = remaining.size() - 1; i > 0; --i) {
-        const int j = QRandomGenerator::global()->bounded(i + 1);
-        if (i != j) {
-            remaining.swapItemsAt(i, j);
-        }
-    }
-
-    QVariantList shuffled;
-    shuffled.reserve(m_queue.size());
-    shuffled.append(currentVariant);
-    for (const QVariant &entry : remaining) {
-        shuffled.append(entry);
+        m_queueCacheValid = true;
     }
-
-    applyQueueOrder(shuffled, 0);
+    return m_queueCache;
 }
 
-void PlayerController::applyQueueOrder(const QVariantList &newOrder, int newCurrentIndex) {
-    const int newSize = newOrder.size();
-
-    QVector<QString> oldOrderIds;
-    oldOrderIds.reserve(m_queue.size());
-    for (const QVariant &entry : m_queue) {
-        oldOrderIds.append(trackIdFromVariant(entry));
-    }
-
-    QVector<QString> newOrderIds;
-    newOrderIds.reserve(newSize);
-    for (const QVariant &entry : newOrder) {
-        newOrderIds.append(trackIdFromVariant(entry));
-    }
-
-    if (!newOrderIds.isEmpty() && oldOrderIds.size() == newOrderIds.size()) {
-        syncMpvPlaylistOrder(oldOrderIds, newOrderIds);
-    }
-
-    m_queue = newOrder;
-    emit queueChanged();
-
-    if (newSize == 0) {
-        m_index = -1;
-        m_current.clear();
-        emit currentTrackChanged();
-        updateDiscordPresence();
-        return;
-    }
-
-    m_index = qBound(0, newCurrentIndex, newSize - 1);
-    m_current = m_queue[m_index].toMap();
-    emit currentTrackChanged();
-    if (m_mediaControls) {
-        m_mediaControls->updateMetadata(m_current);
-    }
-    updateDiscordPresence();
+// QML reads the current track through many bindings; it is boxed once
+// per change instead of on every read.
+void PlayerController::setCurrent(const TrackEntry &track) {
+    m_current = track;
+    m_currentVariant = track.id.isEmpty() ? QVariantMap() : TrackListModel::toVariant(track);
 }
 
-void PlayerController::syncMpvPlaylistOrder(const QVector<QString> &oldOrderIds, const QVector<QString> &newOrderIds) {
-    if (!m_mpv)
-        return;
-    if (oldOrderIds.size() != newOrderIds.size())
-        return;
-
-    QVector<QString> workingOrder = oldOrderIds;
-
-    for (int target = 0; target < newOrderIds.size(); ++target) {
-        const QString &desiredId = newOrderIds.at(target);
-        if (desiredId.isEmpty())
-            continue;
-
-        const int currentIndex = workingOrder.indexOf(desiredId);
-        if (currentIndex < 0 || currentIndex == target)
-            continue;
-
-        m_mpv->command(QVariantList{
-            QStringLiteral("playlist-move"),
-            QString::number(currentIndex),
-            QString::number(target)
-        });
-
-        const QString movedId = workingOrder.takeAt(currentIndex);
-        workingOrder.insert(target, movedId);
-    }
+void PlayerController::notifyQueueChanged() {
+    m_queueCacheValid = false;
+    m_queueCache.clear();
+    emit queueChanged();
 }
@@ -3,15 +3,20 @@
 #include <QVariant>
 #include <QSettings>
 #include "MpvPlayer.h"
+#include "PlaybackQueue.h"
 
 class SubsonicClient;
 class DiscordRPC;
 class MediaControls;
+class QueueModel;
+class StreamProxy;
 
 class PlayerController : public QObject {
     Q_OBJECT
     Q_PROPERTY(QVariantMap currentTrack READ currentTrack NOTIFY currentTrackChanged)
     Q_PROPERTY(QVariantList queue READ queue NOTIFY queueChanged)
+    // The queue in play order, for list views.
+    Q_PROPERTY(QueueModel *queueModel READ queueModel CONSTANT)
     Q_PROPERTY(bool playing READ playing NOTIFY playingChanged)
     Q_PROPERTY(qint64 position READ position NOTIFY positionChanged)
     Q_PROPERTY(qint64 duration READ duration NOTIFY durationChanged)
@@ -21,11 +26,14 @@ class PlayerController : public QObject {
     Q_PROPERTY(int replayGainMode READ replayGainMode WRITE setReplayGainMode NOTIFY replayGainModeChanged)
     Q_PROPERTY(bool shuffleEnabled READ shuffleEnabled WRITE setShuffleEnabled NOTIFY shuffleEnabledChanged)
     Q_PROPERTY(int repeatMode READ repeatMode WRITE setRepeatMode NOTIFY repeatModeChanged)
+    // Set from the main window; position updates slow down while hidden.
+    Q_PROPERTY(bool windowVisible READ windowVisible WRITE setWindowVisible NOTIFY windowVisibleChanged)
 public:
     explicit PlayerController(SubsonicClient *api, DiscordRPC *discord, QObject *parent=nullptr);
 
-    QVariantMap currentTrack() const { return m_current; }
-    QVariantList queue() const { return m_queue; }
+    QVariantMap currentTrack() const { return m_currentVariant; }
+    QVariantList queue() const;
+    QueueModel *queueModel() const { return m_queueModel; }
     bool playing() const { return !m_mpv->isPaused(); }
     qint64 position() const { return m_mpv->position(); }
     qint64 duration() const { return m_mpv->duration(); }
@@ -41,9 +49,13 @@ public:
     void setShuffleEnabled(bool enabled);
     int repeatMode() const { return m_repeatMode; }
     void setRepeatMode(int mode);
+    bool windowVisible() const { return m_windowVisible; }
+    void setWindowVisible(bool visible);
 
     Q_INVOKABLE void playAlbum(const QVariantList& tracks, int index = 0);
     Q_INVOKABLE void addToQueue(const QVariantMap& track);
+    // One queue update for many tracks.
+    Q_INVOKABLE void appendToQueue(const QVariantList& tracks);
     Q_INVOKABLE void next();
     Q_INVOKABLE void previous();
     Q_INVOKABLE void toggle();
@@ -75,33 +87,61 @@ signals:
     void replayGainModeChanged();
     void shuffleEnabledChanged();
     void repeatModeChanged();
+    void windowVisibleChanged();
 
 private slots:
-    void onEndOfFile();
-    void onPlaylistPosChanged(int pos);
+    void onFileStarted(quint64 tag);
 
 private:
+    // mpv only holds the current track and a few around it; see syncWindow().
+    using Handle = PlaybackQueue::Handle;
+    struct WindowEntry {
+        quint64 tag;
+        Handle handle;
+    };
+
+    void playTracks(const TrackList& tracks, int index);
+    void setCurrent(const TrackEntry &track);
     void rebuildPlaylist();
+    void loadWindow();
+    void syncWindow();
+    QList<Handle> windowHandles() const;
+    void updateWindowLoop();
+    void updateReadAhead();
+    void appendWindowEntry(Handle handle);
+    void removeWindowEntry(int windowIndex);
+    int windowIndexOf(Handle handle) const;
+    int nextQueueIndex(int index) const;
+    void notifyQueueChanged();
     void updateVolume();
+    void updatePositionInterval();
     void updateDiscordPresence();
-    void applyShuffleOrder();
-    void applyQueueOrder(const QVariantList &newOrder, int newCurrentIndex);
-    void syncMpvPlaylistOrder(const QVector<QString> &oldOrderIds, const QVector<QString> &newOrderIds);
 
     SubsonicClient *m_api;
     MpvPlayer *m_mpv;
     DiscordRPC *m_discord;
     MediaControls *m_mediaControls;
+    StreamProxy *m_proxy;
     
     int m_index = -1;
-    QVariantList m_queue;
-    QVariantMap m_current;
+    PlaybackQueue m_queue;
+    QueueModel *m_queueModel;
+    // Built for QML on first read after a change.
+    mutable QVariantList m_queueCache;
+    mutable bool m_queueCacheValid = false;
+    TrackEntry m_current;
+    QVariantMap m_currentVariant;  // m_current for QML
     qreal m_volume = 1.0;
     bool m_muted = false;
     bool m_replayGainEnabled = true;
     int m_replayGainMode = 1;
-    int m_lastPlaylistPos = -1;
     bool m_shuffleEnabled = false;
     int m_repeatMode = RepeatOff;
-    QVariantList m_originalQueue;
+    QList<WindowEntry> m_window;  // mpv's playlist, in order
+    int m_windowPos = -1;         // entry mpv was last told to play
+    bool m_windowLoops = false;   // loop-playlist is on
+    quint64 m_nextWindowTag = 0;
+    bool m_windowVisible = true;
+    int m_visiblePositionInterval = 16;
+    int m_hiddenPositionInterval = 1000;
 };
@@ -0,0 +1,71 @@
+#include "QueueModel.h"
+
+QueueModel::QueueModel(const PlaybackQueue *queue, QObject *parent)
+    : LibraryListModel(parent), m_queue(queue) {
+}
+
+int QueueModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : m_queue->size();
+}
+
+QVariant QueueModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= m_queue->size()) return {};
+    const TrackEntry &track = m_queue->trackAt(index.row());
+    switch (role) {
+    case IdRole:
+        return track.id;
+    case TitleRole:
+    case Qt::DisplayRole:
+        return track.title;
+    case ArtistRole:
+        return track.artist;
+    case AlbumRole:
+        return track.album;
+    case CoverArtRole:
+        return track.coverArt;
+    case DurationRole:
+        return track.duration;
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> QueueModel::roleNames() const {
+    return {
+        {IdRole, "id"},
+        {TitleRole, "title"},
+        {ArtistRole, "artist"},
+        {AlbumRole, "album"},
+        {CoverArtRole, "coverArt"},
+        {DurationRole, "duration"},
+    };
+}
+
+QVariantMap QueueModel::get(int row) const {
+    if (row < 0 || row >= m_queue->size()) return {};
+    return TrackListModel::toVariant(m_queue->trackAt(row));
+}
+
+void QueueModel::beginAppend(int count) {
+    beginInsertRows(QModelIndex(), m_queue->size(), m_queue->size() + count - 1);
+}
+
+void QueueModel::endAppend() {
+    endInsertRows();
+}
+
+void QueueModel::beginRemove(int row) {
+    beginRemoveRows(QModelIndex(), row, row);
+}
+
+void QueueModel::endRemove() {
+    endRemoveRows();
+}
+
+void QueueModel::beginReset() {
+    beginResetModel();
+}
+
+void QueueModel::endReset() {
+    endResetModel();
+}
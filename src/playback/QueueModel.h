@@ -0,0 +1,37 @@
+#pragma once
+#include "../core/LibraryModels.h"
+#include "PlaybackQueue.h"
+
+// The play queue for QML list views, read straight from PlaybackQueue in
+// play order. Nothing is copied per row, and switching shuffle is one
+// reset rather than a rebuilt list.
+class QueueModel : public LibraryListModel {
+    Q_OBJECT
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1,
+        TitleRole,
+        ArtistRole,
+        AlbumRole,
+        CoverArtRole,
+        DurationRole
+    };
+
+    explicit QueueModel(const PlaybackQueue *queue, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    QVariantMap get(int row) const override;
+
+    // Called by the player around each change to the queue.
+    void beginAppend(int count);
+    void endAppend();
+    void beginRemove(int row);
+    void endRemove();
+    void beginReset();
+    void endReset();
+
+private:
+    const PlaybackQueue *m_queue;
+};
@@ -0,0 +1,466 @@
+#include "StreamProxy.h"
+#include "../core/CacheManager.h"
+#include "../core/RequestScheduler.h"
+#include "../core/SubsonicClient.h"
+#include <QDebug>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QSettings>
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace {
+// Cap on audio's share; CacheManager's overall budget may evict it sooner.
+constexpr qint64 DEFAULT_CACHE_LIMIT = 2LL * 1024 * 1024 * 1024;
+constexpr int DEFAULT_READ_AHEAD = 2;
+// Bytes queued on a socket before more is read from disk or the server.
+constexpr qint64 CLIENT_BUFFER = 256 * 1024;
+constexpr qint64 CHUNK = 64 * 1024;
+// A range starting this far past what has been downloaded is fetched from
+// the server instead of waiting for the download to get there.
+constexpr qint64 SEEK_WAIT_BYTES = 1024 * 1024;
+constexpr int MAX_REQUEST_BYTES = 16 * 1024;
+// mpv reconnects for every seek, so a download nobody is reading is only
+// dropped after this long.
+constexpr int IDLE_DOWNLOAD_MS = 5000;
+
+QByteArray reasonPhrase(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 416: return "Range Not Satisfiable";
+    default: return "Bad Gateway";
+    }
+}
+
+// Subsonic reports errors, an expired login included, as 200 with an XML
+// or JSON body; none of that may end up in the cache.
+bool isAudioResponse(const QNetworkReply *reply) {
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status != 200 && status != 206) return false;
+    const QByteArray type = reply->rawHeader("Content-Type").trimmed().toLower();
+    return !type.startsWith("text/") && !type.contains("xml") && !type.contains("json");
+}
+}
+
+StreamProxy::StreamProxy(SubsonicClient *api, QObject *parent)
+    : QObject(parent), m_api(api), m_scheduler(new RequestScheduler(&m_nam, this)),
+      m_cache(CacheManager::audioCacheDirectory(),
+              QSettings().value("cache/audioLimitBytes", DEFAULT_CACHE_LIMIT).toLongLong()) {
+    m_nam.setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+    m_readAhead = qMax(0, QSettings().value("player/readAheadTracks", DEFAULT_READ_AHEAD).toInt());
+    m_token = QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+    connect(&m_server, &QTcpServer::newConnection, this, &StreamProxy::onNewConnection);
+    if (!m_server.listen(QHostAddress::LocalHost)) {
+        qWarning() << "StreamProxy: not listening, streaming from the server:" << m_server.errorString();
+    }
+}
+
+StreamProxy::~StreamProxy() {
+    m_server.close();
+    // Finished downloads still being read are committed here.
+    const auto clients = m_clients.values();
+    for (Client *client : clients) closeClient(client);
+    const auto downloads = m_downloads.values();
+    for (Download *download : downloads) failDownload(download);
+}
+
+QUrl StreamProxy::streamUrl(const QString &songId) const {
+    if (!m_server.isListening()) return m_api->streamUrl(songId);
+    return QUrl(QStringLiteral("http://127.0.0.1:%1/%2/%3")
+                    .arg(m_server.serverPort())
+                    .arg(QString::fromLatin1(m_token), QString::fromLatin1(QUrl::toPercentEncoding(songId))));
+}
+
+QString StreamProxy::cacheKey(const QString &songId) const {
+    return m_api->serverUrl() + QLatin1Char('\n') + songId;
+}
+
+void StreamProxy::prefetch(const QStringList &songIds) {
+    if (!m_server.isListening()) return;
+    m_wanted.clear();
+    for (const QString &id : songIds) {
+        m_wanted.insert(cacheKey(id));
+    }
+    const auto downloads = m_downloads.values();
+    for (Download *download : downloads) {
+        if (!download->done && download->clients.isEmpty() && !m_wanted.contains(download->key)) {
+            failDownload(download);
+        }
+    }
+    for (const QString &id : songIds) {
+        const QString key = cacheKey(id);
+        if (!m_downloads.contains(key) && !m_cache.contains(key)) startDownload(id, true);
+    }
+}
+
+void StreamProxy::onNewConnection() {
+    while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+        auto *client = new Client;
+        client->socket = socket;
+        m_clients.insert(socket, client);
+        connect(socket, &QTcpSocket::readyRead, this, [this, client]() { readRequest(client); });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, client]() { pump(client); });
+        // Queued: disconnectFromHost() can emit it while a download is
+        // still walking its readers.
+        connect(socket, &QTcpSocket::disconnected, this, [this, client]() { closeClient(client); },
+                Qt::QueuedConnection);
+    }
+}
+
+// GET or HEAD /<token>/<song id>, with at most a "Range: bytes=a-[b]"
+// header, which is all mpv sends.
+void StreamProxy::readRequest(Client *client) {
+    if (client->received) {
+        client->socket->readAll();
+        return;
+    }
+    client->request += client->socket->readAll();
+    const int headerEnd = client->request.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (client->request.size() > MAX_REQUEST_BYTES) sendError(client, 400);
+        return;
+    }
+    client->received = true;
+    const QList<QByteArray> lines = client->request.left(headerEnd).split('\n');
+    client->request.clear();
+
+    const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+    if (requestLine.size() < 2) {
+        sendError(client, 400);
+        return;
+    }
+    if (requestLine.at(0) != "GET" && requestLine.at(0) != "HEAD") {
+        sendError(client, 405);
+        return;
+    }
+    client->head = requestLine.at(0) == "HEAD";
+    const QList<QByteArray> path = requestLine.at(1).split('/');
+    if (path.size() != 3 || path.at(1) != m_token || path.at(2).isEmpty()) {
+        sendError(client, 404);
+        return;
+    }
+
+    for (int i = 1; i < lines.size(); ++i) {
+        const QByteArray line = lines.at(i).trimmed();
+        if (!line.toLower().startsWith("range:")) continue;
+        const QByteArray spec = line.mid(6).trimmed();
+        if (!spec.startsWith("bytes=")) continue;
+        const QList<QByteArray> bounds = spec.mid(6).split('-');
+        bool ok = false;
+        const qint64 start = bounds.value(0).toLongLong(&ok);
+        if (!ok || bounds.size() != 2) continue;
+        client->ranged = true;
+        client->start = start;
+        const qint64 last = bounds.at(1).toLongLong(&ok);
+        client->last = ok ? last : -1;
+    }
+
+    client->songId = QString::fromUtf8(QByteArray::fromPercentEncoding(path.at(2)));
+    serve(client);
+}
+
+void StreamProxy::serve(Client *client) {
+    client->key = cacheKey(client->songId);
+    if (const auto cached = m_cache.find(client->key)) {
+        client->file.setFileName(cached->path);
+        client->contentType = cached->contentType;
+        if (client->file.open(QIODevice::ReadOnly)) {
+            respond(client);
+            return;
+        }
+    }
+
+    Download *download = m_downloads.value(client->key);
+    if (!download) {
+        download = startDownload(client->songId, false);
+    } else if (download->background) {
+        download->background = false;
+        if (download->reply) m_scheduler->promote(download->reply, RequestPriority::Visible);
+    }
+    if (!download) {
+        // Nowhere to write it; stream without caching.
+        passThrough(client);
+        return;
+    }
+    client->download = download;
+    download->clients.append(client);
+    if (download->started) respond(client);
+}
+
+// Answers from the cached file or the download's part file, once the
+// download knows what it is fetching.
+void StreamProxy::respond(Client *client) {
+    Download *download = client->download;
+    qint64 total = client->file.size();
+    if (download) {
+        const bool lengthKnown = download->done || download->total >= 0;
+        if (client->start > 0 && (!lengthKnown || client->start > download->written + SEEK_WAIT_BYTES)) {
+            passThrough(client);
+            return;
+        }
+        client->contentType = download->contentType;
+        client->file.setFileName(m_cache.partPath(download->key));
+        if (!client->file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            sendError(client, 502);
+            return;
+        }
+        total = download->done ? download->written : download->total;
+    }
+
+    if (total >= 0 && client->ranged
+        && ((client->start > 0 && client->start >= total) || (client->last >= 0 && client->last < client->start))) {
+        sendHeaders(client, 416, "Content-Range: bytes */" + QByteArray::number(total) + "\r\n");
+        client->socket->disconnectFromHost();
+        return;
+    }
+
+    QByteArray headers = "Content-Type: "
+        + (client->contentType.isEmpty() ? QByteArray("application/octet-stream") : client->contentType) + "\r\n";
+    client->position = client->start;
+    if (total < 0) {
+        // Sent until the download ends.
+        client->end = -1;
+        sendHeaders(client, 200, headers);
+    } else {
+        client->end = client->last >= 0 ? qMin(client->last + 1, total) : total;
+        headers += "Accept-Ranges: bytes\r\nContent-Length: " + QByteArray::number(client->end - client->start) + "\r\n";
+        if (client->ranged) {
+            headers += "Content-Range: bytes " + QByteArray::number(client->start) + '-'
+                + QByteArray::number(client->end - 1) + '/' + QByteArray::number(total) + "\r\n";
+            sendHeaders(client, 206, headers);
+        } else {
+            sendHeaders(client, 200, headers);
+        }
+    }
+    pump(client);
+}
+
+// Straight from the server, bypassing the cache, for one request.
+void StreamProxy::passThrough(Client *client) {
+    if (Download *download = client->download) {
+        download->clients.removeOne(client);
+        client->download = nullptr;
+        releaseDownload(download);
+    }
+    client->file.close();
+
+    QNetworkRequest request(m_api->streamUrl(client->songId));
+    if (client->ranged) {
+        QByteArray range = "bytes=" + QByteArray::number(client->start) + '-';
+        if (client->last >= 0) range += QByteArray::number(client->last);
+        request.setRawHeader("Range", range);
+    }
+    QNetworkReply *reply = m_nam.get(request);
+    reply->setReadBufferSize(CLIENT_BUFFER);
+    client->passthrough = reply;
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, client, reply]() {
+        if (client->responding) return;
+        if (!isAudioResponse(reply)) {
+            sendError(client, 502);
+            return;
+        }
+        QByteArray headers;
+        for (const char *name : {"Content-Type", "Content-Length", "Content-Range", "Accept-Ranges"}) {
+            if (reply->hasRawHeader(name)) headers += QByteArray(name) + ": " + reply->rawHeader(name) + "\r\n";
+        }
+        sendHeaders(client, reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), headers);
+    });
+    connect(reply, &QNetworkReply::readyRead, this, [this, client]() { pump(client); });
+    connect(reply, &QNetworkReply::finished, this, [this, client]() {
+        if (!client->responding) {
+            sendError(client, 502);
+            return;
+        }
+        pump(client);
+    });
+}
+
+void StreamProxy::sendHeaders(Client *client, int status, const QByteArray &headers) {
+    client->responding = true;
+    if (client->socket->state() != QAbstractSocket::ConnectedState) return;
+    client->socket->write("HTTP/1.1 " + QByteArray::number(status) + ' ' + reasonPhrase(status) + "\r\n"
+                          "Connection: close\r\n" + headers + "\r\n");
+    if (client->head) client->socket->disconnectFromHost();
+}
+
+void StreamProxy::sendError(Client *client, int status) {
+    if (!client->responding) sendHeaders(client, status, "Content-Length: 0\r\n");
+    client->socket->disconnectFromHost();
+}
+
+// Moves what is available to the socket while it has room, called again
+// as the socket drains and as the download grows.
+void StreamProxy::pump(Client *client) {
+    QTcpSocket *socket = client->socket;
+    if (!client->responding || client->head || socket->state() != QAbstractSocket::ConnectedState) return;
+    if (QNetworkReply *reply = client->passthrough) {
+        while (socket->bytesToWrite() < CLIENT_BUFFER && reply->bytesAvailable() > 0) {
+            socket->write(reply->read(CHUNK));
+        }
+        if (reply->isFinished() && reply->bytesAvailable() == 0) socket->disconnectFromHost();
+        return;
+    }
+    if (!client->file.isOpen()) return;
+
+    Download *download = client->download;
+    const qint64 available = download ? download->written : client->file.size();
+    const qint64 end = client->end >= 0 ? qMin(client->end, available) : available;
+    if (client->position < end && !client->file.seek(client->position)) {
+        socket->disconnectFromHost();
+        return;
+    }
+    while (socket->bytesToWrite() < CLIENT_BUFFER && client->position < end) {
+        const QByteArray data = client->file.read(qMin(CHUNK, end - client->position));
+        if (data.isEmpty()) break;
+        client->position += data.size();
+        socket->write(data);
+    }
+    const bool complete = client->end >= 0 ? client->position >= client->end
+                                           : (!download || download->done) && client->position >= available;
+    if (complete) socket->disconnectFromHost();
+}
+
+void StreamProxy::closeClient(Client *client) {
+    disconnect(client->socket, nullptr, this, nullptr);
+    m_clients.remove(client->socket);
+    client->socket->deleteLater();
+    if (QNetworkReply *reply = client->passthrough) {
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+    client->file.close();
+    Download *download = client->download;
+    if (download) download->clients.removeOne(client);
+    delete client;
+    if (download) releaseDownload(download);
+}
+
+StreamProxy::Download *StreamProxy::startDownload(const QString &songId, bool background) {
+    auto *download = new Download;
+    download->key = cacheKey(songId);
+    download->background = background;
+    download->file.setFileName(m_cache.partPath(download->key));
+    if (!download->file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "StreamProxy: cannot write" << download->file.fileName() << download->file.errorString();
+        delete download;
+        return nullptr;
+    }
+    QNetworkReply *reply = m_scheduler->get(QNetworkRequest(m_api->streamUrl(songId)),
+                                            background ? RequestPriority::Prefetch : RequestPriority::Visible, this);
+    download->reply = reply;
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, download]() { onDownloadMetaData(download); });
+    connect(reply, &QNetworkReply::readyRead, this, [this, download]() { onDownloadData(download); });
+    connect(reply, &QNetworkReply::finished, this, [this, download]() { onDownloadFinished(download); });
+    m_downloads.insert(download->key, download);
+    return download;
+}
+
+void StreamProxy::onDownloadMetaData(Download *download) {
+    if (download->started) return;
+    if (!isAudioResponse(download->reply)) {
+        failDownload(download);
+        return;
+    }
+    download->started = true;
+    download->contentType = download->reply->rawHeader("Content-Type");
+    bool ok = false;
+    const qint64 length = download->reply->rawHeader("Content-Length").toLongLong(&ok);
+    download->total = ok ? length : -1;
+    const auto clients = download->clients;
+    for (Client *client : clients) respond(client);
+}
+
+// Tees what arrived into the part file; false if the download was dropped.
+bool StreamProxy::onDownloadData(Download *download) {
+    if (!download->started) return true;
+    const QByteArray data = download->reply->readAll();
+    if (data.isEmpty()) return true;
+    // Flushed right away: readers open the same file.
+    if (download->file.write(data) != data.size() || !download->file.flush()) {
+        failDownload(download);
+        return false;
+    }
+    download->written += data.size();
+    const auto clients = download->clients;
+    for (Client *client : clients) pump(client);
+    return true;
+}
+
+void StreamProxy::onDownloadFinished(Download *download) {
+    QNetworkReply *reply = download->reply;
+    if (!reply) return;
+    if (reply->error() != QNetworkReply::NoError || !download->started) {
+        failDownload(download);
+        return;
+    }
+    if (!onDownloadData(download)) return;
+    if (download->total >= 0 && download->written != download->total) {
+        failDownload(download);
+        return;
+    }
+    download->reply = nullptr;
+    reply->deleteLater();
+    download->file.close();
+    download->done = true;
+    download->total = download->written;
+    const auto clients = download->clients;
+    for (Client *client : clients) pump(client);
+    releaseDownload(download);
+}
+
+// Readers that got no answer yet get an error; the others are cut off.
+void StreamProxy::failDownload(Download *download) {
+    m_downloads.remove(download->key);
+    if (QNetworkReply *reply = download->reply) {
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+    const auto clients = download->clients;
+    for (Client *client : clients) {
+        client->download = nullptr;
+        client->file.close();
+        sendError(client, 502);
+    }
+    download->file.close();
+    // Left behind if a reader still has it open; removed on the next start.
+    QFile::remove(download->file.fileName());
+    delete download;
+}
+
+// Called when a reader leaves or the download ends. A complete download
+// goes into the cache once nothing reads the part file any more, since an
+// open file cannot be renamed everywhere.
+void StreamProxy::releaseDownload(Download *download) {
+    if (!download->clients.isEmpty()) return;
+    if (download->done) {
+        m_downloads.remove(download->key);
+        m_cache.commit(download->key, download->contentType);
+        delete download;
+        m_cache.trim(keysInUse());
+        return;
+    }
+    if (m_wanted.contains(download->key)) return;
+    const QString key = download->key;
+    QTimer::singleShot(IDLE_DOWNLOAD_MS, this, [this, key]() {
+        Download *idle = m_downloads.value(key);
+        if (idle && !idle->done && idle->clients.isEmpty() && !m_wanted.contains(key)) failDownload(idle);
+    });
+}
+
+QSet<QString> StreamProxy::keysInUse() const {
+    QSet<QString> keys;
+    for (const Client *client : m_clients) {
+        keys.insert(client->key);
+    }
+    for (auto it = m_downloads.cbegin(); it != m_downloads.cend(); ++it) {
+        keys.insert(it.key());
+    }
+    return keys;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+#include <QTcpServer>
+#include <QUrl>
+#include "AudioCache.h"
+
+class QNetworkReply;
+class QTcpSocket;
+class RequestScheduler;
+class SubsonicClient;
+
+// Local HTTP server mpv streams from instead of the Subsonic server. A
+// track is fetched from the server once and written to an AudioCache as
+// it is served, so replaying it, seeking back or going to the previous
+// track reads from disk. Range requests are answered from the file as far
+// as it has been written; a seek well past that is passed through to the
+// server for that one request. prefetch() downloads upcoming tracks in the
+// background.
+class StreamProxy : public QObject {
+    Q_OBJECT
+public:
+    explicit StreamProxy(SubsonicClient *api, QObject *parent = nullptr);
+    ~StreamProxy() override;
+
+    // URL mpv should open for the track; the server's own if the proxy
+    // could not listen.
+    QUrl streamUrl(const QString &songId) const;
+    // Tracks to keep ready, the one playing first. Downloads of tracks no
+    // longer listed stop once nothing is reading them.
+    void prefetch(const QStringList &songIds);
+    // How many tracks after the current one prefetch() should be given.
+    int readAhead() const { return m_readAhead; }
+
+private:
+    struct Client;
+
+    struct Download {
+        QString key;
+        QPointer<QNetworkReply> reply;
+        QFile file;               // the cache's part file
+        qint64 written = 0;
+        qint64 total = -1;        // -1 while unknown; transcoded streams never say
+        QByteArray contentType;
+        bool started = false;     // the server answered with audio
+        bool done = false;
+        bool background = true;   // only prefetch() wants it
+        QList<Client *> clients;
+    };
+
+    struct Client {
+        QTcpSocket *socket = nullptr;
+        QByteArray request;
+        bool received = false;    // one request per connection
+        bool head = false;
+        QString songId;
+        QString key;
+        qint64 start = 0;
+        qint64 last = -1;         // last byte asked for, -1 for the end
+        bool ranged = false;
+        bool responding = false;  // status line sent
+        qint64 position = 0;
+        qint64 end = -1;          // one past the last byte to send, -1 while unknown
+        QByteArray contentType;
+        Download *download = nullptr;
+        QFile file;               // a whole cached file or a download's part
+        QPointer<QNetworkReply> passthrough;
+    };
+
+    void onNewConnection();
+    void readRequest(Client *client);
+    void serve(Client *client);
+    void respond(Client *client);
+    void passThrough(Client *client);
+    void sendHeaders(Client *client, int status, const QByteArray &headers);
+    void sendError(Client *client, int status);
+    void pump(Client *client);
+    void closeClient(Client *client);
+
+    Download *startDownload(const QString &songId, bool background);
+    void onDownloadMetaData(Download *download);
+    bool onDownloadData(Download *download);
+    void onDownloadFinished(Download *download);
+    void failDownload(Download *download);
+    void releaseDownload(Download *download);
+    QSet<QString> keysInUse() const;
+
+    QString cacheKey(const QString &songId) const;
+
+    SubsonicClient *m_api;
+    QTcpServer m_server;
+    QNetworkAccessManager m_nam;
+    RequestScheduler *m_scheduler;
+    AudioCache m_cache;
+    QByteArray m_token;  // first path segment; keeps other local users out
+    int m_readAhead;
+    QHash<QString, Download *> m_downloads;  // by key
+    QHash<QTcpSocket *, Client *> m_clients;
+    QSet<QString> m_wanted;  // keys given to prefetch()
+};